@@ -103,6 +103,10 @@ public:
      *  steering adjustments. */
     float m_network_steering_reduction;
 
+    /** Time in seconds of states and events the rewind queue preallocates
+     *  room for. */
+    float m_rewind_horizon;
+
     /** If the angle between a normal on a vertex and the normal of the
      *  triangle are more than this value, the physics will use the normal
      *  of the triangle in smoothing normal. */
@@ -786,6 +786,9 @@ namespace UserConfigParams
     /** If unit testing is enabled. */
     PARAM_PREFIX bool m_unit_testing PARAM_DEFAULT(false);
 
+    /** If micro benchmarks are to be run. */
+    PARAM_PREFIX bool m_micro_benchmark PARAM_DEFAULT(false);
+
     /** If gamepad debugging is enabled. */
     PARAM_PREFIX bool m_gamepad_debug PARAM_DEFAULT( false );
 
@@ -1340,6 +1343,12 @@ namespace UserConfigParams
                                                "wasn't asked, 1: allowed, 2: "
                                                "not allowed") );
 
+    PARAM_PREFIX IntUserConfigParam        m_max_concurrent_requests
+            PARAM_DEFAULT(  IntUserConfigParam(4, "max_concurrent_requests",
+                                               "Number of http requests that "
+                                               "are transferred at the same "
+                                               "time.") );
+
     PARAM_PREFIX GroupUserConfigParam       m_hw_report_group
             PARAM_DEFAULT( GroupUserConfigParam("HWReport",
                                           "Everything related to hardware configuration.") );
@@ -1425,6 +1434,12 @@ namespace UserConfigParams
                         "Enable all karts and tracks: 0 = disabled, "
                         "1 = everything except final race, 2 = everything") );
 
+    PARAM_PREFIX IntUserConfigParam         m_worker_threads
+            PARAM_DEFAULT( IntUserConfigParam(-1, "worker_threads",
+                        "Number of threads helping the main thread, e.g. to "
+                        "update AI karts: -1 = number of cores minus one, "
+                        "0 = none") );
+
     PARAM_PREFIX StringUserConfigParam      m_commandline
             PARAM_DEFAULT( StringUserConfigParam("", "commandline",
                              "Allows one to set commandline args in config file") );
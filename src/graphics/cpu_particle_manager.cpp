@@ -23,6 +23,7 @@
 #include "graphics/material.hpp"
 #include "graphics/material_manager.hpp"
 #include "utils/log.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <algorithm>
 
@@ -245,17 +246,40 @@ void CPUParticleManager::addBillboardNode(scene::IBillboardSceneNode* node)
 }   // addBillboardNode
 
 // ----------------------------------------------------------------------------
+/** Simulates all particle emitters and fills the per material buffers.
+ *  Each emitter only changes its own data, so the emitters are generated in
+ *  parallel into their own buffers. These are then appended in the order of
+ *  the queue, so the result is the same as generating them one by one.
+ */
 void CPUParticleManager::generateAll()
 {
+    m_emitters.clear();
+    for (auto& p : m_particles_queue)
+    {
+        m_emitters.insert(m_emitters.end(), p.second.begin(), p.second.end());
+    }
+    if (m_emitter_particles.size() < m_emitters.size())
+        m_emitter_particles.resize(m_emitters.size());
+    WorkerPool::parallelFor((unsigned int)m_emitters.size(),
+        [this](unsigned int i)
+        {
+            m_emitter_particles[i].clear();
+            m_emitters[i]->generate(&m_emitter_particles[i]);
+        });
+
+    unsigned int emitter = 0;
     for (auto& p : m_particles_queue)
     {
         if (p.second.empty())
         {
             continue;
         }
-        for (auto& q : p.second)
+        std::vector<CPUParticle>& generated = m_particles_generated[p.first];
+        for (unsigned int i = 0; i < p.second.size(); i++, emitter++)
         {
-            q->generate(&m_particles_generated[p.first]);
+            generated.insert(generated.end(),
+                m_emitter_particles[emitter].begin(),
+                m_emitter_particles[emitter].end());
         }
         if (isFlipsMaterial(p.first))
         {
@@ -84,6 +84,12 @@ private:
     std::unordered_map<std::string, std::vector<CPUParticle> >
         m_particles_generated;
 
+    /** All emitters of the current frame in the order of m_particles_queue,
+     *  each one is generated into its own buffer in m_emitter_particles. */
+    std::vector<STKParticle*> m_emitters;
+
+    std::vector<std::vector<CPUParticle> > m_emitter_particles;
+
     std::unordered_map<std::string, std::unique_ptr<GLParticle> >
         m_gl_particles;
 
@@ -39,6 +39,8 @@
 #include "utils/constants.hpp"
 #include "mini_glm.hpp"
 
+#include <algorithm>
+
 #include <IMeshCache.h>
 #include <ISceneManager.h>
 #include <SMeshBuffer.h>
@@ -62,6 +64,7 @@ const char* g_slipstream_textures[3] =
 SlipStream::SlipStream(AbstractKart* kart)
 {
     m_speed_increase_ticks = m_speed_increase_duration = -1;
+    m_has_candidates = false;
     m_kart = kart;
     m_moving = NULL;
     m_moving_fast = NULL;
@@ -846,12 +849,101 @@ void SlipStream::hideAllNodes()
 #endif
 }   // hideAllNodes
 
+//-----------------------------------------------------------------------------
+/** Broad phase for the slipstream of all karts, called once per time step
+ *  before the karts are updated. For each kart it finds the karts which can
+ *  pass the quick distance test in update(), so update() only needs to test
+ *  those. It uses the snapshot of the karts after the last physics step,
+ *  with a margin for what changes while the karts are updated: the karts
+ *  are moved to the position of their physics body, and their speed is
+ *  computed again from its velocity (or increased by a zipper).
+ *  \param world The world with all karts.
+ */
+void SlipStream::findCandidates(World *world)
+{
+    const KartSnapshot &snapshot = world->getKartSnapshot();
+    const unsigned int num_karts = snapshot.size();
+
+    // Upper limit of the length used in the quick distance test in
+    // update() for each kart as target (without half the kart length of
+    // the slipstreaming kart).
+    std::vector<float> reach(num_karts);
+    std::vector<unsigned int> order(num_karts);
+    float max_reach       = 0.0f;
+    float max_deviation   = 0.0f;
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        const AbstractKart *kart = world->getKart(i);
+        const KartProperties *kp = kart->getKartProperties();
+        float speed = std::max(fabsf(snapshot.getSpeed(i)),
+                               snapshot.getVelocity(i).length());
+        speed = std::max(speed, kart->getCurrentMaxSpeed())*1.1f + 5.0f;
+        reach[i] = kp->getSlipstreamLength()*1.1f
+                 * speed/kp->getSlipstreamBaseSpeed()
+                 + kart->getKartLength();
+        max_reach = std::max(max_reach, reach[i]);
+        // Karts which are not updated yet are still at their old position
+        const float deviation =
+            (kart->getXYZ() - snapshot.getXYZ(i)).length();
+        max_deviation = std::max(max_deviation, deviation);
+        order[i] = i;
+    }
+    // The slipstreaming kart itself can be moved by up to 0.5, see update()
+    const float margin = 2.0f*max_deviation + 1.0f;
+
+    // Sort the karts along the x axis, so each kart only needs to look
+    // at the karts in a small x range
+    std::sort(order.begin(), order.end(),
+              [&snapshot](unsigned int a, unsigned int b)
+              {
+                  return snapshot.getXYZ(a).getX() < snapshot.getXYZ(b).getX();
+              });
+
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        AbstractKart *kart = world->getKart(i);
+        SlipStream *slipstream = kart->getSlipstream();
+        if (!slipstream)
+            continue;
+        slipstream->m_candidates.clear();
+        slipstream->m_has_candidates = true;
+
+        const Vec3 xyz = snapshot.getXYZ(i);
+        const float half_length = 0.5f*kart->getKartLength();
+        const float min_x = xyz.getX() - (max_reach + half_length + margin);
+        const float max_x = xyz.getX() + (max_reach + half_length + margin);
+        std::vector<unsigned int>::const_iterator first =
+            std::lower_bound(order.begin(), order.end(), min_x,
+                             [&snapshot](unsigned int a, float x)
+                             {
+                                 return snapshot.getXYZ(a).getX() < x;
+                             });
+        for (std::vector<unsigned int>::const_iterator it = first;
+             it != order.end(); it++)
+        {
+            const unsigned int j = *it;
+            const Vec3 other_xyz = snapshot.getXYZ(j);
+            if (other_xyz.getX() > max_x)
+                break;
+            if (j == i)
+                continue;
+            const float r = reach[j] + half_length + margin;
+            if ((other_xyz - xyz).length2() <= r*r)
+                slipstream->m_candidates.push_back(j);
+        }
+        std::sort(slipstream->m_candidates.begin(),
+                  slipstream->m_candidates.end());
+    }
+}   // findCandidates
+
 //-----------------------------------------------------------------------------
 /** Update, called once per timestep.
  *  \param dt Time step size.
  */
 void SlipStream::update(int ticks)
 {
+    const bool has_candidates = m_has_candidates;
+    m_has_candidates = false;
     const KartProperties *kp = m_kart->getKartProperties();
 
     // Low level AIs and ghost karts should not do any slipstreaming.
@@ -918,15 +1010,34 @@ void SlipStream::update(int ticks)
     bool is_inner_sstreaming = false;
     bool is_outer_sstreaming = false;
     m_target_kart            = NULL;
-    std::vector<float> target_value;
+    std::vector<float> target_value(num_karts, 0.0f);
 
     // Note that this loop can not be simply replaced with a shorter loop
     // using only the karts with a better position - since a kart might
-    // be a lap behind
-    for(unsigned int i=0; i<num_karts; i++)
+    // be a lap behind. But it is enough to test the karts found close
+    // enough by findCandidates, plus the previous target, which must be
+    // reset if it does not give slipstream anymore. The debug colours are
+    // set for all karts.
+    const bool use_candidates = has_candidates &&
+        !UserConfigParams::m_slipstream_debug &&
+        (m_kart->getXYZ() - world->getKartSnapshot()
+                                 .getXYZ(m_kart->getWorldKartId())).length2()
+        <= 0.25f;
+    if (use_candidates && m_previous_target_id >= 0)
     {
+        std::vector<unsigned int>::iterator it =
+            std::lower_bound(m_candidates.begin(), m_candidates.end(),
+                             (unsigned int)m_previous_target_id);
+        if (it == m_candidates.end() || *it != (unsigned)m_previous_target_id)
+            m_candidates.insert(it, m_previous_target_id);
+    }
+    const unsigned int num_tests = use_candidates
+                                 ? (unsigned int)m_candidates.size()
+                                 : num_karts;
+    for(unsigned int n=0; n<num_tests; n++)
+    {
+        const unsigned int i = use_candidates ? m_candidates[n] : n;
         m_target_kart= world->getKart(i);
-        target_value.push_back(0);
 
         // Don't test for slipstream with itself, a kart that is being
         // rescued or exploding, a ghost kart or an eliminated kart
@@ -1022,7 +1133,12 @@ void SlipStream::update(int ticks)
             is_outer_sstreaming     = true;
             continue;
         }
-    }   // for i < num_karts
+    }   // for n < num_tests
+
+    // Testing all karts leaves the last kart as target if none is
+    // selected below
+    if (num_karts > 0)
+        m_target_kart = world->getKart(num_karts - 1);
 
     int best_target=-1;
     float best_target_value=0.0f;
@@ -36,10 +36,12 @@ namespace SP
 #include "graphics/moving_texture.hpp"
 #include "utils/no_copy.hpp"
 #include <memory>
+#include <vector>
 
 class AbstractKart;
 class Quad;
 class Material;
+class World;
 
 /**
   * \ingroup graphics
@@ -97,6 +99,13 @@ private:
     int          m_speed_increase_ticks;
     int          m_speed_increase_duration;
 
+    /** Indices of the karts which are close enough to give slipstream to
+     *  this kart in this time step, sorted by index (see findCandidates). */
+    std::vector<unsigned int> m_candidates;
+
+    /** True if m_candidates were found for the current time step. */
+    bool         m_has_candidates;
+
     /** Slipstream mode: either nothing happening, or the kart is collecting
      *  'slipstream credits'. Credits can be accumulated while the bonus is used */
     enum         {SS_NONE, SS_COLLECT} m_slipstream_mode;
@@ -130,6 +139,7 @@ public:
     void         update(int ticks);
     bool         isSlipstreamReady() const;
     void         updateSpeedIncrease();
+    static void  findCandidates(World *world);
     // ------------------------------------------------------------------------
     /** Returns the quad in which slipstreaming is effective for
      *  this kart. */
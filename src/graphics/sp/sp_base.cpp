@@ -32,6 +32,7 @@
 #include "graphics/rtts.hpp"
 #include "graphics/shaders.hpp"
 #include "graphics/sp/sp_dynamic_draw_call.hpp"
+#include "graphics/sp/sp_frustum_culler.hpp"
 #include "graphics/sp/sp_instanced_data.hpp"
 #include "graphics/sp/sp_per_object_uniform.hpp"
 #include "graphics/sp/sp_mesh.hpp"
@@ -109,7 +110,12 @@ std::vector<float> g_bounding_boxes;
 // ----------------------------------------------------------------------------
 std::vector<std::shared_ptr<SPDynamicDrawCall> > g_dy_dc;
 // ----------------------------------------------------------------------------
-float g_frustums[5][24] = { { } };
+// Frustums of camera and shadow cascades, and the boxes of this frame
+SPFrustumCuller g_culler;
+// ----------------------------------------------------------------------------
+// Mesh buffers added in addObject, in the same order as their boxes in
+// g_culler
+std::vector<std::pair<SPMeshNode*, unsigned> > g_culled_objects;
 // ----------------------------------------------------------------------------
 unsigned sp_solid_poly_count = 0;
 // ----------------------------------------------------------------------------
@@ -713,6 +719,23 @@ void addEdgeForViz(const core::vector3df& p0, const core::vector3df& p1)
     g_bounding_boxes.push_back(p1.Z);
 }   // addEdgeForViz
 
+// ----------------------------------------------------------------------------
+void addBoxForViz(const core::aabbox3df& bb)
+{
+    addEdgeForViz(getCorner(bb, 0), getCorner(bb, 1));
+    addEdgeForViz(getCorner(bb, 1), getCorner(bb, 5));
+    addEdgeForViz(getCorner(bb, 5), getCorner(bb, 4));
+    addEdgeForViz(getCorner(bb, 4), getCorner(bb, 0));
+    addEdgeForViz(getCorner(bb, 2), getCorner(bb, 3));
+    addEdgeForViz(getCorner(bb, 3), getCorner(bb, 7));
+    addEdgeForViz(getCorner(bb, 7), getCorner(bb, 6));
+    addEdgeForViz(getCorner(bb, 6), getCorner(bb, 2));
+    addEdgeForViz(getCorner(bb, 0), getCorner(bb, 2));
+    addEdgeForViz(getCorner(bb, 1), getCorner(bb, 3));
+    addEdgeForViz(getCorner(bb, 5), getCorner(bb, 7));
+    addEdgeForViz(getCorner(bb, 4), getCorner(bb, 6));
+}   // addBoxForViz
+
 // ----------------------------------------------------------------------------
 void prepareDrawCalls()
 {
@@ -727,22 +750,25 @@ void prepareDrawCalls()
     // 1st one is identity
     g_skinning_offset = 1;
     g_skinning_mesh.clear();
-    mathPlaneFrustumf(g_frustums[0], irr_driver->getProjViewMatrix());
+    mathPlaneFrustumf(g_culler.getPlanes(0), irr_driver->getProjViewMatrix());
     g_handle_shadow = Track::getCurrentTrack() &&
         Track::getCurrentTrack()->hasShadows() && CVS->isDeferredEnabled() &&
         CVS->isShadowEnabled();
 
     if (g_handle_shadow)
     {
-        mathPlaneFrustumf(g_frustums[1],
+        mathPlaneFrustumf(g_culler.getPlanes(1),
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[0]);
-        mathPlaneFrustumf(g_frustums[2],
+        mathPlaneFrustumf(g_culler.getPlanes(2),
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[1]);
-        mathPlaneFrustumf(g_frustums[3],
+        mathPlaneFrustumf(g_culler.getPlanes(3),
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[2]);
-        mathPlaneFrustumf(g_frustums[4],
+        mathPlaneFrustumf(g_culler.getPlanes(4),
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[3]);
     }
+    g_culler.setFrustumCount(g_handle_shadow ? 5 : 1);
+    g_culler.clear();
+    g_culled_objects.clear();
 
     for (auto& p : g_draw_calls)
     {
@@ -757,6 +783,9 @@ void prepareDrawCalls()
 }
 
 // ----------------------------------------------------------------------------
+/** Adds the bounding boxes of all mesh buffers of a node to the culler, the
+ *  draw calls are created in cullObjects once all nodes are added.
+ */
 void addObject(SPMeshNode* node)
 {
     if (!sp_culling)
@@ -770,82 +799,71 @@ void addObject(SPMeshNode* node)
     }
 
     const core::matrix4& model_matrix = node->getAbsoluteTransformation();
-    bool added_for_skinning = false;
     for (unsigned m = 0; m < node->getSPM()->getMeshBufferCount(); m++)
     {
-        SPMeshBuffer* mb = node->getSPM()->getSPMeshBuffer(m);
-        SPShader* shader = node->getShader(m);
-        if (shader == NULL)
+        if (node->getShader(m) == NULL)
         {
             continue;
         }
-        core::aabbox3df bb = mb->getBoundingBox();
+        core::aabbox3df bb = node->getSPM()->getSPMeshBuffer(m)
+            ->getBoundingBox();
         model_matrix.transformBoxEx(bb);
-        std::vector<bool> discard;
-        const bool handle_shadow = node->isInShadowPass() &&
-            g_handle_shadow && shader->hasShader(RP_SHADOW);
-        discard.resize((handle_shadow ? 5 : 1), false);
+        g_culler.addBox(bb);
+        g_culled_objects.emplace_back(node, m);
+    }
+}   // addObject
 
-        for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
+// ----------------------------------------------------------------------------
+/** Culls all mesh buffers added in addObject at once, and creates the draw
+ *  calls of the visible ones.
+ */
+void cullObjects()
+{
+    if (!sp_culling)
+    {
+        return;
+    }
+
+    g_culler.cull();
+    SPMeshNode* skipped_node = NULL;
+    SPMeshNode* skinned_node = NULL;
+    for (unsigned i = 0; i < g_culled_objects.size(); i++)
+    {
+        SPMeshNode* node = g_culled_objects[i].first;
+        const unsigned m = g_culled_objects[i].second;
+        if (node == skipped_node)
         {
-            for (int i = 0; i < 24; i += 4)
-            {
-                bool outside = true;
-                for (int j = 0; j < 8; j++)
-                {
-                    const float dist =
-                        getCorner(bb, j).X * g_frustums[dc_type][i] +
-                        getCorner(bb, j).Y * g_frustums[dc_type][i + 1] +
-                        getCorner(bb, j).Z * g_frustums[dc_type][i + 2] +
-                        g_frustums[dc_type][i + 3];
-                    outside = outside && dist < 0.0f;
-                    if (!outside)
-                    {
-                        break;
-                    }
-                }
-                if (outside)
-                {
-                    discard[dc_type] = true;
-                    break;
-                }
-            }
+            continue;
         }
-        if (handle_shadow ?
-            (discard[0] && discard[1] && discard[2] && discard[3] &&
-            discard[4]) : discard[0])
+        SPMeshBuffer* mb = node->getSPM()->getSPMeshBuffer(m);
+        SPShader* shader = node->getShader(m);
+        const bool handle_shadow = node->isInShadowPass() &&
+            g_handle_shadow && shader->hasShader(RP_SHADOW);
+        const uint8_t visible = g_culler.getVisibility(i) &
+            (handle_shadow ? 0x1f : 0x1);
+        if (visible == 0)
         {
             continue;
         }
 
         if (irr_driver->getBoundingBoxesViz())
         {
-            addEdgeForViz(getCorner(bb, 0), getCorner(bb, 1));
-            addEdgeForViz(getCorner(bb, 1), getCorner(bb, 5));
-            addEdgeForViz(getCorner(bb, 5), getCorner(bb, 4));
-            addEdgeForViz(getCorner(bb, 4), getCorner(bb, 0));
-            addEdgeForViz(getCorner(bb, 2), getCorner(bb, 3));
-            addEdgeForViz(getCorner(bb, 3), getCorner(bb, 7));
-            addEdgeForViz(getCorner(bb, 7), getCorner(bb, 6));
-            addEdgeForViz(getCorner(bb, 6), getCorner(bb, 2));
-            addEdgeForViz(getCorner(bb, 0), getCorner(bb, 2));
-            addEdgeForViz(getCorner(bb, 1), getCorner(bb, 3));
-            addEdgeForViz(getCorner(bb, 5), getCorner(bb, 7));
-            addEdgeForViz(getCorner(bb, 4), getCorner(bb, 6));
+            addBoxForViz(g_culler.getBox(i));
         }
 
         mb->uploadGLMesh();
         // For first frame only need the vbo to be initialized
-        if (!added_for_skinning && node->getAnimationState())
+        if (skinned_node != node && node->getAnimationState())
         {
-            added_for_skinning = true;
+            skinned_node = node;
             int skinning_offset = g_skinning_offset + node->getTotalJoints();
             if (skinning_offset > int(stk_config->m_max_skinning_bones))
             {
                 Log::error("SPBase", "No enough space to render skinned"
                     " mesh %s! Max joints can hold: %d",
                     node->getName(), stk_config->m_max_skinning_bones);
-                return;
+                skipped_node = node;
+                continue;
             }
             node->setSkinningOffset(g_skinning_offset);
             g_skinning_mesh.push_back(node);
@@ -861,7 +879,7 @@ void addObject(SPMeshNode* node)
 
         for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
         {
-            if (discard[dc_type])
+            if ((visible & (1 << dc_type)) == 0)
             {
                 continue;
             }
@@ -928,7 +946,7 @@ void addObject(SPMeshNode* node)
             g_instances.insert(mb);
         }
     }
-}
+}   // cullObjects
 
 // ----------------------------------------------------------------------------
 void handleDynamicDrawCall()
@@ -951,61 +969,23 @@ void handleDynamicDrawCall()
         SPShader* shader = dydc->getShader();
         core::aabbox3df bb = dydc->getBoundingBox();
         dydc->getAbsoluteTransformation().transformBoxEx(bb);
-        std::vector<bool> discard;
         const bool handle_shadow =
             g_handle_shadow && shader->hasShader(RP_SHADOW);
-        discard.resize((handle_shadow ? 5 : 1), false);
-        for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
-        {
-            for (int i = 0; i < 24; i += 4)
-            {
-                bool outside = true;
-                for (int j = 0; j < 8; j++)
-                {
-                    const float dist =
-                        getCorner(bb, j).X * g_frustums[dc_type][i] +
-                        getCorner(bb, j).Y * g_frustums[dc_type][i + 1] +
-                        getCorner(bb, j).Z * g_frustums[dc_type][i + 2] +
-                        g_frustums[dc_type][i + 3];
-                    outside = outside && dist < 0.0f;
-                    if (!outside)
-                    {
-                        break;
-                    }
-                }
-                if (outside)
-                {
-                    discard[dc_type] = true;
-                    break;
-                }
-            }
-        }
-        if (handle_shadow ?
-            (discard[0] && discard[1] && discard[2] && discard[3] &&
-            discard[4]) : discard[0])
+        const uint8_t visible = g_culler.cullBox(bb) &
+            (handle_shadow ? 0x1f : 0x1);
+        if (visible == 0)
         {
             continue;
         }
 
         if (irr_driver->getBoundingBoxesViz())
         {
-            addEdgeForViz(getCorner(bb, 0), getCorner(bb, 1));
-            addEdgeForViz(getCorner(bb, 1), getCorner(bb, 5));
-            addEdgeForViz(getCorner(bb, 5), getCorner(bb, 4));
-            addEdgeForViz(getCorner(bb, 4), getCorner(bb, 0));
-            addEdgeForViz(getCorner(bb, 2), getCorner(bb, 3));
-            addEdgeForViz(getCorner(bb, 3), getCorner(bb, 7));
-            addEdgeForViz(getCorner(bb, 7), getCorner(bb, 6));
-            addEdgeForViz(getCorner(bb, 6), getCorner(bb, 2));
-            addEdgeForViz(getCorner(bb, 0), getCorner(bb, 2));
-            addEdgeForViz(getCorner(bb, 1), getCorner(bb, 3));
-            addEdgeForViz(getCorner(bb, 5), getCorner(bb, 7));
-            addEdgeForViz(getCorner(bb, 4), getCorner(bb, 6));
+            addBoxForViz(bb);
         }
 
         for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
         {
-            if (discard[dc_type])
+            if ((visible & (1 << dc_type)) == 0)
             {
                 continue;
             }
@@ -1282,7 +1262,7 @@ void draw(RenderPass rp, DrawCallType dct)
 {
     std::stringstream profiler_name;
     profiler_name << "SP::Draw " << dct << " with " << rp;
-    PROFILER_PUSH_CPU_MARKER(profiler_name.str().c_str(),
+    PROFILER_PUSH_DYNAMIC_CPU_MARKER(profiler_name.str().c_str(),
         (uint8_t)(float(dct + rp + 2) / float(DCT_FOR_VAO + RP_COUNT) * 255.0f),
         (uint8_t)(float(dct + 1) / (float)DCT_FOR_VAO * 255.0f) ,
         (uint8_t)(float(rp + 1) / (float)RP_COUNT * 255.0f));
@@ -0,0 +1,284 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef SERVER_ONLY
+
+#include "graphics/sp/sp_frustum_culler.hpp"
+#include "utils/log.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+
+#include <ge_main.hpp>
+#include <matrix4.h>
+#include <simd_wrapper.h>
+
+using namespace irr;
+
+namespace SP
+{
+
+// ----------------------------------------------------------------------------
+SPFrustumCuller::SPFrustumCuller()
+{
+    memset(m_planes, 0, sizeof(m_planes));
+    m_frustum_count = 1;
+    m_box_count = 0;
+}   // SPFrustumCuller
+
+// ----------------------------------------------------------------------------
+/** Removes all boxes, but keeps the memory for the next frame. */
+void SPFrustumCuller::clear()
+{
+    m_box_count = 0;
+    m_min_x.clear();
+    m_min_y.clear();
+    m_min_z.clear();
+    m_max_x.clear();
+    m_max_y.clear();
+    m_max_z.clear();
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Adds a box to be tested in the next cull().
+ *  \param bb The box in world space.
+ *  \return The index of the box for getVisibility.
+ */
+unsigned SPFrustumCuller::addBox(const core::aabbox3df& bb)
+{
+    m_min_x.push_back(bb.MinEdge.X);
+    m_min_y.push_back(bb.MinEdge.Y);
+    m_min_z.push_back(bb.MinEdge.Z);
+    m_max_x.push_back(bb.MaxEdge.X);
+    m_max_y.push_back(bb.MaxEdge.Y);
+    m_max_z.push_back(bb.MaxEdge.Z);
+    return m_box_count++;
+}   // addBox
+
+// ----------------------------------------------------------------------------
+/** Computes the visibility bitmask of all added boxes. A box is outside of a
+ *  frustum if all its corners are behind one of the planes. For each plane
+ *  only the corner furthest along the plane normal needs to be tested: it
+ *  has the largest distance of all corners, so it is behind the plane
+ *  exactly if all corners are.
+ */
+void SPFrustumCuller::cull()
+{
+    // Pad to a multiple of 4 so the last boxes can be loaded as one vector,
+    // the results of the padding are never read.
+    while (m_min_x.size() % 4 != 0)
+    {
+        m_min_x.push_back(0.0f);
+        m_min_y.push_back(0.0f);
+        m_min_z.push_back(0.0f);
+        m_max_x.push_back(0.0f);
+        m_max_y.push_back(0.0f);
+        m_max_z.push_back(0.0f);
+    }
+    const unsigned padded_count = (unsigned)m_min_x.size();
+    m_visibility.resize(padded_count);
+
+#ifdef CPU_SSE_SUPPORT
+    const __m128 zero = _mm_setzero_ps();
+    for (unsigned i = 0; i < padded_count; i += 4)
+    {
+        const __m128 min_x = _mm_loadu_ps(&m_min_x[i]);
+        const __m128 min_y = _mm_loadu_ps(&m_min_y[i]);
+        const __m128 min_z = _mm_loadu_ps(&m_min_z[i]);
+        const __m128 max_x = _mm_loadu_ps(&m_max_x[i]);
+        const __m128 max_y = _mm_loadu_ps(&m_max_y[i]);
+        const __m128 max_z = _mm_loadu_ps(&m_max_z[i]);
+        uint8_t visibility[4] = { 0, 0, 0, 0 };
+        for (unsigned f = 0; f < m_frustum_count; f++)
+        {
+            __m128 outside = zero;
+            for (unsigned p = 0; p < 24; p += 4)
+            {
+                const float* plane = &m_planes[f][p];
+                // Same order of operations as cullBox
+                const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(plane[0] >= 0.0f ? max_x : min_x,
+                    _mm_set1_ps(plane[0])),
+                    _mm_mul_ps(plane[1] >= 0.0f ? max_y : min_y,
+                    _mm_set1_ps(plane[1]))),
+                    _mm_mul_ps(plane[2] >= 0.0f ? max_z : min_z,
+                    _mm_set1_ps(plane[2]))),
+                    _mm_set1_ps(plane[3]));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, zero));
+            }
+            const int outside_mask = _mm_movemask_ps(outside);
+            for (unsigned j = 0; j < 4; j++)
+            {
+                if ((outside_mask & (1 << j)) == 0)
+                    visibility[j] |= (uint8_t)(1 << f);
+            }
+        }
+        memcpy(&m_visibility[i], visibility, 4);
+    }
+#else
+    for (unsigned i = 0; i < padded_count; i++)
+    {
+        uint8_t visibility = 0;
+        for (unsigned f = 0; f < m_frustum_count; f++)
+        {
+            bool outside = false;
+            for (unsigned p = 0; p < 24 && !outside; p += 4)
+            {
+                const float* plane = &m_planes[f][p];
+                const float dist =
+                    (plane[0] >= 0.0f ? m_max_x[i] : m_min_x[i]) * plane[0] +
+                    (plane[1] >= 0.0f ? m_max_y[i] : m_min_y[i]) * plane[1] +
+                    (plane[2] >= 0.0f ? m_max_z[i] : m_min_z[i]) * plane[2] +
+                    plane[3];
+                outside = dist < 0.0f;
+            }
+            if (!outside)
+                visibility |= (uint8_t)(1 << f);
+        }
+        m_visibility[i] = visibility;
+    }
+#endif
+}   // cull
+
+// ----------------------------------------------------------------------------
+/** Tests a single box against all corners, for the few objects that are not
+ *  batched (and as reference in the micro benchmark).
+ *  \param bb The box in world space.
+ *  \return Bitmask with bit i set if the box is visible in frustum i.
+ */
+uint8_t SPFrustumCuller::cullBox(const core::aabbox3df& bb) const
+{
+    uint8_t visibility = 0;
+    for (unsigned f = 0; f < m_frustum_count; f++)
+    {
+        bool outside = false;
+        for (unsigned p = 0; p < 24 && !outside; p += 4)
+        {
+            const float* plane = &m_planes[f][p];
+            outside = true;
+            for (unsigned j = 0; j < 8 && outside; j++)
+            {
+                const float dist =
+                    (j & 1 ? bb.MaxEdge.X : bb.MinEdge.X) * plane[0] +
+                    (j & 2 ? bb.MaxEdge.Y : bb.MinEdge.Y) * plane[1] +
+                    (j & 4 ? bb.MaxEdge.Z : bb.MinEdge.Z) * plane[2] +
+                    plane[3];
+                outside = dist < 0.0f;
+            }
+        }
+        if (!outside)
+            visibility |= (uint8_t)(1 << f);
+    }
+    return visibility;
+}   // cullBox
+
+// ----------------------------------------------------------------------------
+/** Compares culling each box separately against all 8 corners (as done
+ *  before batching) with the batched cull(). It only uses the CPU, the
+ *  scene is a fixed pseudo random set of boxes spread over a track sized
+ *  area, seen by a race camera and 4 shadow cascades.
+ */
+void SPFrustumCuller::microBenchmark()
+{
+    const unsigned box_count = 4096;
+    const unsigned iterations = 200;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> ground(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> height(0.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.5f, 20.0f);
+    std::vector<core::aabbox3df> boxes;
+    for (unsigned i = 0; i < box_count; i++)
+    {
+        core::vector3df center(ground(rng), height(rng), ground(rng));
+        core::vector3df extent(size(rng), size(rng), size(rng));
+        boxes.emplace_back(center - extent * 0.5f, center + extent * 0.5f);
+    }
+
+    SPFrustumCuller culler;
+    core::matrix4 proj, view;
+    proj.buildProjectionMatrixPerspectiveFovLH(core::PI / 3.0f,
+        16.0f / 9.0f, 1.0f, 1000.0f);
+    view.buildCameraLookAtMatrixLH(core::vector3df(0.0f, 20.0f, -300.0f),
+        core::vector3df(0.0f, 0.0f, 0.0f), core::vector3df(0.0f, 1.0f, 0.0f));
+    GE::mathPlaneFrustumf(culler.getPlanes(0), proj * view);
+    for (unsigned i = 1; i < MAX_FRUSTUMS; i++)
+    {
+        // Cascades of growing size in front of the camera
+        const float extent = 50.0f * (float)(1 << i);
+        const core::vector3df center(0.0f, 0.0f, -300.0f + extent * 0.5f);
+        core::matrix4 ortho, sun;
+        ortho.buildProjectionMatrixOrthoLH(extent, extent, -500.0f, 500.0f);
+        sun.buildCameraLookAtMatrixLH(center,
+            center + core::vector3df(0.3f, -1.0f, 0.2f),
+            core::vector3df(0.0f, 0.0f, 1.0f));
+        GE::mathPlaneFrustumf(culler.getPlanes(i), ortho * sun);
+    }
+
+    for (unsigned frustum_count : { 1u, MAX_FRUSTUMS })
+    {
+        culler.setFrustumCount(frustum_count);
+        std::vector<uint8_t> reference(box_count);
+        unsigned visible = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned n = 0; n < iterations; n++)
+        {
+            for (unsigned i = 0; i < box_count; i++)
+                reference[i] = culler.cullBox(boxes[i]);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double per_box_scalar = (double)std::chrono::duration_cast
+            <std::chrono::nanoseconds>(end - start).count() /
+            (iterations * box_count);
+
+        start = std::chrono::steady_clock::now();
+        for (unsigned n = 0; n < iterations; n++)
+        {
+            culler.clear();
+            for (unsigned i = 0; i < box_count; i++)
+                culler.addBox(boxes[i]);
+            culler.cull();
+        }
+        end = std::chrono::steady_clock::now();
+        double per_box_batched = (double)std::chrono::duration_cast
+            <std::chrono::nanoseconds>(end - start).count() /
+            (iterations * box_count);
+
+        int error_count = 0;
+        for (unsigned i = 0; i < box_count; i++)
+        {
+            if (culler.getVisibility(i) != reference[i])
+                error_count++;
+            if (reference[i] != 0)
+                visible++;
+        }
+        if (error_count > 0)
+        {
+            Log::error("SPFrustumCuller", "%d of %u boxes differ from the "
+                "per corner test.", error_count, box_count);
+        }
+        Log::info("SPFrustumCuller", "%u frustum(s), %u of %u boxes "
+            "visible: %.1f ns per box per corner, %.1f ns per box batched.",
+            frustum_count, visible, box_count, per_box_scalar,
+            per_box_batched);
+        assert(error_count == 0);
+    }
+}   // microBenchmark
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SP_FRUSTUM_CULLER_HPP
+#define HEADER_SP_FRUSTUM_CULLER_HPP
+
+#include <aabbox3d.h>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace SP
+{
+
+/** Culls axis aligned bounding boxes against up to 5 frustums (the camera
+ *  and the 4 shadow cascades). The boxes of a frame are first gathered into
+ *  structure of arrays storage, then cull() tests 4 boxes at a time against
+ *  each plane with SSE (emulated with simde on NEON). The result of each box
+ *  is a bitmask with bit i set if the box is visible in frustum i.
+ *  The storage is kept between frames, so no memory is allocated once it
+ *  has grown to the size of the scene.
+ */
+class SPFrustumCuller
+{
+public:
+    static const unsigned MAX_FRUSTUMS = 5;
+
+private:
+    /** 6 planes (a, b, c, d) for each frustum, with a point being outside
+     *  if a*x + b*y + c*z + d < 0. */
+    float m_planes[MAX_FRUSTUMS][24];
+
+    /** Number of frustums that are tested in cull(). */
+    unsigned m_frustum_count;
+
+    /** Number of boxes added since the last clear(). The arrays below are
+     *  padded to a multiple of 4 in cull(). */
+    unsigned m_box_count;
+
+    std::vector<float> m_min_x, m_min_y, m_min_z;
+    std::vector<float> m_max_x, m_max_y, m_max_z;
+
+    /** Visibility bitmask of each box, computed in cull(). */
+    std::vector<uint8_t> m_visibility;
+
+public:
+    // ------------------------------------------------------------------------
+    SPFrustumCuller();
+    // ------------------------------------------------------------------------
+    void clear();
+    // ------------------------------------------------------------------------
+    unsigned addBox(const irr::core::aabbox3df& bb);
+    // ------------------------------------------------------------------------
+    void cull();
+    // ------------------------------------------------------------------------
+    uint8_t cullBox(const irr::core::aabbox3df& bb) const;
+    // ------------------------------------------------------------------------
+    static void microBenchmark();
+    // ------------------------------------------------------------------------
+    /** Returns the 24 floats of the planes of frustum i to be written. */
+    float* getPlanes(unsigned i)
+    {
+        assert(i < MAX_FRUSTUMS);
+        return m_planes[i];
+    }
+    // ------------------------------------------------------------------------
+    /** Sets how many frustums are tested, starting with frustum 0. */
+    void setFrustumCount(unsigned count)
+    {
+        assert(count > 0 && count <= MAX_FRUSTUMS);
+        m_frustum_count = count;
+    }
+    // ------------------------------------------------------------------------
+    unsigned getBoxCount() const                      { return m_box_count; }
+    // ------------------------------------------------------------------------
+    /** Returns the visibility bitmask of box i.
+     *  \pre cull() was called after the box was added. */
+    uint8_t getVisibility(unsigned i) const
+    {
+        assert(i < m_box_count);
+        return m_visibility[i];
+    }
+    // ------------------------------------------------------------------------
+    irr::core::aabbox3df getBox(unsigned i) const
+    {
+        assert(i < m_box_count);
+        return irr::core::aabbox3df(m_min_x[i], m_min_y[i], m_min_z[i],
+                                    m_max_x[i], m_max_y[i], m_max_z[i]);
+    }
+
+};
+
+}
+
+#endif
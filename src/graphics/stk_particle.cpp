@@ -86,23 +86,21 @@ static void generateLifetimeSizeDirection(scene::IParticleEmitter *emitter,
 void STKParticle::generateParticlesFromPointEmitter
     (scene::IParticlePointEmitter *emitter)
 {
-    m_particles_generating.clear();
-    m_initial_particles.clear();
     m_particles_generating.resize(m_max_count);
     m_initial_particles.resize(m_max_count);
     for (unsigned i = 0; i < m_max_count; i++)
     {
         // Initial lifetime is > 1
-        m_particles_generating[i].m_lifetime = 2.0f;
+        m_particles_generating.m_lifetime[i] = 2.0f;
 
+        core::vector3df direction;
         generateLifetimeSizeDirection(emitter,
-            m_initial_particles[i].m_lifetime,
-            m_particles_generating[i].m_size,
-            m_particles_generating[i].m_direction);
+            m_initial_particles.m_lifetime[i],
+            m_particles_generating.m_size[i], direction);
 
-        m_initial_particles[i].m_direction =
-            m_particles_generating[i].m_direction;
-        m_initial_particles[i].m_size = m_particles_generating[i].m_size;
+        m_particles_generating.setDirection(i, direction);
+        m_initial_particles.setDirection(i, direction);
+        m_initial_particles.m_size[i] = m_particles_generating.m_size[i];
     }
 }   // generateParticlesFromPointEmitter
 
@@ -110,41 +108,39 @@ void STKParticle::generateParticlesFromPointEmitter
 void STKParticle::generateParticlesFromBoxEmitter
     (scene::IParticleBoxEmitter *emitter)
 {
-    m_particles_generating.clear();
-    m_initial_particles.clear();
     m_particles_generating.resize(m_max_count);
     m_initial_particles.resize(m_max_count);
     const core::vector3df& extent = emitter->getBox().getExtent();
     for (unsigned i = 0; i < m_max_count; i++)
     {
-        m_particles_generating[i].m_position.X =
+        m_particles_generating.m_position_x[i] =
             emitter->getBox().MinEdge.X + os::Randomizer::frand() * extent.X;
-        m_particles_generating[i].m_position.Y =
+        m_particles_generating.m_position_y[i] =
             emitter->getBox().MinEdge.Y + os::Randomizer::frand() * extent.Y;
-        m_particles_generating[i].m_position.Z =
+        m_particles_generating.m_position_z[i] =
             emitter->getBox().MinEdge.Z + os::Randomizer::frand() * extent.Z;
 
         // Initial lifetime is random
-        m_particles_generating[i].m_lifetime = os::Randomizer::frand();
+        m_particles_generating.m_lifetime[i] = os::Randomizer::frand();
         if (!m_randomize_initial_y)
         {
-            m_particles_generating[i].m_lifetime += 1.0f;
+            m_particles_generating.m_lifetime[i] += 1.0f;
         }
-        m_initial_particles[i].m_position =
-            m_particles_generating[i].m_position;
+        m_initial_particles.setPosition(i,
+            m_particles_generating.getPosition(i));
 
+        core::vector3df direction;
         generateLifetimeSizeDirection(emitter,
-            m_initial_particles[i].m_lifetime,
-            m_particles_generating[i].m_size,
-            m_particles_generating[i].m_direction);
+            m_initial_particles.m_lifetime[i],
+            m_particles_generating.m_size[i], direction);
 
-        m_initial_particles[i].m_direction =
-            m_particles_generating[i].m_direction;
-        m_initial_particles[i].m_size = m_particles_generating[i].m_size;
+        m_particles_generating.setDirection(i, direction);
+        m_initial_particles.setDirection(i, direction);
+        m_initial_particles.m_size[i] = m_particles_generating.m_size[i];
 
         if (m_randomize_initial_y)
         {
-            m_initial_particles[i].m_position.Y =
+            m_initial_particles.m_position_y[i] =
                 os::Randomizer::frand() * 50.0f; // -100.0f;
         }
     }
@@ -154,8 +150,6 @@ void STKParticle::generateParticlesFromBoxEmitter
 void STKParticle::generateParticlesFromSphereEmitter
     (scene::IParticleSphereEmitter *emitter)
 {
-    m_particles_generating.clear();
-    m_initial_particles.clear();
     m_particles_generating.resize(m_max_count);
     m_initial_particles.resize(m_max_count);
     for (unsigned i = 0; i < m_max_count; i++)
@@ -169,21 +163,20 @@ void STKParticle::generateParticlesFromSphereEmitter
         pos.rotateYZBy(os::Randomizer::frand() * 360.f, emitter->getCenter());
         pos.rotateXZBy(os::Randomizer::frand() * 360.f, emitter->getCenter());
 
-        m_particles_generating[i].m_position = pos;
+        m_particles_generating.setPosition(i, pos);
 
         // Initial lifetime is > 1
-        m_particles_generating[i].m_lifetime = 2.0f;
-        m_initial_particles[i].m_position =
-            m_particles_generating[i].m_position;
+        m_particles_generating.m_lifetime[i] = 2.0f;
+        m_initial_particles.setPosition(i, pos);
 
+        core::vector3df direction;
         generateLifetimeSizeDirection(emitter,
-            m_initial_particles[i].m_lifetime,
-            m_particles_generating[i].m_size,
-            m_particles_generating[i].m_direction);
+            m_initial_particles.m_lifetime[i],
+            m_particles_generating.m_size[i], direction);
 
-        m_initial_particles[i].m_direction =
-            m_particles_generating[i].m_direction;
-        m_initial_particles[i].m_size = m_particles_generating[i].m_size;
+        m_particles_generating.setDirection(i, direction);
+        m_initial_particles.setDirection(i, direction);
+        m_initial_particles.m_size[i] = m_particles_generating.m_size[i];
     }
 }   // generateParticlesFromSphereEmitter
 
@@ -237,6 +230,12 @@ void STKParticle::setEmitter(scene::IParticleEmitter* emitter)
 }   // setEmitter
 
 // ----------------------------------------------------------------------------
+/** Simulates the particles of this emitter for the last frame.
+ *  It only changes data of this node and does not use the random number
+ *  generator, so CPUParticleManager::generateAll can run it for different
+ *  emitters in parallel.
+ *  \param out The visible particles are appended to it, can be NULL.
+ */
 void STKParticle::generate(std::vector<CPUParticle>* out)
 {
     if (!getEmitter())
@@ -307,17 +306,17 @@ void STKParticle::stimulateHeightMap(float dt, unsigned int active_count,
         float new_lifetime = 0.0f;
 
         const core::vector3df particle_position =
-            m_particles_generating[i].m_position;
-        const float lifetime = m_particles_generating[i].m_lifetime;
+            m_particles_generating.getPosition(i);
+        const float lifetime = m_particles_generating.m_lifetime[i];
         const core::vector3df particle_direction =
-            m_particles_generating[i].m_direction;
+            m_particles_generating.getDirection(i);
 
         const core::vector3df particle_position_initial =
-            m_initial_particles[i].m_position;
-        const float lifetime_initial = m_initial_particles[i].m_lifetime;
+            m_initial_particles.getPosition(i);
+        const float lifetime_initial = m_initial_particles.m_lifetime[i];
         const core::vector3df particle_direction_initial =
-            m_initial_particles[i].m_direction;
-        const float size_initial = m_initial_particles[i].m_size;
+            m_initial_particles.getDirection(i);
+        const float size_initial = m_initial_particles.m_size[i];
 
         bool reset = false;
         const int px = core::clamp((int)(256.0f *
@@ -347,10 +346,10 @@ void STKParticle::stimulateHeightMap(float dt, unsigned int active_count,
             glslMix(size_initial, size_initial * m_size_increase_factor,
             adjusted_lifetime) : 0.0f;
 
-        m_particles_generating[i].m_position = new_particle_position;
-        m_particles_generating[i].m_lifetime = new_lifetime;
-        m_particles_generating[i].m_direction = new_particle_direction;
-        m_particles_generating[i].m_size = new_size;
+        m_particles_generating.setPosition(i, new_particle_position);
+        m_particles_generating.m_lifetime[i] = new_lifetime;
+        m_particles_generating.setDirection(i, new_particle_direction);
+        m_particles_generating.m_size[i] = new_size;
         if (out != NULL)
         {
             if (m_flips || new_size != 0.0f)
@@ -382,18 +381,18 @@ void STKParticle::stimulateNormal(float dt, unsigned int active_count,
         float new_lifetime = 0.0f;
 
         const core::vector3df particle_position =
-            m_particles_generating[i].m_position;
-        const float lifetime = m_particles_generating[i].m_lifetime;
+            m_particles_generating.getPosition(i);
+        const float lifetime = m_particles_generating.m_lifetime[i];
         const core::vector3df particle_direction =
-            m_particles_generating[i].m_direction;
-        const float size = m_particles_generating[i].m_size;
+            m_particles_generating.getDirection(i);
+        const float size = m_particles_generating.m_size[i];
 
         const core::vector3df particle_position_initial =
-            m_initial_particles[i].m_position;
-        const float lifetime_initial = m_initial_particles[i].m_lifetime;
+            m_initial_particles.getPosition(i);
+        const float lifetime_initial = m_initial_particles.m_lifetime[i];
         const core::vector3df particle_direction_initial =
-            m_initial_particles[i].m_direction;
-        const float size_initial = m_initial_particles[i].m_size;
+            m_initial_particles.getDirection(i);
+        const float size_initial = m_initial_particles.m_size[i];
 
         float updated_lifetime = lifetime + (dt / lifetime_initial);
         if (updated_lifetime > 1.0f)
@@ -455,10 +454,10 @@ void STKParticle::stimulateNormal(float dt, unsigned int active_count,
                 glslMix(size_initial, size_initial * m_size_increase_factor,
                 updated_lifetime);
         }
-        m_particles_generating[i].m_position = new_particle_position;
-        m_particles_generating[i].m_lifetime = new_lifetime;
-        m_particles_generating[i].m_direction = new_particle_direction;
-        m_particles_generating[i].m_size = new_size;
+        m_particles_generating.setPosition(i, new_particle_position);
+        m_particles_generating.m_lifetime[i] = new_lifetime;
+        m_particles_generating.setDirection(i, new_particle_direction);
+        m_particles_generating.m_size[i] = new_size;
         if (out != NULL)
         {
             if (m_flips || new_size != 0.0f)
@@ -512,10 +511,10 @@ void STKParticle::OnRegisterSceneNode()
     Buffer->BoundingBox.reset(AbsoluteTransformation.getTranslation());
     for (unsigned i = 0; i < m_particles_generating.size(); i++)
     {
-        if (m_particles_generating[i].m_size == 0.0f ||
-            std::isnan(m_particles_generating[i].m_position.X) ||
-            std::isnan(m_particles_generating[i].m_position.Y) ||
-            std::isnan(m_particles_generating[i].m_position.Z))
+        if (m_particles_generating.m_size[i] == 0.0f ||
+            std::isnan(m_particles_generating.m_position_x[i]) ||
+            std::isnan(m_particles_generating.m_position_y[i]) ||
+            std::isnan(m_particles_generating.m_position_z[i]))
         {
             continue;
         }
@@ -524,13 +523,13 @@ void STKParticle::OnRegisterSceneNode()
         p.endTime = 0;
         p.color = 0;
         p.startColor = 0;
-        p.pos = m_particles_generating[i].m_position;
+        p.pos = m_particles_generating.getPosition(i);
         Buffer->BoundingBox.addInternalPoint(p.pos);
-        p.size = core::dimension2df(m_particles_generating[i].m_size,
-            m_particles_generating[i].m_size);
+        p.size = core::dimension2df(m_particles_generating.m_size[i],
+            m_particles_generating.m_size[i]);
         core::vector3df ret = m_color_from + (m_color_to - m_color_from) *
-            m_particles_generating[i].m_lifetime;
-        float alpha = 1.0f - m_particles_generating[i].m_lifetime;
+            m_particles_generating.m_lifetime[i];
+        float alpha = 1.0f - m_particles_generating.m_lifetime[i];
         alpha = glslSmoothstep(0.0f, 0.35f, alpha);
         p.color.setRed(core::clamp((int)(ret.X * 255.0f), 0, 255));
         p.color.setGreen(core::clamp((int)(ret.Y * 255.0f), 0, 255));
@@ -540,7 +539,7 @@ void STKParticle::OnRegisterSceneNode()
         {
             // Only used in ge_vulkan_draw_call.cpp
             p.startTime = i;
-            p.startSize.Width = m_particles_generating[i].m_lifetime;
+            p.startSize.Width = m_particles_generating.m_lifetime[i];
         }
         Particles.push_back(p);
     }
@@ -54,17 +54,59 @@ private:
               m_x_len(track_x_len), m_z_len(track_z_len) {}
     };
     // ------------------------------------------------------------------------
-    struct ParticleData
+    /** Particle data stored as structure of arrays, so the simulation
+     *  loops read each component contiguously. */
+    struct ParticleArrays
     {
-        core::vector3df m_position;
-        float m_lifetime;
-        core::vector3df m_direction;
-        float m_size;
+        std::vector<float> m_position_x, m_position_y, m_position_z;
+        std::vector<float> m_direction_x, m_direction_y, m_direction_z;
+        std::vector<float> m_lifetime;
+        std::vector<float> m_size;
+        // --------------------------------------------------------------------
+        void resize(unsigned count)
+        {
+            m_position_x.assign(count, 0.0f);
+            m_position_y.assign(count, 0.0f);
+            m_position_z.assign(count, 0.0f);
+            m_direction_x.assign(count, 0.0f);
+            m_direction_y.assign(count, 0.0f);
+            m_direction_z.assign(count, 0.0f);
+            m_lifetime.assign(count, 0.0f);
+            m_size.assign(count, 0.0f);
+        }
+        // --------------------------------------------------------------------
+        unsigned size() const              { return (unsigned)m_size.size(); }
+        // --------------------------------------------------------------------
+        core::vector3df getPosition(unsigned i) const
+        {
+            return core::vector3df(m_position_x[i], m_position_y[i],
+                                   m_position_z[i]);
+        }
+        // --------------------------------------------------------------------
+        void setPosition(unsigned i, const core::vector3df& pos)
+        {
+            m_position_x[i] = pos.X;
+            m_position_y[i] = pos.Y;
+            m_position_z[i] = pos.Z;
+        }
+        // --------------------------------------------------------------------
+        core::vector3df getDirection(unsigned i) const
+        {
+            return core::vector3df(m_direction_x[i], m_direction_y[i],
+                                   m_direction_z[i]);
+        }
+        // --------------------------------------------------------------------
+        void setDirection(unsigned i, const core::vector3df& dir)
+        {
+            m_direction_x[i] = dir.X;
+            m_direction_y[i] = dir.Y;
+            m_direction_z[i] = dir.Z;
+        }
     };
     // ------------------------------------------------------------------------
     HeightMapData* m_hm;
 
-    std::vector<ParticleData> m_particles_generating, m_initial_particles;
+    ParticleArrays m_particles_generating, m_initial_particles;
 
     core::vector3df m_color_from, m_color_to;
 
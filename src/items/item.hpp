@@ -412,6 +412,11 @@ public:
         return lc.length2() < m_distance_2;
     }   // hitKart
     // ------------------------------------------------------------------------
+    /** Returns the largest distance from this item at which hitKart can be
+     *  true. The height difference is halved in hitKart, so this is twice
+     *  the distance at which the item is collected. */
+    float getHitDistance() const           { return 2.0f * sqrtf(m_distance_2); }
+    // ------------------------------------------------------------------------
     bool rotating() const               { return getType() != ITEM_BUBBLEGUM; }
 
 public:
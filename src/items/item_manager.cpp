@@ -51,6 +51,7 @@ std::vector<scene::IMesh *>  ItemManager::m_item_lowres_mesh;
 std::vector<video::SColorf>  ItemManager::m_glow_color;
 std::vector<std::string>     ItemManager::m_icon;
 bool                         ItemManager::m_disable_item_collection = false;
+const float                  ItemManager::ITEM_CELL_SIZE = 4.0f;
 std::mt19937                 ItemManager::m_random_engine;
 uint32_t                     ItemManager::m_random_seed = 0;
 
@@ -171,6 +172,7 @@ void ItemManager::removeTextures()
 ItemManager::ItemManager()
 {
     m_switch_ticks = -1;
+    m_max_hit_distance = 0.0f;
     // The actual loading is done in loadDefaultItems
 
     // Prepare the switch to array, which stores which item should be
@@ -246,6 +248,7 @@ unsigned int ItemManager::insertItem(Item *item)
     }
     item->setItemId(index);
     insertItemInQuad(item);
+    insertItemInCell(item);
     // Now insert into the appropriate quad list, if there is a quad list
     // (i.e. race mode has a quad graph).
     return index;
@@ -270,6 +273,71 @@ void ItemManager::insertItemInQuad(Item *item)
     }   // if m_items_in_quads
 }   // insertItemInQuad
 
+//-----------------------------------------------------------------------------
+/** Inserts an item into the spatial hash of all items. The item must not
+ *  move while it is in there.
+ */
+void ItemManager::insertItemInCell(Item *item)
+{
+    const Vec3& xyz = item->getXYZ();
+    uint64_t key = getCellKey(getCellCoordinate(xyz.getX()),
+                              getCellCoordinate(xyz.getZ()));
+    m_items_in_cells[key].push_back((int)item->getItemId());
+    m_max_hit_distance = std::max(m_max_hit_distance,
+                                  item->getHitDistance());
+}   // insertItemInCell
+
+//-----------------------------------------------------------------------------
+/** Removes an item from the spatial hash of all items.
+ */
+void ItemManager::deleteItemInCell(ItemState *item)
+{
+    const Vec3& xyz = item->getXYZ();
+    uint64_t key = getCellKey(getCellCoordinate(xyz.getX()),
+                              getCellCoordinate(xyz.getZ()));
+    auto cell = m_items_in_cells.find(key);
+    assert(cell != m_items_in_cells.end());
+    if (cell == m_items_in_cells.end())
+        return;
+    std::vector<int>& items = cell->second;
+    auto it = std::find(items.begin(), items.end(), (int)item->getItemId());
+    assert(it != items.end());
+    if (it != items.end())
+        items.erase(it);
+    if (items.empty())
+        m_items_in_cells.erase(cell);
+}   // deleteItemInCell
+
+//-----------------------------------------------------------------------------
+/** Returns the indices of all items that can be hit at the given position,
+ *  sorted by index. Might include items too far away to be hit.
+ *  \param xyz The position to test.
+ *  \param indices On return the indices of the items.
+ */
+void ItemManager::getCloseItems(const Vec3& xyz,
+                                std::vector<int>* indices) const
+{
+    indices->clear();
+    const int x_first = getCellCoordinate(xyz.getX() - m_max_hit_distance);
+    const int x_last  = getCellCoordinate(xyz.getX() + m_max_hit_distance);
+    const int z_first = getCellCoordinate(xyz.getZ() - m_max_hit_distance);
+    const int z_last  = getCellCoordinate(xyz.getZ() + m_max_hit_distance);
+    for (int x = x_first; x <= x_last; x++)
+    {
+        for (int z = z_first; z <= z_last; z++)
+        {
+            auto cell = m_items_in_cells.find(getCellKey(x, z));
+            if (cell != m_items_in_cells.end())
+            {
+                indices->insert(indices->end(), cell->second.begin(),
+                                cell->second.end());
+            }
+        }
+    }
+    // Test the items in the same order as all items are stored
+    std::sort(indices->begin(), indices->end());
+}   // getCloseItems
+
 //-----------------------------------------------------------------------------
 /** Creates a new item at the location of the kart (e.g. kart drops a
  *  bubblegum).
@@ -388,14 +456,10 @@ void ItemManager::collectedItem(ItemState *item, AbstractKart *kart)
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
+    // Using m_items_in_quads would need to check adjacent quads too (since
+    // an item just on the border of one quad might get hit from an adjacent
+    // quad), and items outside of the track. So only the items in the
+    // cells of the spatial hash close to the kart are tested.
 
     /** Disable item collection detection for debug purposes. */
     if(m_disable_item_collection) return;
@@ -403,9 +467,10 @@ void  ItemManager::checkItemHit(AbstractKart* kart)
     // Spare tire karts don't collect items
     if ( dynamic_cast<SpareTireAI*>(kart->getController()) ) return;
 
-    for(AllItemTypes::iterator i =m_all_items.begin();
-                               i!=m_all_items.end();  i++)
+    getCloseItems(kart->getXYZ(), &m_close_items);
+    for (int index : m_close_items)
     {
+        ItemState** i = &m_all_items[index];
         // Ignore items that have been collected or are not available atm
         if ((!*i) || !(*i)->isAvailable() || (*i)->isUsedUp()) continue;
 
@@ -424,7 +489,7 @@ void  ItemManager::checkItemHit(AbstractKart* kart)
         {
             collectedItem(*i, kart);
         }   // if hit
-    }   // for m_all_items
+    }   // for m_close_items
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
@@ -529,6 +594,7 @@ void ItemManager::deleteItem(ItemState *item)
 {
     // First check if the item needs to be removed from the items-in-quad list
     deleteItemInQuad(item);
+    deleteItemInCell(item);
     int index = item->getItemId();
     m_all_items[index] = NULL;
     delete item;
@@ -711,3 +777,77 @@ bool ItemManager::randomItemsForArena(const AlignedArray<btTransform>& pos)
 
     return true;
 }   // randomItemsForArena
+
+//-----------------------------------------------------------------------------
+/** Tests that the spatial hash finds all items that testing all items
+ *  finds.
+ */
+void ItemManager::unitTesting()
+{
+    uint32_t seed = 4711;
+    auto random = [&seed](float min, float max)
+    {
+        seed = seed * 1103515245 + 12345;
+        return min + (max - min) * (float)((seed >> 8) & 0xffff) / 65535.0f;
+    };
+
+    ItemManager im;
+    for (int i = 0; i < 400; i++)
+    {
+        Vec3 xyz(random(-50.0f, 50.0f), random(-5.0f, 5.0f),
+                 random(-50.0f, 50.0f));
+        // Tilted items turn the height difference into a side distance
+        Vec3 normal(random(-0.5f, 0.5f), 1.0f, random(-0.5f, 0.5f));
+        normal.normalize();
+        ItemState::ItemType type = i % 3 == 0 ? ItemState::ITEM_BUBBLEGUM
+                                              : ItemState::ITEM_BONUS_BOX;
+        im.insertItem(new Item(type, xyz, normal, NULL/*mesh*/,
+            NULL/*lowres_mesh*/, ""/*icon*/, NULL/*owner*/));
+    }
+    // Free some entries, and reuse one of them
+    for (unsigned int i = 0; i < im.m_all_items.size(); i += 7)
+        im.deleteItem(im.m_all_items[i]);
+    int error_count = 0;
+    unsigned int index = im.insertItem(new Item(ItemState::ITEM_BANANA,
+        Vec3(1.0f, 0.0f, 1.0f), Vec3(0.0f, 1.0f, 0.0f), NULL, NULL, "",
+        NULL));
+    if (index % 7 != 0)
+        error_count++;
+
+    std::vector<int> close_items;
+    for (int i = 0; i < 5000; i++)
+    {
+        // Test half of the positions close to an item, so that some of
+        // them hit it
+        Vec3 xyz(random(-55.0f, 55.0f), random(-7.0f, 7.0f),
+                 random(-55.0f, 55.0f));
+        const ItemState* near_item =
+            im.m_all_items[(int)random(0.0f, 399.0f)];
+        if (i % 2 == 0 && near_item)
+        {
+            xyz = near_item->getXYZ() + Vec3(random(-1.5f, 1.5f),
+                random(-1.5f, 1.5f), random(-1.5f, 1.5f));
+        }
+        im.getCloseItems(xyz, &close_items);
+        for (unsigned int j = 0; j < im.m_all_items.size(); j++)
+        {
+            const ItemState* item = im.m_all_items[j];
+            if (item && item->hitKart(xyz) &&
+                !std::binary_search(close_items.begin(), close_items.end(),
+                                    (int)j))
+            {
+                Log::error("ItemManager", "Item %d at %f %f %f is not found "
+                    "close to %f %f %f.", j, item->getXYZ().getX(),
+                    item->getXYZ().getY(), item->getXYZ().getZ(),
+                    xyz.getX(), xyz.getY(), xyz.getZ());
+                error_count++;
+            }
+        }
+        for (unsigned int j = 1; j < close_items.size(); j++)
+        {
+            if (close_items[j - 1] >= close_items[j])
+                error_count++;
+        }
+    }
+    assert(error_count == 0);
+}   // unitTesting
@@ -35,6 +35,7 @@
 #include <memory>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class Kart;
@@ -58,6 +59,22 @@ private:
     static uint32_t m_random_seed;
 
     static bool preloadIcon(const std::string& name);
+    // ------------------------------------------------------------------------
+    /** Returns the cell coordinate of a position, far away positions are
+     *  all put in the border cells. */
+    static int getCellCoordinate(float f)
+    {
+        f = f / ITEM_CELL_SIZE;
+        // Also catches NAN
+        if (!(f > -1000000.0f && f < 1000000.0f))
+            return f > 0.0f ? 1000000 : -1000000;
+        return (int)floorf(f);
+    }   // getCellCoordinate
+    // ------------------------------------------------------------------------
+    static uint64_t getCellKey(int x, int z)
+    {
+        return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+    }   // getCellKey
 public:
     static void loadDefaultItemMeshes();
     static void removeTextures();
@@ -113,6 +130,21 @@ private:
      *  field is undefined if no Graph exist, e.g. arena without navmesh. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** Size of a cell of m_items_in_cells. */
+    static const float ITEM_CELL_SIZE;
+
+    /** Spatial hash of all items: the indices in m_all_items of the items
+     *  in each x/z cell, so that checkItemHit only needs to test the items
+     *  close to a kart. Unlike m_items_in_quads it also works for items
+     *  close to the border of a quad or not on any quad. */
+    std::unordered_map<uint64_t, std::vector<int> > m_items_in_cells;
+
+    /** The largest distance at which any item can be hit. */
+    float m_max_hit_distance;
+
+    /** Indices of the items close to a kart, kept to avoid allocations. */
+    std::vector<int> m_close_items;
+
     /** Stores all item models. */
     static std::vector<scene::IMesh *> m_item_mesh;
 
@@ -132,6 +164,9 @@ protected:
     void setSwitchItems(const std::vector<int> &switch_items);
     void insertItemInQuad(Item *item);
     void deleteItemInQuad(ItemState *item);
+    void insertItemInCell(Item *item);
+    void deleteItemInCell(ItemState *item);
+    void getCloseItems(const Vec3& xyz, std::vector<int>* indices) const;
 public:
              ItemManager();
     virtual ~ItemManager();
@@ -149,6 +184,7 @@ public:
     virtual void   collectedItem   (ItemState *item, AbstractKart *kart);
     virtual void   switchItems     ();
     bool           randomItemsForArena(const AlignedArray<btTransform>& pos);
+    static void    unitTesting();
 
     // ------------------------------------------------------------------------
     /** Returns true if the items are switched atm. */
@@ -219,29 +219,19 @@ void NetworkItemManager::setItemConfirmationTime(std::weak_ptr<STKPeer> peer,
  *  to save the initial state, which is the first confirmed state by all
  *  clients.
  */
-BareNetworkString* NetworkItemManager::saveState(std::vector<std::string>* ru)
+bool NetworkItemManager::saveState(BareNetworkString* buffer,
+                                   std::vector<std::string>* ru)
 {
     ru->push_back(getUniqueIdentity());
     // On the server:
     // ==============
     m_item_events.lock();
-    uint16_t n = (uint16_t)m_item_events.getData().size();
-    if(n==0)
+    for (auto& p : m_item_events.getData())
     {
-        BareNetworkString *s = new BareNetworkString();
-        m_item_events.unlock();
-        return s;
-    }
-
-    BareNetworkString *s =
-        new BareNetworkString(n * (  sizeof(int) + sizeof(uint16_t)
-                                   + sizeof(uint8_t)              ) );
-    for (auto p : m_item_events.getData())
-    {
-        p.saveState(s);
+        p.saveState(buffer);
     }
     m_item_events.unlock();
-    return s;
+    return true;
 }   // saveState
 
 //-----------------------------------------------------------------------------
@@ -484,7 +474,14 @@ void NetworkItemManager::restoreState(BareNetworkString *buffer, int count)
         // ... will be copied from item state to item
         if (is && item)
         {
+            // The server can have a different item at the index of an item
+            // predicted here, so it might move in the spatial hash
+            const bool moved = item->getXYZ() != is->getXYZ();
+            if (moved)
+                deleteItemInCell(item);
             *(ItemState*)item = *is;
+            if (moved)
+                insertItemInCell(dynamic_cast<Item*>(item));
         }
         else if (is && !item)
         {
@@ -497,10 +494,12 @@ void NetworkItemManager::restoreState(BareNetworkString *buffer, int count)
             *((ItemState*)item_new) = *is;
             m_all_items[i] = item_new;
             insertItemInQuad(item_new);
+            insertItemInCell(item_new);
         }
         else if (!is && item)
         {
             deleteItemInQuad(item);
+            deleteItemInCell(item);
             delete item;
             m_all_items[i] = NULL;
         }
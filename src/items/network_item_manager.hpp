@@ -81,8 +81,18 @@ public:
                               const AbstractKart *kart,
                               const Vec3 *server_xyz = NULL,
                               const Vec3 *server_normal = NULL) OVERRIDE;
-    virtual BareNetworkString* saveState(std::vector<std::string>* ru)
-        OVERRIDE;
+    virtual bool saveState(BareNetworkString* buffer,
+                           std::vector<std::string>* ru) OVERRIDE;
+    // ------------------------------------------------------------------------
+    /** A client can not predict item events, any event sent by the server
+     *  must be restored (and confirmed). */
+    virtual bool savePredictedState(BareNetworkString* buffer,
+                                    std::vector<std::string>* ru) OVERRIDE
+    {
+        ru->push_back(getUniqueIdentity());
+        return true;
+    }   // savePredictedState
+    // ------------------------------------------------------------------------
     virtual void restoreState(BareNetworkString *buffer, int count) OVERRIDE;
     // ------------------------------------------------------------------------
     virtual void rewindToEvent(BareNetworkString *bns) OVERRIDE {};
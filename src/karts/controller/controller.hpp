@@ -80,6 +80,15 @@ public:
     virtual bool  saveState(BareNetworkString *buffer) const = 0;
     virtual void  rewindTo(BareNetworkString *buffer) = 0;
     virtual void rumble(float strength_low, float strength_high, uint16_t duration) {}
+    // ------------------------------------------------------------------------
+    /** Returns true if this controller implements decide(). */
+    virtual bool  canDecide() const { return false; }
+    // ------------------------------------------------------------------------
+    /** Called by World::decideControllers for all controllers at the same
+     *  time on several threads, before any kart is updated. It may only read
+     *  the world (using World::getKartSnapshot for other karts) and change
+     *  data of this controller; update() then applies the decision. */
+    virtual void  decide(int ticks) {}
     // ---------------------------------------------------------------------------
     /** Sets the controller name for this controller. */
     virtual void setControllerName(const std::string &name)
@@ -57,13 +57,30 @@ bool NetworkAIController::isLocalPlayerController() const
     return NetworkConfig::get()->isNetworkAIInstance();
 }   // isLocalPlayerController
 
+// ----------------------------------------------------------------------------
+/** Lets the AI decide in parallel if it will be updated in this time step.
+ *  The condition must be the same as in update().
+ */
+void NetworkAIController::decide(int ticks)
+{
+    if (!RewindManager::get()->isRewinding() && needsAIUpdate())
+        m_ai_controller->decide(m_ai_frequency);
+}   // decide
+
+// ----------------------------------------------------------------------------
+/** Returns if the AI is updated in this time step. */
+bool NetworkAIController::needsAIUpdate() const
+{
+    return World::getWorld()->isStartPhase() ||
+           World::getWorld()->getTicksSinceStart() > m_prev_update_ticks;
+}   // needsAIUpdate
+
 // ----------------------------------------------------------------------------
 void NetworkAIController::update(int ticks)
 {
     if (!RewindManager::get()->isRewinding())
     {
-        if (World::getWorld()->isStartPhase() ||
-            World::getWorld()->getTicksSinceStart() > m_prev_update_ticks)
+        if (needsAIUpdate())
         {
             m_prev_update_ticks = World::getWorld()->getTicksSinceStart() +
                 m_ai_frequency;
@@ -32,6 +32,7 @@ private:
     AIBaseController* m_ai_controller;
     KartControl* m_ai_controls;
     void convertAIToPlayerActions();
+    bool needsAIUpdate() const;
 public:
                  NetworkAIController(AbstractKart *kart, int local_player_id,
                                      AIBaseController* ai);
@@ -39,6 +40,10 @@ public:
     virtual void update(int ticks) OVERRIDE;
     virtual void reset() OVERRIDE;
     // ------------------------------------------------------------------------
+    virtual bool canDecide() const OVERRIDE { return true; }
+    // ------------------------------------------------------------------------
+    virtual void decide(int ticks) OVERRIDE;
+    // ------------------------------------------------------------------------
     virtual bool isLocalPlayerController() const OVERRIDE;
     // ------------------------------------------------------------------------
     static void setAIFrequency(int freq) { m_ai_frequency = freq; }
@@ -179,6 +179,9 @@ void SkiddingAI::reset()
     m_skid_probability_state     = SKID_PROBAB_NOT_YET;
     m_last_item_random           = NULL;
     m_burster                    = false;
+    m_in_decide                  = false;
+    m_decided_ticks              = -1;
+    m_use_decision               = false;
 
     AIBaseLapController::reset();
     m_track_node               = Graph::UNKNOWN_SECTOR;
@@ -217,6 +220,76 @@ unsigned int SkiddingAI::getNextSector(unsigned int index)
     return m_successor_index[index];
 }   // getNextSector
 
+//-----------------------------------------------------------------------------
+/** Runs the parts of the AI which only depend on the karts after the last
+ *  physics step, i.e. detecting crashes and selecting the point to aim at.
+ *  It is called for all AIs at the same time on several threads (see
+ *  World::decideControllers), so it must not change anything outside of
+ *  this AI. update() then uses the results if the kart is still the same.
+ *  \param ticks Number of physics time steps - should be 1.
+ */
+void SkiddingAI::decide(int ticks)
+{
+    m_decided_ticks = -1;
+#ifndef AI_DEBUG
+    // The debug code in the functions below changes the scene
+    if (m_kart->getKartAnimation() || m_world->isStartPhase())
+        return;
+
+    m_in_decide = true;
+    getKartState(m_kart, &m_decided_xyz, &m_decided_velocity,
+                 &m_decided_forward_speed);
+    m_decided_track_node = m_track_node;
+    checkCrashes(m_decided_xyz);
+    switch(m_point_selection_algorithm)
+    {
+    case PSA_NEW:    findNonCrashingPointNew(&m_decided_aim_point,
+                                             &m_decided_last_node);
+                     break;
+    case PSA_DEFAULT:findNonCrashingPoint(&m_decided_aim_point,
+                                          &m_decided_last_node);
+                     break;
+    }
+    m_in_decide = false;
+    m_decided_ticks = m_world->getTicksSinceStart();
+#endif
+}   // decide
+
+//-----------------------------------------------------------------------------
+/** Returns true if the results of decide() can be used in this time step,
+ *  i.e. the kart and its graph node have not changed since decide().
+ */
+bool SkiddingAI::isDecisionValid() const
+{
+    return m_decided_ticks == m_world->getTicksSinceStart() &&
+           m_decided_track_node == m_track_node &&
+           m_kart->getXYZ() == m_decided_xyz &&
+           Vec3(m_kart->getVelocity()) == m_decided_velocity &&
+           m_kart->getVelocityLC().getZ() == m_decided_forward_speed;
+}   // isDecisionValid
+
+//-----------------------------------------------------------------------------
+/** Returns position, velocity and forward speed of a kart. In decide()
+ *  they are taken from the snapshot of the world, since the karts are not
+ *  updated yet.
+ */
+void SkiddingAI::getKartState(const AbstractKart *kart, Vec3 *xyz,
+                              Vec3 *velocity, float *forward_speed) const
+{
+    if (m_in_decide)
+    {
+        const KartSnapshot &snapshot = m_world->getKartSnapshot();
+        const unsigned int i = kart->getWorldKartId();
+        *xyz           = snapshot.getXYZ(i);
+        *velocity      = snapshot.getVelocity(i);
+        *forward_speed = snapshot.getForwardSpeed(i);
+        return;
+    }
+    *xyz           = kart->getXYZ();
+    *velocity      = kart->getVelocity();
+    *forward_speed = kart->getVelocityLC().getZ();
+}   // getKartState
+
 //-----------------------------------------------------------------------------
 /** This is the main entry point for the AI.
  *  It is called once per frame for each AI and determines the behaviour of
@@ -340,8 +413,14 @@ void SkiddingAI::update(int ticks)
             speed_cap, /*fade_in_time*/0);
     }
 
-    //Detect if we are going to crash with the track and/or kart
-    checkCrashes(m_kart->getXYZ());
+    //Detect if we are going to crash with the track and/or kart. If
+    //decide() has done this already, only the slipstream target can
+    //have changed.
+    m_use_decision = isDecisionValid();
+    if (m_use_decision)
+        checkSlipstreamTarget();
+    else
+        checkCrashes(m_kart->getXYZ());
     determineTrackDirection();
 
     /*Response handling functions*/
@@ -354,6 +433,9 @@ void SkiddingAI::update(int ticks)
     if(RaceManager::get()->isTimeTrialMode() && (m_world->getTime()<5.0f) )
         m_controls->setFire(false);
 
+    m_use_decision = false;
+    m_decided_ticks = -1;
+
     /*And obviously general kart stuff*/
     AIBaseLapController::update(ticks);
 }   // update
@@ -469,12 +551,20 @@ void SkiddingAI::handleSteering(float dt)
         Vec3 aim_point;
         int last_node = Graph::UNKNOWN_SECTOR;
 
-        switch(m_point_selection_algorithm)
+        if (m_use_decision)
+        {
+            aim_point = m_decided_aim_point;
+            last_node = m_decided_last_node;
+        }
+        else
         {
-        case PSA_NEW:    findNonCrashingPointNew(&aim_point, &last_node);
-                         break;
-        case PSA_DEFAULT:findNonCrashingPoint(&aim_point, &last_node);
-                         break;
+            switch(m_point_selection_algorithm)
+            {
+            case PSA_NEW:    findNonCrashingPointNew(&aim_point, &last_node);
+                             break;
+            case PSA_DEFAULT:findNonCrashingPoint(&aim_point, &last_node);
+                             break;
+            }
         }
 #ifdef AI_DEBUG
         m_debug_sphere[m_point_selection_algorithm]->setPosition(aim_point.toIrrVector());
@@ -2452,7 +2542,10 @@ int SkiddingAI::computeSkill(SkillType type)
 //-----------------------------------------------------------------------------
 void SkiddingAI::checkCrashes(const Vec3& pos )
 {
-    int steps = int( m_kart->getVelocityLC().getZ() / m_kart_length );
+    Vec3 velocity, unused_xyz;
+    float forward_speed;
+    getKartState(m_kart, &unused_xyz, &velocity, &forward_speed);
+    int steps = int( forward_speed / m_kart_length );
     if( steps < 2 ) steps = 2;
 
     // The AI drives significantly better with more steps, so for now
@@ -2466,33 +2559,17 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
     //tell when a kart is going to get out of the track so it steers.
     m_crashes.clear();
 
-    // If slipstream should be handled actively, trigger overtaking the
-    // kart which gives us slipstream if slipstream is ready
-    const SlipStream *slip=m_kart->getSlipstream();
-    // Atm network ai always use slipstream because it's a player controller
-    // underlying
-    bool use_slipstream =
-        m_enabled_network_ai || m_ai_properties->m_make_use_of_slipstream;
-    if(use_slipstream &&
-        slip->isSlipstreamReady() &&
-        slip->getSlipstreamTarget())
-    {
-        //Log::debug(getControllerName().c_str(), "%s overtaking %s",
-        //           m_kart->getIdent().c_str(),
-        //           m_kart->getSlipstreamKart()->getIdent().c_str());
-        // FIXME: we might define a minimum distance, and if the target kart
-        // is too close break first - otherwise the AI hits the kart when
-        // trying to overtake it, actually speeding the other kart up.
-        m_crashes.m_kart = slip->getSlipstreamTarget()->getWorldKartId();
-    }
+    // The slipstream is updated together with the kart
+    if (!m_in_decide)
+        checkSlipstreamTarget();
 
     const size_t NUM_KARTS = m_world->getNumKarts();
 
-    float speed = m_kart->getVelocity().length();
+    float speed = velocity.length();
     // If the velocity is zero, no sense in checking for crashes in time
     if(speed==0) return;
 
-    Vec3 vel_normal = m_kart->getVelocity().normalized();
+    Vec3 vel_normal = velocity.normalized();
 
     // Time it takes to drive for m_kart_length units.
     float dt = m_kart_length / speed;
@@ -2502,7 +2579,7 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
     {
         Log::warn(getControllerName().c_str(),
                   "Incorrect STEPS=%d. kart_length %f velocity %f",
-                  steps, m_kart_length, m_kart->getVelocityLC().getZ());
+                  steps, m_kart_length, forward_speed);
         steps=1000;
     }
     for(int i = 1; steps > i; ++i)
@@ -2519,12 +2596,14 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
                 const AbstractKart* kart = m_world->getKart(j);
                 // Ignore eliminated karts
                 if(kart==m_kart||kart->isEliminated()||kart->isGhostKart()) continue;
-                const AbstractKart *other_kart = m_world->getKart(j);
+                Vec3 other_xyz, other_velocity;
+                float other_forward_speed;
+                getKartState(kart, &other_xyz, &other_velocity,
+                             &other_forward_speed);
                 // Ignore karts ahead that are faster than this kart.
-                if(m_kart->getVelocityLC().getZ() < other_kart->getVelocityLC().getZ())
+                if(forward_speed < other_forward_speed)
                     continue;
-                Vec3 other_kart_xyz = other_kart->getXYZ()
-                                    + other_kart->getVelocity()*(i*dt);
+                Vec3 other_kart_xyz = other_xyz + other_velocity*(i*dt);
                 float kart_distance = (step_coord - other_kart_xyz).length();
 
                 if( kart_distance < m_kart_length)
@@ -2546,6 +2625,31 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
     }
 }   // checkCrashes
 
+//-----------------------------------------------------------------------------
+/** If slipstream should be handled actively, triggers overtaking the kart
+ *  which gives us slipstream if slipstream is ready.
+ */
+void SkiddingAI::checkSlipstreamTarget()
+{
+    const SlipStream *slip=m_kart->getSlipstream();
+    // Atm network ai always use slipstream because it's a player controller
+    // underlying
+    bool use_slipstream =
+        m_enabled_network_ai || m_ai_properties->m_make_use_of_slipstream;
+    if(use_slipstream &&
+        slip->isSlipstreamReady() &&
+        slip->getSlipstreamTarget())
+    {
+        //Log::debug(getControllerName().c_str(), "%s overtaking %s",
+        //           m_kart->getIdent().c_str(),
+        //           m_kart->getSlipstreamKart()->getIdent().c_str());
+        // FIXME: we might define a minimum distance, and if the target kart
+        // is too close break first - otherwise the AI hits the kart when
+        // trying to overtake it, actually speeding the other kart up.
+        m_crashes.m_kart = slip->getSlipstreamTarget()->getWorldKartId();
+    }
+}   // checkSlipstreamTarget
+
 //-----------------------------------------------------------------------------
 /** This is a new version of findNonCrashingPoint, which at this stage is
  *  slightly inferior (though faster and more correct) than the original
@@ -2584,7 +2688,10 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
 void SkiddingAI::findNonCrashingPointNew(Vec3 *result, int *last_node)
 {
     *last_node = m_next_node_index[m_track_node];
-    const core::vector2df xz = m_kart->getXYZ().toIrrVector2d();
+    Vec3 kart_xyz, velocity;
+    float forward_speed;
+    getKartState(m_kart, &kart_xyz, &velocity, &forward_speed);
+    const core::vector2df xz = kart_xyz.toIrrVector2d();
 
     const DriveNode* dn = DriveGraph::get()->getNode(*last_node);
 
@@ -2701,6 +2808,9 @@ void SkiddingAI::findNonCrashingPointNew(Vec3 *result, int *last_node)
     Vec3 forw(0, 0, 50);
     m_curve[CURVE_KART]->addPoint(m_kart->getTrans()(forw)+eps);
 #endif
+    Vec3 kart_xyz, velocity;
+    float forward_speed;
+    getKartState(m_kart, &kart_xyz, &velocity, &forward_speed);
     *last_node = m_next_node_index[m_track_node];
     float angle = DriveGraph::get()->getAngleToNext(m_track_node,
                                               m_successor_index[m_track_node]);
@@ -2731,7 +2841,7 @@ void SkiddingAI::findNonCrashingPointNew(Vec3 *result, int *last_node)
 
         //direction is a vector from our kart to the sectors we are testing
         direction = DriveGraph::get()->getNode(target_sector)->getCenter()
-                  - m_kart->getXYZ();
+                  - kart_xyz;
 
         float len=direction.length();
         unsigned int steps = (unsigned int)( len / m_kart_length );
@@ -2751,7 +2861,7 @@ void SkiddingAI::findNonCrashingPointNew(Vec3 *result, int *last_node)
         //Test if we crash if we drive towards the target sector
         for(unsigned int i = 2; i < steps; ++i )
         {
-            step_coord = m_kart->getXYZ()+direction*m_kart_length * float(i);
+            step_coord = kart_xyz+direction*m_kart_length * float(i);
 
             DriveGraph::get()->spatialToTrack(&step_track_coord, step_coord,
                                              *last_node );
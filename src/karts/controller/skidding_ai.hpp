@@ -236,6 +236,27 @@ private:
           m_point_selection_algorithm;
 
     ItemManager* m_item_manager;
+
+    /** True while decide() is running, in which case the karts are read
+     *  from the snapshot of the world. */
+    bool m_in_decide;
+
+    /** World ticks for which decide() was called, -1 if there is no
+     *  decision to use. */
+    int m_decided_ticks;
+
+    /** State of the kart and the graph node on which decide() was based. */
+    Vec3 m_decided_xyz;
+    Vec3 m_decided_velocity;
+    float m_decided_forward_speed;
+    int m_decided_track_node;
+
+    /** Point to aim at and its graph node found in decide(). */
+    Vec3 m_decided_aim_point;
+    int m_decided_last_node;
+
+    /** True if update() uses the results of decide(). */
+    bool m_use_decision;
 #ifdef AI_DEBUG
     /** For skidding debugging: shows the estimated turn shape. */
     ShowCurve **m_curve;
@@ -287,6 +308,10 @@ private:
                         std::vector<const ItemState *> *items_to_collect);
 
     void  checkCrashes(const Vec3& pos);
+    void  checkSlipstreamTarget();
+    void  getKartState(const AbstractKart *kart, Vec3 *xyz, Vec3 *velocity,
+                       float *forward_speed) const;
+    bool  isDecisionValid() const;
     void  findNonCrashingPointNew(Vec3 *result, int *last_node);
     void  findNonCrashingPoint(Vec3 *result, int *last_node);
 
@@ -303,6 +328,8 @@ public:
                 ~SkiddingAI();
     virtual void update      (int ticks);
     virtual void reset       ();
+    virtual bool canDecide   () const OVERRIDE { return true; }
+    virtual void decide      (int ticks) OVERRIDE;
     virtual const irr::core::stringw& getNamePostfix() const;
 };
 
@@ -0,0 +1,64 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "karts/kart_snapshot.hpp"
+
+#include "karts/abstract_kart.hpp"
+#include "modes/world.hpp"
+
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+
+// ----------------------------------------------------------------------------
+/** Copies the state of all karts. The transform is taken from the physics
+ *  body, since the karts copy it only in their own update.
+ *  \param world The world with all karts.
+ */
+void KartSnapshot::update(const World *world)
+{
+    const unsigned int n = world->getNumKarts();
+    m_x.resize(n);
+    m_y.resize(n);
+    m_z.resize(n);
+    m_velocity_x.resize(n);
+    m_velocity_y.resize(n);
+    m_velocity_z.resize(n);
+    m_forward_speed.resize(n);
+    m_speed.resize(n);
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const AbstractKart *kart = world->getKart(i);
+        const btRigidBody *body = kart->getBody();
+        btTransform trans = kart->getTrans();
+        if (body && body->getInvMass() != 0 && body->getMotionState())
+            body->getMotionState()->getWorldTransform(trans);
+
+        const btVector3 &xyz = trans.getOrigin();
+        m_x[i] = xyz.getX();
+        m_y[i] = xyz.getY();
+        m_z[i] = xyz.getZ();
+
+        const Vec3 &velocity = kart->getVelocity();
+        m_velocity_x[i] = velocity.getX();
+        m_velocity_y[i] = velocity.getY();
+        m_velocity_z[i] = velocity.getZ();
+        // Same as Moveable::update computes getVelocityLC()
+        m_forward_speed[i] = (velocity * trans.getBasis()).getZ();
+        m_speed[i] = kart->getSpeed();
+    }
+}   // update
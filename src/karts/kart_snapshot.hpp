@@ -0,0 +1,81 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_KART_SNAPSHOT_HPP
+#define HEADER_KART_SNAPSHOT_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
+
+#include <cassert>
+#include <vector>
+
+class World;
+
+/**
+ *  \brief The state of all karts after the last physics step.
+ *
+ *  World updates the snapshot once per time step before the karts are
+ *  updated. Code which tests all karts (e.g. the AI) can then read a few
+ *  contiguous arrays instead of calling virtual functions of karts all over
+ *  the heap. All values are the same for the whole time step, even for karts
+ *  which were updated already. The snapshot is never written while the
+ *  karts are updated, so it can be read from several threads.
+ *
+ * \ingroup karts
+ */
+class KartSnapshot : public NoCopy
+{
+private:
+    /** Position of the physics body of each kart. */
+    std::vector<float> m_x, m_y, m_z;
+
+    /** Velocity of the physics body of each kart. */
+    std::vector<float> m_velocity_x, m_velocity_y, m_velocity_z;
+
+    /** Velocity in the direction the kart is facing. */
+    std::vector<float> m_forward_speed;
+
+    /** Speed of the kart as computed in its last update, i.e. negative
+     *  when driving backwards, see AbstractKart::getSpeed(). */
+    std::vector<float> m_speed;
+
+public:
+    void update(const World *world);
+    // ------------------------------------------------------------------------
+    /** Returns the number of karts. */
+    unsigned int size() const               { return (unsigned int)m_x.size(); }
+    // ------------------------------------------------------------------------
+    Vec3 getXYZ(unsigned int i) const
+    {
+        assert(i < m_x.size());
+        return Vec3(m_x[i], m_y[i], m_z[i]);
+    }   // getXYZ
+    // ------------------------------------------------------------------------
+    Vec3 getVelocity(unsigned int i) const
+    {
+        assert(i < m_x.size());
+        return Vec3(m_velocity_x[i], m_velocity_y[i], m_velocity_z[i]);
+    }   // getVelocity
+    // ------------------------------------------------------------------------
+    float getForwardSpeed(unsigned int i) const { return m_forward_speed[i]; }
+    // ------------------------------------------------------------------------
+    float getSpeed(unsigned int i) const                { return m_speed[i]; }
+};   // KartSnapshot
+
+#endif
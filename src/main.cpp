@@ -220,6 +220,7 @@ extern "C" {
 #include "graphics/particle_kind_manager.hpp"
 #include "graphics/referee.hpp"
 #include "graphics/sp/sp_base.hpp"
+#include "graphics/sp/sp_frustum_culler.hpp"
 #include "graphics/sp/sp_shader.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
@@ -244,6 +245,7 @@ extern "C" {
 #include "karts/official_karts.hpp"
 #include "modes/cutscene_world.hpp"
 #include "modes/demo_world.hpp"
+#include "network/ban_index.hpp"
 #include "network/protocols/connect_to_server.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/protocols/server_lobby.hpp"
@@ -252,6 +254,7 @@ extern "C" {
 #include "network/network_string.hpp"
 #include "network/protocols/connect_to_server.hpp"
 #include "network/protocols/client_lobby.hpp"
+#include "network/protocols/game_protocol.hpp"
 #include "network/protocols/server_lobby.hpp"
 #include "network/race_event_manager.hpp"
 #include "network/rewind_manager.hpp"
@@ -260,6 +263,7 @@ extern "C" {
 #include "network/server_config.hpp"
 #include "network/servers_manager.hpp"
 #include "network/socket_address.hpp"
+#include "network/state_delta.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 #include "online/profile_manager.hpp"
@@ -279,6 +283,7 @@ extern "C" {
 #include "states_screens/dialogs/message_dialog.hpp"
 #include "tips/tips_manager.hpp"
 #include "tracks/arena_graph.hpp"
+#include "tracks/graph.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/command_line.hpp"
@@ -291,6 +296,7 @@ extern "C" {
 #include "utils/stk_process.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
+#include "utils/worker_pool.hpp"
 #include "io/rich_presence.hpp"
 
 #include <IrrlichtDevice.h>
@@ -298,6 +304,7 @@ extern "C" {
 static void cleanSuperTuxKart();
 static void cleanUserConfig();
 void runUnitTests();
+void runMicroBenchmarks();
 
 // ============================================================================
 //                        gamepad visualisation screen
@@ -620,6 +627,8 @@ void cmdLineHelp()
                               "laps.\n"
     "       --profile-time=n   Enable automatic driven profile mode for n "
                               "seconds.\n"
+    "       --profile-trace=FILE Record profiler events and write them as Chrome\n"
+    "                          trace (JSON) to FILE on exit, also with --no-graphics.\n"
     "       --benchmark        Start Benchmark Mode, save results and exit. \n"
     "       --unlock-all       Permanently unlock all karts and tracks for testing.\n"
     "       --no-unlock-all    Disable unlock-all (i.e. base unlocking on player achievement).\n"
@@ -754,6 +763,7 @@ void cmdDebugHelp()
     "       --gamepad-visuals           Debug gamepads by visualising their values.\n"
     "       --no-high-scores            Disable writing high scores.\n"
     "       --unit-testing              Run unit tests and exit.\n"
+    "       --micro-benchmark           Run micro benchmarks and exit.\n"
     "       --gamepad-debug             Enable verbose logging of gamepad button presses.\n"
     "       --keyboard-debug            Enable verbose logging of keyboard key presses.\n"
     "       --wiimote-debug             Enable verbose logging of Wii Remote button presses.\n"
@@ -1057,6 +1067,8 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
         UserConfigParams::m_no_high_scores=true;
     if (CommandLine::has("--unit-testing"))
         UserConfigParams::m_unit_testing = true;
+    if (CommandLine::has("--micro-benchmark"))
+        UserConfigParams::m_micro_benchmark = true;
     if (CommandLine::has("--gamepad-debug"))
         UserConfigParams::m_gamepad_debug=true;
     if (CommandLine::has("--keyboard-debug"))
@@ -1770,6 +1782,14 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
         RaceManager::get()->setNumLaps(999999); // profile end depends on time
     }   // --profile-time
 
+    if (CommandLine::has("--profile-trace", &s))
+    {
+        Log::verbose("main", "Writing profiler trace to '%s'.", s.c_str());
+        profiler.setTraceFile(s);
+        profiler.setDrawing(false);
+        profiler.activate();
+    }   // --profile-trace
+
     if(CommandLine::has("--history"))
     {
         history->setReplayHistory(true);
@@ -1983,6 +2003,7 @@ void initRest()
     track_manager           = new TrackManager         ();
     kart_properties_manager = new KartPropertiesManager();
     ProjectileManager::create();
+    WorkerPool::create(UserConfigParams::m_worker_threads);
     powerup_manager         = new PowerupManager       ();
     attachment_manager      = new AttachmentManager    ();
     highscore_manager       = new HighscoreManager     ();
@@ -2211,6 +2232,8 @@ int main(int argc, char *argv[])
         std::string s, server_config;
 
         handleCmdLineOutputModifier();
+        // Write log messages on a separate thread from now on
+        Log::startLoggerThread();
 
         if (CommandLine::has("--server-config", &s))
         {
@@ -2416,6 +2439,12 @@ int main(int argc, char *argv[])
             exit(0);
         }
 
+        if(UserConfigParams::m_micro_benchmark)
+        {
+            runMicroBenchmarks();
+            exit(0);
+        }
+
 #ifndef SERVER_ONLY
         if (!GUIEngine::isNoGraphics())
         {
@@ -2664,6 +2693,7 @@ int main(int argc, char *argv[])
     MemoryLeaks::checkForLeaks();
 #endif
 
+    Log::stopLoggerThread();
     Log::flushBuffers();
 
 #ifndef WIN32
@@ -2714,6 +2744,7 @@ static void cleanSuperTuxKart()
 {
 
     delete main_loop;
+    profiler.writeChromeTraceOnExit();
 
     if(Online::RequestManager::isRunning())
         Online::RequestManager::get()->stopNetworkThread();
@@ -2753,6 +2784,7 @@ static void cleanSuperTuxKart()
     ItemManager::removeTextures();
     if(powerup_manager)         delete powerup_manager;
     ProjectileManager::destroy();
+    WorkerPool::destroy();
     if(kart_properties_manager) delete kart_properties_manager;
     if(track_manager)           delete track_manager;
     if(material_manager)        delete material_manager;
@@ -2891,13 +2923,49 @@ void runUnitTests()
     Log::info("UnitTest", "Arena Graph");
     ArenaGraph::unitTesting();
 
+    Log::info("UnitTest", "Graph sector search");
+    Graph::unitTesting();
+
     Log::info("UnitTest", "Fonts for translation");
     font_manager->unitTesting();
 
     Log::info("UnitTest", "RewindQueue");
     RewindQueue::unitTesting();
 
+    Log::info("UnitTest", "StateDelta");
+    StateDelta::unitTesting();
+
+    Log::info("UnitTest", "BanIndex");
+    BanIndex::unitTesting();
+
+    Log::info("UnitTest", "ItemManager");
+    ItemManager::unitTesting();
+
+    Log::info("UnitTest", "WorkerPool");
+    WorkerPool::unitTesting();
+
+    Log::info("UnitTest", "Replay format");
+    ReplayBase::unitTesting();
+
+    Log::info("UnitTest", "RequestManager");
+    Online::RequestManager::unitTesting();
+
     Log::info("UnitTest", "=====================");
     Log::info("UnitTest", "Testing successful   ");
     Log::info("UnitTest", "=====================");
 }   // runUnitTests
+
+//=============================================================================
+void runMicroBenchmarks()
+{
+    Log::info("MicroBenchmark", "Starting micro benchmarks");
+    Log::info("MicroBenchmark", "=====================");
+    Log::info("MicroBenchmark", "GameProtocol state");
+    GameProtocol::microBenchmark();
+#ifndef SERVER_ONLY
+    Log::info("MicroBenchmark", "SP frustum culling");
+    SP::SPFrustumCuller::microBenchmark();
+#endif
+
+    Log::info("MicroBenchmark", "=====================");
+}   // runMicroBenchmarks
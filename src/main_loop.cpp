@@ -45,6 +45,7 @@
 #include "network/race_event_manager.hpp"
 #include "network/rewind_manager.hpp"
 #include "network/server.hpp"
+#include "network/server_config.hpp"
 #include "network/stk_host.hpp"
 #include "online/request_manager.hpp"
 #include "race/history.hpp"
@@ -55,6 +56,7 @@
 #include "states_screens/state_manager.hpp"
 #include "utils/profiler.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/tick_scheduler.hpp"
 #include "utils/time.hpp"
 #include "utils/translation.hpp"
 #include "io/rich_presence.hpp"
@@ -404,6 +406,15 @@ void MainLoop::run()
     // happens in fixed timesteps
     double left_over_time = 0;
 
+    // A server without graphics waits for the deadline of each tick instead
+    // of throttling the frame rate
+    TickScheduler scheduler;
+    bool scheduler_init = false;
+    TimePoint next_tick = m_curr_time;
+    bool waited_for_tick = false;
+    const std::chrono::nanoseconds tick_time(
+        (int64_t)(stk_config->ticks2Time(1) * 1000000000.0));
+
 #ifdef WIN32
     HANDLE parent = 0;
     if (m_parent_pid != 0)
@@ -461,6 +472,13 @@ void MainLoop::run()
         int num_steps   = stk_config->time2Ticks(left_over_time);
         float dt = stk_config->ticks2Time(1);
         left_over_time -= num_steps * dt;
+        if (waited_for_tick)
+        {
+            for (int i = 0; i < num_steps; i++)
+                scheduler.addTick(next_tick + i * tick_time, m_curr_time,
+                    tick_time);
+            waited_for_tick = false;
+        }
 
         // Shutdown next frame if shutdown request is sent while loading the
         // world
@@ -708,7 +726,27 @@ void MainLoop::run()
             }
         }
 
-        if (!UserConfigParams::m_benchmark)
+        const bool tick_server = GUIEngine::isNoGraphics() &&
+            NetworkConfig::get()->isNetworking() &&
+            NetworkConfig::get()->isServer() && m_throttle_fps &&
+            !ProfileWorld::isProfileMode();
+        if (!UserConfigParams::m_benchmark && tick_server)
+        {
+            if (!scheduler_init)
+            {
+                scheduler.init(ServerConfig::m_tick_sleep_strategy,
+                    ServerConfig::m_simulation_thread_core);
+                scheduler_init = true;
+            }
+            // The next tick is due when the left over time reaches a tick
+            next_tick = m_curr_time + std::chrono::nanoseconds(
+                (int64_t)((dt - left_over_time) * 1000000000.0));
+            PROFILER_PUSH_CPU_MARKER("Wait for tick", 0, 0, 0);
+            scheduler.waitUntil(next_tick);
+            PROFILER_POP_CPU_MARKER();
+            waited_for_tick = true;
+        }
+        else if (!UserConfigParams::m_benchmark)
         {
             TimePoint frame_end = std::chrono::steady_clock::now();
             double frame_time = convertToTime(frame_end, frame_start) * 0.001;
@@ -739,6 +777,9 @@ void MainLoop::run()
         PROFILER_SYNC_FRAME();
     }  // while !m_abort
 
+    if (scheduler_init)
+        scheduler.logStatistics("MainLoop");
+
 #ifdef WIN32
     if (parent != 0 && parent != INVALID_HANDLE_VALUE)
         CloseHandle(parent);
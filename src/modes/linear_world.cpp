@@ -36,6 +36,7 @@
 #include "network/network_string.hpp"
 #include "network/protocols/game_events_protocol.hpp"
 #include "network/protocols/server_lobby.hpp"
+#include "network/rewind_manager.hpp"
 #include "network/server_config.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
@@ -377,10 +378,13 @@ void LinearWorld::newLap(unsigned int kart_index)
 {
     KartInfo &kart_info = m_kart_info[kart_index];
     AbstractKart *kart  = m_karts[kart_index].get();
+    // A lap crossed in a replayed tick was already announced when the tick
+    // was first simulated, only the lap state itself is updated again
+    const bool is_rewinding = RewindManager::get()->isRewinding();
 
     // Reset reset-after-lap achievements
     PlayerProfile *p = PlayerManager::getCurrentPlayer();
-    if (kart->getController()->canGetAchievements())
+    if (kart->getController()->canGetAchievements() && !is_rewinding)
     {
         p->getAchievementsStatus()->onLapEnd();
     }
@@ -413,13 +417,14 @@ void LinearWorld::newLap(unsigned int kart_index)
     // Last lap message (kart_index's assert in previous block already)
     if (raceHasLaps() && kart_info.m_finished_laps+1 == lap_count)
     {
-        if (lap_count > 1 && !isLiveJoinWorld() && m_race_gui)
+        if (lap_count > 1 && !isLiveJoinWorld() && m_race_gui &&
+            !is_rewinding)
         {
             m_race_gui->addMessage(_("Final lap!"), kart,
                                3.0f, GUIEngine::getSkin()->getColor("font::normal"), true,
                                true /* big font */, true /* outline */);
         }
-        if(!m_last_lap_sfx_played && lap_count > 1)
+        if(!m_last_lap_sfx_played && lap_count > 1 && !is_rewinding)
         {
             if (UserConfigParams::m_sfx)
             {
@@ -453,7 +458,8 @@ void LinearWorld::newLap(unsigned int kart_index)
         }
     }
     else if (raceHasLaps() && kart_info.m_finished_laps > 0 &&
-             kart_info.m_finished_laps+1 < lap_count && !isLiveJoinWorld() && m_race_gui)
+             kart_info.m_finished_laps+1 < lap_count && !isLiveJoinWorld() && m_race_gui &&
+             !is_rewinding)
     {
         m_race_gui->addMessage(_("Lap %i", kart_info.m_finished_laps+1), kart,
                                2.0f, GUIEngine::getSkin()->getColor("font::normal"), true,
@@ -559,7 +565,7 @@ void LinearWorld::newLap(unsigned int kart_index)
         irr::core::stringw m_fastest_lap_message =
             _C("fastest_lap", "%s by %s", s.c_str(), kart_name);
 
-        if (m_race_gui)
+        if (m_race_gui && !is_rewinding)
         {
             m_race_gui->addMessage(m_fastest_lap_message, NULL, 4.0f,
                 video::SColor(255, 255, 255, 255), false);
@@ -868,9 +874,36 @@ btTransform LinearWorld::getRescueTransform(unsigned int index) const
 }   // getRescueTransform
 
 //-----------------------------------------------------------------------------
-/** Find the position (rank) of every kart. ATM it uses a stable O(n^2)
- *  algorithm by counting for each kart how many other karts are ahead of
- *  it.
+/** Returns true if kart a comes before kart b in m_position_order. Karts
+ *  that are still racing come first, sorted by their overall distance,
+ *  and by their initial position if the distance is the same. All other
+ *  karts follow in the order of their index.
+ */
+bool LinearWorld::isRankedBefore(unsigned int a, unsigned int b) const
+{
+    const bool a_racing = !m_karts[a]->isEliminated() &&
+                          !m_karts[a]->hasFinishedRace();
+    const bool b_racing = !m_karts[b]->isEliminated() &&
+                          !m_karts[b]->hasFinishedRace();
+    if (a_racing != b_racing)
+        return a_racing;
+    if (!a_racing)
+        return a < b;
+    const float distance_a = m_kart_info[a].m_overall_distance;
+    const float distance_b = m_kart_info[b].m_overall_distance;
+    return distance_a > distance_b ||
+           (distance_a == distance_b &&
+            m_karts[a]->getInitialPosition() <
+            m_karts[b]->getInitialPosition());
+}   // isRankedBefore
+
+//-----------------------------------------------------------------------------
+/** Find the position (rank) of every kart. A kart that is still racing is
+ *  behind all karts that have finished the race, and behind all racing
+ *  karts that have covered a larger overall distance, or the same distance
+ *  but started earlier. Eliminated karts are ignored. The racing karts are
+ *  kept sorted in m_position_order, which is only insertion sorted again
+ *  since the order rarely changes between two calls.
  */
 void LinearWorld::updateRacePosition()
 {
@@ -882,57 +915,55 @@ void LinearWorld::updateRacePosition()
     bool rank_changed = false;
 #endif
 
-    // NOTE: if you do any changes to this loop, the next loop (see
-    // DEBUG_KART_RANK below) needs to have the same changes applied
-    // so that debug output is still correct!!!!!!!!!!!
-    for (unsigned int i=0; i<kart_amount; i++)
+    if (m_position_order.size() != kart_amount)
     {
-        AbstractKart* kart = m_karts[i].get();
+        m_position_order.resize(kart_amount);
+        for (unsigned int i = 0; i < kart_amount; i++)
+            m_position_order[i] = i;
+    }
+    for (unsigned int i = 1; i < kart_amount; i++)
+    {
+        const unsigned int kart_id = m_position_order[i];
+        unsigned int j = i;
+        for (; j > 0 && isRankedBefore(kart_id, m_position_order[j - 1]); j--)
+            m_position_order[j] = m_position_order[j - 1];
+        m_position_order[j] = kart_id;
+    }
+
+    // All karts that have finished the race are ahead of the racing karts
+    int p = 1;
+    for (unsigned int i = 0; i < kart_amount; i++)
+    {
+        if (!m_karts[i]->isEliminated() && m_karts[i]->hasFinishedRace())
+            p++;
+    }
+    m_new_position.resize(kart_amount);
+    for (unsigned int i = 0; i < kart_amount; i++)
+    {
+        const unsigned int kart_id = m_position_order[i];
+        const AbstractKart* kart = m_karts[kart_id].get();
         // Karts that are either eliminated or have finished the
         // race already have their (final) position assigned. If
         // these karts would get their rank updated, it could happen
         // that a kart that finished first will be overtaken after
         // crossing the finishing line and become second!
-        if(kart->isEliminated() || kart->hasFinishedRace())
-        {
-            // This is only necessary to support debugging inconsistencies
-            // in kart position parameters.
-            setKartPosition(i, kart->getPosition());
-            continue;
-        }
-        KartInfo& kart_info = m_kart_info[i];
-
-        int p = 1 ;
-
-        const unsigned int my_id = kart->getWorldKartId();
-        const float my_distance  = m_kart_info[my_id].m_overall_distance;
-
-        // Count karts ahead of the current kart, i.e. kart that are
-        // already finished or have covered a larger overall distance.
-        for (unsigned int j = 0 ; j < kart_amount ; j++)
-        {
-            // don't compare a kart with itself and ignore eliminated karts
-            if(j == my_id || m_karts[j]->isEliminated())
-                continue;
-
-            // If the other kart has:
-            // - finished the race (but this kart hasn't)
-            // - or is ahead
-            // - or has the same distance (very unlikely) but started earlier
-            // it is ahead --> increase position
-            if((!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace()) ||
-                m_kart_info[j].m_overall_distance > my_distance            ||
-               (m_kart_info[j].m_overall_distance == my_distance &&
-                m_karts[j]->getInitialPosition()<kart->getInitialPosition() ) )
-            {
-                p++;
-            }
+        if (kart->isEliminated() || kart->hasFinishedRace())
+            m_new_position[kart_id] = kart->getPosition();
+        else
+            m_new_position[kart_id] = p++;
+    }
 
-        } //next kart
+    // NOTE: if you do any changes to the ranking, the next loop (see
+    // DEBUG_KART_RANK below) needs to have the same changes applied
+    // so that debug output is still correct!!!!!!!!!!!
+    for (unsigned int i=0; i<kart_amount; i++)
+    {
+        p = m_new_position[i];
 
 #ifndef DEBUG
         setKartPosition(i, p);
 #else
+        AbstractKart* kart = m_karts[i].get();
         rank_changed |= kart->getPosition()!=p;
         if (!setKartPosition(i,p))
         {
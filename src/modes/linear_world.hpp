@@ -132,6 +132,15 @@ protected:
       */
     std::vector<KartInfo> m_kart_info;
 
+    /** All karts ordered by their race position in the last call of
+     *  updateRacePosition, karts which are still racing first. Since this
+     *  order rarely changes between two calls, it is sorted again in
+     *  almost linear time. */
+    std::vector<unsigned int> m_position_order;
+
+    /** The race positions computed in updateRacePosition. */
+    std::vector<int> m_new_position;
+
     virtual void  checkForWrongDirection(unsigned int i, float dt);
     virtual float estimateFinishTimeForKart(AbstractKart* kart) OVERRIDE;
 
@@ -149,6 +158,7 @@ public:
                                             bool account_for_checklines) const;
     void          updateTrackSectors();
     void          updateRacePosition();
+    bool          isRankedBefore(unsigned int a, unsigned int b) const;
     float         getDistanceToCenterForKart(const int kart_id) const;
     float         getEstimatedFinishTime(const int kart_id) const;
     int           getLapForKart(const int kart_id) const;
@@ -30,6 +30,7 @@
 #include "graphics/irr_driver.hpp"
 #include "graphics/material.hpp"
 #include "graphics/material_manager.hpp"
+#include "graphics/slip_stream.hpp"
 #include <ge_render_info.hpp>
 #include "guiengine/modaldialog.hpp"
 #include "guiengine/screen_keyboard.hpp"
@@ -83,6 +84,7 @@
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <IrrlichtDevice.h>
 #include <ISceneManager.h>
@@ -1085,6 +1087,34 @@ void World::updateWorld(int ticks)
     }
 }   // updateWorld
 
+//-----------------------------------------------------------------------------
+/** Simulates time steps during a rewind. Unlike updateWorld() this does not
+ *  handle scheduled pauses or the end of the race, these are left to the
+ *  next updateWorld() call once all ticks of the rewind are replayed.
+ *  It still calls the virtual update(), since the game modes update state
+ *  that is part of the simulation there (kart positions and track sectors,
+ *  the soccer ball, flags, checks and items via updateTrack()). World::update
+ *  itself only runs updateSimulation() while rewinding.
+ *  \param ticks Number of ticks to simulate - should be 1.
+ */
+void World::updateForRewind(int ticks)
+{
+    assert(RewindManager::get()->isRewinding());
+    if ((getPhase() == FINISH_PHASE) ||
+        ((getPhase() == IN_GAME_MENU_PHASE) &&
+        (!NetworkConfig::get()->isNetworking() || !RaceManager::get()->isBenchmarking())))
+        return;
+
+    try
+    {
+        update(ticks);
+    }
+    catch (AbortWorldUpdateException& e)
+    {
+        (void)e;   // avoid compiler warning
+    }
+}   // updateForRewind
+
 #define MEASURE_FPS 0
 
 //-----------------------------------------------------------------------------
@@ -1142,6 +1172,36 @@ void World::updateGraphics(float dt)
     Track::getCurrentTrack()->updateGraphics(dt);
 }   // updateGraphics
 
+//-----------------------------------------------------------------------------
+/** Lets all controllers which support it decide what to do in this time
+ *  step in parallel. They only read the snapshot of the karts taken after
+ *  the last physics step, so the result does not depend on the order or on
+ *  the number of threads. Kart::update then calls the controllers one by one as
+ *  before, which use their decision if it is still valid.
+ *  \param ticks Number of physics time steps - should be 1.
+ */
+void World::decideControllers(int ticks)
+{
+    m_deciding_controllers.clear();
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        AbstractKart* kart = m_karts[i].get();
+        Controller* controller = kart->getController();
+        if (!kart->isEliminated() && controller && controller->canDecide())
+            m_deciding_controllers.push_back(controller);
+    }
+    if (m_deciding_controllers.empty())
+        return;
+
+    PROFILER_PUSH_CPU_MARKER("World::update (AI decide)", 0x40, 0x7F, 0x40);
+    WorkerPool::parallelFor((unsigned int)m_deciding_controllers.size(),
+        [this, ticks](unsigned int i)
+        {
+            m_deciding_controllers[i]->decide(ticks);
+        });
+    PROFILER_POP_CPU_MARKER();
+}   // decideControllers
+
 //-----------------------------------------------------------------------------
 /** Updates the physics, all karts, the track, and projectile manager.
  *  \param ticks Number of physics time steps - should be 1.
@@ -1164,6 +1224,15 @@ void World::update(int ticks)
     }
 #endif
 
+    // Replayed ticks of a rewind only need the simulation, the cameras,
+    // state saving and sounds are handled by the next regular update
+    if (RewindManager::get()->isRewinding())
+    {
+        updateSimulation(ticks);
+        PROFILER_POP_CPU_MARKER();
+        return;
+    }
+
     if (m_restart_camera)
     {
         m_restart_camera = false;
@@ -1181,8 +1250,31 @@ void World::update(int ticks)
     RewindManager::get()->update(ticks);
     PROFILER_POP_CPU_MARKER();
 
+    updateSimulation(ticks);
+
+    PROFILER_POP_CPU_MARKER();
+    updateTimeTargetSound();
+
+#ifdef DEBUG
+    assert(m_magic_number == 0xB01D6543);
+#endif
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Updates the parts of the world that are simulated: the physical track
+ *  objects, all karts, the projectiles and the physics. This is used for
+ *  each normal time step, and on its own for the ticks replayed during a
+ *  rewind.
+ *  \param ticks Number of physics time steps - should be 1.
+ */
+void World::updateSimulation(int ticks)
+{
     PROFILER_PUSH_CPU_MARKER("World::update (Track object manager)", 0x20, 0x7F, 0x40);
-    Track::getCurrentTrack()->getTrackObjectManager()->update(stk_config->ticks2Time(ticks));
+    TrackObjectManager* tom = Track::getCurrentTrack()->getTrackObjectManager();
+    if (RewindManager::get()->isRewinding())
+        tom->updateForRewind(stk_config->ticks2Time(ticks));
+    else
+        tom->update(stk_config->ticks2Time(ticks));
     PROFILER_POP_CPU_MARKER();
 
     PROFILER_PUSH_CPU_MARKER("World::update (Kart::upate)", 0x40, 0x7F, 0x00);
@@ -1190,6 +1282,9 @@ void World::update(int ticks)
     // Update all the karts. This in turn will also update the controller,
     // which causes all AI steering commands set. So in the following
     // physics update the new steering is taken into account.
+    m_kart_snapshot.update(this);
+    SlipStream::findCandidates(this);
+    decideControllers(ticks);
     const int kart_amount = (int)m_karts.size();
     for (int i = 0 ; i < kart_amount; ++i)
     {
@@ -1202,7 +1297,9 @@ void World::update(int ticks)
             m_karts[i]->makeKartRest();
     }
     PROFILER_POP_CPU_MARKER();
-    if(RaceManager::get()->isRecordingRace()) ReplayRecorder::get()->update(ticks);
+    if (RaceManager::get()->isRecordingRace() &&
+        !RewindManager::get()->isRewinding())
+        ReplayRecorder::get()->update(ticks);
 
     PROFILER_PUSH_CPU_MARKER("World::update (projectiles)", 0xa0, 0x7F, 0x00);
     ProjectileManager::get()->update(ticks);
@@ -1211,14 +1308,7 @@ void World::update(int ticks)
     PROFILER_PUSH_CPU_MARKER("World::update (physics)", 0xa0, 0x7F, 0x00);
     Physics::get()->update(ticks);
     PROFILER_POP_CPU_MARKER();
-
-    PROFILER_POP_CPU_MARKER();
-    updateTimeTargetSound();
-
-#ifdef DEBUG
-    assert(m_magic_number == 0xB01D6543);
-#endif
-}   // update
+}   // updateSimulation
 
 // ----------------------------------------------------------------------------
 /** Only updates the track. The order in which the various parts of STK are
@@ -33,6 +33,7 @@
 #include <stdexcept>
 
 #include "graphics/weather.hpp"
+#include "karts/kart_snapshot.hpp"
 #include "modes/world_status.hpp"
 #include "race/highscores.hpp"
 #include "states_screens/race_gui_base.hpp"
@@ -113,6 +114,13 @@ protected:
 
     /** The list of all karts. */
     KartList                  m_karts;
+
+    /** State of all karts after the last physics step. */
+    KartSnapshot              m_kart_snapshot;
+
+    /** Controllers which decide in parallel in this time step. */
+    std::vector<Controller*>  m_deciding_controllers;
+
     RandomGenerator           m_random;
 
     AbstractKart* m_fastest_kart;
@@ -135,6 +143,7 @@ protected:
     bool        m_use_highscores;
 
     void  updateHighscores  (int* best_highscore_rank);
+    void  decideControllers (int ticks);
     void  resetAllKarts     ();
     Controller*
           loadAIController  (AbstractKart *kart);
@@ -190,6 +199,7 @@ protected:
     /** Returns true if the race is over. Must be defined by all modes. */
     virtual bool  isRaceOver() = 0;
     virtual void  update(int ticks) OVERRIDE;
+            void  updateSimulation(int ticks);
     virtual void  createRaceGUI();
             void  updateTrack(int ticks);
     // ------------------------------------------------------------------------
@@ -326,6 +336,7 @@ public:
     void            scheduleExitRace() { m_schedule_exit_race = true; }
     void            scheduleTutorial();
     void            updateWorld(int ticks);
+    void            updateForRewind(int ticks);
     void            handleExplosion(const Vec3 &xyz, AbstractKart *kart_hit,
                                     PhysicalObject *object);
     AbstractKart*   getPlayerKart(unsigned int player) const;
@@ -348,6 +359,10 @@ public:
     /** Returns all karts. */
     const KartList & getKarts() const { return m_karts; }
     // ------------------------------------------------------------------------
+    /** Returns the state of all karts after the last physics step, which
+     *  is updated before the karts are updated. */
+    const KartSnapshot& getKartSnapshot() const { return m_kart_snapshot; }
+    // ------------------------------------------------------------------------
     /** Returns the number of currently active (i.e.non-elikminated) karts. */
     unsigned int    getCurrentNumKarts() const { return (int)m_karts.size() -
                                                          m_eliminated_karts; }
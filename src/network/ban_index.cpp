@@ -0,0 +1,236 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/ban_index.hpp"
+
+#include "network/stk_ipv6.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+// ----------------------------------------------------------------------------
+BanIndex::BanIndex()
+{
+    Ipv6Node root = {{ -1, -1 }, -1};
+    m_ipv6_nodes.push_back(root);
+    m_sorted = true;
+}   // BanIndex
+
+// ----------------------------------------------------------------------------
+void BanIndex::addIpBan(const IpBan& ban)
+{
+    m_ip_bans.push_back(ban);
+    m_sorted = false;
+}   // addIpBan
+
+// ----------------------------------------------------------------------------
+/** Adds an IPv6 ban, the CIDR block is parsed the same way as
+ *  insideIPv6CIDR does.
+ *  \return False if the CIDR block is invalid, it's not added then.
+ */
+bool BanIndex::addIpv6Ban(const Ipv6Ban& ban)
+{
+    size_t mask_location = ban.m_ipv6_cidr.find('/');
+    if (mask_location == std::string::npos)
+        return false;
+    unsigned char addr[16];
+    std::string ipv6 = ban.m_ipv6_cidr.substr(0, mask_location);
+    if (parseIPv6(ipv6.c_str(), addr) != 1)
+        return false;
+    int mask_length = atoi(ban.m_ipv6_cidr.c_str() + mask_location + 1);
+    if (mask_length > 128 || mask_length <= 0)
+        return false;
+
+    int node = 0;
+    for (int i = 0; i < mask_length; i++)
+    {
+        int bit = (addr[i / 8] >> (7 - i % 8)) & 1;
+        if (m_ipv6_nodes[node].m_child[bit] == -1)
+        {
+            Ipv6Node child = {{ -1, -1 }, -1};
+            m_ipv6_nodes[node].m_child[bit] = (int)m_ipv6_nodes.size();
+            m_ipv6_nodes.push_back(child);
+        }
+        node = m_ipv6_nodes[node].m_child[bit];
+    }
+    // Keep the first row like the LIMIT 1 query did
+    if (m_ipv6_nodes[node].m_ban == -1)
+    {
+        m_ipv6_nodes[node].m_ban = (int)m_ipv6_bans.size();
+        m_ipv6_bans.push_back(ban);
+    }
+    return true;
+}   // addIpv6Ban
+
+// ----------------------------------------------------------------------------
+void BanIndex::addOnlineIdBan(uint32_t online_id, const Ban& ban)
+{
+    m_online_id_bans.insert(std::make_pair(online_id, ban));
+}   // addOnlineIdBan
+
+// ----------------------------------------------------------------------------
+/** Prepares the IPv4 bans for searching, must be called after adding them. */
+void BanIndex::sort()
+{
+    std::stable_sort(m_ip_bans.begin(), m_ip_bans.end(),
+        [](const IpBan& a, const IpBan& b)
+        {
+            return a.m_ip_start < b.m_ip_start;
+        });
+    m_ip_max_end.resize(m_ip_bans.size());
+    uint32_t max_end = 0;
+    for (unsigned i = 0; i < m_ip_bans.size(); i++)
+    {
+        max_end = std::max(max_end, m_ip_bans[i].m_ip_end);
+        m_ip_max_end[i] = max_end;
+    }
+    m_sorted = true;
+}   // sort
+
+// ----------------------------------------------------------------------------
+/** Returns the ban whose range contains ip, or NULL if not banned. */
+const BanIndex::IpBan* BanIndex::findIp(uint32_t ip) const
+{
+    assert(m_sorted);
+    auto it = std::upper_bound(m_ip_bans.begin(), m_ip_bans.end(), ip,
+        [](uint32_t value, const IpBan& ban)
+        { return value < ban.m_ip_start; });
+    // All ranges before it start at or before ip, go back as long as some
+    // of them can still reach ip
+    for (int i = (int)(it - m_ip_bans.begin()) - 1;
+         i >= 0 && m_ip_max_end[i] >= ip; i--)
+    {
+        if (m_ip_bans[i].m_ip_end >= ip)
+            return &m_ip_bans[i];
+    }
+    return NULL;
+}   // findIp
+
+// ----------------------------------------------------------------------------
+/** Returns the ban with the longest CIDR block prefix that contains ipv6,
+ *  or NULL if not banned. */
+const BanIndex::Ipv6Ban* BanIndex::findIpv6(const std::string& ipv6) const
+{
+    unsigned char addr[16];
+    if (parseIPv6(ipv6.c_str(), addr) != 1)
+        return NULL;
+    const Ipv6Ban* longest_match = NULL;
+    int node = 0;
+    for (int i = 0; i < 128; i++)
+    {
+        int bit = (addr[i / 8] >> (7 - i % 8)) & 1;
+        node = m_ipv6_nodes[node].m_child[bit];
+        if (node == -1)
+            break;
+        if (m_ipv6_nodes[node].m_ban != -1)
+            longest_match = &m_ipv6_bans[m_ipv6_nodes[node].m_ban];
+    }
+    return longest_match;
+}   // findIpv6
+
+// ----------------------------------------------------------------------------
+const BanIndex::Ban* BanIndex::findOnlineId(uint32_t online_id) const
+{
+    auto it = m_online_id_bans.find(online_id);
+    return it == m_online_id_bans.end() ? NULL : &it->second;
+}   // findOnlineId
+
+// ----------------------------------------------------------------------------
+void BanIndex::unitTesting()
+{
+    BanIndex index;
+    IpBan ip_ban;
+    ip_ban.m_row_id = 1;
+    ip_ban.m_ip_start = 100;
+    ip_ban.m_ip_end = 1000;
+    index.addIpBan(ip_ban);
+    ip_ban.m_row_id = 2;
+    ip_ban.m_ip_start = 200;
+    ip_ban.m_ip_end = 300;
+    index.addIpBan(ip_ban);
+    ip_ban.m_row_id = 3;
+    ip_ban.m_ip_start = 2000;
+    ip_ban.m_ip_end = 2000;
+    index.addIpBan(ip_ban);
+    index.sort();
+    assert(index.findIp(99) == NULL);
+    assert(index.findIp(100)->m_row_id == 1);
+    assert(index.findIp(250) != NULL);
+    // Covered only by the range starting earlier
+    assert(index.findIp(500)->m_row_id == 1);
+    assert(index.findIp(1000)->m_row_id == 1);
+    assert(index.findIp(1001) == NULL);
+    assert(index.findIp(2000)->m_row_id == 3);
+    assert(index.findIp(2001) == NULL);
+
+    // The first three blocks are valid, 2001:db8:1::/48 is inside of
+    // 2001:db8::/32
+    const char* cidrs[] = { "2001:db8::/32", "fe80::1/128", "2001:db8:1::/48",
+                            "::/0", "bad/64", "2001:db8::/129" };
+    const unsigned num_valid = 3;
+    int error_count = 0;
+    for (unsigned i = 0; i < sizeof(cidrs) / sizeof(cidrs[0]); i++)
+    {
+        Ipv6Ban ipv6_ban;
+        ipv6_ban.m_row_id = i;
+        ipv6_ban.m_ipv6_cidr = cidrs[i];
+        if (index.addIpv6Ban(ipv6_ban) != (i < num_valid))
+        {
+            Log::error("BanIndex", "CIDR block '%s' was %s.", cidrs[i],
+                       i < num_valid ? "not added" : "added");
+            error_count++;
+        }
+    }
+    const char* addrs[] = { "2001:db8::1", "2001:db8:ffff::", "2001:db9::1",
+                            "2001:db8:1::5", "fe80::1", "fe80::2", "::1" };
+    for (const char* addr : addrs)
+    {
+        const Ipv6Ban* ban = index.findIpv6(addr);
+        // The expected ban is the longest block containing the address
+        const char* expected = NULL;
+        int expected_length = -1;
+        for (unsigned i = 0; i < num_valid; i++)
+        {
+            int length = atoi(strchr(cidrs[i], '/') + 1);
+            if (insideIPv6CIDR(cidrs[i], addr) == 1 &&
+                length > expected_length)
+            {
+                expected = cidrs[i];
+                expected_length = length;
+            }
+        }
+        if ((ban == NULL) != (expected == NULL) ||
+            (ban && ban->m_ipv6_cidr != expected))
+        {
+            Log::error("BanIndex", "Address '%s' matched '%s' instead of "
+                       "'%s'.", addr, ban ? ban->m_ipv6_cidr.c_str() : "none",
+                       expected ? expected : "none");
+            error_count++;
+        }
+    }
+    assert(error_count == 0);
+
+    Ban ban;
+    ban.m_row_id = 7;
+    index.addOnlineIdBan(42, ban);
+    assert(index.findOnlineId(42)->m_row_id == 7);
+    assert(index.findOnlineId(43) == NULL);
+}   // unitTesting
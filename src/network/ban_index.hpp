@@ -0,0 +1,101 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_BAN_INDEX_HPP
+#define HEADER_BAN_INDEX_HPP
+
+#include "utils/types.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** \ingroup network
+ *  In-memory copy of the ban tables, so a connecting peer can be checked
+ *  without a database query. IPv4 bans are ranges sorted by their start,
+ *  IPv6 bans are CIDR blocks stored in a binary trie of the address bits,
+ *  so a lookup takes at most 128 steps.
+ *  The index is built once and not changed afterwards, a refreshed one is
+ *  built to replace it.
+ */
+class BanIndex
+{
+public:
+    /** A row of a ban table. */
+    struct Ban
+    {
+        int m_row_id;
+        std::string m_reason;
+        std::string m_description;
+    };
+    /** A row of the IPv4 ban table. */
+    struct IpBan : public Ban
+    {
+        uint32_t m_ip_start;
+        uint32_t m_ip_end;
+    };
+    /** A row of the IPv6 ban table. */
+    struct Ipv6Ban : public Ban
+    {
+        std::string m_ipv6_cidr;
+    };
+
+private:
+    /** IPv4 bans sorted by m_ip_start. */
+    std::vector<IpBan> m_ip_bans;
+
+    /** Largest m_ip_end of m_ip_bans up to the same index, so the search
+     *  for overlapping ranges can stop early. */
+    std::vector<uint32_t> m_ip_max_end;
+
+    /** A node of the IPv6 trie, the root is the first node. */
+    struct Ipv6Node
+    {
+        int m_child[2];
+        /** Index in m_ipv6_bans if a CIDR block ends here, or -1. */
+        int m_ban;
+    };
+    std::vector<Ipv6Node> m_ipv6_nodes;
+
+    std::vector<Ipv6Ban> m_ipv6_bans;
+
+    std::unordered_map<uint32_t, Ban> m_online_id_bans;
+
+    bool m_sorted;
+
+public:
+    BanIndex();
+    // ------------------------------------------------------------------------
+    void addIpBan(const IpBan& ban);
+    // ------------------------------------------------------------------------
+    bool addIpv6Ban(const Ipv6Ban& ban);
+    // ------------------------------------------------------------------------
+    void addOnlineIdBan(uint32_t online_id, const Ban& ban);
+    // ------------------------------------------------------------------------
+    void sort();
+    // ------------------------------------------------------------------------
+    const IpBan* findIp(uint32_t ip) const;
+    // ------------------------------------------------------------------------
+    const Ipv6Ban* findIpv6(const std::string& ipv6) const;
+    // ------------------------------------------------------------------------
+    const Ban* findOnlineId(uint32_t online_id) const;
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+};   // class BanIndex
+
+#endif // HEADER_BAN_INDEX_HPP
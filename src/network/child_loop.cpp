@@ -30,51 +30,9 @@
 #include "states_screens/state_manager.hpp"
 #include "utils/log.hpp"
 #include "utils/stk_process.hpp"
-#include "utils/time.hpp"
+#include "utils/tick_scheduler.hpp"
 #include "utils/vs.hpp"
 
-// ----------------------------------------------------------------------------
-float ChildLoop::getLimitedDt()
-{
-    m_prev_time = m_curr_time;
-
-    float dt = 0;
-    while (1)
-    {
-        m_curr_time = StkTime::getMonoTimeMs();
-        if (m_prev_time > m_curr_time)
-        {
-            m_prev_time = m_curr_time;
-        }
-        dt = (float)(m_curr_time - m_prev_time);
-        while (dt == 0)
-        {
-            StkTime::sleep(1);
-            m_curr_time = StkTime::getMonoTimeMs();
-            if (m_prev_time > m_curr_time)
-            {
-                Log::error("MainLopp", "System clock keeps backwards!");
-                m_prev_time = m_curr_time;
-            }
-            dt = (float)(m_curr_time - m_prev_time);
-        }
-        if (UserConfigParams::m_benchmark)
-            break;
-
-        const int current_fps = (int)(1000.0f / dt);
-        const int max_fps = UserConfigParams::m_max_fps;
-        if (current_fps <= max_fps)
-            break;
-
-        int wait_time = 1000 / max_fps - 1000 / current_fps;
-        if (wait_time < 1) wait_time = 1;
-
-        StkTime::sleep(wait_time);
-    }   // while(1)
-    dt *= 0.001f;
-    return dt;
-}   // getLimitedDt
-
 // ----------------------------------------------------------------------------
 void ChildLoop::run()
 {
@@ -111,8 +69,15 @@ void ChildLoop::run()
     ServerConfig::loadServerLobbyFromConfig();
     StateManager::get()->enterMenuState();
 
-    m_curr_time = StkTime::getMonoTimeMs();
-    float left_over_time = 0;
+    // Run each tick at its deadline, instead of sleeping whole milliseconds
+    // and running the ticks which became due meanwhile in a burst
+    TickScheduler scheduler;
+    scheduler.init(ServerConfig::m_tick_sleep_strategy,
+        ServerConfig::m_simulation_thread_core);
+    const std::chrono::nanoseconds tick_time(
+        (int64_t)(stk_config->ticks2Time(1) * 1000000000.0));
+    TickScheduler::TimePoint next_tick = std::chrono::steady_clock::now();
+    bool had_world = false;
     while (!m_abort)
     {
         if (STKHost::existHost() && STKHost::get()->requestedShutdown())
@@ -130,10 +95,25 @@ void ChildLoop::run()
             }
         }
 
-        left_over_time += getLimitedDt();
-        int num_steps = stk_config->time2Ticks(left_over_time);
-        float dt = stk_config->ticks2Time(1);
-        left_over_time -= num_steps * dt;
+        scheduler.waitUntil(next_tick);
+        TickScheduler::TimePoint now = std::chrono::steady_clock::now();
+        int num_steps = 0;
+        while (next_tick <= now)
+        {
+            scheduler.addTick(next_tick, now, tick_time);
+            next_tick += tick_time;
+            num_steps++;
+        }
+
+        // Report the timing of each race
+        if (World::getWorld())
+            had_world = true;
+        else if (had_world)
+        {
+            scheduler.logStatistics("ChildLoop");
+            scheduler.resetStatistics();
+            had_world = false;
+        }
 
         for (int i = 0; i < num_steps; i++)
         {
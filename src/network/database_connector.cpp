@@ -20,6 +20,7 @@
 
 #include "network/database_connector.hpp"
 
+#include "network/ban_index.hpp"
 #include "network/network_player_profile.hpp"
 #include "network/server_config.hpp"
 #include "network/socket_address.hpp"
@@ -27,6 +28,11 @@
 #include "network/stk_ipv6.hpp"
 #include "network/stk_peer.hpp"
 #include "utils/log.hpp"
+#include "utils/vs.hpp"
+
+/** Number of prepared statements kept per connection, values are bound
+ *  so this only needs to hold the distinct queries. */
+static const unsigned MAX_CACHED_STATEMENTS = 64;
 
 //-----------------------------------------------------------------------------
 /** Prints "?" to the output stream and saves the Binder object to the
@@ -58,8 +64,19 @@ std::function<void(sqlite3_stmt* stmt)> BinderCollection::getBindFunction() cons
         {
             if (binder)
             {
+                if (binder->m_use_integer)
+                {
+                    if (sqlite3_bind_int64(stmt, idx, binder->m_integer) !=
+                        SQLITE_OK)
+                    {
+                        Log::error("easySQLQuery", "Failed to bind %lld as "
+                            "%s.", (long long)binder->m_integer,
+                            binder->m_name.c_str());
+                    }
+                }
                 // SQLITE_TRANSIENT to copy string
-                if (binder->m_use_null_if_empty && binder->m_value.empty())
+                else if (binder->m_use_null_if_empty &&
+                         binder->m_value.empty())
                 {
                     if (sqlite3_bind_null(stmt, idx) != SQLITE_OK)
                     {
@@ -82,49 +99,77 @@ std::function<void(sqlite3_stmt* stmt)> BinderCollection::getBindFunction() cons
     };
 }   // BinderCollection::getBindFunction
 
+//-----------------------------------------------------------------------------
+/** Opens a connection to the database and sets its busy handler and the
+ *  functions used in queries.
+ *  \param path Path of the database file.
+ *  \param flags Flags for sqlite3_open_v2 besides SQLITE_OPEN_READWRITE.
+ *  \return The connection or NULL if the database cannot be opened.
+ */
+sqlite3* DatabaseConnector::openDatabase(const std::string& path, int flags)
+{
+    sqlite3* db = NULL;
+    int ret = sqlite3_open_v2(path.c_str(), &db,
+        flags | SQLITE_OPEN_READWRITE, NULL);
+    if (ret != SQLITE_OK)
+    {
+        Log::error("ServerLobby", "Cannot open database: %s.",
+            sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return NULL;
+    }
+    sqlite3_busy_handler(db, [](void* data, int retry)
+        {
+            int retry_count = ServerConfig::m_database_timeout / 100;
+            if (retry < retry_count)
+            {
+                sqlite3_sleep(100);
+                // Return non-zero to let caller retry again
+                return 1;
+            }
+            // Return zero to let caller return SQLITE_BUSY immediately
+            return 0;
+        }, NULL);
+    sqlite3_create_function(db, "insideIPv6CIDR", 2, SQLITE_UTF8, NULL,
+        &insideIPv6CIDRSQL, NULL, NULL);
+    sqlite3_create_function(db, "upperIPv6", 1, SQLITE_UTF8, NULL,
+        &upperIPv6SQL, NULL, NULL);
+    return db;
+}   // openDatabase
+
 //-----------------------------------------------------------------------------
 /** Opens the database, sets its busy handler and variables related to it. */
 void DatabaseConnector::initDatabase()
 {
     m_last_poll_db_time = StkTime::getMonoTimeMs();
     m_db = NULL;
+    m_worker_db = NULL;
     m_ip_ban_table_exists = false;
     m_ipv6_ban_table_exists = false;
     m_online_id_ban_table_exists = false;
     m_ip_geolocation_table_exists = false;
     m_ipv6_geolocation_table_exists = false;
     m_player_reports_table_exists = false;
+    m_stop_worker = false;
+    m_ban_index = std::make_shared<const BanIndex>();
     if (!ServerConfig::m_sql_management)
         return;
     const std::string& path = ServerConfig::getConfigDirectory() + "/" +
         ServerConfig::m_database_file.c_str();
-    int ret = sqlite3_open_v2(path.c_str(), &m_db,
-        SQLITE_OPEN_SHAREDCACHE | SQLITE_OPEN_FULLMUTEX |
-        SQLITE_OPEN_READWRITE, NULL);
-    if (ret != SQLITE_OK)
+    m_db = openDatabase(path,
+        SQLITE_OPEN_SHAREDCACHE | SQLITE_OPEN_FULLMUTEX);
+    if (!m_db)
+        return;
+    // A private cache, so table locks of the other connection are handled
+    // by the busy handler instead of failing at once
+    m_worker_db = openDatabase(path,
+        SQLITE_OPEN_PRIVATECACHE | SQLITE_OPEN_NOMUTEX);
+    if (!m_worker_db)
     {
-        Log::error("ServerLobby", "Cannot open database: %s.",
-            sqlite3_errmsg(m_db));
         sqlite3_close(m_db);
         m_db = NULL;
         return;
     }
-    sqlite3_busy_handler(m_db, [](void* data, int retry)
-        {
-            int retry_count = ServerConfig::m_database_timeout / 100;
-            if (retry < retry_count)
-            {
-                sqlite3_sleep(100);
-                // Return non-zero to let caller retry again
-                return 1;
-            }
-            // Return zero to let caller return SQLITE_BUSY immediately
-            return 0;
-        }, NULL);
-    sqlite3_create_function(m_db, "insideIPv6CIDR", 2, SQLITE_UTF8, NULL,
-        &insideIPv6CIDRSQL, NULL, NULL);
-    sqlite3_create_function(m_db, "upperIPv6", 1, SQLITE_UTF8, NULL,
-        &upperIPv6SQL, NULL, NULL);
     checkTableExists(ServerConfig::m_ip_ban_table, m_ip_ban_table_exists);
     checkTableExists(ServerConfig::m_ipv6_ban_table, m_ipv6_ban_table_exists);
     checkTableExists(ServerConfig::m_online_id_ban_table,
@@ -135,19 +180,208 @@ void DatabaseConnector::initDatabase()
         m_ip_geolocation_table_exists);
     checkTableExists(ServerConfig::m_ipv6_geolocation_table,
         m_ipv6_geolocation_table_exists);
+    m_ban_index = loadBanIndex();
+    m_worker = std::thread(&DatabaseConnector::workerLoop, this);
 }   // initDatabase
 
 //-----------------------------------------------------------------------------
-/** Closes the database. */
+/** Closes the database, after all queued queries are done. */
 void DatabaseConnector::destroyDatabase()
 {
     auto peers = STKHost::get()->getPeers();
     for (auto& peer : peers)
         writeDisconnectInfoTable(peer.get());
+    writeBanTriggerCounts();
+    if (m_worker.joinable())
+    {
+        std::unique_lock<std::mutex> ul(m_jobs_mutex);
+        m_stop_worker = true;
+        ul.unlock();
+        m_jobs_cv.notify_one();
+        m_worker.join();
+    }
+    // The lobby is going away, so nobody handles the callbacks anymore
+    std::lock_guard<std::mutex> lock(m_callbacks_mutex);
+    m_callbacks.clear();
+    if (m_worker_db != NULL)
+    {
+        clearStatements(&m_worker_statements);
+        sqlite3_close(m_worker_db);
+        m_worker_db = NULL;
+    }
     if (m_db != NULL)
+    {
+        clearStatements(&m_statements);
         sqlite3_close(m_db);
+    }
 }   // destroyDatabase
 
+//-----------------------------------------------------------------------------
+/** The worker thread, it runs the queued jobs in order. Consecutive queries
+ *  are committed in one transaction, so sqlite syncs the disk only once for
+ *  them.
+ */
+void DatabaseConnector::workerLoop()
+{
+    VS::setThreadName("DatabaseWorker");
+    std::unique_lock<std::mutex> ul(m_jobs_mutex);
+    while (true)
+    {
+        m_jobs_cv.wait(ul, [this]()
+            { return m_stop_worker || !m_jobs.empty(); });
+        // Stop only after all queued jobs are done
+        if (m_jobs.empty())
+            break;
+        std::deque<Job> jobs;
+        std::swap(jobs, m_jobs);
+        ul.unlock();
+
+        size_t i = 0;
+        while (i < jobs.size())
+        {
+            if (jobs[i].m_read)
+            {
+                std::function<void()> callback = jobs[i].m_read();
+                if (callback)
+                    addCallback(std::move(callback));
+                i++;
+                continue;
+            }
+            size_t end = i;
+            while (end < jobs.size() && !jobs[end].m_read)
+                end++;
+            const bool transaction = end - i > 1 && easySQLQuery("BEGIN;");
+            std::vector<std::pair<std::function<void(bool)>, bool> > done;
+            for (; i < end; i++)
+            {
+                bool written = easySQLQuery(jobs[i].m_query, nullptr,
+                    jobs[i].m_bind_function);
+                if (jobs[i].m_done)
+                    done.emplace_back(jobs[i].m_done, written);
+            }
+            bool committed = true;
+            if (transaction && !easySQLQuery("COMMIT;"))
+            {
+                easySQLQuery("ROLLBACK;");
+                committed = false;
+            }
+            for (auto& d : done)
+            {
+                std::function<void(bool)> f = d.first;
+                const bool written = d.second && committed;
+                addCallback([f, written]() { f(written); });
+            }
+        }
+        ul.lock();
+    }
+}   // workerLoop
+
+//-----------------------------------------------------------------------------
+void DatabaseConnector::addJob(Job&& job)
+{
+    if (!m_worker.joinable())
+        return;
+    std::unique_lock<std::mutex> ul(m_jobs_mutex);
+    m_jobs.push_back(std::move(job));
+    ul.unlock();
+    m_jobs_cv.notify_one();
+}   // addJob
+
+//-----------------------------------------------------------------------------
+void DatabaseConnector::addCallback(std::function<void()>&& callback)
+{
+    std::lock_guard<std::mutex> lock(m_callbacks_mutex);
+    m_callbacks.push_back(std::move(callback));
+}   // addCallback
+
+//-----------------------------------------------------------------------------
+/** Runs the query in the worker thread, the result is ignored.
+ *  \param query The SQL query with '?'-placeholders for values to bind.
+ *  \param bind_function The function for binding missing values.
+ *  \param done Optional function called in \ref handleCallbacks with true if
+ *               the query succeeded.
+ */
+void DatabaseConnector::queueQuery(const std::string& query,
+                         std::function<void(sqlite3_stmt* stmt)> bind_function,
+                                               std::function<void(bool)> done)
+{
+    Job job;
+    job.m_query = query;
+    job.m_bind_function = bind_function;
+    job.m_done = done;
+    addJob(std::move(job));
+}   // queueQuery
+
+//-----------------------------------------------------------------------------
+/** Runs read in the worker thread, the function returned by it is called in
+ *  \ref handleCallbacks, so it can use the result in the lobby thread.
+ */
+void DatabaseConnector::queueRead(std::function<std::function<void()>()> read)
+{
+    Job job;
+    job.m_read = read;
+    addJob(std::move(job));
+}   // queueRead
+
+//-----------------------------------------------------------------------------
+/** Calls the functions given back by finished jobs, this is called regularly
+ *  by the lobby. */
+void DatabaseConnector::handleCallbacks()
+{
+    std::deque<std::function<void()> > callbacks;
+    std::unique_lock<std::mutex> ul(m_callbacks_mutex);
+    std::swap(callbacks, m_callbacks);
+    ul.unlock();
+    for (auto& callback : callbacks)
+        callback();
+}   // handleCallbacks
+
+//-----------------------------------------------------------------------------
+/** Returns a prepared statement for the query, reusing a previously prepared
+ *  one if possible. For the lobby connection m_statements_mutex must be
+ *  locked.
+ *  \param db The connection to prepare the statement for.
+ *  \param cache The statement cache of that connection.
+ *  \return The statement or NULL if the query cannot be prepared.
+ */
+sqlite3_stmt* DatabaseConnector::getStatement(sqlite3* db,
+                                              StatementCache* cache,
+                                              const std::string& query) const
+{
+    auto it = cache->m_statements_map.find(query);
+    if (it != cache->m_statements_map.end())
+    {
+        cache->m_statements.splice(cache->m_statements.begin(),
+            cache->m_statements, it->second);
+        return it->second->second;
+    }
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, 0) != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    cache->m_statements.emplace_front(query, stmt);
+    cache->m_statements_map[query] = cache->m_statements.begin();
+    if (cache->m_statements.size() > MAX_CACHED_STATEMENTS)
+    {
+        sqlite3_finalize(cache->m_statements.back().second);
+        cache->m_statements_map.erase(cache->m_statements.back().first);
+        cache->m_statements.pop_back();
+    }
+    return stmt;
+}   // getStatement
+
+//-----------------------------------------------------------------------------
+void DatabaseConnector::clearStatements(StatementCache* cache)
+{
+    std::lock_guard<std::mutex> lock(m_statements_mutex);
+    for (auto& s : cache->m_statements)
+        sqlite3_finalize(s.second);
+    cache->m_statements.clear();
+    cache->m_statements_map.clear();
+}   // clearStatements
+
 //-----------------------------------------------------------------------------
 /** Runs simple query with optional bind function. If output vector pointer is
  *   not (default) nullptr, then the output is written there.
@@ -156,21 +390,28 @@ void DatabaseConnector::destroyDatabase()
  *                is ignored.
  *  \param bind_function The function for binding missing values.
  *  \return True if no error occurs.
+ *  The query runs on the worker connection if called in the worker thread,
+ *  otherwise on the lobby connection.
  */
 bool DatabaseConnector::easySQLQuery(
        const std::string& query, std::vector<std::vector<std::string>>* output,
                          std::function<void(sqlite3_stmt* stmt)> bind_function,
                                                   std::string null_value) const
 {
-    if (!m_db)
+    const bool in_worker = std::this_thread::get_id() == m_worker.get_id();
+    sqlite3* db = in_worker ? m_worker_db : m_db;
+    if (!db)
         return false;
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
+    std::unique_lock<std::mutex> lock(m_statements_mutex, std::defer_lock);
+    if (!in_worker)
+        lock.lock();
+    sqlite3_stmt* stmt = getStatement(db,
+        in_worker ? &m_worker_statements : &m_statements, query);
+    if (stmt)
     {
         if (bind_function)
             bind_function(stmt);
-        ret = sqlite3_step(stmt);
+        int ret = sqlite3_step(stmt);
         if (output)
         {
             output->clear();
@@ -189,12 +430,14 @@ bool DatabaseConnector::easySQLQuery(
                 ret = sqlite3_step(stmt);
             }
         }
-        ret = sqlite3_finalize(stmt);
+        // Keep the statement for next time
+        ret = sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
         if (ret != SQLITE_OK)
         {
             Log::error("DatabaseConnector",
-                "Error finalize database for easy query %s: %s",
-                query.c_str(), sqlite3_errmsg(m_db));
+                "Error running database for easy query %s: %s",
+                query.c_str(), sqlite3_errmsg(db));
             return false;
         }
     }
@@ -202,7 +445,7 @@ bool DatabaseConnector::easySQLQuery(
     {
         Log::error("DatabaseConnector",
             "Error preparing database for easy query %s: %s",
-            query.c_str(), sqlite3_errmsg(m_db));
+            query.c_str(), sqlite3_errmsg(db));
         return false;
     }
     return true;
@@ -256,15 +499,17 @@ std::string DatabaseConnector::ip2Country(const SocketAddress& addr) const
         return "";
 
     std::string cc_code;
+    std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
     std::string query = StringUtils::insertValues(
         "SELECT country_code FROM %s "
-        "WHERE `ip_start` <= %d AND `ip_end` >= %d "
+        "WHERE `ip_start` <= %s AND `ip_end` >= %s "
         "ORDER BY `ip_start` DESC LIMIT 1;",
-        ServerConfig::m_ip_geolocation_table.c_str(), addr.getIP(),
-        addr.getIP());
+        ServerConfig::m_ip_geolocation_table.c_str(),
+        Binder(coll, addr.getIP(), "ip"), Binder(coll, addr.getIP(), "ip"));
 
     std::vector<std::vector<std::string>> output;
-    if (easySQLQuery(query, &output) && !output.empty())
+    if (easySQLQuery(query, &output, coll->getBindFunction()) &&
+        !output.empty())
     {
         cc_code = output[0][0];
     }
@@ -285,15 +530,17 @@ std::string DatabaseConnector::ipv62Country(const SocketAddress& addr) const
 
     std::string cc_code;
     const std::string& ipv6 = addr.toString(false/*show_port*/);
+    std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
     std::string query = StringUtils::insertValues(
         "SELECT country_code FROM %s "
-        "WHERE `ip_start` <= upperIPv6(\"%s\") AND `ip_end` >= upperIPv6(\"%s\") "
+        "WHERE `ip_start` <= upperIPv6(%s) AND `ip_end` >= upperIPv6(%s) "
         "ORDER BY `ip_start` DESC LIMIT 1;",
-        ServerConfig::m_ipv6_geolocation_table.c_str(), ipv6.c_str(),
-        ipv6.c_str());
+        ServerConfig::m_ipv6_geolocation_table.c_str(),
+        Binder(coll, ipv6, "ipv6"), Binder(coll, ipv6, "ipv6"));
 
     std::vector<std::vector<std::string>> output;
-    if (easySQLQuery(query, &output) && !output.empty())
+    if (easySQLQuery(query, &output, coll->getBindFunction()) &&
+        !output.empty())
     {
         cc_code = output[0][0];
     }
@@ -372,13 +619,15 @@ void DatabaseConnector::writeDisconnectInfoTable(STKPeer* peer)
 {
     if (m_server_stats_table.empty())
         return;
+    std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
     std::string query = StringUtils::insertValues(
         "UPDATE %s SET disconnected_time = datetime('now'), "
-        "ping = %d, packet_loss = %d "
-        "WHERE host_id = %u;", m_server_stats_table.c_str(),
-        peer->getAveragePing(), peer->getPacketLoss(),
-        peer->getHostId());
-    easySQLQuery(query);
+        "ping = %s, packet_loss = %s "
+        "WHERE host_id = %s;", m_server_stats_table.c_str(),
+        Binder(coll, peer->getAveragePing(), "ping"),
+        Binder(coll, peer->getPacketLoss(), "packet_loss"),
+        Binder(coll, peer->getHostId(), "host_id"));
+    queueQuery(query, coll->getBindFunction());
 }   // writeDisconnectInfoTable
 
 //-----------------------------------------------------------------------------
@@ -576,12 +825,13 @@ void DatabaseConnector::initServerStatsTable()
  *  \param reporting Peer that is reported.
  *  \param reporting_npp Player profile that is reported.
  *  \param info The report message.
- *  \return True if the database query succeeded.
+ *  \param written Called in \ref handleCallbacks with true if the database
+ *                 query succeeded.
  */
-bool DatabaseConnector::writeReport(
+void DatabaseConnector::writeReport(
        STKPeer* reporter, std::shared_ptr<NetworkPlayerProfile> reporter_npp,
        STKPeer* reporting, std::shared_ptr<NetworkPlayerProfile> reporting_npp,
-       irr::core::stringw& info)
+       irr::core::stringw& info, std::function<void(bool)> written)
 {
     std::string query;
 
@@ -592,17 +842,21 @@ bool DatabaseConnector::writeReport(
             "INSERT INTO %s "
             "(server_uid, reporter_ip, reporter_ipv6, reporter_online_id, reporter_username, "
             "info, reporting_ip, reporting_ipv6, reporting_online_id, reporting_username) "
-            "VALUES (%s, %u, \"%s\", %u, %s, %s, %u, \"%s\", %u, %s);",
+            "VALUES (%s, %s, %s, %s, %s, %s, %s, %s, %s, %s);",
             ServerConfig::m_player_reports_table.c_str(),
             Binder(coll, ServerConfig::m_server_uid, "server_uid"),
-            !reporter->getAddress().isIPv6() ? reporter->getAddress().getIP() : 0,
-            reporter->getAddress().isIPv6() ? reporter->getAddress().toString(false) : "",
-            reporter_npp->getOnlineId(),
+            Binder(coll, !reporter->getAddress().isIPv6() ?
+                reporter->getAddress().getIP() : 0, "reporter_ip"),
+            Binder(coll, reporter->getAddress().isIPv6() ?
+                reporter->getAddress().toString(false) : "", "reporter_ipv6"),
+            Binder(coll, reporter_npp->getOnlineId(), "reporter_online_id"),
             Binder(coll, StringUtils::wideToUtf8(reporter_npp->getName()), "reporter_name"),
             Binder(coll, StringUtils::wideToUtf8(info), "info"),
-            !reporting->getAddress().isIPv6() ? reporting->getAddress().getIP() : 0,
-            reporting->getAddress().isIPv6() ? reporting->getAddress().toString(false) : "",
-            reporting_npp->getOnlineId(),
+            Binder(coll, !reporting->getAddress().isIPv6() ?
+                reporting->getAddress().getIP() : 0, "reporting_ip"),
+            Binder(coll, reporting->getAddress().isIPv6() ?
+                reporting->getAddress().toString(false) : "", "reporting_ipv6"),
+            Binder(coll, reporting_npp->getOnlineId(), "reporting_online_id"),
             Binder(coll, StringUtils::wideToUtf8(reporting_npp->getName()), "reporting_name")
         );
     }
@@ -612,19 +866,19 @@ bool DatabaseConnector::writeReport(
             "INSERT INTO %s "
             "(server_uid, reporter_ip, reporter_online_id, reporter_username, "
             "info, reporting_ip, reporting_online_id, reporting_username) "
-            "VALUES (%s, %u, %u, %s, %s, %u, %u, %s);",
+            "VALUES (%s, %s, %s, %s, %s, %s, %s, %s);",
             ServerConfig::m_player_reports_table.c_str(),
             Binder(coll, ServerConfig::m_server_uid, "server_uid"),
-            reporter->getAddress().getIP(),
-            reporter_npp->getOnlineId(),
+            Binder(coll, reporter->getAddress().getIP(), "reporter_ip"),
+            Binder(coll, reporter_npp->getOnlineId(), "reporter_online_id"),
             Binder(coll, StringUtils::wideToUtf8(reporter_npp->getName()), "reporter_name"),
             Binder(coll, StringUtils::wideToUtf8(info), "info"),
-            reporting->getAddress().getIP(),
-            reporting_npp->getOnlineId(),
+            Binder(coll, reporting->getAddress().getIP(), "reporting_ip"),
+            Binder(coll, reporting_npp->getOnlineId(), "reporting_online_id"),
             Binder(coll, StringUtils::wideToUtf8(reporting_npp->getName()), "reporting_name")
         );
     }
-    return easySQLQuery(query, nullptr, coll->getBindFunction());
+    queueQuery(query, coll->getBindFunction(), written);
 }   // writeReport
 
 //-----------------------------------------------------------------------------
@@ -644,11 +898,15 @@ DatabaseConnector::getIpBanTableData(uint32_t ip) const
         return result;
     }
     bool single_ip = (ip != 0);
+    std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
     std::ostringstream oss;
     oss << "SELECT rowid, ip_start, ip_end, reason, description FROM ";
     oss << (std::string)ServerConfig::m_ip_ban_table << " WHERE ";
     if (single_ip)
-        oss << "ip_start <= " << ip << " AND ip_end >= " << ip << " AND ";
+    {
+        oss << "ip_start <= " << Binder(coll, ip, "ip") << " AND ip_end >= "
+            << Binder(coll, ip, "ip") << " AND ";
+    }
     oss << "datetime('now') > datetime(starting_time) AND "
         "(expired_days is NULL OR datetime"
         "(starting_time, '+'||expired_days||' days') > datetime('now'))";
@@ -658,7 +916,7 @@ DatabaseConnector::getIpBanTableData(uint32_t ip) const
     std::string query = oss.str();
 
     std::vector<std::vector<std::string>> output;
-    easySQLQuery(query, &output);
+    easySQLQuery(query, &output, coll->getBindFunction());
 
     for (std::vector<std::string>& row: output)
     {
@@ -678,19 +936,16 @@ DatabaseConnector::getIpBanTableData(uint32_t ip) const
 
 //-----------------------------------------------------------------------------
 /** For a peer that turned out to be banned by IPv4, this function increases
- *   the trigger count.
+ *   the trigger count. It's written to the database later in
+ *   writeBanTriggerCounts.
  *  \param ip_start Start of IP ban range corresponding to peer.
  *  \param ip_end End of IP ban range corresponding to peer.
  */
-void DatabaseConnector::increaseIpBanTriggerCount(uint32_t ip_start, uint32_t ip_end) const
+void DatabaseConnector::increaseIpBanTriggerCount(uint32_t ip_start, uint32_t ip_end)
 {
-    std::string query = StringUtils::insertValues(
-        "UPDATE %s SET trigger_count = trigger_count + 1, "
-        "last_trigger = datetime('now') "
-        "WHERE ip_start = %u AND ip_end = %u;",
-        ServerConfig::m_ip_ban_table.c_str(), ip_start, ip_end);
-    easySQLQuery(query);
-}   // getIpBanTableData
+    std::lock_guard<std::mutex> lock(m_ban_triggers_mutex);
+    m_ip_ban_triggers[std::make_pair(ip_start, ip_end)]++;
+}   // increaseIpBanTriggerCount
 
 //-----------------------------------------------------------------------------
 /** Gets the rows from IPv6 ban table, either all of them (for polling
@@ -747,20 +1002,14 @@ DatabaseConnector::getIpv6BanTableData(std::string ipv6) const
 
 //-----------------------------------------------------------------------------
 /** For a peer that turned out to be banned by IPv6, this function increases
- *   the trigger count.
+ *   the trigger count. It's written to the database later in
+ *   writeBanTriggerCounts.
  *  \param ipv6_cidr Block of IPv6 addresses corresponding to the peer.
  */
-void DatabaseConnector::increaseIpv6BanTriggerCount(const std::string& ipv6_cidr) const
+void DatabaseConnector::increaseIpv6BanTriggerCount(const std::string& ipv6_cidr)
 {
-    std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
-    std::string query = StringUtils::insertValues(
-        "UPDATE %s SET trigger_count = trigger_count + 1, "
-        "last_trigger = datetime('now') "
-        "WHERE ipv6_cidr = %s;",
-        ServerConfig::m_ipv6_ban_table.c_str(),
-        Binder(coll, ipv6_cidr, "ipv6_cidr")
-    );
-    easySQLQuery(query, nullptr, coll->getBindFunction());
+    std::lock_guard<std::mutex> lock(m_ban_triggers_mutex);
+    m_ipv6_ban_triggers[ipv6_cidr]++;
 }   // increaseIpv6BanTriggerCount
 
 //-----------------------------------------------------------------------------
@@ -780,12 +1029,13 @@ DatabaseConnector::getOnlineIdBanTableData(uint32_t online_id) const
         return result;
     }
     bool single_id = (online_id != 0);
+    std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
     std::ostringstream oss;
     oss << "SELECT rowid, online_id, reason, description FROM ";
     oss << (std::string)ServerConfig::m_online_id_ban_table;
     oss << " WHERE ";
     if (single_id)
-        oss << "online_id = " << online_id << " AND ";
+        oss << "online_id = " << Binder(coll, online_id, "online_id") << " AND ";
     oss << "datetime('now') > datetime(starting_time) AND "
         "(expired_days is NULL OR datetime"
         "(starting_time, '+'||expired_days||' days') > datetime('now'))";
@@ -793,38 +1043,134 @@ DatabaseConnector::getOnlineIdBanTableData(uint32_t online_id) const
         oss << " LIMIT 1";
     oss << ";";
     std::string query = oss.str();
-    sqlite3_exec(m_db, query.c_str(),
-        [](void* ptr, int count, char** data, char** columns)
-        {
-            std::vector<OnlineIdBanTableData>* vec = (std::vector<OnlineIdBanTableData>*)ptr;
-            OnlineIdBanTableData element;
-            if (!StringUtils::fromString(data[0], element.row_id))
-                return 0;
-            if (!StringUtils::fromString(data[1], element.online_id))
-                return 0;
-            element.reason = std::string(data[2]);
-            element.description = std::string(data[3]);
-            vec->push_back(element);
-            return 0;
-        }, &result, NULL);
+
+    std::vector<std::vector<std::string>> output;
+    easySQLQuery(query, &output, coll->getBindFunction());
+
+    for (std::vector<std::string>& row: output)
+    {
+        OnlineIdBanTableData element;
+        if (!StringUtils::fromString(row[0], element.row_id))
+            continue;
+        if (!StringUtils::fromString(row[1], element.online_id))
+            continue;
+        element.reason = row[2];
+        element.description = row[3];
+        result.push_back(element);
+    }
     return result;
 }   // getOnlineIdBanTableData
 
 //-----------------------------------------------------------------------------
 /** For a peer that turned out to be banned by online id, this function
- *   increases the trigger count.
+ *   increases the trigger count. It's written to the database later in
+ *   writeBanTriggerCounts.
  *  \param online_id Online id of the peer.
  */
-void DatabaseConnector::increaseOnlineIdBanTriggerCount(uint32_t online_id) const
+void DatabaseConnector::increaseOnlineIdBanTriggerCount(uint32_t online_id)
 {
-    std::string query = StringUtils::insertValues(
-        "UPDATE %s SET trigger_count = trigger_count + 1, "
-        "last_trigger = datetime('now') "
-        "WHERE online_id = %u;",
-        ServerConfig::m_online_id_ban_table.c_str(), online_id);
-    easySQLQuery(query);
+    std::lock_guard<std::mutex> lock(m_ban_triggers_mutex);
+    m_online_id_ban_triggers[online_id]++;
 }   // increaseOnlineIdBanTriggerCount
 
+//-----------------------------------------------------------------------------
+/** Queues the collected ban trigger counts to be written, so a flood of
+ *   connections from a banned address costs one query per ban.
+ */
+void DatabaseConnector::writeBanTriggerCounts()
+{
+    std::unique_lock<std::mutex> lock(m_ban_triggers_mutex);
+    std::map<std::pair<uint32_t, uint32_t>, unsigned> ip_triggers;
+    std::map<std::string, unsigned> ipv6_triggers;
+    std::map<uint32_t, unsigned> online_id_triggers;
+    std::swap(ip_triggers, m_ip_ban_triggers);
+    std::swap(ipv6_triggers, m_ipv6_ban_triggers);
+    std::swap(online_id_triggers, m_online_id_ban_triggers);
+    lock.unlock();
+
+    for (auto& t : ip_triggers)
+    {
+        std::shared_ptr<BinderCollection> coll =
+            std::make_shared<BinderCollection>();
+        std::string query = StringUtils::insertValues(
+            "UPDATE %s SET trigger_count = trigger_count + %s, "
+            "last_trigger = datetime('now') "
+            "WHERE ip_start = %s AND ip_end = %s;",
+            ServerConfig::m_ip_ban_table.c_str(),
+            Binder(coll, t.second, "trigger_count"),
+            Binder(coll, t.first.first, "ip_start"),
+            Binder(coll, t.first.second, "ip_end"));
+        queueQuery(query, coll->getBindFunction());
+    }
+    for (auto& t : ipv6_triggers)
+    {
+        std::shared_ptr<BinderCollection> coll =
+            std::make_shared<BinderCollection>();
+        std::string query = StringUtils::insertValues(
+            "UPDATE %s SET trigger_count = trigger_count + %s, "
+            "last_trigger = datetime('now') "
+            "WHERE ipv6_cidr = %s;",
+            ServerConfig::m_ipv6_ban_table.c_str(),
+            Binder(coll, t.second, "trigger_count"),
+            Binder(coll, t.first, "ipv6_cidr")
+        );
+        queueQuery(query, coll->getBindFunction());
+    }
+    for (auto& t : online_id_triggers)
+    {
+        std::shared_ptr<BinderCollection> coll =
+            std::make_shared<BinderCollection>();
+        std::string query = StringUtils::insertValues(
+            "UPDATE %s SET trigger_count = trigger_count + %s, "
+            "last_trigger = datetime('now') "
+            "WHERE online_id = %s;",
+            ServerConfig::m_online_id_ban_table.c_str(),
+            Binder(coll, t.second, "trigger_count"),
+            Binder(coll, t.first, "online_id"));
+        queueQuery(query, coll->getBindFunction());
+    }
+}   // writeBanTriggerCounts
+
+//-----------------------------------------------------------------------------
+/** Reads all active bans from the ban tables into a new BanIndex. */
+std::shared_ptr<BanIndex> DatabaseConnector::loadBanIndex() const
+{
+    std::shared_ptr<BanIndex> index = std::make_shared<BanIndex>();
+    for (IpBanTableData& row : getIpBanTableData())
+    {
+        BanIndex::IpBan ban;
+        ban.m_row_id = row.row_id;
+        ban.m_reason = row.reason;
+        ban.m_description = row.description;
+        ban.m_ip_start = row.ip_start;
+        ban.m_ip_end = row.ip_end;
+        index->addIpBan(ban);
+    }
+    for (Ipv6BanTableData& row : getIpv6BanTableData())
+    {
+        BanIndex::Ipv6Ban ban;
+        ban.m_row_id = row.row_id;
+        ban.m_reason = row.reason;
+        ban.m_description = row.description;
+        ban.m_ipv6_cidr = row.ipv6_cidr;
+        if (!index->addIpv6Ban(ban))
+        {
+            Log::warn("DatabaseConnector", "Invalid IPv6 CIDR %s in ban "
+                "table (rowid: %d).", row.ipv6_cidr.c_str(), row.row_id);
+        }
+    }
+    for (OnlineIdBanTableData& row : getOnlineIdBanTableData())
+    {
+        BanIndex::Ban ban;
+        ban.m_row_id = row.row_id;
+        ban.m_reason = row.reason;
+        ban.m_description = row.description;
+        index->addOnlineIdBan(row.online_id, ban);
+    }
+    index->sort();
+    return index;
+}   // loadBanIndex
+
 //-----------------------------------------------------------------------------
 /** Clears reports that are older than a certain number of days
  *   (specified in the server config).
@@ -840,7 +1186,7 @@ void DatabaseConnector::clearOldReports()
             "(reported_time, '+%f days') < datetime('now');",
             ServerConfig::m_player_reports_table.c_str(),
             ServerConfig::m_player_reports_expired_days);
-        easySQLQuery(query);
+        queueQuery(query);
     }
 }   // clearOldReports
 
@@ -873,7 +1219,7 @@ void DatabaseConnector::setDisconnectionTimes(std::vector<uint32_t>& present_hos
         oss << ");";
     }
     std::string query = oss.str();
-    easySQLQuery(query);
+    queueQuery(query);
 }   // setDisconnectionTimes
 
 //-----------------------------------------------------------------------------
@@ -886,11 +1232,25 @@ void DatabaseConnector::saveAddressToIpBanTable(const SocketAddress& addr)
     if (addr.isIPv6() || !m_db || !m_ip_ban_table_exists)
         return;
 
+    std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
     std::string query = StringUtils::insertValues(
         "INSERT INTO %s (ip_start, ip_end) "
-        "VALUES (%u, %u);",
-        ServerConfig::m_ip_ban_table.c_str(), addr.getIP(), addr.getIP());
-    easySQLQuery(query);
+        "VALUES (%s, %s);",
+        ServerConfig::m_ip_ban_table.c_str(),
+        Binder(coll, addr.getIP(), "ip_start"),
+        Binder(coll, addr.getIP(), "ip_end"));
+    queueQuery(query, coll->getBindFunction());
+
+    // Effective at once, not only after the next poll
+    std::shared_ptr<BanIndex> index =
+        std::make_shared<BanIndex>(*getBanIndex());
+    BanIndex::IpBan ban;
+    ban.m_row_id = -1;
+    ban.m_ip_start = addr.getIP();
+    ban.m_ip_end = addr.getIP();
+    index->addIpBan(ban);
+    index->sort();
+    setBanIndex(index);
 }   // saveAddressToIpBanTable
 
 //-----------------------------------------------------------------------------
@@ -914,18 +1274,18 @@ void DatabaseConnector::onPlayerJoinQueries(std::shared_ptr<STKPeer> peer,
             "INSERT INTO %s "
             "(host_id, ip, ipv6, port, online_id, username, player_num, "
             "country_code, version, os, ping) "
-            "VALUES (%u, 0, \"%s\", %u, %u, %s, %u, %s, %s, %s, %u);",
+            "VALUES (%s, 0, %s, %s, %s, %s, %s, %s, %s, %s, %s);",
             m_server_stats_table.c_str(),
-            peer->getHostId(),
-            peer->getAddress().toString(false),
-            peer->getAddress().getPort(),
-            online_id,
+            Binder(coll, peer->getHostId(), "host_id"),
+            Binder(coll, peer->getAddress().toString(false), "ipv6"),
+            Binder(coll, peer->getAddress().getPort(), "port"),
+            Binder(coll, online_id, "online_id"),
             Binder(coll, StringUtils::wideToUtf8(peer->getPlayerProfiles()[0]->getName()), "player_name"),
-            player_count,
+            Binder(coll, player_count, "player_num"),
             Binder(coll, country_code, "country_code", true),
             Binder(coll, version_os.first, "version"),
             Binder(coll, version_os.second, "os"),
-            peer->getAveragePing()
+            Binder(coll, peer->getAveragePing(), "ping")
         );
     }
     else
@@ -934,21 +1294,21 @@ void DatabaseConnector::onPlayerJoinQueries(std::shared_ptr<STKPeer> peer,
             "INSERT INTO %s "
             "(host_id, ip, port, online_id, username, player_num, "
             "country_code, version, os, ping) "
-            "VALUES (%u, %u, %u, %u, %s, %u, %s, %s, %s, %u);",
+            "VALUES (%s, %s, %s, %s, %s, %s, %s, %s, %s, %s);",
             m_server_stats_table.c_str(),
-            peer->getHostId(),
-            peer->getAddress().getIP(),
-            peer->getAddress().getPort(),
-            online_id,
+            Binder(coll, peer->getHostId(), "host_id"),
+            Binder(coll, peer->getAddress().getIP(), "ip"),
+            Binder(coll, peer->getAddress().getPort(), "port"),
+            Binder(coll, online_id, "online_id"),
             Binder(coll, StringUtils::wideToUtf8(peer->getPlayerProfiles()[0]->getName()), "player_name"),
-            player_count,
+            Binder(coll, player_count, "player_num"),
             Binder(coll, country_code, "country_code", true),
             Binder(coll, version_os.first, "version"),
             Binder(coll, version_os.second, "os"),
-            peer->getAveragePing()
+            Binder(coll, peer->getAveragePing(), "ping")
         );
     }
-    easySQLQuery(query, nullptr, coll->getBindFunction());
+    queueQuery(query, coll->getBindFunction());
 }   // onPlayerJoinQueries
 
 //-----------------------------------------------------------------------------
@@ -24,13 +24,21 @@
 #include "utils/string_utils.hpp"
 #include "utils/time.hpp"
 
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <sqlite3.h>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+class BanIndex;
 class SocketAddress;
 class STKPeer;
 class NetworkPlayerProfile;
@@ -90,11 +98,22 @@ struct Binder
     std::string m_value;
     std::string m_name;
     bool m_use_null_if_empty;
+    /** If set, m_integer is bound as integer instead of m_value. */
+    bool m_use_integer;
+    int64_t m_integer;
 
     Binder(std::shared_ptr<BinderCollection> collection, std::string value,
            std::string name = "", bool use_null_if_empty = false):
         m_collection(collection), m_value(value),
-        m_name(name), m_use_null_if_empty(use_null_if_empty) {}
+        m_name(name), m_use_null_if_empty(use_null_if_empty),
+        m_use_integer(false), m_integer(0) {}
+
+    /** Binds an integer, so queries only differing in numbers share one
+     *  prepared statement. */
+    Binder(std::shared_ptr<BinderCollection> collection, int64_t value,
+           std::string name = ""):
+        m_collection(collection), m_name(name), m_use_null_if_empty(false),
+        m_use_integer(true), m_integer(value) {}
 };
 
 std::ostream& operator << (std::ostream& os, const Binder& binder);
@@ -103,11 +122,41 @@ std::ostream& operator << (std::ostream& os, const Binder& binder);
  *   The SQL queries are intended to be placed only within the implementation
  *   of this class, while the logic corresponding to those queries should not
  *   belong here.
+ *  Writes and the periodic polling run in a worker thread, so a slow disk or
+ *   a big table never stalls the lobby. Results are given back to the lobby
+ *   as callbacks, which are run in \ref handleCallbacks. The worker has its
+ *   own database connection, so its transactions never include queries run
+ *   synchronously by the lobby.
  */
 class DatabaseConnector
 {
 private:
+    /** A query or read job to be run in the worker thread. */
+    struct Job
+    {
+        std::string m_query;
+        std::function<void(sqlite3_stmt* stmt)> m_bind_function;
+        /** Called in the lobby thread with the result of a write. */
+        std::function<void(bool)> m_done;
+        /** If set this is a read job instead of m_query, the returned
+         *  function is called in the lobby thread. */
+        std::function<std::function<void()>()> m_read;
+    };
+
+    /** Prepared statements of a connection by query string, most recently
+     *  used first. */
+    struct StatementCache
+    {
+        std::list<std::pair<std::string, sqlite3_stmt*> > m_statements;
+        std::unordered_map<std::string,
+            std::list<std::pair<std::string, sqlite3_stmt*> >::iterator>
+            m_statements_map;
+    };
+
+    /** Connection used by the lobby. */
     sqlite3* m_db;
+    /** Connection only used by the worker thread. */
+    sqlite3* m_worker_db;
     std::string m_server_stats_table;
     bool m_ip_ban_table_exists;
     bool m_ipv6_ban_table_exists;
@@ -117,6 +166,40 @@ private:
     bool m_player_reports_table_exists;
     uint64_t m_last_poll_db_time;
 
+    mutable StatementCache m_statements;
+    /** Only used in the worker thread, so it needs no mutex. */
+    mutable StatementCache m_worker_statements;
+
+    /** Protects the statement cache of the lobby connection, only one
+     *  thread can step its prepared statements at a time. */
+    mutable std::mutex m_statements_mutex;
+
+    std::thread m_worker;
+    std::deque<Job> m_jobs;
+    std::deque<std::function<void()> > m_callbacks;
+    bool m_stop_worker;
+    std::mutex m_jobs_mutex;
+    std::condition_variable m_jobs_cv;
+    std::mutex m_callbacks_mutex;
+
+    /** In-memory copy of the ban tables, checked for connecting peers. It's
+     *  replaced as a whole when refreshed, see \ref getBanIndex. */
+    std::shared_ptr<const BanIndex> m_ban_index;
+
+    /** Ban trigger counts not written to the database yet. */
+    std::map<std::pair<uint32_t, uint32_t>, unsigned> m_ip_ban_triggers;
+    std::map<std::string, unsigned> m_ipv6_ban_triggers;
+    std::map<uint32_t, unsigned> m_online_id_ban_triggers;
+    std::mutex m_ban_triggers_mutex;
+
+    void workerLoop();
+    static sqlite3* openDatabase(const std::string& path, int flags);
+    sqlite3_stmt* getStatement(sqlite3* db, StatementCache* cache,
+                               const std::string& query) const;
+    void clearStatements(StatementCache* cache);
+    void addJob(Job&& job);
+    void addCallback(std::function<void()>&& callback);
+
 public:
     /** Corresponds to the row of IPv4 ban table. */
     struct IpBanTableData
@@ -151,6 +234,14 @@ public:
                std::function<void(sqlite3_stmt* stmt)> bind_function = nullptr,
                                             std::string null_value = "") const;
 
+    void queueQuery(const std::string& query,
+               std::function<void(sqlite3_stmt* stmt)> bind_function = nullptr,
+                                     std::function<void(bool)> done = nullptr);
+
+    void queueRead(std::function<std::function<void()>()> read);
+
+    void handleCallbacks();
+
     void checkTableExists(const std::string& table, bool& result);
 
     std::string ip2Country(const SocketAddress& addr) const;
@@ -163,10 +254,11 @@ public:
                                                          sqlite3_value** argv);
     void writeDisconnectInfoTable(STKPeer* peer);
     void initServerStatsTable();
-    bool writeReport(
+    void writeReport(
          STKPeer* reporter, std::shared_ptr<NetworkPlayerProfile> reporter_npp,
        STKPeer* reporting, std::shared_ptr<NetworkPlayerProfile> reporting_npp,
-                                                     irr::core::stringw& info);
+                                                     irr::core::stringw& info,
+                                          std::function<void(bool)> written);
     bool hasDatabase() const                        { return m_db != nullptr; }
     bool hasServerStatsTable() const  { return !m_server_stats_table.empty(); }
     bool hasPlayerReportsTable() const
@@ -180,9 +272,16 @@ public:
     std::vector<IpBanTableData> getIpBanTableData(uint32_t ip = 0) const;
     std::vector<Ipv6BanTableData> getIpv6BanTableData(std::string ipv6 = "") const;
     std::vector<OnlineIdBanTableData> getOnlineIdBanTableData(uint32_t online_id = 0) const;
-    void increaseIpBanTriggerCount(uint32_t ip_start, uint32_t ip_end) const;
-    void increaseIpv6BanTriggerCount(const std::string& ipv6_cidr) const;
-    void increaseOnlineIdBanTriggerCount(uint32_t online_id) const;
+    std::shared_ptr<BanIndex> loadBanIndex() const;
+    void setBanIndex(std::shared_ptr<const BanIndex> index)
+                                  { std::atomic_store(&m_ban_index, index); }
+    /** Returns the ban index, it stays valid even if it's refreshed. */
+    std::shared_ptr<const BanIndex> getBanIndex() const
+                                     { return std::atomic_load(&m_ban_index); }
+    void increaseIpBanTriggerCount(uint32_t ip_start, uint32_t ip_end);
+    void increaseIpv6BanTriggerCount(const std::string& ipv6_cidr);
+    void increaseOnlineIdBanTriggerCount(uint32_t online_id);
+    void writeBanTriggerCounts();
     void clearOldReports();
     void setDisconnectionTimes(std::vector<uint32_t>& present_hosts);
     void saveAddressToIpBanTable(const SocketAddress& addr);
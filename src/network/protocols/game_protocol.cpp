@@ -22,6 +22,7 @@
 #include "karts/abstract_kart.hpp"
 #include "karts/controller/player_controller.hpp"
 #include "modes/world.hpp"
+#include "network/compress_network_body.hpp"
 #include "network/event.hpp"
 #include "network/network_config.hpp"
 #include "network/game_setup.hpp"
@@ -31,7 +32,10 @@
 #include "network/protocol_manager.hpp"
 #include "network/rewind_info.hpp"
 #include "network/rewind_manager.hpp"
+#include "network/rewinder.hpp"
+#include "network/server_config.hpp"
 #include "network/socket_address.hpp"
+#include "network/state_delta.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 #include "tracks/track.hpp"
@@ -39,6 +43,9 @@
 #include "utils/time.hpp"
 #include "main_loop.hpp"
 
+#include <chrono>
+#include <memory>
+
 // ============================================================================
 std::weak_ptr<GameProtocol> GameProtocol::m_game_protocol[PT_COUNT];
 // ============================================================================
@@ -60,15 +67,26 @@ std::shared_ptr<GameProtocol> GameProtocol::createInstance()
 GameProtocol::GameProtocol()
             : Protocol(PROTOCOL_CONTROLLER_EVENTS)
 {
-    m_network_item_manager = static_cast<NetworkItemManager*>
-        (Track::getCurrentTrack()->getItemManager());
+    // No track is loaded when running the micro benchmark
+    Track* track = Track::getCurrentTrack();
+    m_network_item_manager = track ?
+        static_cast<NetworkItemManager*>(track->getItemManager()) : NULL;
     m_data_to_send = getNetworkString();
+    m_rewinder_state_start = 0;
+    for (StateHistory& sh : m_state_history)
+        sh.m_ticks = -1;
+    m_state_history_index = 0;
+    m_delta_states_used = 0;
+    // To forget the state acks of disconnected peers
+    setHandleDisconnections(true);
 }   // GameProtocol
 
 //-----------------------------------------------------------------------------
 GameProtocol::~GameProtocol()
 {
     delete m_data_to_send;
+    for (auto& p : m_delta_states)
+        delete p.second;
 }   // ~GameProtocol
 
 //-----------------------------------------------------------------------------
@@ -118,6 +136,12 @@ void GameProtocol::sendActions()
  */
 bool GameProtocol::notifyEventAsynchronous(Event* event)
 {
+    if (event->getType() == EVENT_TYPE_DISCONNECTED)
+    {
+        std::lock_guard<std::mutex> lock(m_peer_state_ack_mutex);
+        m_peer_state_ack.erase(event->getPeer()->getHostId());
+        return true;
+    }
     if(!checkDataSize(event, 1)) return true;
 
     // Ignore events arriving when client has already exited
@@ -132,6 +156,8 @@ bool GameProtocol::notifyEventAsynchronous(Event* event)
     case GP_CONTROLLER_ACTION: handleControllerAction(event); break;
     case GP_STATE:             handleState(event);            break;
     case GP_ITEM_CONFIRMATION: handleItemEventConfirmation(event); break;
+    case GP_STATE_DELTA:       handleStateDelta(event);       break;
+    case GP_STATE_ACK:         handleStateAck(event);         break;
     case GP_ADJUST_TIME:
     case GP_ITEM_UPDATE:
         break;
@@ -291,16 +317,38 @@ void GameProtocol::startNewState()
 }   // startNewState
 
 // ----------------------------------------------------------------------------
-/** Called by a server to add data to the current state. The data in buffer
- *  is copied, so the data can be freed after this call/.
- *  \param buffer Adds the data in the buffer to the current state.
+/** Called by a server before a rewinder saves its state. A placeholder for
+ *  the 16 bit state size is added, and the rewinder then writes its state
+ *  directly into the returned buffer, so no temporary buffer needs to be
+ *  allocated and copied for each rewinder.
+ *  \return The buffer the rewinder state is written to.
  */
-void GameProtocol::addState(BareNetworkString *buffer)
+BareNetworkString* GameProtocol::startRewinderState()
 {
-    assert(NetworkConfig::get()->isServer());
-    m_data_to_send->addUInt16(buffer->size());
-    (*m_data_to_send) += *buffer;
-}   // addState
+    m_rewinder_state_start = m_data_to_send->getTotalSize();
+    m_data_to_send->addUInt16(0);
+    return m_data_to_send;
+}   // startRewinderState
+
+// ----------------------------------------------------------------------------
+/** Called by a server after a rewinder has written its state. It either
+ *  fills in the size of the state, or discards anything written since
+ *  startRewinderState() if the rewinder did not save a state.
+ *  \param saved If the rewinder saved a state.
+ */
+void GameProtocol::finishRewinderState(bool saved)
+{
+    std::vector<uint8_t>& buffer = m_data_to_send->getBuffer();
+    if (!saved)
+    {
+        buffer.resize(m_rewinder_state_start);
+        return;
+    }
+    unsigned size = (unsigned)buffer.size() - m_rewinder_state_start - 2;
+    assert(size < 65536);
+    buffer[m_rewinder_state_start    ] = (size >> 8) & 0xff;
+    buffer[m_rewinder_state_start + 1] =  size       & 0xff;
+}   // finishRewinderState
 
 // ----------------------------------------------------------------------------
 /** Called by a server to finalize the current state, which add updated
@@ -310,32 +358,194 @@ void GameProtocol::addState(BareNetworkString *buffer)
 void GameProtocol::finalizeState(std::vector<std::string>& cur_rewinder)
 {
     assert(NetworkConfig::get()->isServer());
-    auto& buffer = m_data_to_send->getBuffer();
-    auto pos = buffer.begin() + 1/*protocol type*/ + 1 /*gp event type*/+
-        4/*time*/;
-
     m_data_to_send->reset();
-    std::vector<uint8_t> names;
-    names.push_back((uint8_t)cur_rewinder.size());
-    for (std::string& name : cur_rewinder)
+
+    size_t names_size = 1;
+    for (const std::string& name : cur_rewinder)
+        names_size += 1 + name.size();
+
+    // Make room for the names in place and fill them in, so no temporary
+    // buffers are needed
+    auto& buffer = m_data_to_send->getBuffer();
+    const size_t pos = 1/*protocol type*/ + 1 /*gp event type*/+ 4/*time*/;
+    buffer.insert(buffer.begin() + pos, names_size, 0);
+    uint8_t* p = buffer.data() + pos;
+    *p++ = (uint8_t)cur_rewinder.size();
+    for (const std::string& name : cur_rewinder)
     {
-        names.push_back((uint8_t)name.size());
-        std::vector<uint8_t> rewinder(name.begin(), name.end());
-        names.insert(names.end(), rewinder.begin(), rewinder.end());
+        *p++ = (uint8_t)name.size();
+        memcpy(p, name.data(), name.size());
+        p += name.size();
     }
-    buffer.insert(pos, names.begin(), names.end());
 }   // finalizeState
 
 // ----------------------------------------------------------------------------
 /** Called when the last state information has been added and the message
- *  can be sent to the clients.
+ *  can be sent to the clients. If delta states are enabled, each peer
+ *  which supports it gets the state compressed against the newest state it
+ *  confirmed, a full state is only sent if that state is too old (e.g. due
+ *  to packet loss) or the peer has not confirmed any state yet (e.g. after
+ *  live join).
  */
 void GameProtocol::sendState()
 {
     assert(NetworkConfig::get()->isServer());
-    sendMessageToPeers(m_data_to_send, /*reliable*/false);
+    if (!ServerConfig::m_delta_state)
+    {
+        sendMessageToPeers(m_data_to_send, /*reliable*/false);
+        return;
+    }
+
+    const int ticks = World::getWorld()->getTicksSinceStart();
+    const std::vector<uint8_t>& buffer = m_data_to_send->getBuffer();
+    const size_t header = 1/*protocol type*/ + 1 /*gp event type*/+
+        4/*time*/;
+    addStateHistory(ticks).m_payload.assign(buffer.begin() + header,
+        buffer.end());
+
+    m_delta_states_used = 0;
+    for (auto& peer : STKHost::get()->getPeers())
+    {
+        if (!peer->isValidated() || peer->isWaitingForGame())
+            continue;
+        peer->sendPacket(getStateForPeer(peer.get(), ticks),
+            /*reliable*/false);
+    }
 }   // sendState
 
+// ----------------------------------------------------------------------------
+/** Returns the state message to be sent to a peer, which is either the full
+ *  state or a delta against the newest state the peer confirmed.
+ *  \param peer The peer to send the state to.
+ *  \param ticks Time of the current state.
+ */
+NetworkString* GameProtocol::getStateForPeer(const STKPeer* peer, int ticks)
+{
+    if (peer->getClientCapabilities().find("state_delta") ==
+        peer->getClientCapabilities().end())
+        return m_data_to_send;
+
+    int base_ticks = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_peer_state_ack_mutex);
+        auto it = m_peer_state_ack.find(peer->getHostId());
+        if (it != m_peer_state_ack.end())
+            base_ticks = it->second;
+    }
+    const StateHistory* base = findStateHistory(base_ticks);
+    if (!base || base_ticks == ticks)
+        return m_data_to_send;
+
+    // Peers confirming the same state share the delta
+    for (unsigned i = 0; i < m_delta_states_used; i++)
+    {
+        if (m_delta_states[i].first == base_ticks)
+            return m_delta_states[i].second;
+    }
+
+    if (m_delta_states_used == m_delta_states.size())
+    {
+        m_delta_states.emplace_back(-1,
+            getNetworkString(m_data_to_send->getTotalSize()));
+    }
+    auto& delta = m_delta_states[m_delta_states_used++];
+    delta.first = base_ticks;
+    NetworkString* ns = delta.second;
+    ns->clear();
+    ns->addUInt8(GP_STATE_DELTA).addUInt32(ticks).addUInt32(base_ticks);
+    const StateHistory& cur = m_state_history[
+        (m_state_history_index + STATE_HISTORY_SIZE - 1) % STATE_HISTORY_SIZE];
+    StateDelta::encode(base->m_payload.data(),
+        (unsigned)base->m_payload.size(), cur.m_payload.data(),
+        (unsigned)cur.m_payload.size(), ns);
+
+    // Nothing gained for a (nearly) completely changed state
+    if (ns->getTotalSize() >= m_data_to_send->getTotalSize())
+    {
+        ns->clear();
+        ns->getBuffer().insert(ns->getBuffer().end(),
+            m_data_to_send->getBuffer().begin() + 1,
+            m_data_to_send->getBuffer().end());
+    }
+    return ns;
+}   // getStateForPeer
+
+// ----------------------------------------------------------------------------
+/** Stores a new state in the ring buffer of recent states, overwriting the
+ *  oldest one.
+ *  \param ticks Time of the state.
+ *  \return The history entry, whose payload needs to be filled in.
+ */
+GameProtocol::StateHistory& GameProtocol::addStateHistory(int ticks)
+{
+    StateHistory& sh = m_state_history[m_state_history_index];
+    m_state_history_index = (m_state_history_index + 1) % STATE_HISTORY_SIZE;
+    sh.m_ticks = ticks;
+    return sh;
+}   // addStateHistory
+
+// ----------------------------------------------------------------------------
+/** Returns the stored state at the given time, or NULL if it is not in the
+ *  ring buffer (anymore).
+ */
+const GameProtocol::StateHistory* GameProtocol::findStateHistory(int ticks)
+                                                                         const
+{
+    if (ticks < 0)
+        return NULL;
+    for (const StateHistory& sh : m_state_history)
+    {
+        if (sh.m_ticks == ticks)
+            return &sh;
+    }
+    return NULL;
+}   // findStateHistory
+
+// ----------------------------------------------------------------------------
+/** Called on the server when a client confirms a received state, which can
+ *  then be used as base for delta states sent to this client.
+ */
+void GameProtocol::handleStateAck(Event *event)
+{
+    if (!NetworkConfig::get()->isServer() || !checkDataSize(event, 4))
+        return;
+    int ticks = event->data().getTime();
+    std::lock_guard<std::mutex> lock(m_peer_state_ack_mutex);
+    auto ret = m_peer_state_ack.emplace(event->getPeer()->getHostId(), ticks);
+    if (!ret.second && ret.first->second < ticks)
+        ret.first->second = ticks;
+}   // handleStateAck
+
+// ----------------------------------------------------------------------------
+/** Called when a delta state is received from the server. It is decoded
+ *  with the stored base state, if that state is no longer available it is
+ *  ignored: the server will send a full state once it notices that the
+ *  confirmed state is too old.
+ */
+void GameProtocol::handleStateDelta(Event *event)
+{
+    if (!NetworkConfig::get()->isClient())
+        return;
+    NetworkString &data = event->data();
+    int ticks      = data.getUInt32();
+    int base_ticks = data.getUInt32();
+    const StateHistory* base = findStateHistory(base_ticks);
+    if (!base)
+    {
+        Log::debug("GameProtocol", "Missing base state %d for state %d.",
+            base_ticks, ticks);
+        return;
+    }
+    BareNetworkString state;
+    if (!StateDelta::decode(base->m_payload.data(),
+        (unsigned)base->m_payload.size(), &data, &state.getBuffer()))
+    {
+        Log::warn("GameProtocol", "Invalid delta state %d.", ticks);
+        return;
+    }
+    addReceivedState(ticks, state);
+}   // handleStateDelta
+
 // ----------------------------------------------------------------------------
 /** Called when a new full state is received form the server.
  */
@@ -345,6 +555,28 @@ void GameProtocol::handleState(Event *event)
         return;
     NetworkString &data = event->data();
     int ticks          = data.getUInt32();
+    addReceivedState(ticks, data);
+}   // handleState
+
+// ----------------------------------------------------------------------------
+/** Adds a (full or decoded delta) state from the server to the rewind
+ *  manager, and confirms it to the server if it supports delta states.
+ *  \param ticks Time of the state.
+ *  \param data The state, starting at the current offset.
+ */
+void GameProtocol::addReceivedState(int ticks, BareNetworkString& data)
+{
+    const auto& caps = NetworkConfig::get()->getServerCapabilities();
+    if (caps.find("state_delta") != caps.end())
+    {
+        addStateHistory(ticks).m_payload.assign(
+            data.getBuffer().begin() + data.getCurrentOffset(),
+            data.getBuffer().end());
+        NetworkString *ns = getNetworkString(5);
+        ns->addUInt8(GP_STATE_ACK).addUInt32(ticks);
+        sendToServer(ns, /*reliable*/false);
+        delete ns;
+    }
 
     // Check for updated rewinder using
     unsigned rewinder_size = data.getUInt8();
@@ -360,7 +592,7 @@ void GameProtocol::handleState(Event *event)
     RewindInfoState* ris = new RewindInfoState(ticks, data.getCurrentOffset(),
         rewinder_using, data.getBuffer());
     RewindManager::get()->addNetworkRewindInfo(ris);
-}   // handleState
+}   // addReceivedState
 
 // ----------------------------------------------------------------------------
 /** Called from the RewindManager when rolling back.
@@ -400,3 +632,104 @@ void GameProtocol::update(int ticks)
     if (!World::getWorld())
         ProtocolManager::lock()->findAndTerminate(PROTOCOL_CONTROLLER_EVENTS);
 }   // update
+
+// ============================================================================
+namespace GameProtocolBenchmark
+{
+    /** A rewinder that saves a state of about the size and cost of a kart
+     *  state (controls, status flags and a compressed rigid body). */
+    class KartLikeRewinder : public Rewinder
+    {
+    private:
+        btSphereShape m_shape;
+        btDefaultMotionState m_motion_state;
+        std::unique_ptr<btRigidBody> m_body;
+    public:
+        KartLikeRewinder(int id)
+            : Rewinder({ RN_KART, static_cast<char>(id) }), m_shape(0.5f)
+        {
+            m_body.reset(new btRigidBody(250.0f, &m_motion_state, &m_shape));
+            m_body->setLinearVelocity(btVector3(id * 0.5f, 0.1f, 20.0f));
+            m_body->setAngularVelocity(btVector3(0.0f, 0.3f, 0.0f));
+        }
+        // --------------------------------------------------------------------
+        virtual bool saveState(BareNetworkString* buffer,
+                               std::vector<std::string>* ru)
+        {
+            ru->push_back(getUniqueIdentity());
+            // Controls, two flag bytes and energy like KartRewinder
+            buffer->addUInt16(0).addUInt8(12).addUInt8(0).addUInt8(1 << 4)
+                .addUInt8(0).addFloat(1.5f);
+            CompressNetworkBody::compress(m_body.get(), &m_motion_state,
+                buffer);
+            // Max speed and skidding
+            buffer->addUInt16(0).addUInt8(0).addFloat(0.0f).addUInt8(0);
+            return true;
+        }
+        // --------------------------------------------------------------------
+        virtual void saveTransform()                                      {}
+        virtual void computeError()                                       {}
+        virtual void undoEvent(BareNetworkString *buffer)                 {}
+        virtual void rewindToEvent(BareNetworkString *buffer)             {}
+        virtual void restoreState(BareNetworkString *buffer, int count)   {}
+        virtual void undoState(BareNetworkString *buffer)                 {}
+    };   // KartLikeRewinder
+}   // namespace GameProtocolBenchmark
+
+// ----------------------------------------------------------------------------
+/** Measures the cost of assembling a server state for 8, 16 and 32 karts,
+ *  both with the previous approach (one temporary buffer per rewinder which
+ *  is copied into the state) and with rewinders writing directly into the
+ *  state buffer.
+ */
+void GameProtocol::microBenchmark()
+{
+    using namespace GameProtocolBenchmark;
+    const int iterations = 20000;
+    const bool is_server = NetworkConfig::get()->isServer();
+    NetworkConfig::get()->setIsServer(true);
+    auto gp = std::make_shared<GameProtocol>();
+    std::vector<std::string> rewinder_using;
+    for (int num_karts : { 8, 16, 32 })
+    {
+        std::vector<std::unique_ptr<KartLikeRewinder> > rewinders;
+        for (int i = 0; i < num_karts; i++)
+            rewinders.emplace_back(new KartLikeRewinder(i));
+
+        for (int in_place = 0; in_place < 2; in_place++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int n = 0; n < iterations; n++)
+            {
+                gp->m_data_to_send->clear();
+                gp->m_data_to_send->addUInt8(GP_STATE).addUInt32(n);
+                rewinder_using.clear();
+                for (auto& r : rewinders)
+                {
+                    if (in_place)
+                    {
+                        BareNetworkString* bns = gp->startRewinderState();
+                        gp->finishRewinderState(
+                            r->saveState(bns, &rewinder_using));
+                        continue;
+                    }
+                    BareNetworkString* buffer = new BareNetworkString();
+                    if (r->saveState(buffer, &rewinder_using))
+                    {
+                        gp->m_data_to_send->addUInt16(buffer->size());
+                        (*gp->m_data_to_send) += *buffer;
+                    }
+                    delete buffer;
+                }
+                gp->finalizeState(rewinder_using);
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = (double)std::chrono::duration_cast
+                <std::chrono::nanoseconds>(end - start).count() / iterations;
+            Log::info("GameProtocol", "%s state, %d karts: %u bytes, "
+                "%.1f ns per state.", in_place ? "In-place" : "Copied",
+                num_karts, gp->m_data_to_send->getTotalSize(), ns);
+        }
+    }
+    NetworkConfig::get()->setIsServer(is_server);
+}   // microBenchmark
@@ -26,7 +26,9 @@
 #include "utils/cpp2011.hpp"
 #include "utils/stk_process.hpp"
 
+#include <array>
 #include <cstdlib>
+#include <map>
 #include <mutex>
 #include <vector>
 #include <tuple>
@@ -49,13 +51,50 @@ private:
            GP_STATE,
            GP_ITEM_UPDATE,
            GP_ITEM_CONFIRMATION,
-           GP_ADJUST_TIME
+           GP_ADJUST_TIME,
+           GP_STATE_DELTA,
+           GP_STATE_ACK
     };
 
+    /** Number of states kept for delta compression: the server keeps the
+     *  states it sent, the client the states it received. */
+    static const unsigned STATE_HISTORY_SIZE = 16;
+
+    /** A state without the message header, used as base of a delta. */
+    struct StateHistory
+    {
+        int                  m_ticks;
+        std::vector<uint8_t> m_payload;
+    };   // struct StateHistory
+
+    /** Ring buffer of recent states. */
+    std::array<StateHistory, STATE_HISTORY_SIZE> m_state_history;
+
+    /** Index in m_state_history where the next state will be stored. */
+    unsigned m_state_history_index;
+
+    /** Server only: the newest state ticks each peer confirmed to have
+     *  received, indexed by host id. Written by the network thread. */
+    std::map<uint32_t, int> m_peer_state_ack;
+
+    std::mutex m_peer_state_ack_mutex;
+
+    /** Server only: delta states built in the current sendState(), each
+     *  with the ticks of its base state, so that peers with the same base
+     *  share one delta. The network strings are reused. */
+    std::vector<std::pair<int, NetworkString*> > m_delta_states;
+
+    /** Number of entries in m_delta_states used by the current state. */
+    unsigned m_delta_states_used;
+
     /** A network string that collects all information from the server to be sent
      *  next. */
     NetworkString *m_data_to_send;
 
+    /** Offset in m_data_to_send of the size field of the rewinder state
+     *  which is currently being written. */
+    unsigned m_rewinder_state_start;
+
     /** The server might request that the world clock of a client is adjusted
      *  to reduce number of rollbacks. */
     std::vector<int8_t> m_adjust_time;
@@ -78,6 +117,12 @@ private:
     void handleState(Event *event);
     void handleAdjustTime(Event *event);
     void handleItemEventConfirmation(Event *event);
+    void handleStateDelta(Event *event);
+    void handleStateAck(Event *event);
+    void addReceivedState(int ticks, BareNetworkString& data);
+    StateHistory& addStateHistory(int ticks);
+    const StateHistory* findStateHistory(int ticks) const;
+    NetworkString* getStateForPeer(const STKPeer* peer, int ticks);
     static std::weak_ptr<GameProtocol> m_game_protocol[PT_COUNT];
     NetworkItemManager* m_network_item_manager;
     // Maximum value of values are only 32768
@@ -112,10 +157,12 @@ public:
     void controllerAction(int kart_id, PlayerAction action,
                           int value, int val_l, int val_r);
     void startNewState();
-    void addState(BareNetworkString *buffer);
+    BareNetworkString* startRewinderState();
+    void finishRewinderState(bool saved);
     void sendState();
     void finalizeState(std::vector<std::string>& cur_rewinder);
     void sendItemEventConfirmation(int ticks);
+    static void microBenchmark();
 
     virtual void undo(BareNetworkString *buffer) OVERRIDE;
     virtual void rewind(BareNetworkString *buffer) OVERRIDE;
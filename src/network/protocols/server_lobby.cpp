@@ -29,6 +29,7 @@
 #include "karts/official_karts.hpp"
 #include "modes/capture_the_flag.hpp"
 #include "modes/linear_world.hpp"
+#include "network/ban_index.hpp"
 #include "network/crypto.hpp"
 #include "network/database_connector.hpp"
 #include "network/event.hpp"
@@ -635,91 +636,74 @@ bool ServerLobby::notifyEventAsynchronous(Event* event)
 
 //-----------------------------------------------------------------------------
 #ifdef ENABLE_SQLITE3
-/* Every 1 minute STK will poll database:
- * 1. Set disconnected time to now for non-exists host.
- * 2. Clear expired player reports if necessary
- * 3. Kick active peer from ban list
- */
-void ServerLobby::pollDatabase()
+/** Kicks the connected peers which are found in the ban index. */
+static void kickBannedPeers(const BanIndex& index)
 {
-    if (!ServerConfig::m_sql_management || !m_db_connector->hasDatabase())
-        return;
-
-    if (!m_db_connector->isTimeToPoll())
-        return;
-
-    m_db_connector->updatePollTime();
-
-    std::vector<DatabaseConnector::IpBanTableData> ip_ban_list =
-            m_db_connector->getIpBanTableData();
-    std::vector<DatabaseConnector::Ipv6BanTableData> ipv6_ban_list =
-            m_db_connector->getIpv6BanTableData();
-    std::vector<DatabaseConnector::OnlineIdBanTableData> online_id_ban_list =
-            m_db_connector->getOnlineIdBanTableData();
-
     for (std::shared_ptr<STKPeer>& p : STKHost::get()->getPeers())
     {
         if (p->isAIPeer())
             continue;
-        bool is_kicked = false;
-        std::string address = "";
-        std::string reason = "";
-        std::string description = "";
-
+        std::string address;
+        const BanIndex::Ban* ban = NULL;
         if (p->getAddress().isIPv6())
         {
             address = p->getAddress().toString(false);
             if (address.empty())
                 continue;
-            for (auto& item: ipv6_ban_list)
-            {
-                if (insideIPv6CIDR(item.ipv6_cidr.c_str(), address.c_str()) == 1)
-                {
-                    is_kicked = true;
-                    reason = item.reason;
-                    description = item.description;
-                    break;
-                }
-            }
+            ban = index.findIpv6(address);
         }
         else
         {
-            uint32_t peer_addr = p->getAddress().getIP();
             address = p->getAddress().toString();
-            for (auto& item: ip_ban_list)
-            {
-                if (item.ip_start <= peer_addr && item.ip_end >= peer_addr)
-                {
-                    is_kicked = true;
-                    reason = item.reason;
-                    description = item.description;
-                    break;
-                }
-            }
+            ban = index.findIp(p->getAddress().getIP());
         }
-        if (!is_kicked && !p->getPlayerProfiles().empty())
+        if (!ban && !p->getPlayerProfiles().empty())
         {
             uint32_t online_id = p->getPlayerProfiles()[0]->getOnlineId();
-            for (auto& item: online_id_ban_list)
-            {
-                if (item.online_id == online_id)
-                {
-                    is_kicked = true;
-                    reason = item.reason;
-                    description = item.description;
-                    break;
-                }
-            }
+            ban = index.findOnlineId(online_id);
         }
-        if (is_kicked)
+        if (ban)
         {
             Log::info("ServerLobby", "Kick %s, reason: %s, description: %s",
-                address.c_str(), reason.c_str(), description.c_str());
+                address.c_str(), ban->m_reason.c_str(),
+                ban->m_description.c_str());
             p->kick();
         }
     } // for p in peers
+}   // kickBannedPeers
+
+//-----------------------------------------------------------------------------
+/* Every 1 minute STK will poll database:
+ * 1. Set disconnected time to now for non-exists host.
+ * 2. Clear expired player reports if necessary
+ * 3. Refresh the ban index and kick active peer from ban list
+ * 4. Write the ban trigger counts
+ * The ban index is loaded in the database thread, the kicking is done in
+ * kickBannedPeers when it's ready.
+ */
+void ServerLobby::pollDatabase()
+{
+    if (!ServerConfig::m_sql_management || !m_db_connector->hasDatabase())
+        return;
+
+    if (!m_db_connector->isTimeToPoll())
+        return;
+
+    m_db_connector->updatePollTime();
+
+    DatabaseConnector* db = m_db_connector;
+    m_db_connector->queueRead([db]()
+        {
+            std::shared_ptr<const BanIndex> index = db->loadBanIndex();
+            return std::function<void()>([db, index]()
+                {
+                    db->setBanIndex(index);
+                    kickBannedPeers(*index);
+                });
+        });
 
     m_db_connector->clearOldReports();
+    m_db_connector->writeBanTriggerCounts();
 
     auto peers = STKHost::get()->getPeers();
     std::vector<uint32_t> hosts;
@@ -757,17 +741,24 @@ void ServerLobby::writePlayerReport(Event* event)
         return;
     auto reporting_npp = reporting_peer->getPlayerProfiles()[0];
 
-    bool written = m_db_connector->writeReport(reporter, reporter_npp,
-            reporting_peer.get(), reporting_npp, info);
-    if (written)
-    {
-        NetworkString* success = getNetworkString();
-        success->setSynchronous(true);
-        success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
-            .encodeString(reporting_npp->getName());
-        event->getPeer()->sendPacket(success, true/*reliable*/);
-        delete success;
-    }
+    // The report is written in the database thread, the reporter may have
+    // left when it's done
+    std::weak_ptr<STKPeer> reporter_peer = event->getPeerSP();
+    core::stringw reporting_name = reporting_npp->getName();
+    m_db_connector->writeReport(reporter, reporter_npp, reporting_peer.get(),
+        reporting_npp, info, [reporter_peer, reporting_name, this]
+        (bool written)
+        {
+            auto peer = reporter_peer.lock();
+            if (!written || !peer)
+                return;
+            NetworkString* success = getNetworkString();
+            success->setSynchronous(true);
+            success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
+                .encodeString(reporting_name);
+            peer->sendPacket(success, true/*reliable*/);
+            delete success;
+        });
 #endif
 }   // writePlayerReport
 
@@ -792,6 +783,7 @@ void ServerLobby::asynchronousUpdate()
     }
 
 #ifdef ENABLE_SQLITE3
+    m_db_connector->handleCallbacks();
     pollDatabase();
 #endif
 
@@ -3762,27 +3754,18 @@ void ServerLobby::testBannedForIP(STKPeer* peer) const
     if (peer->getAddress().isIPv6())
         return;
 
-    bool is_banned = false;
-    uint32_t ip_start = 0;
-    uint32_t ip_end = 0;
-
-    std::vector<DatabaseConnector::IpBanTableData> ip_ban_list =
-            m_db_connector->getIpBanTableData(peer->getAddress().getIP());
-    if (!ip_ban_list.empty())
+    auto index = m_db_connector->getBanIndex();
+    const BanIndex::IpBan* ban = index->findIp(peer->getAddress().getIP());
+    if (ban)
     {
-        is_banned = true;
-        ip_start = ip_ban_list[0].ip_start;
-        ip_end = ip_ban_list[0].ip_end;
-        int row_id = ip_ban_list[0].row_id;
-        std::string reason = ip_ban_list[0].reason;
-        std::string description = ip_ban_list[0].description;
         Log::info("ServerLobby", "%s banned by IP: %s "
                 "(rowid: %d, description: %s).",
-                peer->getAddress().toString().c_str(), reason.c_str(), row_id, description.c_str());
-        kickPlayerWithReason(peer, reason.c_str());
+                peer->getAddress().toString().c_str(), ban->m_reason.c_str(),
+                ban->m_row_id, ban->m_description.c_str());
+        kickPlayerWithReason(peer, ban->m_reason.c_str());
+        m_db_connector->increaseIpBanTriggerCount(ban->m_ip_start,
+            ban->m_ip_end);
     }
-    if (is_banned)
-        m_db_connector->increaseIpBanTriggerCount(ip_start, ip_end);
 #endif
 }   // testBannedForIP
 
@@ -3797,26 +3780,19 @@ void ServerLobby::testBannedForIPv6(STKPeer* peer) const
     if (!peer->getAddress().isIPv6())
         return;
 
-    bool is_banned = false;
-    std::string ipv6_cidr = "";
-
-    std::vector<DatabaseConnector::Ipv6BanTableData> ipv6_ban_list =
-            m_db_connector->getIpv6BanTableData(peer->getAddress().toString(false));
-
-    if (!ipv6_ban_list.empty())
+    auto index = m_db_connector->getBanIndex();
+    const BanIndex::Ipv6Ban* ban =
+        index->findIpv6(peer->getAddress().toString(false));
+    if (ban)
     {
-        is_banned = true;
-        ipv6_cidr = ipv6_ban_list[0].ipv6_cidr;
-        int row_id = ipv6_ban_list[0].row_id;
-        std::string reason = ipv6_ban_list[0].reason;
-        std::string description = ipv6_ban_list[0].description;
         Log::info("ServerLobby", "%s banned by IPv6: %s "
                 "(rowid: %d, description: %s).",
-                peer->getAddress().toString(false).c_str(), reason.c_str(), row_id, description.c_str());
-        kickPlayerWithReason(peer, reason.c_str());
+                peer->getAddress().toString(false).c_str(),
+                ban->m_reason.c_str(), ban->m_row_id,
+                ban->m_description.c_str());
+        kickPlayerWithReason(peer, ban->m_reason.c_str());
+        m_db_connector->increaseIpv6BanTriggerCount(ban->m_ipv6_cidr);
     }
-    if (is_banned)
-        m_db_connector->increaseIpv6BanTriggerCount(ipv6_cidr);
 #endif
 }   // testBannedForIPv6
 
@@ -3828,23 +3804,17 @@ void ServerLobby::testBannedForOnlineId(STKPeer* peer,
     if (!m_db_connector->hasDatabase() || !m_db_connector->hasOnlineIdBanTable())
         return;
 
-    bool is_banned = false;
-    std::vector<DatabaseConnector::OnlineIdBanTableData> online_id_ban_list =
-            m_db_connector->getOnlineIdBanTableData(online_id);
-
-    if (!online_id_ban_list.empty())
+    auto index = m_db_connector->getBanIndex();
+    const BanIndex::Ban* ban = index->findOnlineId(online_id);
+    if (ban)
     {
-        is_banned = true;
-        int row_id = online_id_ban_list[0].row_id;
-        std::string reason = online_id_ban_list[0].reason;
-        std::string description = online_id_ban_list[0].description;
         Log::info("ServerLobby", "%s banned by online id: %s "
                 "(online id: %u, rowid: %d, description: %s).",
-                peer->getAddress().toString().c_str(), reason.c_str(), online_id, row_id, description.c_str());
-        kickPlayerWithReason(peer, reason.c_str());
-    }
-    if (is_banned)
+                peer->getAddress().toString().c_str(), ban->m_reason.c_str(),
+                online_id, ban->m_row_id, ban->m_description.c_str());
+        kickPlayerWithReason(peer, ban->m_reason.c_str());
         m_db_connector->increaseOnlineIdBanTriggerCount(online_id);
+    }
 #endif
 }   // testBannedForOnlineId
 
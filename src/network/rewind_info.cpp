@@ -24,6 +24,66 @@
 #include "items/projectile_manager.hpp"
 #include "utils/log.hpp"
 
+#include <mutex>
+
+namespace RewindInfoPool
+{
+    /** Allocations are rounded up to this size, each size class has its own
+     *  free list. */
+    const size_t GRANULARITY = 16;
+    const size_t SIZE_CLASSES = 8;
+    /** Maximum number of unused RewindInfo kept for each size class. */
+    const size_t MAX_FREE = 1024;
+
+    std::mutex g_mutex;
+    std::vector<void*> g_free_list[SIZE_CLASSES];
+}   // namespace RewindInfoPool
+
+// ----------------------------------------------------------------------------
+void* RewindInfo::operator new(size_t size)
+{
+    using namespace RewindInfoPool;
+    const size_t size_class = (size - 1) / GRANULARITY;
+    if (size_class >= SIZE_CLASSES)
+        return ::operator new(size);
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        std::vector<void*>& free_list = g_free_list[size_class];
+        if (!free_list.empty())
+        {
+            void* p = free_list.back();
+            free_list.pop_back();
+            return p;
+        }
+    }
+    return ::operator new((size_class + 1) * GRANULARITY);
+}   // operator new
+
+// ----------------------------------------------------------------------------
+void RewindInfo::operator delete(void* p, size_t size)
+{
+    using namespace RewindInfoPool;
+    if (!p)
+        return;
+    const size_t size_class = (size - 1) / GRANULARITY;
+    if (size_class < SIZE_CLASSES)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        std::vector<void*>& free_list = g_free_list[size_class];
+        if (free_list.size() < MAX_FREE)
+        {
+            if (free_list.capacity() == 0)
+                free_list.reserve(MAX_FREE);
+            free_list.push_back(p);
+            return;
+        }
+    }
+    ::operator delete(p);
+}   // operator delete
+
+// ============================================================================
+
 /** Constructor for a state: it only takes the size, and allocates a buffer
  *  for all state info.
  *  \param size Necessary buffer size for a state.
@@ -26,6 +26,7 @@
 #include "utils/ptr_vector.hpp"
 
 #include <assert.h>
+#include <cstddef>
 #include <functional>
 #include <string>
 #include <vector>
@@ -57,6 +58,11 @@ private:
 public:
     RewindInfo(int ticks, bool is_confirmed);
 
+    /** RewindInfo are created and deleted for every event and state, so
+     *  they are taken from a pool instead of the heap. */
+    static void* operator new(size_t size);
+    static void  operator delete(void* p, size_t size);
+
     void setTicks(int ticks);
 
     /** Called when going back in time to undo any rewind information. */
@@ -114,6 +120,13 @@ public:
     /** Returns a pointer to the state buffer. */
     BareNetworkString *getBuffer() const { return m_buffer; }
     // ------------------------------------------------------------------------
+    /** Returns the unique identities of all rewinders in this state. */
+    const std::vector<std::string>& getRewinderUsing() const
+                                                  { return m_rewinder_using; }
+    // ------------------------------------------------------------------------
+    /** Returns the offset of the first rewinder data in the buffer. */
+    int getStartOffset() const                      { return m_start_offset; }
+    // ------------------------------------------------------------------------
     virtual bool isState() const { return true; }
     // ------------------------------------------------------------------------
     /** Called when going back in time to undo any rewind information.
@@ -36,6 +36,8 @@
 #include "utils/profiler.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 
 RewindManager* RewindManager::m_rewind_manager[PT_COUNT];
 std::atomic_bool RewindManager::m_enable_rewind_manager(false);
@@ -64,6 +66,7 @@ void RewindManager::destroy()
  */
 RewindManager::RewindManager()
 {
+    m_skipped_rewinds = 0;
     reset();
 }   // RewindManager
 
@@ -73,6 +76,7 @@ RewindManager::RewindManager()
  */
 RewindManager::~RewindManager()
 {
+    logRewindCost();
     for (RewindInfoEventFunction* rief : m_pending_rief)
         delete rief;
     m_pending_rief.clear();
@@ -87,9 +91,23 @@ void RewindManager::reset()
     m_is_rewinding = false;
     m_not_rewound_ticks.store(0);
     m_overall_state_size = 0;
+    logRewindCost();
+    m_skipped_rewinds = 0;
     m_state_frequency = stk_config->getPhysicsFPS() /
         NetworkConfig::get()->getStateFrequency();
 
+    const int horizon = stk_config->time2Ticks(stk_config->m_rewind_horizon);
+    m_local_state.resize(std::max(horizon, 0) / m_state_frequency + 1);
+    m_rewind_cost.assign(m_local_state.size() + 1,
+        std::make_pair(0u, 0.0));
+    for (LocalState& ls : m_local_state)
+    {
+        ls.m_ticks = -1;
+        ls.m_functions.clear();
+        ls.m_rewinder_using.clear();
+        ls.m_predicted_offset.clear();
+    }
+
     if (!m_enable_rewind_manager) return;
 
     clearExpiredRewinder();
@@ -160,24 +178,21 @@ void RewindManager::saveState()
         return;
     gp->startNewState();
 
-    m_overall_state_size = 0;
-    std::vector<std::string> rewinder_using;
+    m_rewinder_using.clear();
+    const unsigned int start_size = gp->getState()->getTotalSize();
 
     for (auto& p : m_all_rewinder)
     {
-        // TODO: check if it's worth passing in a sufficiently large buffer from
-        // GameProtocol - this would save the copy operation.
-        BareNetworkString* buffer = NULL;
+        // Each rewinder writes directly into the state buffer of
+        // GameProtocol, which keeps its capacity between states
         if (auto r = p.second.lock())
-            buffer = r->saveState(&rewinder_using);
-        if (buffer != NULL)
         {
-            m_overall_state_size += buffer->size();
-            gp->addState(buffer);
+            BareNetworkString* buffer = gp->startRewinderState();
+            gp->finishRewinderState(r->saveState(buffer, &m_rewinder_using));
         }
-        delete buffer;    // buffer can be freed
     }
-    gp->finalizeState(rewinder_using);
+    m_overall_state_size = gp->getState()->getTotalSize() - start_size;
+    gp->finalizeState(m_rewinder_using);
     PROFILER_POP_CPU_MARKER();
 }   // saveState
 
@@ -204,12 +219,15 @@ void RewindManager::update(int ticks_not_used)
     clearExpiredRewinder();
     if (NetworkConfig::get()->isClient())
     {
-        auto& ret = m_local_state[ticks];
+        LocalState& ls = reserveLocalState(ticks);
+        ls.m_ticks = ticks;
+        ls.m_functions.clear();
         for (auto& p : m_all_rewinder)
         {
             if (auto r = p.second.lock())
-                ret.push_back(r->getLocalStateRestoreFunction());
+                ls.m_functions.push_back(r->getLocalStateRestoreFunction());
         }
+        savePredictedState(&ls);
     }
     else
     {
@@ -221,6 +239,52 @@ void RewindManager::update(int ticks_not_used)
     PROFILER_POP_CPU_MARKER();
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Returns the local state entry to save the state at the given time in. If
+ *  that entry still holds an older state for which no confirmed state was
+ *  received yet, the ring buffer is doubled in size instead of overwriting
+ *  it, similar to RewindQueue::reserveTicks.
+ *  \param ticks Time at which the state is saved.
+ */
+RewindManager::LocalState& RewindManager::reserveLocalState(int ticks)
+{
+    LocalState& ls = getLocalState(ticks);
+    if (ls.m_ticks == -1 || ls.m_ticks >= ticks)
+        return ls;
+
+    std::vector<LocalState> ring(m_local_state.size() * 2);
+    for (LocalState& new_ls : ring)
+        new_ls.m_ticks = -1;
+    for (LocalState& old : m_local_state)
+    {
+        if (old.m_ticks == -1)
+            continue;
+        std::swap(ring[(old.m_ticks / m_state_frequency) % ring.size()], old);
+    }
+    std::swap(m_local_state, ring);
+    Log::info("RewindManager", "Rewind horizon exceeded, now %d local "
+        "states.", (int)m_local_state.size());
+    return getLocalState(ticks);
+}   // reserveLocalState
+
+// ----------------------------------------------------------------------------
+/** Marks all local states up to and including the given time as unused,
+ *  they are not needed anymore once a confirmed state for that time was
+ *  handled.
+ *  \param ticks Time of the confirmed state.
+ */
+void RewindManager::releaseLocalStates(int ticks)
+{
+    for (LocalState& ls : m_local_state)
+    {
+        if (ls.m_ticks != -1 && ls.m_ticks <= ticks)
+        {
+            ls.m_ticks = -1;
+            ls.m_functions.clear();
+        }
+    }
+}   // releaseLocalStates
+
 // ----------------------------------------------------------------------------
 /** Replays all events from the last event played till the specified time.
  *  \param world_ticks Up to (and inclusive) which time events will be replayed.
@@ -242,6 +306,16 @@ void RewindManager::playEventsTill(int world_ticks, bool fast_forward)
     // be getTime()+dt - world time has not been updated yet).
     m_rewind_queue.mergeNetworkData(world_ticks, &needs_rewind, &rewind_ticks);
 
+    // If the client predicted the confirmed state exactly, a rewind would
+    // end up with the current state again
+    if (needs_rewind && !fast_forward && isPredictionCorrect(rewind_ticks))
+    {
+        m_rewind_queue.skipUntil(world_ticks);
+        releaseLocalStates(rewind_ticks);
+        needs_rewind = false;
+        m_skipped_rewinds++;
+    }
+
     if (needs_rewind)
     {
         Log::setPrefix("Rewind");
@@ -266,6 +340,95 @@ void RewindManager::playEventsTill(int world_ticks, bool fast_forward)
     m_is_rewinding = false;
 }   // playEventsTill
 
+// ----------------------------------------------------------------------------
+/** Saves the state this client predicts the server will send for the
+ *  current time, so it can be compared with the confirmed state later.
+ *  Most rewinders save it with their saveState(), which for physical bodies
+ *  calls CompressNetworkBody::compress. Besides writing the state this
+ *  rounds the body to the transmitted precision, exactly like the server
+ *  does when it saves its state at this time. The client rounds its bodies
+ *  at state saving times anyway (see NetworkConfig::roundValuesNow), so
+ *  this changes nothing in the simulation, but it makes sure the predicted
+ *  bytes are computed from the same rounded values as the server's.
+ *  \param ls The local state entry for the current time.
+ */
+void RewindManager::savePredictedState(LocalState* ls)
+{
+    std::vector<uint8_t>& buffer = m_prediction_buffer.getBuffer();
+    buffer.clear();
+    ls->m_rewinder_using.clear();
+    ls->m_predicted_offset.clear();
+    for (auto& p : m_all_rewinder)
+    {
+        if (auto r = p.second.lock())
+        {
+            const unsigned start = (unsigned)buffer.size();
+            if (r->savePredictedState(&m_prediction_buffer,
+                &ls->m_rewinder_using))
+                ls->m_predicted_offset.push_back(start);
+            else
+                buffer.resize(start);
+        }
+    }
+    ls->m_predicted_offset.push_back((unsigned)buffer.size());
+    std::swap(ls->m_predicted_state, buffer);
+}   // savePredictedState
+
+// ----------------------------------------------------------------------------
+/** Checks if the confirmed state at the given time is identical to the
+ *  state predicted by this client for all rewinders in the confirmed
+ *  state. Then a rewind would not change anything (unless events were
+ *  received late, which are only applied by a rewind).
+ *  The comparison is byte exact on purpose: skipping a rewind keeps the
+ *  predicted values, so any tolerance would let the client drift from the
+ *  server without ever being corrected. Since the simulation is
+ *  deterministic a prediction is exact if the client had all events up to
+ *  the state time when it simulated it. This is mostly the case while no
+ *  other player changes their controls (only changes are sent), e.g. on
+ *  straights, for spectators, or with few players. Any input change of
+ *  another player arrives after the client simulated that time and forces
+ *  a rewind. The number of skipped rewinds is logged with the rewind cost
+ *  when the RewindManager is reset, which gives the hit rate of a game.
+ *  \param ticks Time of the confirmed state.
+ */
+bool RewindManager::isPredictionCorrect(int ticks)
+{
+    const LocalState& ls = getLocalState(ticks);
+    if (ls.m_ticks != ticks ||
+        m_rewind_queue.getLatestLateEventTime() > ticks ||
+        ls.m_predicted_offset.size() != ls.m_rewinder_using.size() + 1)
+        return false;
+
+    RewindInfoState* ris = m_rewind_queue.getConfirmedState(ticks);
+    if (!ris)
+        return false;
+
+    const std::vector<uint8_t>& state = ris->getBuffer()->getBuffer();
+    unsigned offset = ris->getStartOffset();
+    for (const std::string& name : ris->getRewinderUsing())
+    {
+        if (offset + 2 > state.size())
+            return false;
+        const unsigned size = (state[offset] << 8) | state[offset + 1];
+        offset += 2;
+        if (offset + size > state.size())
+            return false;
+
+        auto it = std::find(ls.m_rewinder_using.begin(),
+            ls.m_rewinder_using.end(), name);
+        if (it == ls.m_rewinder_using.end())
+            return false;
+        const unsigned i = (unsigned)(it - ls.m_rewinder_using.begin());
+        const unsigned start = ls.m_predicted_offset[i];
+        if (ls.m_predicted_offset[i + 1] - start != size ||
+            (size > 0 && memcmp(ls.m_predicted_state.data() + start,
+                                state.data() + offset, size) != 0))
+            return false;
+        offset += size;
+    }
+    return true;
+}   // isPredictionCorrect
+
 // ----------------------------------------------------------------------------
 /** Adds a Rewinder to the list of all rewinders.
  *  \return true If successfully added, false otherwise.
@@ -295,6 +458,7 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
                              bool fast_forward)
 {
     assert(!m_is_rewinding);
+    auto start = std::chrono::steady_clock::now();
     bool is_history = history->replayHistory();
     history->setReplayHistory(false);
 
@@ -331,27 +495,22 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
 
     // Restore states from the exact rewind time
     // -----------------------------------------
-    auto it = m_local_state.find(exact_rewind_ticks);
-    if (it != m_local_state.end())
+    LocalState& ls = getLocalState(exact_rewind_ticks);
+    if (ls.m_ticks == exact_rewind_ticks)
     {
-        for (auto& restore_local_state : it->second)
+        for (auto& restore_local_state : ls.m_functions)
         {
             if (restore_local_state)
                 restore_local_state();
         }
-        for (auto it = m_local_state.begin(); it != m_local_state.end();)
-        {
-            if (it->first <= exact_rewind_ticks)
-                it = m_local_state.erase(it);
-            else
-                break;
-        }
     }
     else if (!fast_forward)
     {
         Log::warn("RewindManager", "Missing local state at ticks %d",
             exact_rewind_ticks);
     }
+    // Local states up to the rewind time are not needed anymore
+    releaseLocalStates(exact_rewind_ticks);
 
     // A loop in case that we should split states into several smaller ones:
     while (current && current->getTicks() == exact_rewind_ticks && 
@@ -386,7 +545,7 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
 
         // Now simulate the next time step
         if (!fast_forward)
-            world->updateWorld(1);
+            world->updateForRewind(1);
 #undef SHOW_ROLLBACK
 #ifdef SHOW_ROLLBACK
         irr_driver->update(stk_config->ticks2Time(1));
@@ -405,8 +564,42 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
     history->setReplayHistory(is_history);
     m_is_rewinding = false;
     mergeRewindInfoEventFunction();
+
+    std::chrono::duration<double> duration =
+        std::chrono::steady_clock::now() - start;
+    const unsigned depth = std::min(
+        (unsigned)(now_ticks - exact_rewind_ticks) / m_state_frequency,
+        (unsigned)m_rewind_cost.size() - 1);
+    m_rewind_cost[depth].first++;
+    m_rewind_cost[depth].second += duration.count();
 }   // rewindTo
 
+// ----------------------------------------------------------------------------
+/** Logs the number of rewinds and their average time for each rewind depth,
+ *  which shows how the cost of a rewind grows with the network latency.
+ */
+void RewindManager::logRewindCost() const
+{
+    unsigned rewinds = 0;
+    for (auto& cost : m_rewind_cost)
+        rewinds += cost.first;
+    if (rewinds + m_skipped_rewinds == 0)
+        return;
+
+    Log::info("RewindManager", "Skipped %d of %d rewinds.",
+        m_skipped_rewinds, rewinds + m_skipped_rewinds);
+    for (unsigned i = 0; i < m_rewind_cost.size(); i++)
+    {
+        if (m_rewind_cost[i].first == 0)
+            continue;
+        Log::info("RewindManager",
+            "Depth %d-%d ticks: %d rewinds, average %.3f ms.",
+            i * m_state_frequency, (i + 1) * m_state_frequency - 1,
+            m_rewind_cost[i].first,
+            m_rewind_cost[i].second * 1000.0 / m_rewind_cost[i].first);
+    }
+}   // logRewindCost
+
 // ----------------------------------------------------------------------------
 bool RewindManager::useLocalEvent() const
 {
@@ -19,6 +19,7 @@
 #ifndef HEADER_REWIND_MANAGER_HPP
 #define HEADER_REWIND_MANAGER_HPP
 
+#include "network/network_string.hpp"
 #include "network/rewind_queue.hpp"
 #include "utils/stk_process.hpp"
 
@@ -91,7 +92,37 @@ private:
      *  rewind data in case of local races only. */
     static std::atomic_bool m_enable_rewind_manager;
 
-    std::map<int, std::vector<std::function<void()> > > m_local_state;
+    /** The functions to restore the local state (which is not sent by the
+     *  server) of all rewinders at one state saving time. */
+    struct LocalState
+    {
+        int m_ticks;
+        std::vector<std::function<void()> > m_functions;
+        /** The state this client predicted at this time, used to detect
+         *  if a rewind to the confirmed state would change anything. */
+        std::vector<std::string> m_rewinder_using;
+        /** Offset of the data of each rewinder in m_predicted_state, with
+         *  the end of the data as additional last entry. */
+        std::vector<unsigned> m_predicted_offset;
+        std::vector<uint8_t> m_predicted_state;
+    };
+
+    /** Ring buffer of local states covering the rewind horizon, indexed by
+     *  the state saving time. Entries are reused to avoid allocations, and
+     *  the ring grows if it is full of states that were not confirmed. */
+    std::vector<LocalState> m_local_state;
+
+    /** Buffer used to save a predicted state, its memory is swapped with
+     *  the LocalState it is saved for. */
+    BareNetworkString m_prediction_buffer;
+
+    /** Number of rewinds that were skipped since the state was predicted
+     *  correctly. */
+    unsigned m_skipped_rewinds;
+
+    /** Number of rewinds and their total time in seconds, grouped by the
+     *  rewind depth in multiples of m_state_frequency. */
+    std::vector<std::pair<unsigned, double> > m_rewind_cost;
 
     /** A list of all objects that can be rewound. */
     std::map<std::string, std::weak_ptr<Rewinder> > m_all_rewinder;
@@ -119,6 +150,10 @@ private:
 
     std::set<std::string> m_missing_rewinders;
 
+    /** Unique identities of rewinders which saved a state, reused to avoid
+     *  allocations when saving a state. */
+    std::vector<std::string> m_rewinder_using;
+
     RewindManager();
    ~RewindManager();
     // ------------------------------------------------------------------------
@@ -136,6 +171,19 @@ private:
     }
     // ------------------------------------------------------------------------
     void mergeRewindInfoEventFunction();
+    LocalState& reserveLocalState(int ticks);
+    void releaseLocalStates(int ticks);
+    void savePredictedState(LocalState* ls);
+    bool isPredictionCorrect(int ticks);
+    void logRewindCost() const;
+    // ------------------------------------------------------------------------
+    /** Returns the entry in the local state ring buffer used for the
+     *  state saved at the given time. */
+    LocalState& getLocalState(int ticks)
+    {
+        return m_local_state[(ticks / m_state_frequency) %
+                             m_local_state.size()];
+    }   // getLocalState
 
 public:
     // First static functions to manage rewinding.
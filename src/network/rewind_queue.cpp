@@ -29,9 +29,9 @@
 
 #include <algorithm>
 
-/** The RewindQueue stores one TimeStepInfo for each time step done.
- *  The TimeStepInfo stores all states and events to be used at the
- *  given timestep. 
+/** The RewindQueue stores all states and events in a ring buffer indexed
+ *  by the time step, so no allocation is needed while the queue stays
+ *  inside the rewind horizon (see stk_config's rewind-horizon).
  *  All network events (i.e. new states or client events) are stored in a
  *  separate list m_network_events. At the very start of a new time step
  *  a new TimeStepInfo object is added. Then all network events that are
@@ -45,6 +45,8 @@
  */
 RewindQueue::RewindQueue()
 {
+    m_first_ticks = 0;
+    m_last_ticks  = -1;
     reset();
 }   // RewindQueue
 
@@ -74,15 +76,86 @@ void RewindQueue::reset()
     m_network_events.getData().clear();
     m_network_events.unlock();
 
-    AllRewindInfo::const_iterator i;
-    for (i = m_all_rewind_info.begin(); i != m_all_rewind_info.end(); ++i)
-        delete *i;
+    for (int ticks = m_first_ticks; ticks <= m_last_ticks; ticks++)
+    {
+        TickRewindInfo& tri = getTickRewindInfo(ticks);
+        for (RewindInfo* ri : tri)
+            delete ri;
+        tri.clear();
+    }
 
-    m_all_rewind_info.clear();
-    m_current = m_all_rewind_info.end();
+    if (m_all_rewind_info.empty())
+    {
+        int horizon = stk_config->time2Ticks(stk_config->m_rewind_horizon);
+        m_all_rewind_info.resize(std::max(horizon, 1));
+    }
+    m_first_ticks   = 0;
+    m_last_ticks    = -1;
+    m_current_ticks = 0;
+    m_current_index = 0;
     m_latest_confirmed_state_time = -1;
+    m_latest_late_event_time = -1;
 }   // reset
 
+// ----------------------------------------------------------------------------
+/** Makes sure that the ring buffer can store RewindInfo at the given time
+ *  together with all RewindInfo already stored. It only allocates if the
+ *  rewind horizon is exceeded, e.g. if no confirmed state was received for
+ *  a long time.
+ *  \param ticks Time at which a RewindInfo will be stored.
+ */
+void RewindQueue::reserveTicks(int ticks)
+{
+    if (m_last_ticks < m_first_ticks)
+    {
+        m_first_ticks = m_last_ticks = ticks;
+        return;
+    }
+    const int first = std::min(m_first_ticks, ticks);
+    const int last  = std::max(m_last_ticks, ticks);
+    const int size  = (int)m_all_rewind_info.size();
+    if (last - first + 1 > size)
+    {
+        std::vector<TickRewindInfo> ring(std::max(size * 2, last - first + 1));
+        for (int t = m_first_ticks; t <= m_last_ticks; t++)
+            std::swap(ring[t % ring.size()], getTickRewindInfo(t));
+        std::swap(m_all_rewind_info, ring);
+        Log::info("RewindQueue", "Rewind horizon exceeded, now %d ticks.",
+            (int)m_all_rewind_info.size());
+    }
+    m_first_ticks = first;
+    m_last_ticks  = last;
+}   // reserveTicks
+
+// ----------------------------------------------------------------------------
+/** Makes sure that current points to an existing RewindInfo (or past the
+ *  last one) by skipping time steps without RewindInfo.
+ */
+void RewindQueue::skipEmptyTicks()
+{
+    while (m_current_ticks <= m_last_ticks &&
+           m_current_index >= getTickRewindInfo(m_current_ticks).size())
+    {
+        m_current_ticks++;
+        m_current_index = 0;
+    }
+}   // skipEmptyTicks
+
+// ----------------------------------------------------------------------------
+/** Returns all RewindInfo in order, only used in unit testing.
+ */
+std::vector<RewindInfo*> RewindQueue::getAllRewindInfo() const
+{
+    std::vector<RewindInfo*> all;
+    for (int ticks = m_first_ticks; ticks <= m_last_ticks; ticks++)
+    {
+        const TickRewindInfo& tri =
+            m_all_rewind_info[ticks % m_all_rewind_info.size()];
+        all.insert(all.end(), tri.begin(), tri.end());
+    }
+    return all;
+}   // getAllRewindInfo
+
 // ----------------------------------------------------------------------------
 /** Inserts a RewindInfo object in the list of all events at the correct time.
  *  If there are several RewindInfo at the exact same time, state RewindInfo
@@ -94,23 +167,24 @@ void RewindQueue::reset()
  */
 void RewindQueue::insertRewindInfo(RewindInfo *ri)
 {
-    AllRewindInfo::iterator i = m_all_rewind_info.end();
+    const int ticks = ri->getTicks();
+    const bool was_end = !hasMoreRewindInfo();
+    reserveTicks(ticks);
+
+    TickRewindInfo& tri = getTickRewindInfo(ticks);
+    const unsigned index = ri->isEvent() ? (unsigned)tri.size() : 0;
+    tri.insert(tri.begin() + index, ri);
 
-    while (i != m_all_rewind_info.begin())
+    if (was_end)
     {
-        AllRewindInfo::iterator i_prev = i;
-        i_prev--;
-        // Now test if 'ri' needs to be inserted after the
-        // previous element, i.e. before the current element:
-        if ((*i_prev)->getTicks() < ri->getTicks()) break;
-        if ((*i_prev)->getTicks() == ri->getTicks() &&
-            ri->isEvent()                              ) break;
-        i = i_prev;
+        m_current_ticks = ticks;
+        m_current_index = index;
+    }
+    else if (m_current_ticks == ticks && m_current_index >= index)
+    {
+        // Keep current pointing to the same RewindInfo
+        m_current_index++;
     }
-    if(m_current == m_all_rewind_info.end())
-        m_current = m_all_rewind_info.insert(i, ri);
-    else
-        m_all_rewind_info.insert(i, ri);  
 }   // insertRewindInfo
 
 // ----------------------------------------------------------------------------
@@ -261,6 +335,13 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
 
         insertRewindInfo(*i);
 
+        if (NetworkConfig::get()->isClient() && (*i)->isEvent() &&
+            (*i)->getTicks() < world_ticks &&
+            (*i)->getTicks() > m_latest_late_event_time)
+        {
+            m_latest_late_event_time = (*i)->getTicks();
+        }
+
         // Check if a rewind is necessary, i.e. a message is received in the
         // past of client (server never rewinds). Even if
         // getTicks()==world_ticks (which should not happen in reality, since
@@ -321,31 +402,69 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
 
 }   // mergeNetworkData
 
+// ----------------------------------------------------------------------------
+/** Returns the confirmed state at the given time, or NULL if there is none.
+ *  \param ticks Time of the state.
+ */
+RewindInfoState* RewindQueue::getConfirmedState(int ticks)
+{
+    if (ticks < m_first_ticks || ticks > m_last_ticks)
+        return NULL;
+    for (RewindInfo* ri : getTickRewindInfo(ticks))
+    {
+        if (ri->isState() && ri->isConfirmed())
+            return static_cast<RewindInfoState*>(ri);
+    }
+    return NULL;
+}   // getConfirmedState
+
+// ----------------------------------------------------------------------------
+/** Moves current to the first RewindInfo at or after the given time without
+ *  undoing or replaying anything. This is used instead of a rewind if the
+ *  client already predicted the received state correctly.
+ *  \param ticks Time up to which all RewindInfo are skipped.
+ */
+void RewindQueue::skipUntil(int ticks)
+{
+    if (m_current_ticks >= ticks)
+        return;
+    m_current_ticks = std::max(ticks, m_first_ticks);
+    m_current_index = 0;
+    skipEmptyTicks();
+}   // skipUntil
+
 // ----------------------------------------------------------------------------
 /** Deletes all states and event before the given time.
  *  \param ticks Time (in ticks).
  */
 void RewindQueue::cleanupOldRewindInfo(int ticks)
 {
-    auto i = m_all_rewind_info.begin();
+    if (ticks <= m_first_ticks)
+        return;
 
-    while (!m_all_rewind_info.empty() &&
-        (*i)->getTicks() < ticks)
+    const int last = std::min(ticks - 1, m_last_ticks);
+    for (int t = m_first_ticks; t <= last; t++)
     {
-        if (m_current == i) next();
-        delete *i;
-        i = m_all_rewind_info.erase(i);
+        TickRewindInfo& tri = getTickRewindInfo(t);
+        for (RewindInfo* ri : tri)
+            delete ri;
+        tri.clear();
     }
+    m_first_ticks = ticks;
 
-    if (m_all_rewind_info.empty())
-        m_current = m_all_rewind_info.end();
-
+    // Move current to the first remaining RewindInfo if it was deleted
+    if (m_current_ticks < m_first_ticks)
+    {
+        m_current_ticks = m_first_ticks;
+        m_current_index = 0;
+        skipEmptyTicks();
+    }
 }   // cleanupOldRewindInfo
 
 // ----------------------------------------------------------------------------
 bool RewindQueue::isEmpty() const
 {
-    return m_current == m_all_rewind_info.end();
+    return !hasMoreRewindInfo();
 }   // isEmpty
 
 // ----------------------------------------------------------------------------
@@ -353,7 +472,7 @@ bool RewindQueue::isEmpty() const
  */
 bool RewindQueue::hasMoreRewindInfo() const
 {
-    return m_current != m_all_rewind_info.end();
+    return m_first_ticks <= m_last_ticks && m_current_ticks <= m_last_ticks;
 }   // hasMoreRewindInfo
 
 // ----------------------------------------------------------------------------
@@ -366,28 +485,48 @@ bool RewindQueue::hasMoreRewindInfo() const
 int RewindQueue::undoUntil(int undo_ticks)
 {
     // A rewind is done after a state in the past is inserted. This function
-    // makes sure that m_current is not end()
-    //assert(m_current != m_all_rewind_info.end());
-    assert(!m_all_rewind_info.empty());
-    m_current = m_all_rewind_info.end();
-    m_current--;
-    while((*m_current)->getTicks() > undo_ticks ||
-        (*m_current)->isEvent() || !(*m_current)->isConfirmed())
+    // makes sure that current is not past the last RewindInfo
+    assert(m_first_ticks <= m_last_ticks);
+    m_current_ticks = m_last_ticks;
+    while (m_current_ticks > m_first_ticks &&
+           getTickRewindInfo(m_current_ticks).empty())
+        m_current_ticks--;
+    assert(!getTickRewindInfo(m_current_ticks).empty());
+    m_current_index = (unsigned)getTickRewindInfo(m_current_ticks).size() - 1;
+
+    RewindInfo* current = getCurrent();
+    while (current->getTicks() > undo_ticks ||
+           current->isEvent() || !current->isConfirmed())
     {
         // Undo all events and states from the current time
-        (*m_current)->undo();
-        if(m_current == m_all_rewind_info.begin())
+        current->undo();
+        if (m_current_index > 0)
         {
-            // This shouldn't happen, but add some debug info just in case
-            Log::error("undoUntil",
-                       "At %d rewinding to %d current = %d = begin",
-                       World::getWorld()->getTicksSinceStart(), undo_ticks, 
-                       (*m_current)->getTicks());
+            m_current_index--;
         }
-        m_current--;
+        else
+        {
+            int ticks = m_current_ticks - 1;
+            while (ticks >= m_first_ticks &&
+                   getTickRewindInfo(ticks).empty())
+                ticks--;
+            if (ticks < m_first_ticks)
+            {
+                // This shouldn't happen, but add some debug info just in case
+                Log::error("undoUntil",
+                           "At %d rewinding to %d current = %d = begin",
+                           World::getWorld()->getTicksSinceStart(),
+                           undo_ticks, current->getTicks());
+                break;
+            }
+            m_current_ticks = ticks;
+            m_current_index =
+                (unsigned)getTickRewindInfo(ticks).size() - 1;
+        }
+        current = getCurrent();
     }
 
-    return (*m_current)->getTicks();
+    return current->getTicks();
 }   // undoUntil
 
 // ----------------------------------------------------------------------------
@@ -397,11 +536,12 @@ int RewindQueue::undoUntil(int undo_ticks)
 void RewindQueue::replayAllEvents(int ticks)
 {
     // Replay all events that happened at the current time step
-    while ( hasMoreRewindInfo() && (*m_current)->getTicks() == ticks )
+    while ( hasMoreRewindInfo() && m_current_ticks == ticks )
     {
-        if ((*m_current)->isEvent())
-            (*m_current)->replay();
-        m_current++;
+        RewindInfo* current = getCurrent();
+        if (current->isEvent())
+            current->replay();
+        next();
     }   // while current->getTIcks == ticks
 
 }   // replayAllEvents
@@ -427,57 +567,51 @@ void RewindQueue::unitTesting()
     assert(!q0.hasMoreRewindInfo());
 
     q0.addLocalState(NULL, /*confirmed*/true, 0);
-    assert(q0.m_all_rewind_info.front()->isState());
-    assert(!q0.m_all_rewind_info.front()->isEvent());
+    assert(q0.getAllRewindInfo().front()->isState());
+    assert(!q0.getAllRewindInfo().front()->isEvent());
     assert(q0.hasMoreRewindInfo());
     assert(q0.undoUntil(0) == 0);
 
     q0.addNetworkEvent(dummy_rewinder.get(), NULL, 0);
     // Network events are not immediately merged
-    assert(q0.m_all_rewind_info.size() == 1);
+    assert(q0.getAllRewindInfo().size() == 1);
 
     bool needs_rewind;
     int rewind_ticks;
     int world_ticks = 0;
     q0.mergeNetworkData(world_ticks, &needs_rewind, &rewind_ticks);
     assert(q0.hasMoreRewindInfo());
-    assert(q0.m_all_rewind_info.size() == 2);
-    AllRewindInfo::iterator rii = q0.m_all_rewind_info.begin();
-    assert((*rii)->isState());
-    rii++;
-    assert((*rii)->isEvent());
+    std::vector<RewindInfo*> all = q0.getAllRewindInfo();
+    assert(all.size() == 2);
+    assert(all[0]->isState());
+    assert(all[1]->isEvent());
 
     // Another state must be sorted before the event:
     q0.addNetworkState(NULL, 0);
     assert(q0.hasMoreRewindInfo());
     q0.mergeNetworkData(world_ticks, &needs_rewind, &rewind_ticks);
-    assert(q0.m_all_rewind_info.size() == 3);
-    rii = q0.m_all_rewind_info.begin();
-    assert((*rii)->isState());
-    rii++;
-    assert((*rii)->isState());
-    rii++;
-    assert((*rii)->isEvent());
+    all = q0.getAllRewindInfo();
+    assert(all.size() == 3);
+    assert(all[0]->isState());
+    assert(all[1]->isState());
+    assert(all[2]->isEvent());
 
     // Test time base comparisons: adding an event to the end
     q0.addLocalEvent(dummy_rewinder.get(), NULL, true, 4);
     // Then adding an earlier event
     q0.addLocalEvent(dummy_rewinder.get(), NULL, false, 1);
-    // rii points to the 3rd element, the ones added just now
-    // should be elements4 and 5:
-    rii++;
-    assert((*rii)->getTicks()==1);
-    rii++;
-    assert((*rii)->getTicks()==4);
+    // The ones added just now should be elements 4 and 5:
+    all = q0.getAllRewindInfo();
+    assert(all[3]->getTicks()==1);
+    assert(all[4]->getTicks()==4);
 
     // Now test inserting an event first, then the state
     RewindQueue q1;
     q1.addLocalEvent(NULL, NULL, true, 5);
     q1.addLocalState(NULL, true, 5);
-    rii = q1.m_all_rewind_info.begin();
-    assert((*rii)->isState());
-    rii++;
-    assert((*rii)->isEvent());
+    all = q1.getAllRewindInfo();
+    assert(all[0]->isState());
+    assert(all[1]->isEvent());
 
     // Bugs seen before
     // ----------------
@@ -496,12 +630,12 @@ void RewindQueue::unitTesting()
     //    event, that m_current pooints to the first event, otherwise
     //    events with same time stamp will not be handled correctly.
     //    At this stage current points to the event at time 2 from above
-    AllRewindInfo::iterator current_old = b1.m_current;
+    RewindInfo* current_old = b1.getCurrent();
     b1.addLocalEvent(NULL, NULL, true, 2);
     // Make sure that current was not modified, i.e. the new event at time
     // 2 was added at the end of the list:
-    if (current_old != b1.m_current)
-        Log::fatal("RewindQueue", "current_old != b1.m_current");
+    if (current_old != b1.getCurrent())
+        Log::fatal("RewindQueue", "current_old != b1.getCurrent()");
 
     // This should not trigger an exception, now current points to the
     // second event at the same time:
@@ -509,7 +643,7 @@ void RewindQueue::unitTesting()
     assert(ri->getTicks() == 2);
     assert(ri->isEvent());
     b1.next();
-    assert(b1.m_current == b1.m_all_rewind_info.end());
+    assert(!b1.hasMoreRewindInfo());
 
     // 3) Test that if cleanupOldRewindInfo is called, it will if necessary
     //    adjust m_current to point to the latest confirmed state.
@@ -518,7 +652,31 @@ void RewindQueue::unitTesting()
     b2.addNetworkState(NULL, 2);
     b2.addNetworkState(NULL, 3);
     b2.mergeNetworkData(4, &needs_rewind, &rewind_ticks);
-    assert((*b2.m_current)->getTicks() == 3);
-
-
+    assert(b2.getCurrent()->getTicks() == 3);
+
+    // 4) Adding more time steps than the rewind horizon must grow the ring
+    //    buffer and keep all RewindInfo sorted.
+    RewindQueue b3;
+    const int ring_size = (int)b3.m_all_rewind_info.size();
+    for (int i = ring_size * 2; i >= 0; i -= 2)
+        b3.addLocalEvent(NULL, NULL, true, i);
+    all = b3.getAllRewindInfo();
+    assert((int)all.size() == ring_size + 1);
+    for (unsigned i = 0; i < all.size(); i++)
+        assert(all[i]->getTicks() == (int)i * 2);
+    b3.cleanupOldRewindInfo(ring_size);
+    assert(b3.getAllRewindInfo().front()->getTicks() >= ring_size);
+
+    // 5) Skipping a rewind must move current past all RewindInfo before
+    //    the given time, but not past the ones at that time.
+    RewindQueue b4;
+    b4.addLocalState(NULL, true, 1);
+    b4.addLocalEvent(NULL, NULL, true, 2);
+    b4.addLocalEvent(NULL, NULL, true, 4);
+    assert(b4.getConfirmedState(1) != NULL);
+    assert(b4.getConfirmedState(2) == NULL);
+    b4.skipUntil(4);
+    assert(b4.getCurrent()->getTicks() == 4);
+    b4.skipUntil(5);
+    assert(!b4.hasMoreRewindInfo());
 }   // unitTesting
@@ -22,12 +22,12 @@
 #include "utils/synchronised.hpp"
 
 #include <assert.h>
-#include <list>
 #include <vector>
 
 class BareNetworkString;
 class EventRewinder;
 class RewindInfo;
+class RewindInfoState;
 class TimeStepInfo;
 
 /** \ingroup network
@@ -37,9 +37,22 @@ class RewindQueue
 {
 private:
 
-    typedef std::list<RewindInfo*> AllRewindInfo;
+    /** All RewindInfo of one time step, states before events. */
+    typedef std::vector<RewindInfo*> TickRewindInfo;
 
-    AllRewindInfo m_all_rewind_info;
+    /** Ring buffer with one entry per time step, indexed by ticks modulo
+     *  its size. It stores all RewindInfo from m_first_ticks to
+     *  m_last_ticks, all other entries are empty. The vectors keep their
+     *  capacity, so once the ring covers the rewind horizon adding and
+     *  removing RewindInfo does not allocate. */
+    std::vector<TickRewindInfo> m_all_rewind_info;
+
+    /** Time of the first (oldest) time step in m_all_rewind_info. */
+    int m_first_ticks;
+
+    /** Time of the last time step in m_all_rewind_info, less than
+     *  m_first_ticks if the queue is empty. */
+    int m_last_ticks;
 
     /** The list of all events received from the network. They are stored
      *  in a separate thread (so this data structure is thread-save), and
@@ -49,14 +62,30 @@ private:
     typedef std::vector<RewindInfo*> AllNetworkRewindInfo;
     Synchronised<AllNetworkRewindInfo> m_network_events;
 
-    /** Iterator to the curren time step info to be handled. */
-    AllRewindInfo::iterator m_current;
+    /** Time and index in its time step of the current RewindInfo to be
+     *  handled. If m_current_ticks is larger than m_last_ticks, all
+     *  RewindInfo have been handled. */
+    int m_current_ticks;
+    unsigned m_current_index;
 
     /** Time at which the latest confirmed state is at. */
     int m_latest_confirmed_state_time;
 
+    /** Latest time of an event received by a client after it had already
+     *  simulated that time step. Such events are only applied by a rewind. */
+    int m_latest_late_event_time;
+
 
     void cleanupOldRewindInfo(int ticks);
+    void reserveTicks(int ticks);
+    void skipEmptyTicks();
+    std::vector<RewindInfo*> getAllRewindInfo() const;
+    // ------------------------------------------------------------------------
+    TickRewindInfo& getTickRewindInfo(int ticks)
+    {
+        assert(ticks >= 0);
+        return m_all_rewind_info[ticks % m_all_rewind_info.size()];
+    }   // getTickRewindInfo
 
 public:
         static void unitTesting();
@@ -82,7 +111,9 @@ public:
     bool isEmpty() const;
     bool hasMoreRewindInfo() const;
     int  undoUntil(int undo_ticks);
+    void skipUntil(int ticks);
     void insertRewindInfo(RewindInfo *ri);
+    RewindInfoState* getConfirmedState(int ticks);
 
     // ------------------------------------------------------------------------
     /** Returns the time of the latest confirmed state. */
@@ -91,13 +122,17 @@ public:
         return m_latest_confirmed_state_time;
     }
     // ------------------------------------------------------------------------
+    /** Returns the latest time of an event that was received too late to be
+     *  used without a rewind. */
+    int getLatestLateEventTime() const    { return m_latest_late_event_time; }
+    // ------------------------------------------------------------------------
     /** Sets the current element to be the next one and returns the next
      *  RewindInfo element. */
     void next()
     {
-        assert(m_current != m_all_rewind_info.end());
-        m_current++;
-        return;
+        assert(hasMoreRewindInfo());
+        m_current_index++;
+        skipEmptyTicks();
     }   // operator++
 
     // ------------------------------------------------------------------------
@@ -105,7 +140,8 @@ public:
      *  least one more RewindInfo (see hasMoreRewindInfo()). */
     RewindInfo* getCurrent()
     {
-        return (m_current != m_all_rewind_info.end() ) ? *m_current : NULL;
+        return hasMoreRewindInfo() ?
+            getTickRewindInfo(m_current_ticks)[m_current_index] : NULL;
     }   // getNext
 
 };   // RewindQueue
@@ -70,12 +70,24 @@ public:
      *  caused by the rewind (which is then visually smoothed over time). */
     virtual void computeError() = 0;
 
-    /** Provides a copy of the state of the object in one memory buffer.
-     *  The memory is managed by the RewindManager.
+    /** Writes the state of the object directly into the state buffer of
+     *  GameProtocol, so no temporary buffer is allocated or copied.
+     *  \param buffer The buffer to append the state to.
      *  \param[out] ru The unique identity of rewinder writing to.
-     *  \return The address of the memory buffer with the state.
+     *  \return True if a state was written, false if this rewinder has
+     *  nothing to save (anything appended to buffer is then discarded).
      */
-    virtual BareNetworkString* saveState(std::vector<std::string>* ru) = 0;
+    virtual bool saveState(BareNetworkString* buffer,
+                           std::vector<std::string>* ru) = 0;
+
+    /** Called on a client to save the state it predicts the server will
+     *  send for the current time. It is compared with the confirmed state
+     *  later, and if they are identical for all rewinders the rewind can
+     *  be skipped. Same parameters as saveState().
+     */
+    virtual bool savePredictedState(BareNetworkString* buffer,
+                                    std::vector<std::string>* ru)
+                                            { return saveState(buffer, ru); }
 
     /** Called when an event needs to be undone. This is called while going
      *  backwards for rewinding - all stored events will get an 'undo' call.
@@ -357,6 +357,28 @@ namespace ServerConfig
         "more rewind, which clients with slow device may have problem playing "
         "this server, use the default value is recommended."));
 
+    SERVER_CFG_PREFIX BoolServerConfigParam m_delta_state
+        SERVER_CFG_DEFAULT(BoolServerConfigParam(true,
+        "delta-state",
+        "Send states compressed against the newest state each client "
+        "confirmed to have received, which saves upload bandwidth. A full "
+        "state is still sent to clients which do not support it, live join "
+        "or lost too many states."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_tick_sleep_strategy
+        SERVER_CFG_DEFAULT(IntServerConfigParam(1,
+        "tick-sleep-strategy",
+        "How the server waits for the next physics tick: 0 only sleeps, which "
+        "uses the least cpu but ticks can start late, 1 sleeps until shortly "
+        "before the tick and then yields, 2 yields all the time, which gives "
+        "the most exact tick timing but keeps a cpu core busy."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_simulation_thread_core
+        SERVER_CFG_DEFAULT(IntServerConfigParam(-1,
+        "simulation-thread-core",
+        "Run the game simulation of this server on this cpu core only "
+        "(counted from 0), -1 to let the operating system decide."));
+
     SERVER_CFG_PREFIX BoolServerConfigParam m_sql_management
         SERVER_CFG_DEFAULT(BoolServerConfigParam(false,
         "sql-management",
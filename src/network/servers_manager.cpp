@@ -321,6 +321,14 @@ std::shared_ptr<ServerList> ServersManager::getLANRefreshRequest() const
          *  functions are called, which will cause a crash. */
         virtual void afterOperation() OVERRIDE {}
         // --------------------------------------------------------------------
+        /** There is no curl transfer, the broadcast is done synchronously in
+         *  the request manager thread. */
+        virtual bool startAsync(CURL *handle) OVERRIDE
+        {
+            execute();
+            return false;
+        }   // startAsync
+        // --------------------------------------------------------------------
     };   // LANRefreshRequest
     // ========================================================================
 
@@ -0,0 +1,201 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/state_delta.hpp"
+
+#include "network/network_string.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace StateDelta
+{
+    /** A zero run shorter than this is cheaper to keep inside the literal
+     *  bytes than to start a new token. */
+    const unsigned MIN_ZERO_RUN = 3;
+    // ------------------------------------------------------------------------
+    /** Adds an unsigned value using 7 bits per byte, the highest bit tells
+     *  if more bytes follow. */
+    void addVarUInt(BareNetworkString* out, unsigned value)
+    {
+        while (value >= 0x80)
+        {
+            out->addUInt8((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        out->addUInt8((uint8_t)value);
+    }   // addVarUInt
+    // ------------------------------------------------------------------------
+    unsigned getVarUInt(const BareNetworkString* in)
+    {
+        unsigned value = 0;
+        for (unsigned shift = 0; shift < 32; shift += 7)
+        {
+            uint8_t b = in->getUInt8();
+            value |= (unsigned)(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return value;
+        }
+        throw std::out_of_range("Invalid variable length integer.");
+    }   // getVarUInt
+    // ------------------------------------------------------------------------
+    /** Encodes state as a delta to base.
+     *  \param base The older state which the receiver has.
+     *  \param base_size Size of base.
+     *  \param state The new state to be encoded.
+     *  \param state_size Size of state.
+     *  \param out The network string the delta is appended to, it must be
+     *         the last data in the message.
+     */
+    void encode(const uint8_t* base, unsigned base_size,
+                const uint8_t* state, unsigned state_size,
+                BareNetworkString* out)
+    {
+        auto delta = [base, base_size, state](unsigned i)
+        {
+            return i < base_size ? (uint8_t)(state[i] ^ base[i]) : state[i];
+        };
+
+        addVarUInt(out, state_size);
+        unsigned i = 0;
+        while (i < state_size)
+        {
+            unsigned zeros = 0;
+            while (i + zeros < state_size && delta(i + zeros) == 0)
+                zeros++;
+            // Trailing zeros are implied by the state size
+            if (i + zeros == state_size)
+                break;
+            i += zeros;
+
+            // Keep short zero runs inside the literals
+            unsigned literals = 0;
+            unsigned zero_run = 0;
+            while (i + literals < state_size)
+            {
+                if (delta(i + literals) == 0)
+                {
+                    if (++zero_run == MIN_ZERO_RUN)
+                    {
+                        zero_run--;
+                        break;
+                    }
+                }
+                else
+                    zero_run = 0;
+                literals++;
+            }
+            literals -= zero_run;
+
+            addVarUInt(out, zeros);
+            addVarUInt(out, literals);
+            for (unsigned j = 0; j < literals; j++)
+                out->addUInt8(delta(i + j));
+            i += literals;
+        }
+    }   // encode
+    // ------------------------------------------------------------------------
+    /** Decodes a delta created by encode.
+     *  \param base The same base state used in encoding.
+     *  \param base_size Size of base.
+     *  \param in The delta, read from the current offset till the end.
+     *  \param out The decoded state.
+     *  \return False if the delta is invalid.
+     */
+    bool decode(const uint8_t* base, unsigned base_size,
+                const BareNetworkString* in, std::vector<uint8_t>* out)
+    {
+        try
+        {
+            const unsigned state_size = getVarUInt(in);
+            if (state_size > 65536 * 4)
+                return false;
+            out->resize(state_size);
+            uint8_t* state = out->data();
+            unsigned i = 0;
+            while (i < state_size && in->size() > 0)
+            {
+                unsigned zeros = getVarUInt(in);
+                unsigned literals = getVarUInt(in);
+                if (zeros > state_size - i ||
+                    literals > state_size - i - zeros)
+                    return false;
+                for (unsigned j = 0; j < zeros; j++, i++)
+                    state[i] = i < base_size ? base[i] : 0;
+                for (unsigned j = 0; j < literals; j++, i++)
+                {
+                    uint8_t d = in->getUInt8();
+                    state[i] = i < base_size ? (uint8_t)(d ^ base[i]) : d;
+                }
+            }
+            // Remaining bytes are unchanged
+            for (; i < state_size; i++)
+                state[i] = i < base_size ? base[i] : 0;
+        }
+        catch (std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }   // decode
+    // ------------------------------------------------------------------------
+    void unitTesting()
+    {
+        std::vector<uint8_t> base = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+        std::vector<std::vector<uint8_t> > states =
+        {
+            base,
+            { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 13 },
+            { 0, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 },
+            { 1, 9, 3, 9, 5, 6, 7, 8, 9, 10, 9, 12, 0, 0, 7, 0 },
+            { 1, 2, 3, 4 },
+            { },
+            { 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9 }
+        };
+        for (auto& state : states)
+        {
+            BareNetworkString delta;
+            encode(base.data(), (unsigned)base.size(), state.data(),
+                (unsigned)state.size(), &delta);
+            std::vector<uint8_t> result;
+            bool decoded = decode(base.data(), (unsigned)base.size(), &delta,
+                &result);
+            assert(decoded);
+            assert(result == state);
+            (void)decoded;
+            assert(delta.size() == 0);
+        }
+
+        // An unchanged state only needs its size
+        BareNetworkString same;
+        encode(base.data(), (unsigned)base.size(), base.data(),
+            (unsigned)base.size(), &same);
+        assert(same.size() == 1);
+
+        // Truncated delta must fail and not read out of range
+        BareNetworkString truncated;
+        encode(base.data(), (unsigned)base.size(), states[6].data(),
+            (unsigned)states[6].size(), &truncated);
+        truncated.getBuffer().resize(truncated.getBuffer().size() - 2);
+        std::vector<uint8_t> result;
+        bool decoded = decode(base.data(), (unsigned)base.size(), &truncated,
+            &result);
+        assert(!decoded);
+        (void)decoded;
+    }   // unitTesting
+}   // namespace StateDelta
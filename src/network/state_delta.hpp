@@ -0,0 +1,47 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_STATE_DELTA_HPP
+#define HEADER_STATE_DELTA_HPP
+
+#include "utils/types.hpp"
+
+#include <vector>
+
+class BareNetworkString;
+
+/** \ingroup network
+ *  Delta compression of a game state against an older state which the
+ *  receiver already has. The new state is XOR'ed with the base state, so
+ *  every unchanged byte becomes zero, and the result is written as a
+ *  sequence of (zero run length, literal count, literal bytes) tokens with
+ *  variable length integers.
+ */
+namespace StateDelta
+{
+    void encode(const uint8_t* base, unsigned base_size,
+                const uint8_t* state, unsigned state_size,
+                BareNetworkString* out);
+    // ------------------------------------------------------------------------
+    bool decode(const uint8_t* base, unsigned base_size,
+                const BareNetworkString* in, std::vector<uint8_t>* out);
+    // ------------------------------------------------------------------------
+    void unitTesting();
+};   // namespace StateDelta
+
+#endif // HEADER_STATE_DELTA_HPP
@@ -65,6 +65,7 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <cinttypes>
 #include <functional>
 #include <limits>
 #include <random>
@@ -316,6 +317,9 @@ void STKHost::init()
     m_players_waiting.store(0);
     m_total_players.store(0);
     m_network_timer.store((int64_t)StkTime::getMonoTimeMs());
+    m_shared_packet_copies.store(0);
+    m_shared_packet_bytes.store(0);
+    m_peers_snapshot = std::make_shared<const PeerMap>();
     m_shutdown         = false;
     m_authorised       = false;
     m_network          = NULL;
@@ -365,11 +369,18 @@ STKHost::~STKHost()
     // Drop all unsent packets
     for (auto& p : m_enet_cmd)
     {
+        ENetPacket* packet = std::get<1>(p);
         if (std::get<3>(p) == ECT_SEND_PACKET)
-        {
-            ENetPacket* packet = std::get<1>(p);
             enet_packet_destroy(packet);
-        }
+        else if (std::get<3>(p) == ECT_RELEASE_PACKET &&
+            --packet->referenceCount == 0)
+            enet_packet_destroy(packet);
+    }
+    if (m_shared_packet_copies.load() > 0)
+    {
+        Log::info("STKHost", "Shared packets saved %" PRIu64 " copies "
+            "(%" PRIu64 " bytes).", m_shared_packet_copies.load(),
+            m_shared_packet_bytes.load());
     }
     delete m_network;
     enet_deinitialize();
@@ -746,6 +757,7 @@ void STKHost::disconnectAllPeers(bool timeout_waiting)
         m_exit_timeout.store(StkTime::getMonoTimeMs() + 2000);
     }
     m_peers.clear();
+    publishPeers();
 }   // disconnectAllPeers
 
 //-----------------------------------------------------------------------------
@@ -862,7 +874,7 @@ void STKHost::mainLoop(ProcessType pt)
 
         if (is_server)
         {
-            std::unique_lock<std::mutex> peer_lock(m_peers_mutex);
+            auto peers = getPeersSnapshot();
             const float timeout = ServerConfig::m_validation_timeout;
             bool need_ping = false;
             if (sl && (!sl->isRacing() || sl->allowJoinedPlayersWaiting()) &&
@@ -876,10 +888,11 @@ void STKHost::mainLoop(ProcessType pt)
             }
 
             BareNetworkString ping_packet;
+            ENetPacket* shared_ping = NULL;
             if (need_ping)
             {
                 m_peer_pings.getData().clear();
-                for (auto& p : m_peers)
+                for (auto& p : *peers)
                 {
                     m_peer_pings.getData()[p.second->getHostId()] =
                         p.second->getPing();
@@ -949,49 +962,63 @@ void STKHost::mainLoop(ProcessType pt)
                 ping_packet.getBuffer().insert(
                     ping_packet.getBuffer().begin(), g_ping_packet.begin(),
                     g_ping_packet.end());
+                // One packet is shared by all peers, enet counts the
+                // references and destroys it once sent to all of them
+                shared_ping = enet_packet_create(ping_packet.getData(),
+                    ping_packet.getTotalSize(), ENET_PACKET_FLAG_RELIABLE);
+                // Keep a reference, so resetting a peer below can not
+                // destroy it
+                if (shared_ping)
+                    shared_ping->referenceCount++;
             }
+            unsigned ping_sent = 0;
+            std::vector<ENetPeer*> timed_out;
 
-            for (auto it = m_peers.begin(); it != m_peers.end();)
+            for (auto& p : *peers)
             {
-                if (!ping_packet.getBuffer().empty() &&
+                if (shared_ping &&
                     (!sl->allowJoinedPlayersWaiting() ||
-                    !sl->isRacing() || it->second->isWaitingForGame()))
+                    !sl->isRacing() || p.second->isWaitingForGame()))
                 {
-                    ENetPacket* packet = enet_packet_create(ping_packet.getData(),
-                        ping_packet.getTotalSize(), ENET_PACKET_FLAG_RELIABLE);
-                    if (packet)
-                    {
-                        // If enet_peer_send failed, destroy the packet to
-                        // prevent leaking, this can only be done if the packet
-                        // is copied instead of shared sending to all peers
-                        if (enet_peer_send(
-                            it->first, EVENT_CHANNEL_UNENCRYPTED, packet) < 0)
-                        {
-                            enet_packet_destroy(packet);
-                        }
-                    }
+                    if (enet_peer_send(p.first, EVENT_CHANNEL_UNENCRYPTED,
+                        shared_ping) == 0)
+                        ping_sent++;
                 }
 
                 // Remove peer which has not been validated after a specific time
                 // It is validated when the first connection request has finished
-                if (!it->second->isAIPeer() &&
-                    !it->second->isValidated() &&
-                    it->second->getConnectedTime() > timeout)
+                if (!p.second->isAIPeer() &&
+                    !p.second->isValidated() &&
+                    p.second->getConnectedTime() > timeout)
                 {
                     Log::info("STKHost", "%s has not been validated for more"
                         " than %f seconds, disconnect it by force.",
-                        it->second->getAddress().toString().c_str(),
+                        p.second->getAddress().toString().c_str(),
                         timeout);
                     enet_host_flush(host);
-                    enet_peer_reset(it->first);
-                    it = m_peers.erase(it);
+                    enet_peer_reset(p.first);
+                    timed_out.push_back(p.first);
                 }
-                else
+            }
+            if (!timed_out.empty())
+            {
+                std::lock_guard<std::mutex> lock(m_peers_mutex);
+                for (ENetPeer* peer : timed_out)
+                    m_peers.erase(peer);
+                publishPeers();
+            }
+            peers.reset();
+            if (shared_ping)
+            {
+                if (ping_sent > 1)
                 {
-                    it++;
+                    m_shared_packet_copies.fetch_add(ping_sent - 1);
+                    m_shared_packet_bytes.fetch_add(
+                        (ping_sent - 1) * shared_ping->dataLength);
                 }
+                if (--shared_ping->referenceCount == 0)
+                    enet_packet_destroy(shared_ping);
             }
-            peer_lock.unlock();
         }
 
         std::vector<std::tuple<ENetPeer*, ENetPacket*, uint32_t,
@@ -1001,6 +1028,13 @@ void STKHost::mainLoop(ProcessType pt)
         lock.unlock();
         for (auto& p : copied_list)
         {
+            if (std::get<3>(p) == ECT_RELEASE_PACKET)
+            {
+                ENetPacket* packet = std::get<1>(p);
+                if (--packet->referenceCount == 0)
+                    enet_packet_destroy(packet);
+                continue;
+            }
             ENetPeer* peer = std::get<0>(p);
             ENetAddress& ea = std::get<4>(p);
             ENetAddress& ea_peer_now = peer->address;
@@ -1015,13 +1049,20 @@ void STKHost::mainLoop(ProcessType pt)
                 (ea_peer_now.host != ea.host && ea_peer_now.port != ea.port))
 #endif
             {
-                if (packet != NULL)
+                if (packet != NULL &&
+                    std::get<3>(p) != ECT_SEND_SHARED_PACKET)
                     enet_packet_destroy(packet);
                 continue;
             }
 
             switch (std::get<3>(p))
             {
+            case ECT_SEND_SHARED_PACKET:
+                // Another reference is kept till ECT_RELEASE_PACKET
+                enet_peer_send(peer, (uint8_t)std::get<2>(p), packet);
+                break;
+            case ECT_RELEASE_PACKET:
+                break;
             case ECT_SEND_PACKET:
             {
                 // If enet_peer_send failed, destroy the packet to
@@ -1043,6 +1084,7 @@ void STKHost::mainLoop(ProcessType pt)
                 // Remove the stk peer of it
                 std::lock_guard<std::mutex> lock(m_peers_mutex);
                 m_peers.erase(peer);
+                publishPeers();
                 break;
             }
         }
@@ -1081,6 +1123,7 @@ void STKHost::mainLoop(ProcessType pt)
                 std::unique_lock<std::mutex> lock(m_peers_mutex);
                 m_peers[event.peer] = stk_peer;
                 size_t new_peer_count = m_peers.size();
+                publishPeers();
                 lock.unlock();
                 stk_event = new Event(&event, stk_peer);
                 Log::info("STKHost", "%s has just connected. There are "
@@ -1113,16 +1156,22 @@ void STKHost::mainLoop(ProcessType pt)
                     stk_event = new Event(&event, peer);
                     m_peers.erase(event.peer);
                     new_peer_count = m_peers.size();
+                    publishPeers();
                 }
                 Log::info("STKHost", "%s has just disconnected. There are "
                     "now %u peers.", addr.c_str(), new_peer_count);
             }   // ENET_EVENT_TYPE_DISCONNECT
 
-            std::unique_lock<std::mutex> lock(m_peers_mutex);
-            if (!stk_event && m_peers.find(event.peer) != m_peers.end())
+            std::shared_ptr<STKPeer> peer;
+            if (!stk_event)
+            {
+                auto peers = getPeersSnapshot();
+                auto it = peers->find(event.peer);
+                if (it != peers->end())
+                    peer = it->second;
+            }
+            if (peer)
             {
-                std::shared_ptr<STKPeer> peer = m_peers.at(event.peer);
-                lock.unlock();
                 if (isPingPacket(event.packet->data, event.packet->dataLength))
                 {
                     if (!is_server)
@@ -1307,10 +1356,9 @@ void STKHost::handleDirectSocketRequest(Network* direct_socket,
  */
 bool STKHost::peerExists(const SocketAddress& peer)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    for (auto& p : *getPeersSnapshot())
     {
-        auto stk_peer = p.second;
+        auto& stk_peer = p.second;
         if (stk_peer->getAddress() == peer ||
             ((stk_peer->getAddress().isPublicAddressLocalhost() &&
             peer.isPublicAddressLocalhost()) &&
@@ -1327,9 +1375,10 @@ bool STKHost::peerExists(const SocketAddress& peer)
 std::shared_ptr<STKPeer> STKHost::getServerPeerForClient() const
 {
     assert(NetworkConfig::get()->isClient());
-    if (m_peers.size() != 1)
+    auto peers = getPeersSnapshot();
+    if (peers->size() != 1)
         return nullptr;
-    return m_peers.begin()->second;
+    return peers->begin()->second;
 }   // getServerPeerForClient
 
 //-----------------------------------------------------------------------------
@@ -1339,12 +1388,8 @@ std::shared_ptr<STKPeer> STKHost::getServerPeerForClient() const
  */
 void STKHost::sendPacketToAllPeersInServer(NetworkString *data, bool reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
-    {
-        if (p.second->isValidated())
-            p.second->sendPacket(data, reliable);
-    }
+    sendPacketToPeers(data, reliable,
+        [](STKPeer* p) { return p->isValidated(); });
 }   // sendPacketToAllPeersInServer
 
 //-----------------------------------------------------------------------------
@@ -1354,12 +1399,8 @@ void STKHost::sendPacketToAllPeersInServer(NetworkString *data, bool reliable)
  */
 void STKHost::sendPacketToAllPeers(NetworkString *data, bool reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
-    {
-        if (p.second->isValidated() && !p.second->isWaitingForGame())
-            p.second->sendPacket(data, reliable);
-    }
+    sendPacketToPeers(data, reliable, [](STKPeer* p)
+        { return p->isValidated() && !p->isWaitingForGame(); });
 }   // sendPacketToAllPeers
 
 //-----------------------------------------------------------------------------
@@ -1371,16 +1412,11 @@ void STKHost::sendPacketToAllPeers(NetworkString *data, bool reliable)
 void STKHost::sendPacketExcept(STKPeer* peer, NetworkString *data,
                                bool reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
-    {
-        STKPeer* stk_peer = p.second.get();
-        if (!stk_peer->isSamePeer(peer) && p.second->isValidated() &&
-            !p.second->isWaitingForGame())
+    sendPacketToPeers(data, reliable, [peer](STKPeer* p)
         {
-            stk_peer->sendPacket(data, reliable);
-        }
-    }
+            return !p->isSamePeer(peer) && p->isValidated() &&
+                !p->isWaitingForGame();
+        });
 }   // sendPacketExcept
 
 //-----------------------------------------------------------------------------
@@ -1392,26 +1428,72 @@ void STKHost::sendPacketExcept(STKPeer* peer, NetworkString *data,
 void STKHost::sendPacketToAllPeersWith(std::function<bool(STKPeer*)> predicate,
                                        NetworkString* data, bool reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    sendPacketToPeers(data, reliable, [&predicate](STKPeer* p)
+        { return p->isValidated() && predicate(p); });
+}   // sendPacketToAllPeersWith
+
+//-----------------------------------------------------------------------------
+/** Sends data to all peers for which predicate is true. Each peer using
+ *  encryption needs its own encrypted packet, all other peers share one
+ *  reference counted ENet packet instead of a copy each.
+ *  \param data Data to sent.
+ *  \param reliable If the data should be sent reliable or now.
+ *  \param predicate Function which returns true if a peer should get the
+ *         data.
+ */
+void STKHost::sendPacketToPeers(NetworkString *data, bool reliable,
+                               const std::function<bool(STKPeer*)>& predicate)
+{
+    ENetPacket* shared = NULL;
+    unsigned shared_peers = 0;
+    for (auto& p : *getPeersSnapshot())
     {
         STKPeer* stk_peer = p.second.get();
-        if (!stk_peer->isValidated())
+        if (!predicate(stk_peer))
             continue;
-        if (predicate(stk_peer))
+        if (stk_peer->getCrypto())
+        {
             stk_peer->sendPacket(data, reliable);
+            continue;
+        }
+        if (stk_peer->isDisconnected())
+            continue;
+        if (!shared)
+        {
+            shared = enet_packet_create(data->getData(),
+                data->getTotalSize(), (reliable ?
+                ENET_PACKET_FLAG_RELIABLE :
+                (ENET_PACKET_FLAG_UNSEQUENCED |
+                ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)));
+            if (!shared)
+                return;
+            // Released by ECT_RELEASE_PACKET after all sends
+            shared->referenceCount++;
+        }
+        stk_peer->sendSharedPacket(shared);
+        shared_peers++;
     }
-}   // sendPacketToAllPeersWith
+    if (!shared)
+        return;
+
+    if (shared_peers > 1)
+    {
+        m_shared_packet_copies.fetch_add(shared_peers - 1);
+        m_shared_packet_bytes.fetch_add(
+            (shared_peers - 1) * shared->dataLength);
+    }
+    addEnetCommand(NULL, shared, 0, ECT_RELEASE_PACKET, ENetAddress());
+}   // sendPacketToPeers
 
 //-----------------------------------------------------------------------------
 /** Sends a message from a client to the server. */
 void STKHost::sendToServer(NetworkString *data, bool reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    if (m_peers.empty())
+    auto peers = getPeersSnapshot();
+    if (peers->empty())
         return;
     assert(NetworkConfig::get()->isClient());
-    m_peers.begin()->second->sendPacket(data, reliable);
+    peers->begin()->second->sendPacket(data, reliable);
 }   // sendToServer
 
 //-----------------------------------------------------------------------------
@@ -1419,8 +1501,7 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
     STKHost::getAllPlayerProfiles() const
 {
     std::vector<std::shared_ptr<NetworkPlayerProfile> > p;
-    std::unique_lock<std::mutex> lock(m_peers_mutex);
-    for (auto& peer : m_peers)
+    for (auto& peer : *getPeersSnapshot())
     {
         if (peer.second->isDisconnected() || !peer.second->isValidated())
             continue;
@@ -1429,7 +1510,6 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
         auto peer_profile = peer.second->getPlayerProfiles();
         p.insert(p.end(), peer_profile.begin(), peer_profile.end());
     }
-    lock.unlock();
     return p;
 }   // getAllPlayerProfiles
 
@@ -1437,8 +1517,7 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
 std::set<uint32_t> STKHost::getAllPlayerOnlineIds() const
 {
     std::set<uint32_t> online_ids;
-    std::unique_lock<std::mutex> lock(m_peers_mutex);
-    for (auto& peer : m_peers)
+    for (auto& peer : *getPeersSnapshot())
     {
         if (peer.second->isDisconnected() || !peer.second->isValidated())
             continue;
@@ -1448,28 +1527,27 @@ std::set<uint32_t> STKHost::getAllPlayerOnlineIds() const
                 peer.second->getPlayerProfiles()[0]->getOnlineId());
         }
     }
-    lock.unlock();
     return online_ids;
 }   // getAllPlayerOnlineIds
 
 //-----------------------------------------------------------------------------
 std::shared_ptr<STKPeer> STKHost::findPeerByHostId(uint32_t id) const
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    auto ret = std::find_if(m_peers.begin(), m_peers.end(),
+    auto peers = getPeersSnapshot();
+    auto ret = std::find_if(peers->begin(), peers->end(),
         [id](const std::pair<ENetPeer*, std::shared_ptr<STKPeer> >& p)
         {
             return p.second->getHostId() == id;
         });
-    return ret != m_peers.end() ? ret->second : nullptr;
+    return ret != peers->end() ? ret->second : nullptr;
 }   // findPeerByHostId
 
 //-----------------------------------------------------------------------------
 std::shared_ptr<STKPeer>
     STKHost::findPeerByName(const core::stringw& name) const
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    auto ret = std::find_if(m_peers.begin(), m_peers.end(),
+    auto peers = getPeersSnapshot();
+    auto ret = std::find_if(peers->begin(), peers->end(),
         [name](const std::pair<ENetPeer*, std::shared_ptr<STKPeer> >& p)
         {
             bool found = false;
@@ -1483,7 +1561,7 @@ std::shared_ptr<STKPeer>
             }
             return found;
         });
-    return ret != m_peers.end() ? ret->second : nullptr;
+    return ret != peers->end() ? ret->second : nullptr;
 }   // findPeerByName
 
 //-----------------------------------------------------------------------------
@@ -1500,7 +1578,10 @@ void STKHost::initClientNetwork(ENetEvent& event, Network* new_network)
     auto stk_peer = std::make_shared<STKPeer>(event.peer, this,
         m_next_unique_host_id++);
     stk_peer->setValidated(true);
+    std::unique_lock<std::mutex> lock(m_peers_mutex);
     m_peers[event.peer] = stk_peer;
+    publishPeers();
+    lock.unlock();
     auto pm = ProtocolManager::lock();
     if (pm && !pm->isExiting())
         pm->propagateEvent(new Event(&event, stk_peer));
@@ -1530,8 +1611,7 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
     STKHost::getPlayersForNewGame(bool* has_always_on_spectators) const
 {
     std::vector<std::shared_ptr<NetworkPlayerProfile> > players;
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto& p : m_peers)
+    for (auto& p : *getPeersSnapshot())
     {
         auto& stk_peer = p.second;
         // Handle always spectate for peer
@@ -1564,8 +1644,7 @@ void STKHost::updatePlayers(unsigned* ingame, unsigned* waiting,
     uint32_t ingame_players = 0;
     uint32_t waiting_players = 0;
     uint32_t total_players = 0;
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto& p : m_peers)
+    for (auto& p : *getPeersSnapshot())
     {
         auto& stk_peer = p.second;
         if (!stk_peer->isValidated())
@@ -66,7 +66,12 @@ enum ENetCommandType : unsigned int
 {
     ECT_SEND_PACKET = 0,
     ECT_DISCONNECT = 1,
-    ECT_RESET = 2
+    ECT_RESET = 2,
+    /** Send a packet shared with other peers, which is not destroyed if
+     *  sending fails. */
+    ECT_SEND_SHARED_PACKET = 3,
+    /** Release the reference of a shared packet held by its sender. */
+    ECT_RELEASE_PACKET = 4
 };
 
 class STKHost
@@ -86,8 +91,9 @@ private:
     /** Network console thread */
     std::thread m_network_console;
 
-    /** Make sure the removing or adding a peer is thread-safe. */
-    mutable std::mutex m_peers_mutex;
+    /** Serializes adding and removing peers, readers use
+     *  \ref m_peers_snapshot and never take it. */
+    std::mutex m_peers_mutex;
 
     /** Let (atm enet_peer_send and enet_peer_disconnect) run in the listening
      *  thread. */
@@ -98,8 +104,16 @@ private:
     /** Protect \ref m_enet_cmd from multiple threads usage. */
     std::mutex m_enet_cmd_mutex;
 
-    /** The list of peers connected to this instance. */
-    std::map<ENetPeer*, std::shared_ptr<STKPeer> > m_peers;
+    typedef std::map<ENetPeer*, std::shared_ptr<STKPeer> > PeerMap;
+
+    /** The list of peers connected to this instance, only accessed by
+     *  writers with \ref m_peers_mutex locked. */
+    PeerMap m_peers;
+
+    /** Immutable copy of \ref m_peers, replaced as a whole after each change
+     *  (read-copy-update), so the per-packet lookup and broadcasts can read
+     *  the peers without locking. Use \ref getPeersSnapshot to access it. */
+    std::shared_ptr<const PeerMap> m_peers_snapshot;
 
     /** Next unique host id. It is increased whenever a new peer is added (see
      *  getPeer()), but not decreased whena host (=peer) disconnects. This
@@ -155,6 +169,11 @@ private:
 
     std::atomic<int64_t> m_network_timer;
 
+    /** Number of packet copies and bytes saved by sharing one ENet packet
+     *  for all peers without encryption in broadcasts. */
+    std::atomic<uint64_t> m_shared_packet_copies;
+    std::atomic<uint64_t> m_shared_packet_bytes;
+
     std::unique_ptr<NetworkTimerSynchronizer> m_nts;
 
     // ------------------------------------------------------------------------
@@ -164,6 +183,22 @@ private:
     // ------------------------------------------------------------------------
     void init();
     // ------------------------------------------------------------------------
+    void sendPacketToPeers(NetworkString *data, bool reliable,
+                           const std::function<bool(STKPeer*)>& predicate);
+    // ------------------------------------------------------------------------
+    /** Publishes the current \ref m_peers to readers, must be called with
+     *  \ref m_peers_mutex locked after each change to it. */
+    void publishPeers()
+    {
+        std::atomic_store(&m_peers_snapshot,
+            std::shared_ptr<const PeerMap>(std::make_shared<PeerMap>(m_peers)));
+    }
+    // ------------------------------------------------------------------------
+    /** Returns the peers at the time of calling, it stays valid (and keeps
+     *  the peers alive) even if peers are added or removed meanwhile. */
+    std::shared_ptr<const PeerMap> getPeersSnapshot() const
+                                 { return std::atomic_load(&m_peers_snapshot); }
+    // ------------------------------------------------------------------------
     void handleDirectSocketRequest(Network* direct_socket,
                                    std::shared_ptr<ServerLobby> sl,
                                    std::map<std::string, uint64_t>& ctp);
@@ -312,9 +347,8 @@ public:
     /** Returns a copied list of peers. */
     std::vector<std::shared_ptr<STKPeer> > getPeers() const
     {
-        std::lock_guard<std::mutex> lock(m_peers_mutex);
         std::vector<std::shared_ptr<STKPeer> > peers;
-        for (auto p : m_peers)
+        for (auto& p : *getPeersSnapshot())
         {
             peers.push_back(p.second);
         }
@@ -333,8 +367,7 @@ public:
     /** Returns the number of currently connected peers. */
     unsigned int getPeerCount() const
     {
-        std::lock_guard<std::mutex> lock(m_peers_mutex);
-        return (unsigned)m_peers.size();
+        return (unsigned)getPeersSnapshot()->size();
     }
     // ------------------------------------------------------------------------
     /** Sets the global host id of this host (client use). */
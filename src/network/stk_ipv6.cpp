@@ -482,6 +482,14 @@ extern "C" int insideIPv6CIDR(const char* ipv6_cidr, const char* ipv6_in)
     return 1;
 }   // andIPv6
 
+// ----------------------------------------------------------------------------
+/** Converts a textual IPv6 address to its 16 bytes in network order.
+ *  \return 1 if successful. */
+extern "C" int parseIPv6(const char* ipv6, unsigned char* out)
+{
+    return stk_inet_pton6(ipv6, out);
+}   // parseIPv6
+
 #ifndef ENABLE_IPV6
 // ----------------------------------------------------------------------------
 extern "C" int isIPv6Socket()
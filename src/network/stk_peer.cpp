@@ -133,6 +133,26 @@ void STKPeer::sendPacket(NetworkString *data, bool reliable, bool encrypted)
     }
 }   // sendPacket
 
+//-----------------------------------------------------------------------------
+/** Sends an unencrypted packet which is shared with other peers, see
+ *  STKHost::sendPacketToPeers. The packet is not destroyed if sending fails.
+ *  \param packet The ENet packet to send.
+ */
+void STKPeer::sendSharedPacket(ENetPacket* packet)
+{
+    if (m_disconnected.load())
+        return;
+
+    if (Network::m_connection_debug)
+    {
+        Log::verbose("STKPeer", "sending shared packet of size %d to %s "
+            "at %lf", packet->dataLength, getAddress().toString().c_str(),
+            StkTime::getRealTime());
+    }
+    m_host->addEnetCommand(m_enet_peer, packet, EVENT_CHANNEL_NORMAL,
+        ECT_SEND_SHARED_PACKET, m_address);
+}   // sendSharedPacket
+
 //-----------------------------------------------------------------------------
 /** Returns if the peer is connected or not.
  */
@@ -22,6 +22,7 @@
 #include "online/request_manager.hpp"
 #include "utils/constants.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
 
 #ifdef WIN32
@@ -93,6 +94,7 @@ namespace Online
         m_progress.store(0.0f);
         m_total_size.store(-1.0);
         m_disable_sending_log = false;
+        m_timing = Timing();
     }   // init
 
     // ------------------------------------------------------------------------
@@ -148,11 +150,13 @@ namespace Online
     }   // isAllowedToAdd
 
     // ------------------------------------------------------------------------
-    /** Sets up the curl data structures.
+    /** Sets up the curl data structures. If the request manager did not hand
+     *  out a handle from its pool a new curl session is created.
      */
     void HTTPRequest::prepareOperation()
     {
-        m_curl_session = curl_easy_init();
+        if (!m_curl_session)
+            m_curl_session = curl_easy_init();
         if (!m_curl_session)
         {
             Log::error("HTTPRequest::prepareOperation",
@@ -170,6 +174,9 @@ namespace Online
         curl_easy_setopt(m_curl_session, CURLOPT_LOW_SPEED_LIMIT, 10);
         curl_easy_setopt(m_curl_session, CURLOPT_LOW_SPEED_TIME, 20);
         curl_easy_setopt(m_curl_session, CURLOPT_NOSIGNAL, 1);
+        // Keep idle connections alive so that the next request to the
+        // same server can reuse them.
+        curl_easy_setopt(m_curl_session, CURLOPT_TCP_KEEPALIVE, 1L);
         //curl_easy_setopt(m_curl_session, CURLOPT_VERBOSE, 1L);
 
         // https, load certificate info
@@ -195,22 +202,38 @@ namespace Online
      */
     void HTTPRequest::operation()
     {
-        if (!m_curl_session)
+        if (!beginTransfer())
             return;
 
-        FILE *fout = NULL;
+        m_curl_code = curl_easy_perform(m_curl_session);
+        Request::operation();
+        endTransfer();
+    }   // operation
+
+    // ------------------------------------------------------------------------
+    /** Sets the remaining curl options of the transfer: where the data is
+     *  written to and the POST parameters. Also logs the request.
+     *  \return False if the transfer can not be started.
+     */
+    bool HTTPRequest::beginTransfer()
+    {
+        if (!m_curl_session)
+            return false;
+
+        m_timing.m_queue =
+            (StkTime::getMonoTimeMs() - getBusyTime()) / 1000.0;
         if (m_filename.size() > 0)
         {
-            fout = FileUtils::fopenU8Path(m_filename + ".part", "wb");
+            m_file = FileUtils::fopenU8Path(m_filename + ".part", "wb");
 
-            if (!fout)
+            if (!m_file)
             {
                 Log::error("HTTPRequest",
                            "Can't open '%s' for writing, ignored.",
                            (m_filename+".part").c_str());
-                return;
+                return false;
             }
-            curl_easy_setopt(m_curl_session,  CURLOPT_WRITEDATA,     fout  );
+            curl_easy_setopt(m_curl_session,  CURLOPT_WRITEDATA,     m_file);
             curl_easy_setopt(m_curl_session,  CURLOPT_WRITEFUNCTION, fwrite);
         }
         else
@@ -268,13 +291,38 @@ namespace Online
         }
         const std::string& uagent = StringUtils::getUserAgentString();
         curl_easy_setopt(m_curl_session, CURLOPT_USERAGENT, uagent.c_str());
+        return true;
+    }   // beginTransfer
 
-        m_curl_code = curl_easy_perform(m_curl_session);
-        Request::operation();
-
-        if (fout)
+    // ------------------------------------------------------------------------
+    /** Called once curl finished the transfer (m_curl_code is set). Collects
+     *  the timing of the transfer and moves a downloaded file into place.
+     */
+    void HTTPRequest::endTransfer()
+    {
+        curl_easy_getinfo(m_curl_session, CURLINFO_NAMELOOKUP_TIME,
+                          &m_timing.m_dns);
+        curl_easy_getinfo(m_curl_session, CURLINFO_CONNECT_TIME,
+                          &m_timing.m_connect);
+        curl_easy_getinfo(m_curl_session, CURLINFO_APPCONNECT_TIME,
+                          &m_timing.m_tls);
+        curl_easy_getinfo(m_curl_session, CURLINFO_STARTTRANSFER_TIME,
+                          &m_timing.m_first_byte);
+        curl_easy_getinfo(m_curl_session, CURLINFO_TOTAL_TIME,
+                          &m_timing.m_total);
+        curl_easy_getinfo(m_curl_session, CURLINFO_NUM_CONNECTS,
+                          &m_timing.m_new_connections);
+        Log::debug("HTTPRequest", "%s: queued %.3fs, dns %.3fs, connect "
+                   "%.3fs, tls %.3fs, first byte %.3fs, total %.3fs, "
+                   "%ld new connection(s).", m_url.c_str(), m_timing.m_queue,
+                   m_timing.m_dns, m_timing.m_connect, m_timing.m_tls,
+                   m_timing.m_first_byte, m_timing.m_total,
+                   m_timing.m_new_connections);
+
+        if (m_file)
         {
-            fclose(fout);
+            fclose(m_file);
+            m_file = NULL;
             if (m_curl_code == CURLE_OK)
             {
                 if(UserConfigParams::logAddons())
@@ -298,8 +346,48 @@ namespace Online
                     m_curl_code = CURLE_WRITE_ERROR;
                 }
             }   // m_curl_code ==CURLE_OK
-        }   // if fout
-    }   // operation
+        }   // if m_file
+    }   // endTransfer
+
+    // ------------------------------------------------------------------------
+    /** Starts the transfer on a handle from the request manager's pool. The
+     *  manager adds the handle to its curl multi handle and calls
+     *  finishAsync once the transfer is done.
+     *  \param handle The curl easy handle to use.
+     *  \return False if no transfer was started, in which case the request
+     *          was already finished (or aborted) and the handle is unused.
+     */
+    bool HTTPRequest::startAsync(CURL *handle)
+    {
+        assert(isBusy());
+        if (isAborted())
+            return false;
+
+        m_curl_session = handle;
+        prepareOperation();
+        if (!isAborted() && beginTransfer())
+            return true;
+
+        // Nothing to transfer, finish the request like execute() would
+        m_curl_session = NULL;
+        if (!isAborted())
+            completeOperation();
+        return false;
+    }   // startAsync
+
+    // ------------------------------------------------------------------------
+    /** Finishes a transfer started with startAsync.
+     *  \param code The curl result of the transfer.
+     */
+    void HTTPRequest::finishAsync(CURLcode code)
+    {
+        m_curl_code = code;
+        endTransfer();
+        // The handle belongs to the request manager's pool
+        m_curl_session = NULL;
+        if (!isAborted())
+            completeOperation();
+    }   // finishAsync
 
     // ------------------------------------------------------------------------
     /** Cleanup once the download is finished. The value of progress is
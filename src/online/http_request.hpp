@@ -29,6 +29,7 @@
 #include <atomic>
 #include <curl/curl.h>
 #include <assert.h>
+#include <stdio.h>
 #include <string>
 
 #if defined(CURLOPT_XFERINFODATA)
@@ -54,6 +55,28 @@ namespace Online
      */
     class HTTPRequest : public Request
     {
+    public:
+        /** Timing information of a finished transfer, in seconds. Except for
+         *  the queue time all values are measured by curl from the start of
+         *  the transfer. */
+        struct Timing
+        {
+            /** Time the request waited in the queue before it started. */
+            double m_queue;
+            /** Time until the host name was resolved. */
+            double m_dns;
+            /** Time until the tcp connection was established. */
+            double m_connect;
+            /** Time until the TLS handshake was done. */
+            double m_tls;
+            /** Time until the first byte of the answer was received. */
+            double m_first_byte;
+            /** Total time of the transfer. */
+            double m_total;
+            /** Number of new connections, 0 if a connection was reused. */
+            long   m_new_connections;
+        };
+
     private:
         /** The progress indicator. 0 untill it is started and the first
          *  packet is downloaded. Guaranteed to be <1 while the download
@@ -79,6 +102,13 @@ namespace Online
         /** String to store the received data in. */
         std::string m_string_buffer;
 
+        /** The file the data is written to while downloading, or NULL if the
+         *  data is kept in m_string_buffer. */
+        FILE *m_file = NULL;
+
+        /** Timing of the transfer, valid once the request was executed. */
+        Timing m_timing;
+
         struct curl_slist* m_http_header = NULL;
     protected:
         /** Contains a filename if the data should be saved into a file
@@ -94,6 +124,9 @@ namespace Online
         virtual void operation() OVERRIDE;
         virtual void afterOperation() OVERRIDE;
 
+        bool beginTransfer();
+        void endTransfer();
+
         static int progressDownload(void *clientp, progress_t dltotal,
                                     progress_t dlnow,  progress_t ultotal,
                                     progress_t ulnow);
@@ -117,6 +150,8 @@ namespace Online
             }
         }
         virtual bool       isAllowedToAdd() const OVERRIDE;
+        virtual bool       startAsync(CURL *handle) OVERRIDE;
+        virtual void       finishAsync(CURLcode code) OVERRIDE;
         void               setApiURL(const std::string& url, const std::string &action);
         void               setAddonsURL(const std::string& path);
 
@@ -181,6 +216,15 @@ namespace Online
             curl_free(s2);
         }   // addParameter
 
+        // --------------------------------------------------------------------
+        /** Returns the timing of the transfer.
+         *  \pre request has to be executed */
+        const Timing& getTiming() const
+        {
+            assert(hasBeenExecuted());
+            return m_timing;
+        }   // getTiming
+
         // --------------------------------------------------------------------
         /** Returns the current progress. */
         float getProgress() const { return m_progress.load(); }
@@ -0,0 +1,185 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "online/local_http_server.hpp"
+
+#include "utils/string_utils.hpp"
+
+#include <chrono>
+#include <functional>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#  define SHUT_RDWR SD_BOTH
+typedef int socklen_t;
+#else
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/select.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#  define closesocket close
+#  define INVALID_SOCKET -1
+#endif
+
+namespace Online
+{
+    // ------------------------------------------------------------------------
+    /** Opens a listening socket on a free port of the loopback interface and
+     *  starts the thread accepting connections.
+     */
+    LocalHttpServer::LocalHttpServer()
+    {
+        m_port = 0;
+        m_stop.store(false);
+        m_fast_answered = 0;
+        m_slow_in_time = false;
+        m_listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listen_socket == INVALID_SOCKET)
+            return;
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (bind(m_listen_socket, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+            listen(m_listen_socket, 16) != 0 ||
+            getsockname(m_listen_socket, (sockaddr*)&addr, &len) != 0)
+            return;
+        m_port = ntohs(addr.sin_port);
+        m_accept_thread = std::thread(&LocalHttpServer::acceptLoop, this);
+    }   // LocalHttpServer
+
+    // ------------------------------------------------------------------------
+    LocalHttpServer::~LocalHttpServer()
+    {
+        m_stop.store(true);
+        if (m_accept_thread.joinable())
+            m_accept_thread.join();
+        // Wake up the connection threads waiting in recv
+        for (Socket s : m_connections)
+            shutdown(s, SHUT_RDWR);
+        for (std::thread &t : m_connection_threads)
+            t.join();
+        for (Socket s : m_connections)
+            closesocket(s);
+        if (m_listen_socket != INVALID_SOCKET)
+            closesocket(m_listen_socket);
+    }   // ~LocalHttpServer
+
+    // ------------------------------------------------------------------------
+    /** Accepts new connections till the server is deleted. The listening
+     *  socket is polled so that the stop flag is checked regularly.
+     */
+    void LocalHttpServer::acceptLoop()
+    {
+        while (!m_stop.load())
+        {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(m_listen_socket, &set);
+            timeval tv;
+            tv.tv_sec  = 0;
+            tv.tv_usec = 50000;
+            if (select((int)m_listen_socket + 1, &set, NULL, NULL, &tv) <= 0)
+                continue;
+            Socket s = accept(m_listen_socket, NULL, NULL);
+            if (s == INVALID_SOCKET)
+                continue;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_connections.push_back(s);
+            m_connection_threads.emplace_back(
+                std::bind(&LocalHttpServer::handleConnection, this, s));
+        }
+    }   // acceptLoop
+
+    // ------------------------------------------------------------------------
+    /** Answers all requests sent on one connection, till the client closes
+     *  it or the server is deleted.
+     *  \param s The socket of the connection.
+     */
+    void LocalHttpServer::handleConnection(Socket s)
+    {
+        std::string data;
+        char buffer[1024];
+        while (true)
+        {
+            size_t header_end = data.find("\r\n\r\n");
+            if (header_end == std::string::npos)
+            {
+                int n = recv(s, buffer, sizeof(buffer), 0);
+                if (n <= 0)
+                    return;
+                data.append(buffer, n);
+                continue;
+            }
+            // Skip the body of a POST request
+            size_t length = 0;
+            size_t pos = data.find("Content-Length:");
+            if (pos != std::string::npos && pos < header_end)
+                length = atoi(data.c_str() + pos + 15);
+            while (data.size() < header_end + 4 + length)
+            {
+                int n = recv(s, buffer, sizeof(buffer), 0);
+                if (n <= 0)
+                    return;
+                data.append(buffer, n);
+            }
+            bool slow = data.compare(0, 10, "POST /slow") == 0 ||
+                        data.compare(0, 9,  "GET /slow") == 0;
+            data.erase(0, header_end + 4 + length);
+
+            std::string body = slow ? "slow" : "fast";
+            if (slow)
+            {
+                std::unique_lock<std::mutex> ul(m_mutex);
+                m_slow_in_time = m_cv.wait_for(ul, std::chrono::seconds(10),
+                    [this]() { return m_fast_answered >= 3; });
+            }
+            std::string reply = "HTTP/1.1 200 OK\r\nContent-Length: " +
+                StringUtils::toString(body.size()) + "\r\n\r\n" + body;
+            send(s, reply.c_str(), (int)reply.size(), 0);
+            if (!slow)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_fast_answered++;
+                m_cv.notify_all();
+            }
+        }
+    }   // handleConnection
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of connections accepted so far. */
+    int LocalHttpServer::getConnectionCount()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return (int)m_connections.size();
+    }   // getConnectionCount
+
+    // ------------------------------------------------------------------------
+    /** Returns if /slow was answered after three other requests, i.e. the
+     *  other requests were not blocked by it. */
+    bool LocalHttpServer::wasSlowInTime()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_slow_in_time;
+    }   // wasSlowInTime
+
+} // namespace Online
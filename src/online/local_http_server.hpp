@@ -0,0 +1,91 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LOCAL_HTTP_SERVER_HPP
+#define HEADER_LOCAL_HTTP_SERVER_HPP
+
+#include "utils/no_copy.hpp"
+
+#ifdef WIN32
+#  include <winsock2.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Online
+{
+    /** A minimal keep-alive http server on localhost, only used by
+     *  RequestManager::unitTesting. Each connection is handled in its own
+     *  thread. A request for /slow is only answered once three other
+     *  requests were answered (or after 10 seconds), so it can only finish
+     *  in time if the requests are transferred concurrently. All other
+     *  requests are answered immediately with "fast".
+     * \ingroup online
+     */
+    class LocalHttpServer : public NoCopy
+    {
+    private:
+#ifdef WIN32
+        typedef SOCKET Socket;
+#else
+        typedef int    Socket;
+#endif
+        Socket m_listen_socket;
+
+        /** The port the server listens on, 0 if it could not be started. */
+        int m_port;
+
+        std::atomic_bool m_stop;
+
+        std::thread m_accept_thread;
+
+        /** Protects all members below. */
+        std::mutex m_mutex;
+
+        std::condition_variable m_cv;
+
+        /** All accepted connections. */
+        std::vector<Socket> m_connections;
+
+        std::vector<std::thread> m_connection_threads;
+
+        /** Number of answered requests other than /slow. */
+        int m_fast_answered;
+
+        /** If /slow was answered after three other requests. */
+        bool m_slow_in_time;
+
+        void acceptLoop();
+        void handleConnection(Socket s);
+
+    public:
+        LocalHttpServer();
+        ~LocalHttpServer();
+        int  getConnectionCount();
+        bool wasSlowInTime();
+        // --------------------------------------------------------------------
+        /** Returns the port, or 0 if the server could not be started. */
+        int getPort() const { return m_port; }
+    };   // LocalHttpServer
+} // namespace Online
+#endif // HEADER_LOCAL_HTTP_SERVER_HPP
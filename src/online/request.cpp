@@ -41,6 +41,7 @@ namespace Online
         m_cancel.setAtomic(false);
         m_state.setAtomic(S_PREPARING);
         m_is_abortable.setAtomic(true);
+        m_busy_time = 0;
     }   // Request
 
     // ------------------------------------------------------------------------
@@ -51,6 +52,15 @@ namespace Online
         RequestManager::get()->addRequest(shared_from_this());
     }   // queue
 
+    // ------------------------------------------------------------------------
+    /** Returns true if STK is quitting and this request can be aborted.
+     */
+    bool Request::isAborted() const
+    {
+        return RequestManager::isRunning() &&
+               RequestManager::get()->getAbort() && isAbortable();
+    }   // isAborted
+
     // ------------------------------------------------------------------------
     /** Executes the request. This calles prepareOperation, operation, and
      *  afterOperation.
@@ -59,19 +69,24 @@ namespace Online
     {
         assert(isBusy());
         // Abort as early as possible if abort is requested
-        if (RequestManager::isRunning() &&
-            RequestManager::get()->getAbort() && isAbortable()) return;
+        if (isAborted()) return;
         prepareOperation();
-        if (RequestManager::isRunning() &&
-            RequestManager::get()->getAbort() && isAbortable()) return;
+        if (isAborted()) return;
         operation();
-        if (RequestManager::isRunning() &&
-            RequestManager::get()->getAbort() && isAbortable()) return;
+        if (isAborted()) return;
+        completeOperation();
+    }   // execute
+
+    // ------------------------------------------------------------------------
+    /** Marks the request as executed and calls afterOperation. This is the
+     *  last step of execute, and of an asynchronous transfer once it is done.
+     */
+    void Request::completeOperation()
+    {
         setExecuted();
-        if (RequestManager::isRunning() &&
-            RequestManager::get()->getAbort() && isAbortable()) return;
+        if (isAborted()) return;
         afterOperation();
-    }   // execute
+    }   // completeOperation
 
     // ------------------------------------------------------------------------
     /** Executes the request now, i.e. in the main thread and without involving
@@ -83,11 +98,9 @@ namespace Online
         assert(isPreparing());
         setBusy();
         execute();
-        if (RequestManager::isRunning() &&
-            RequestManager::get()->getAbort() && isAbortable()) return;
+        if (isAborted()) return;
         callback();
-        if (RequestManager::isRunning() &&
-            RequestManager::get()->getAbort() && isAbortable()) return;
+        if (isAborted()) return;
         setDone();
     }   // executeNow
 
@@ -22,6 +22,7 @@
 #include "utils/cpp2011.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/synchronised.hpp"
+#include "utils/time.hpp"
 
 #ifdef WIN32
 #  include <winsock2.h>
@@ -105,6 +106,13 @@ namespace Online
          *  executed */
         Synchronised<State>             m_state;
 
+        /** Time (StkTime::getMonoTimeMs) at which this request was put into
+         *  the queue, used to report how long it waited for a free slot. */
+        uint64_t                        m_busy_time;
+
+        bool isAborted() const;
+        void completeOperation();
+
         // --------------------------------------------------------------------
         /** The actual operation to be executed. Empty as default, which
          *  allows to create a 'quit' request without any additional code. */
@@ -130,6 +138,22 @@ namespace Online
         void     executeNow();
         void     queue();
 
+        // --------------------------------------------------------------------
+        /** Starts this request on the given curl easy handle without waiting
+         *  for the transfer to finish. The default implementation has no
+         *  transfer to start, it executes the request synchronously instead.
+         *  \param handle A reset curl easy handle from the manager's pool.
+         *  \return True if the handle was added to a transfer, in which case
+         *          finishAsync must be called once it is done. */
+        virtual bool startAsync(CURL *handle) { execute(); return false; }
+
+        // --------------------------------------------------------------------
+        /** Called by the manager thread once a transfer started in
+         *  startAsync is complete. After this the request must not use the
+         *  handle anymore.
+         *  \param code The curl result of the transfer. */
+        virtual void finishAsync(CURLcode code) {}
+
         // --------------------------------------------------------------------
         /** Executed when a request has finished. */
         virtual void callback() {}
@@ -163,9 +187,14 @@ namespace Online
         void setBusy()
         {
             assert(m_state.getAtomic() == S_PREPARING);
+            m_busy_time = StkTime::getMonoTimeMs();
             m_state.setAtomic(S_BUSY);
         }   // setBusy
 
+        // --------------------------------------------------------------------
+        /** Returns the time in ms at which this request was set busy. */
+        uint64_t getBusyTime() const { return m_busy_time; }
+
         // --------------------------------------------------------------------
         /** Sets the request to be completed. */
         void setExecuted()
@@ -22,9 +22,13 @@
 
 #include "config/player_manager.hpp"
 #include "config/user_config.hpp"
+#include "online/http_request.hpp"
+#include "online/local_http_server.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/string_utils.hpp"
 #include "utils/vs.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <stdio.h>
@@ -75,6 +79,7 @@ namespace Online
         m_game_polling_interval = 60;  // same for game polling
         m_time_since_poll       = m_menu_polling_interval;
         curl_global_init(CURL_GLOBAL_DEFAULT);
+        m_multi = curl_multi_init();
         m_abort.setAtomic(false);
     }   // RequestManager
 
@@ -82,6 +87,10 @@ namespace Online
     RequestManager::~RequestManager()
     {
         m_thread.join();
+        assert(m_active_requests.empty());
+        for (CURL *handle : m_idle_handles)
+            curl_easy_cleanup(handle);
+        curl_multi_cleanup(m_multi);
         curl_global_cleanup();
     }   // ~RequestManager
 
@@ -162,12 +171,19 @@ namespace Online
         // Wake up the network http thread
         m_condition_variable.notify_one();
         m_request_queue.unlock();
+#if LIBCURL_VERSION_NUM >= 0x074400
+        // In case that the thread is waiting for running transfers
+        curl_multi_wakeup(m_multi);
+#endif
     }   // addRequest
 
     // ------------------------------------------------------------------------
     /** The actual main loop, which is started as a separate thread from the
      *  constructor. After testing for a new server, fetching news, the list
      *  of packages to download, it will wait for commands to be issued.
+     *  Queued requests are started as long as fewer than
+     *  UserConfigParams::m_max_concurrent_requests transfers are running,
+     *  and the running transfers are driven by the curl multi handle.
      *  \param obj: A pointer to this object, passed on by pthread_create
      */
     void RequestManager::mainLoop(void *obj)
@@ -175,40 +191,63 @@ namespace Online
         VS::setThreadName("RequestManager");
         RequestManager *me = (RequestManager*) obj;
 
-        me->m_current_request = nullptr;
+        bool quit = false;
         std::unique_lock<std::mutex> ul = me->m_request_queue.acquireMutex();
-        while (me->m_request_queue.getData().empty() ||
-               me->m_request_queue.getData().top()->getType() != Request::RT_QUIT)
+        while (!quit || !me->m_active_requests.empty())
         {
-            bool empty = me->m_request_queue.getData().empty();
-
-            // Wait in cond_wait for a request to arrive. The 'while' is necessary
-            // since "spurious wakeups from the pthread_cond_wait ... may occur"
-            // (pthread_cond_wait man page)!
-            while (empty)
+            // Wait in cond_wait for a request to arrive if no transfer is
+            // running. The 'while' is necessary since "spurious wakeups from
+            // the pthread_cond_wait ... may occur" (pthread_cond_wait man page)!
+            while (!quit && me->m_active_requests.empty() &&
+                   me->m_request_queue.getData().empty())
             {
                 me->m_condition_variable.wait(ul);
-                empty = me->m_request_queue.getData().empty();
             }
-            // We pause the request manager thread when going into background in iOS
-            // So this will only be evaluated a while
-            if (me->m_paused.load())
-                StkTime::sleep(1);
-            me->m_current_request = me->m_request_queue.getData().top();
-            me->m_request_queue.getData().pop();
 
-            if (me->m_current_request->getType() == Request::RT_QUIT)
+            // Start queued requests while there are free transfer slots.
+            // Once the quit request is found no new request is started, but
+            // running transfers (e.g. a not abortable sign-out) are finished.
+            const unsigned int max_active =
+                std::max((int)UserConfigParams::m_max_concurrent_requests, 1);
+            while (!quit && !me->m_request_queue.getData().empty() &&
+                   me->m_active_requests.size() < max_active)
             {
-                break;
-            }
+                // We pause the request manager thread when going into
+                // background in iOS. So this will only be evaluated a while
+                if (me->m_paused.load())
+                    StkTime::sleep(1);
+                std::shared_ptr<Request> request =
+                    me->m_request_queue.getData().top();
+                me->m_request_queue.getData().pop();
+
+                if (request->getType() == Request::RT_QUIT)
+                {
+                    quit = true;
+                    break;
+                }
 
+                ul.unlock();
+                me->startRequest(request);
+                ul = me->m_request_queue.acquireMutex();
+            }
             ul.unlock();
-            me->m_current_request->execute();
-            // This test is necessary in case that execute() was aborted
-            // (otherwise the assert in addResult will be triggered).
-            if (!me->getAbort())
-                me->addResult(me->m_current_request);
-            me->m_current_request = nullptr;
+
+            if (!me->m_active_requests.empty())
+            {
+                int running = 0;
+                curl_multi_perform(me->m_multi, &running);
+                me->finishTransfers();
+            }
+            if (!me->m_active_requests.empty())
+            {
+                // Wait for network activity, a new request (see addRequest),
+                // or at most 100 ms to check the abort flag again.
+#if LIBCURL_VERSION_NUM >= 0x074400
+                curl_multi_poll(me->m_multi, NULL, 0, 100, NULL);
+#else
+                curl_multi_wait(me->m_multi, NULL, 0, 100, NULL);
+#endif
+            }
             ul = me->m_request_queue.acquireMutex();
         } // while handle all requests
 
@@ -224,6 +263,87 @@ namespace Online
         }
     }   // mainLoop
 
+    // ------------------------------------------------------------------------
+    /** Returns a curl easy handle from the pool, or a new one if all handles
+     *  are in use. Returns NULL if curl can not create a handle.
+     */
+    CURL* RequestManager::acquireHandle()
+    {
+        if (m_idle_handles.empty())
+            return curl_easy_init();
+        CURL *handle = m_idle_handles.back();
+        m_idle_handles.pop_back();
+        return handle;
+    }   // acquireHandle
+
+    // ------------------------------------------------------------------------
+    /** Puts a handle back into the pool. The options are reset, but curl
+     *  keeps its connections alive so that they can be reused.
+     *  \param handle The handle which is not used by any transfer anymore.
+     */
+    void RequestManager::releaseHandle(CURL *handle)
+    {
+        curl_easy_reset(handle);
+        m_idle_handles.push_back(handle);
+    }   // releaseHandle
+
+    // ------------------------------------------------------------------------
+    /** Starts the transfer of a request. Requests without a transfer (or
+     *  which failed to start one) are finished immediately.
+     *  \param request The request taken from the queue.
+     */
+    void RequestManager::startRequest(std::shared_ptr<Online::Request> request)
+    {
+        CURL *handle = acquireHandle();
+        if (!handle)
+        {
+            request->execute();
+        }
+        else if (request->startAsync(handle))
+        {
+            m_active_requests[handle] = request;
+            curl_multi_add_handle(m_multi, handle);
+            return;
+        }
+        else
+        {
+            releaseHandle(handle);
+        }
+
+        // This test is necessary in case that execute() was aborted
+        // (otherwise the assert in addResult will be triggered).
+        if (!getAbort())
+            addResult(request);
+    }   // startRequest
+
+    // ------------------------------------------------------------------------
+    /** Finishes all requests whose transfers are done and returns their
+     *  handles to the pool.
+     */
+    void RequestManager::finishTransfers()
+    {
+        int messages_left = 0;
+        while (CURLMsg *msg = curl_multi_info_read(m_multi, &messages_left))
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+            // msg is invalid once the handle is removed
+            CURL *handle = msg->easy_handle;
+            CURLcode code = msg->data.result;
+            curl_multi_remove_handle(m_multi, handle);
+
+            auto it = m_active_requests.find(handle);
+            assert(it != m_active_requests.end());
+            std::shared_ptr<Request> request = it->second;
+            m_active_requests.erase(it);
+
+            request->finishAsync(code);
+            releaseHandle(handle);
+            if (!getAbort())
+                addResult(request);
+        }
+    }   // finishTransfers
+
     // ------------------------------------------------------------------------
     /** Inserts a request into the queue of results.
      *  \param request The pointer to the request to insert.
@@ -286,4 +406,108 @@ namespace Online
         }
 
     }   // update
+
+    // ------------------------------------------------------------------------
+    /** Tests the request manager against a local http server: a slow request
+     *  must not block the requests queued after it, and later requests must
+     *  reuse the kept alive connections.
+     */
+    void RequestManager::unitTesting()
+    {
+        int error_count = 0;
+        RequestManager *rm = get();
+
+        // Waits till all requests are executed, and handles their results.
+        auto wait_for = [rm](std::vector<std::shared_ptr<HTTPRequest> > &r)
+        {
+            uint64_t timeout = StkTime::getMonoTimeMs() + 20000;
+            bool done = false;
+            while (!done && StkTime::getMonoTimeMs() < timeout)
+            {
+                StkTime::sleep(10);
+                rm->handleResultQueue();
+                done = true;
+                for (auto &request : r)
+                    done &= request->isDone();
+            }
+            return done;
+        };
+
+        LocalHttpServer server;
+        if (server.getPort() == 0)
+        {
+            Log::error("RequestManager", "Can not start local http server.");
+            assert(false);
+            return;
+        }
+        int saved_internet = UserConfigParams::m_internet_status;
+        int saved_max = UserConfigParams::m_max_concurrent_requests;
+        UserConfigParams::m_internet_status = IPERM_ALLOWED;
+        UserConfigParams::m_max_concurrent_requests = 4;
+
+        std::string url = "http://127.0.0.1:" +
+                          StringUtils::toString(server.getPort()) + "/";
+        std::vector<std::shared_ptr<HTTPRequest> > requests;
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            // The slow request has the highest priority, so it is started
+            // before the fast ones.
+            auto request = std::make_shared<HTTPRequest>(i == 0 ? 10 : 1);
+            request->setURL(url + (i == 0 ? "slow" : "fast"));
+            rm->addRequest(request);
+            requests.push_back(request);
+        }
+        if (!wait_for(requests))
+        {
+            Log::error("RequestManager", "Concurrent requests timed out.");
+            error_count++;
+        }
+        if (!server.wasSlowInTime())
+        {
+            Log::error("RequestManager",
+                       "Slow request blocked the other requests.");
+            error_count++;
+        }
+        for (unsigned int i = 0; i < requests.size(); i++)
+        {
+            if (!requests[i]->isDone())
+                continue;
+            if (requests[i]->hadDownloadError() ||
+                requests[i]->getData() != (i == 0 ? "slow" : "fast"))
+            {
+                Log::error("RequestManager", "Request %u failed.", i);
+                error_count++;
+            }
+        }
+
+        // Later requests must reuse the existing connections
+        int connections = server.getConnectionCount();
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            std::vector<std::shared_ptr<HTTPRequest> > single;
+            single.push_back(std::make_shared<HTTPRequest>());
+            single[0]->setURL(url + "fast");
+            rm->addRequest(single[0]);
+            if (!wait_for(single) || single[0]->hadDownloadError())
+            {
+                Log::error("RequestManager", "Request failed.");
+                error_count++;
+            }
+            else if (single[0]->getTiming().m_new_connections != 0)
+            {
+                Log::error("RequestManager", "Connection was not reused.");
+                error_count++;
+            }
+        }
+        if (server.getConnectionCount() != connections)
+        {
+            Log::error("RequestManager", "%d new connections were opened.",
+                       server.getConnectionCount() - connections);
+            error_count++;
+        }
+
+        UserConfigParams::m_internet_status = saved_internet;
+        UserConfigParams::m_max_concurrent_requests = saved_max;
+        assert(error_count == 0);
+    }   // unitTesting
 } // namespace Online
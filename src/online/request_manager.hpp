@@ -36,9 +36,11 @@
 #include <atomic>
 #include <condition_variable>
 #include <curl/curl.h>
+#include <map>
 #include <memory>
 #include <queue>
 #include <thread>
+#include <vector>
 
 namespace Online
 {
@@ -56,6 +58,12 @@ namespace Online
      *  any functions or data members in requests, since they will either
      *  be handled by the main thread, or RequestManager thread, never by
      *  both.
+     *  The http transfers themselves are driven by a curl multi handle, so
+     *  up to UserConfigParams::m_max_concurrent_requests requests are
+     *  transferred at the same time (a slow addon download does not block
+     *  a sign-in). The curl easy handles are kept in a pool and reused, and
+     *  idle connections are kept alive in the multi handle, so consecutive
+     *  requests to the same server do not need a new tcp/TLS handshake.
      *  On exit, if necessary a high priority sign-out or client-quit request
      *  is put into the queue, and a flag is set which causes libcurl to
      *  abort any ongoing download. Then an additional 'quit' event with
@@ -96,8 +104,17 @@ namespace Online
             /** Time passed since the last poll request. */
             float                     m_time_since_poll;
 
-            /** The current requested being worked on. */
-            std::shared_ptr<Online::Request> m_current_request;
+            /** The curl multi handle which runs all transfers. */
+            CURLM                    *m_multi;
+
+            /** Curl easy handles that are not used by any transfer. Only
+             *  accessed by the manager thread. */
+            std::vector<CURL*>        m_idle_handles;
+
+            /** The requests whose transfers are currently running, indexed
+             *  by their curl handle. Only accessed by the manager thread. */
+            std::map<CURL*, std::shared_ptr<Online::Request> >
+                                      m_active_requests;
 
             /** A conditional variable to wake up the main loop. */
             std::condition_variable   m_condition_variable;
@@ -133,6 +150,10 @@ namespace Online
 
             void addResult(std::shared_ptr<Online::Request> request);
             void handleResultQueue();
+            CURL* acquireHandle();
+            void releaseHandle(CURL *handle);
+            void startRequest(std::shared_ptr<Online::Request> request);
+            void finishTransfers();
 
             static void mainLoop(void *obj);
 
@@ -159,6 +180,7 @@ namespace Online
 
             static void deallocate();
             static bool isRunning();
+            static void unitTesting();
 
             void addRequest(std::shared_ptr<Online::Request> request);
             void startNetworkThread();
@@ -838,14 +838,14 @@ void PhysicalObject::computeError()
 }   // computeError
 
 // ----------------------------------------------------------------------------
-BareNetworkString* PhysicalObject::saveState(std::vector<std::string>* ru)
+bool PhysicalObject::saveState(BareNetworkString* buffer,
+                               std::vector<std::string>* ru)
 {
     bool has_live_join = false;
 
     if (auto sl = LobbyProtocol::get<LobbyProtocol>())
         has_live_join = sl->hasLiveJoiningRecently();
 
-    BareNetworkString* buffer = new BareNetworkString();
     // This will compress and round down values of body, use the rounded
     // down value to test if sending state is needed
     // If any client live-joined always send new state for this object
@@ -859,17 +859,31 @@ BareNetworkString* PhysicalObject::saveState(std::vector<std::string>* ru)
         (current_lv - m_last_lv).length() < 0.01f &&
         (current_av - m_last_av).length() < 0.01f && !has_live_join)
     {
-        delete buffer;
-        return nullptr;
+        // The compressed body written above is discarded by the caller
+        return false;
     }
 
     ru->push_back(getUniqueIdentity());
     m_last_transform = cur_transform;
     m_last_lv = current_lv;
     m_last_av = current_av;
-    return buffer;
+    return true;
 }   // saveState
 
+// ----------------------------------------------------------------------------
+/** The client keeps the last transform for its local state restore, so
+ *  unlike saveState() this must not modify it. The body itself is rounded
+ *  by compress() like on the server, see
+ *  RewindManager::savePredictedState().
+ */
+bool PhysicalObject::savePredictedState(BareNetworkString* buffer,
+                                        std::vector<std::string>* ru)
+{
+    ru->push_back(getUniqueIdentity());
+    CompressNetworkBody::compress(m_body, m_motion_state, buffer);
+    return true;
+}   // savePredictedState
+
 // ----------------------------------------------------------------------------
 void PhysicalObject::restoreState(BareNetworkString *buffer, int count)
 {
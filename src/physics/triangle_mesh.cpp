@@ -19,16 +19,17 @@
 #include "physics/triangle_mesh.hpp"
 
 #include "config/stk_config.hpp"
+#include "io/file_manager.hpp"
 #include "main_loop.hpp"
+#include "network/crypto.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 
 #include "btBulletDynamicsCommon.h"
 
-#include <fstream>
-
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
  */
@@ -45,6 +46,7 @@ TriangleMesh::TriangleMesh(bool can_be_transformed) : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_bvh_buffer       = NULL;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -87,13 +89,149 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
     m_p1p2p3.push_back(edge1.cross(edge2).length2());
 }   // addTriangle
 
+// -----------------------------------------------------------------------------
+/** Version of the BVH cache files, must be increased if the format or the
+ *  way the BVH is built is changed. */
+static const uint8_t BVH_CACHE_VERSION = 1;
+
+/** Returns the name of the file in which the BVH of this mesh is cached. It
+ *  contains a hash of all triangles, the bullet version and the memory
+ *  layout, since the serialized BVH can only be used if all of them are
+ *  the same.
+ */
+std::string TriangleMesh::getBvhCacheFile() const
+{
+    const IndexedMeshArray &m = m_mesh.getIndexedMeshArray();
+    const btIndexedMesh &mesh = m[0];
+
+    std::string content;
+    const int layout[] = { BVH_CACHE_VERSION, BT_BULLET_VERSION,
+                           (int)sizeof(btScalar), (int)sizeof(void*),
+                           IS_LITTLE_ENDIAN ? 1 : 0 };
+    content.append((const char*)layout, sizeof(layout));
+    // Only the three coordinates, the fourth component of the vertices is
+    // not initialised
+    content.reserve(content.size() +
+                    mesh.m_numVertices * 3 * sizeof(btScalar) +
+                    mesh.m_numTriangles * mesh.m_triangleIndexStride);
+    for (int i = 0; i < mesh.m_numVertices; i++)
+    {
+        const btScalar *v = (const btScalar*)
+            (mesh.m_vertexBase + i * mesh.m_vertexStride);
+        content.append((const char*)v, 3 * sizeof(btScalar));
+    }
+    content.append((const char*)mesh.m_triangleIndexBase,
+                   mesh.m_numTriangles * mesh.m_triangleIndexStride);
+
+    std::string hash;
+    char hex[3];
+    for (uint8_t byte : Crypto::sha256(content))
+    {
+        snprintf(hex, sizeof(hex), "%02x", byte);
+        hash += hex;
+    }
+    return file_manager->getCachedDataDir() + "bvh-" + hash + ".bin";
+}   // getBvhCacheFile
+
+// -----------------------------------------------------------------------------
+/** Loads the BVH from the cache. The serialized BVH is read into aligned
+ *  memory and initialised in place there, so no tree has to be built.
+ *  \return The BVH, or NULL if there is no valid cache file.
+ */
+btOptimizedBvh* TriangleMesh::loadBvhCache(const std::string &cache_file)
+{
+    FILE* fp = FileUtils::fopenU8Path(cache_file, "rb");
+    if (!fp)
+        return NULL;
+
+    // The size stored in the file must match the rest of the file, so a
+    // corrupted size never causes a huge allocation
+    long file_size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0)
+        file_size = ftell(fp);
+    rewind(fp);
+
+    uint8_t version = 0;
+    uint32_t size = 0;
+    btOptimizedBvh* bvh = NULL;
+    if (fread(&version, 1, 1, fp) == 1 && version == BVH_CACHE_VERSION &&
+        fread(&size, 4, 1, fp) == 1 && size > 0 &&
+        file_size == 5 + (long)size)
+    {
+        m_bvh_buffer = btAlignedAlloc(size, 16);
+        if (m_bvh_buffer != NULL && fread(m_bvh_buffer, size, 1, fp) == 1 &&
+            fgetc(fp) == EOF)
+        {
+            // This checks that the size matches the nodes in the buffer
+            bvh = btOptimizedBvh::deSerializeInPlace(m_bvh_buffer, size,
+                                                     false);
+        }
+    }
+    fclose(fp);
+
+    if (bvh == NULL || bvh->isQuantized())
+    {
+        Log::warn("TriangleMesh", "Ignoring invalid BVH cache '%s'.",
+            cache_file.c_str());
+        btAlignedFree(m_bvh_buffer);
+        m_bvh_buffer = NULL;
+        return NULL;
+    }
+    return bvh;
+}   // loadBvhCache
+
+// -----------------------------------------------------------------------------
+/** Saves the BVH in the cache. A temporary file is renamed at the end, so
+ *  another process never reads a partly written file. The temporary file
+ *  has a unique name, since the client and the server (which can run in the
+ *  same process) may save the same track at the same time.
+ */
+void TriangleMesh::saveBvhCache(const std::string &cache_file,
+                                btOptimizedBvh *bvh) const
+{
+    const uint32_t size = bvh->calculateSerializeBufferSize();
+    void* buffer = btAlignedAlloc(size, 16);
+    if (buffer == NULL || !bvh->serializeInPlace(buffer, size, false))
+    {
+        btAlignedFree(buffer);
+        return;
+    }
+
+    const std::string tmp_file = FileUtils::getUniqueTempPath(cache_file);
+    FILE* fp = FileUtils::fopenU8Path(tmp_file, "wb");
+    bool written = false;
+    if (fp)
+    {
+        written = fwrite(&BVH_CACHE_VERSION, 1, 1, fp) == 1 &&
+                  fwrite(&size, 4, 1, fp) == 1 &&
+                  fwrite(buffer, size, 1, fp) == 1;
+        written = fclose(fp) == 0 && written;
+    }
+    btAlignedFree(buffer);
+    if (!written || FileUtils::renameU8Path(tmp_file, cache_file) != 0)
+    {
+        // On windows rename fails if another writer was faster, its file
+        // has the same content then
+        if (!written || !file_manager->fileExists(cache_file))
+        {
+            Log::warn("TriangleMesh", "Can not write BVH cache '%s'.",
+                cache_file.c_str());
+        }
+        if (fp)
+            file_manager->removeFile(tmp_file);
+    }
+}   // saveBvhCache
+
 // -----------------------------------------------------------------------------
 /** Creates a collision body only, which can be used for raycasting, but
  *  has no physical properties.
- *  @param serialized_bhv if non-null, load the serialized bhv from file instead
- *                        of builing it on the fly
+ *  \param create_collision_object If a collision object should be created.
+ *  \param use_bvh_cache If the BVH should be loaded from the on-disk cache,
+ *         it is built and saved there if it's not cached yet. This is used
+ *         for the static track meshes, which are the same in each load.
  */
-void TriangleMesh::createCollisionShape(bool create_collision_object, const char* serialized_bhv)
+void TriangleMesh::createCollisionShape(bool create_collision_object,
+                                        bool use_bvh_cache)
 {
     if(m_triangleIndex2Material.size()==0)
     {
@@ -106,53 +244,25 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
     // Now convert the triangle mesh into a static rigid body
     btBvhTriangleMeshShape* bhv_triangle_mesh;
 
-    if (serialized_bhv != NULL)
+    std::string cache_file;
+    btOptimizedBvh* bvh = NULL;
+    if (use_bvh_cache)
     {
-        FILE *f = fopen(serialized_bhv, "rb");
-        fseek(f, 0, SEEK_END);
-        long pos = ftell(f);
-        assert(pos != -1L);
-        fseek(f, 0, SEEK_SET);
-
-        void* bytes = btAlignedAlloc(pos, 16);
-        fread(bytes, pos, 1, f);
-        fclose(f);
-
-        btOptimizedBvh* bhv = btOptimizedBvh::deSerializeInPlace(bytes, pos, !IS_LITTLE_ENDIAN);
-        if (bhv == NULL)
-        {
-            Log::warn("TriangleMesh", "Failed to load serialized BHV");
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-        }
-        else
-        {
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
-                                                           false /* buildBvh */);
-            bhv_triangle_mesh->setOptimizedBvh( bhv );
-        }
-        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the btOptimizedBvh object
-        // directly at this memory location
-        //free(bytes);
+        cache_file = getBvhCacheFile();
+        bvh = loadBvhCache(cache_file);
+    }
 
+    if (bvh != NULL)
+    {
+        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
+                                                       false /* buildBvh */);
+        bhv_triangle_mesh->setOptimizedBvh(bvh);
     }
     else
     {
         bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
+        if (use_bvh_cache)
+            saveBvhCache(cache_file, bhv_triangle_mesh->getOptimizedBvh());
     }
 
     m_collision_shape = bhv_triangle_mesh;
@@ -179,16 +289,16 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
  *  for height of terrain detection).
  *  \param friction Friction to be used for this TriangleMesh.
  *  \param flags Additional collision flags (default 0).
- *  \param serializedBhv if non-NULL, the bhv is deserialized instead of
- *                       being calculated on the fly
+ *  \param use_bvh_cache If the BVH should be loaded from the cache, see
+ *         createCollisionShape.
  */
 void TriangleMesh::createPhysicalBody(float friction,
                                       btCollisionObject::CollisionFlags flags,
-                                      const char* serializedBhv)
+                                      bool use_bvh_cache)
 {
     // We need the collision shape, but not the collision object (since
     // this will be created when the dynamics body is anyway).
-    createCollisionShape(/*create_collision_object*/false, serializedBhv);
+    createCollisionShape(/*create_collision_object*/false, use_bvh_cache);
     main_loop->renderGUI(5583);
 
     btTransform startTransform;
@@ -233,6 +343,13 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    // The shape doesn't own a BVH set from the cache, and it's stored in
+    // this buffer
+    if (m_bvh_buffer)
+    {
+        btAlignedFree(m_bvh_buffer);
+        m_bvh_buffer = NULL;
+    }
 }   // removeAll
 
 // -----------------------------------------------------------------------------
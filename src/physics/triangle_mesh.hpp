@@ -19,6 +19,7 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <string>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
@@ -46,6 +47,11 @@ private:
     btDefaultMotionState        *m_motion_state;
     btCollisionShape            *m_collision_shape;
 
+    /** If the BVH of m_collision_shape was loaded from the cache, the
+     *  memory it was deserialized in, which must be kept till the shape is
+     *  deleted. NULL if the shape built its own BVH. */
+    void                        *m_bvh_buffer;
+
     /** The three normals for each triangle. */
     AlignedArray<btVector3>      m_normals;
 
@@ -57,6 +63,11 @@ private:
      *  to the current transform of the body. */
     bool m_can_be_transformed;
 
+    std::string     getBvhCacheFile() const;
+    btOptimizedBvh* loadBvhCache(const std::string &cache_file);
+    void            saveBvhCache(const std::string &cache_file,
+                                 btOptimizedBvh *bvh) const;
+
 public:
     class RigidBodyTriangleMesh : public btRigidBody
     {
@@ -76,11 +87,12 @@ public:
                      const btVector3 &t3, const btVector3 &n1,
                      const btVector3 &n2, const btVector3 &n3,
                      const Material* m);
-    void createCollisionShape(bool create_collision_object=true, const char* serialized_bhv=NULL);
+    void createCollisionShape(bool create_collision_object=true,
+                              bool use_bvh_cache=false);
     void createPhysicalBody(float friction,
                             btCollisionObject::CollisionFlags flags=
                                (btCollisionObject::CollisionFlags)0,
-                            const char* serializedBhv = NULL);
+                            bool use_bvh_cache=false);
     void removeAll();
     void removeCollisionObject();
     btVector3 getInterpolatedNormal(unsigned int index,
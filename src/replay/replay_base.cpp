@@ -18,7 +18,23 @@
 #include "replay/replay_base.hpp"
 
 #include "io/file_manager.hpp"
+#include "network/network_string.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/log.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+/** The first four bytes of a binary replay file ("STKR"). Text replays
+ *  start with "version:", so both formats can be told apart. */
+static const uint32_t BINARY_REPLAY_MAGIC = 0x53544b52;
+
+/** Quantization scale for all float values except rotations, i.e.
+ *  times, distances and speeds are stored with a precision of 1/1000. */
+static const float QUANTIZE_SCALE = 1000.0f;
+
+/** Quantization scale for the quaternion components. */
+static const float ROTATION_SCALE = 32767.0f;
 
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
@@ -28,13 +44,17 @@ ReplayBase::ReplayBase()
 /** Opens a replay file which is determined by sub classes.
  *  \param writeable True if the file should be opened for writing.
  *  \param full_path True if the file is full path.
+ *  \param binary True if the file is a binary replay.
  *  \return A FILE *, or NULL if the file could not be opened.
  */
-FILE* ReplayBase::openReplayFile(bool writeable, bool full_path, int replay_file_number)
+FILE* ReplayBase::openReplayFile(bool writeable, bool full_path,
+                                 int replay_file_number, bool binary)
 {
+    const char *mode = binary ? (writeable ? "wb" : "rb")
+                              : (writeable ? "w"  : "r" );
     FILE* fd = FileUtils::fopenU8Path(full_path ? getReplayFilename(replay_file_number) :
         file_manager->getReplayDir() + getReplayFilename(replay_file_number),
-        writeable ? "w" : "r");
+        mode);
     if (!fd)
     {
         return NULL;
@@ -42,3 +62,365 @@ FILE* ReplayBase::openReplayFile(bool writeable, bool full_path, int replay_file
     return fd;
 
 }   // openReplayFile
+
+// -----------------------------------------------------------------------------
+/** Writes the fixed-size header of a binary replay file.
+ *  \param header The header data.
+ *  \param out The string to which exactly BINARY_HEADER_SIZE bytes are
+ *         appended.
+ */
+void ReplayBase::writeBinaryHeader(const BinaryHeader &header,
+                                   BareNetworkString *out)
+{
+    const unsigned int start = out->getTotalSize();
+    out->addUInt32(BINARY_REPLAY_MAGIC).addUInt32(header.m_version)
+        .addUInt8(header.m_complete ? 1 : 0)
+        .addUInt8(header.m_reverse ? 1 : 0)
+        .addUInt16((uint16_t)header.m_num_karts)
+        .addUInt8((uint8_t)header.m_difficulty)
+        .addUInt16((uint16_t)header.m_laps)
+        .addFloat(header.m_min_time)
+        .addUInt64(header.m_replay_uid)
+        .addUInt32(header.m_num_events)
+        .addUInt32(header.m_info_offset)
+        .addUInt32(header.m_info_size);
+    assert(out->getTotalSize() - start <= BINARY_HEADER_SIZE);
+    while (out->getTotalSize() - start < BINARY_HEADER_SIZE)
+        out->addUInt8(0);
+}   // writeBinaryHeader
+
+// -----------------------------------------------------------------------------
+/** Reads the fixed-size header of a binary replay file.
+ *  \param in The string containing (at least) the header.
+ *  \param header On return the header data.
+ *  \return False if the data is not a binary replay header.
+ */
+bool ReplayBase::readBinaryHeader(const BareNetworkString &in,
+                                  BinaryHeader *header)
+{
+    if (in.size() < BINARY_HEADER_SIZE || in.getUInt32() != BINARY_REPLAY_MAGIC)
+        return false;
+    header->m_version     = in.getUInt32();
+    header->m_complete    = in.getUInt8() != 0;
+    header->m_reverse     = in.getUInt8() != 0;
+    header->m_num_karts   = in.getUInt16();
+    header->m_difficulty  = in.getUInt8();
+    header->m_laps        = in.getUInt16();
+    header->m_min_time    = in.getFloat();
+    header->m_replay_uid  = in.getUInt64();
+    header->m_num_events  = in.getUInt32();
+    header->m_info_offset = in.getUInt32();
+    header->m_info_size   = in.getUInt32();
+    return true;
+}   // readBinaryHeader
+
+// -----------------------------------------------------------------------------
+static int32_t quantize(float f, float scale)
+{
+    return (int32_t)floorf(f * scale + 0.5f);
+}   // quantize
+
+// -----------------------------------------------------------------------------
+/** Converts one event into the fixed point values stored in binary replays.
+ *  The order of the values is the same as in the text format.
+ *  \param values Array of NUM_EVENT_VALUES entries.
+ */
+void ReplayBase::quantizeEvent(const TransformEvent &p, const PhysicInfo &q,
+                               const BonusInfo &b, const KartReplayEvent &r,
+                               int32_t *values)
+{
+    const btVector3 &xyz = p.m_transform.getOrigin();
+    const btQuaternion rotation = p.m_transform.getRotation();
+    values[ 0] = quantize(p.m_time,       QUANTIZE_SCALE);
+    values[ 1] = quantize(xyz.getX(),     QUANTIZE_SCALE);
+    values[ 2] = quantize(xyz.getY(),     QUANTIZE_SCALE);
+    values[ 3] = quantize(xyz.getZ(),     QUANTIZE_SCALE);
+    values[ 4] = quantize(rotation.getX(), ROTATION_SCALE);
+    values[ 5] = quantize(rotation.getY(), ROTATION_SCALE);
+    values[ 6] = quantize(rotation.getZ(), ROTATION_SCALE);
+    values[ 7] = quantize(rotation.getW(), ROTATION_SCALE);
+    values[ 8] = quantize(q.m_speed,      QUANTIZE_SCALE);
+    values[ 9] = quantize(q.m_steer,      QUANTIZE_SCALE);
+    for (unsigned int i = 0; i < 4; i++)
+        values[10 + i] = quantize(q.m_suspension_length[i], QUANTIZE_SCALE);
+    values[14] = q.m_skidding_state;
+    values[15] = b.m_attachment;
+    values[16] = quantize(b.m_nitro_amount, QUANTIZE_SCALE);
+    values[17] = b.m_item_amount;
+    values[18] = b.m_item_type;
+    values[19] = b.m_special_value;
+    values[20] = quantize(r.m_distance,   QUANTIZE_SCALE);
+    values[21] = r.m_nitro_usage;
+    values[22] = r.m_zipper_usage ? 1 : 0;
+    values[23] = r.m_skidding_effect;
+    values[24] = r.m_red_skidding ? 1 : 0;
+    values[25] = r.m_jumping ? 1 : 0;
+}   // quantizeEvent
+
+// -----------------------------------------------------------------------------
+/** Converts the fixed point values of a binary replay back into an event.
+ *  \param values Array of NUM_EVENT_VALUES entries.
+ */
+void ReplayBase::dequantizeEvent(const int32_t *values, TransformEvent *p,
+                                 PhysicInfo *q, BonusInfo *b,
+                                 KartReplayEvent *r)
+{
+    p->m_time = values[0] / QUANTIZE_SCALE;
+    btQuaternion rotation(values[4] / ROTATION_SCALE,
+                          values[5] / ROTATION_SCALE,
+                          values[6] / ROTATION_SCALE,
+                          values[7] / ROTATION_SCALE);
+    if (rotation.length2() > 0.0f)
+        rotation.normalize();
+    else
+        rotation = btQuaternion(0.0f, 0.0f, 0.0f, 1.0f);
+    p->m_transform = btTransform(rotation,
+                                 btVector3(values[1] / QUANTIZE_SCALE,
+                                           values[2] / QUANTIZE_SCALE,
+                                           values[3] / QUANTIZE_SCALE));
+    q->m_speed = values[8] / QUANTIZE_SCALE;
+    q->m_steer = values[9] / QUANTIZE_SCALE;
+    for (unsigned int i = 0; i < 4; i++)
+        q->m_suspension_length[i] = values[10 + i] / QUANTIZE_SCALE;
+    q->m_skidding_state    = values[14];
+    b->m_attachment        = values[15];
+    b->m_nitro_amount      = values[16] / QUANTIZE_SCALE;
+    b->m_item_amount       = values[17];
+    b->m_item_type         = values[18];
+    b->m_special_value     = values[19];
+    r->m_distance          = values[20] / QUANTIZE_SCALE;
+    r->m_nitro_usage       = values[21];
+    r->m_zipper_usage      = values[22] != 0;
+    r->m_skidding_effect   = values[23];
+    r->m_red_skidding      = values[24] != 0;
+    r->m_jumping           = values[25] != 0;
+}   // dequantizeEvent
+
+// -----------------------------------------------------------------------------
+/** Appends the delta between two events of the same kart. Each value is
+ *  stored as a zigzag encoded variable length integer, so the small
+ *  changes between consecutive events usually take a single byte.
+ *  \param values The quantized values of the new event.
+ *  \param previous The values of the previous event of this kart (all 0
+ *         for the first event). On return it contains the new values.
+ *  \param out The string to which the event is appended.
+ */
+void ReplayBase::encodeEvent(const int32_t *values, int32_t *previous,
+                             BareNetworkString *out)
+{
+    for (unsigned int i = 0; i < NUM_EVENT_VALUES; i++)
+    {
+        // Use unsigned arithmetic, so overflows wrap around on both sides
+        const int32_t delta = (int32_t)((uint32_t)values[i] -
+                                        (uint32_t)previous[i]);
+        uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        while (zigzag >= 0x80)
+        {
+            out->addUInt8((uint8_t)(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        out->addUInt8((uint8_t)zigzag);
+        previous[i] = values[i];
+    }
+}   // encodeEvent
+
+// -----------------------------------------------------------------------------
+/** Reads an event written by encodeEvent.
+ *  \param in The string to read from.
+ *  \param values The values of the previous event of this kart, on return
+ *         the values of the decoded event.
+ *  \throw std::out_of_range if the data is truncated or invalid.
+ */
+void ReplayBase::decodeEvent(const BareNetworkString &in, int32_t *values)
+{
+    for (unsigned int i = 0; i < NUM_EVENT_VALUES; i++)
+    {
+        uint32_t zigzag = 0;
+        unsigned int shift = 0;
+        while (true)
+        {
+            if (shift > 28)
+                throw std::out_of_range("Invalid replay event.");
+            const uint8_t byte = in.getUInt8();
+            zigzag |= (uint32_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                break;
+            shift += 7;
+        }
+        const uint32_t delta = (zigzag >> 1) ^ (0u - (zigzag & 1));
+        values[i] = (int32_t)((uint32_t)values[i] + delta);
+    }
+}   // decodeEvent
+
+// -----------------------------------------------------------------------------
+/** Tests the binary replay header and the event encoding.
+ */
+void ReplayBase::unitTesting()
+{
+    int error_count = 0;
+
+    BinaryHeader header;
+    header.m_version     = 5;
+    header.m_complete    = true;
+    header.m_num_karts   = 3;
+    header.m_reverse     = true;
+    header.m_difficulty  = 2;
+    header.m_laps        = 4;
+    header.m_min_time    = 83.25f;
+    header.m_replay_uid  = 0x0123456789abcdefULL;
+    header.m_num_events  = 12345;
+    header.m_info_offset = 678901;
+    header.m_info_size   = 234;
+
+    BareNetworkString header_data;
+    writeBinaryHeader(header, &header_data);
+    BinaryHeader read_header;
+    if (header_data.getTotalSize() != BINARY_HEADER_SIZE ||
+        !readBinaryHeader(header_data, &read_header))
+    {
+        Log::error("ReplayBase", "Binary header could not be read back.");
+        error_count++;
+    }
+    else if (read_header.m_version     != header.m_version     ||
+             read_header.m_complete    != header.m_complete    ||
+             read_header.m_num_karts   != header.m_num_karts   ||
+             read_header.m_reverse     != header.m_reverse     ||
+             read_header.m_difficulty  != header.m_difficulty  ||
+             read_header.m_laps        != header.m_laps        ||
+             read_header.m_min_time    != header.m_min_time    ||
+             read_header.m_replay_uid  != header.m_replay_uid  ||
+             read_header.m_num_events  != header.m_num_events  ||
+             read_header.m_info_offset != header.m_info_offset ||
+             read_header.m_info_size   != header.m_info_size      )
+    {
+        Log::error("ReplayBase", "Binary header values differ.");
+        error_count++;
+    }
+
+    // A text replay must not be mistaken for a binary one
+    std::string text = "version: 4\nstk_version: git\n";
+    while (text.size() < BINARY_HEADER_SIZE)
+        text += "kart: tux\n";
+    BareNetworkString text_data(text.c_str(), (int)text.size());
+    if (readBinaryHeader(text_data, &read_header))
+    {
+        Log::error("ReplayBase", "Text replay detected as binary.");
+        error_count++;
+    }
+
+    // Round trip a few events of one kart
+    const unsigned int num_events = 3;
+    TransformEvent p[num_events];
+    PhysicInfo q[num_events];
+    BonusInfo b[num_events];
+    KartReplayEvent r[num_events];
+    for (unsigned int i = 0; i < num_events; i++)
+    {
+        btQuaternion rotation(btVector3(0.3f, 1.0f, -0.2f).normalized(),
+                              0.7f * i - 1.0f);
+        p[i].m_time = 1.5f + 0.45f * i;
+        p[i].m_transform = btTransform(rotation,
+                           btVector3(-120.5f + 3.1f * i, 2.25f, 870.125f));
+        q[i].m_speed = 21.37f - i;
+        q[i].m_steer = -0.83f + 0.4f * i;
+        for (unsigned int j = 0; j < 4; j++)
+            q[i].m_suspension_length[j] = 0.1f + 0.01f * j;
+        q[i].m_skidding_state = i;
+        b[i].m_attachment     = 2;
+        b[i].m_nitro_amount   = 17.5f - 2.0f * i;
+        b[i].m_item_amount    = 3 - i;
+        b[i].m_item_type      = 8;
+        b[i].m_special_value  = -1;
+        r[i].m_distance        = 1234.5f + 12.5f * i;
+        r[i].m_nitro_usage     = i;
+        r[i].m_zipper_usage    = i == 1;
+        r[i].m_skidding_effect = 2;
+        r[i].m_red_skidding    = i == 2;
+        r[i].m_jumping         = false;
+    }
+
+    BareNetworkString events;
+    int32_t previous[NUM_EVENT_VALUES] = { 0 };
+    for (unsigned int i = 0; i < num_events; i++)
+    {
+        int32_t values[NUM_EVENT_VALUES];
+        quantizeEvent(p[i], q[i], b[i], r[i], values);
+        encodeEvent(values, previous, &events);
+    }
+    // Extreme values must survive the delta coding too
+    int32_t extreme[NUM_EVENT_VALUES];
+    for (unsigned int i = 0; i < NUM_EVENT_VALUES; i++)
+        extreme[i] = (i % 2) ? INT32_MIN : INT32_MAX;
+    encodeEvent(extreme, previous, &events);
+
+    int32_t decoded[NUM_EVENT_VALUES] = { 0 };
+    for (unsigned int i = 0; i < num_events; i++)
+    {
+        decodeEvent(events, decoded);
+        TransformEvent p2;
+        PhysicInfo q2;
+        BonusInfo b2;
+        KartReplayEvent r2;
+        dequantizeEvent(decoded, &p2, &q2, &b2, &r2);
+        const float e = 0.001f;
+        bool same = fabsf(p2.m_time - p[i].m_time) < e &&
+            (p2.m_transform.getOrigin() - p[i].m_transform.getOrigin())
+                                                            .length() < e &&
+            fabsf(p2.m_transform.getRotation()
+                  .dot(p[i].m_transform.getRotation())) > 1.0f - e &&
+            fabsf(q2.m_speed - q[i].m_speed) < e &&
+            fabsf(q2.m_steer - q[i].m_steer) < e &&
+            fabsf(q2.m_suspension_length[3] -
+                  q[i].m_suspension_length[3]) < e &&
+            q2.m_skidding_state == q[i].m_skidding_state &&
+            b2.m_attachment == b[i].m_attachment &&
+            fabsf(b2.m_nitro_amount - b[i].m_nitro_amount) < e &&
+            b2.m_item_amount == b[i].m_item_amount &&
+            b2.m_item_type == b[i].m_item_type &&
+            b2.m_special_value == b[i].m_special_value &&
+            fabsf(r2.m_distance - r[i].m_distance) < e &&
+            r2.m_nitro_usage == r[i].m_nitro_usage &&
+            r2.m_zipper_usage == r[i].m_zipper_usage &&
+            r2.m_skidding_effect == r[i].m_skidding_effect &&
+            r2.m_red_skidding == r[i].m_red_skidding &&
+            r2.m_jumping == r[i].m_jumping;
+        if (!same)
+        {
+            Log::error("ReplayBase", "Event %d differs after decoding.", i);
+            error_count++;
+        }
+    }
+    decodeEvent(events, decoded);
+    for (unsigned int i = 0; i < NUM_EVENT_VALUES; i++)
+    {
+        if (decoded[i] != extreme[i])
+        {
+            Log::error("ReplayBase", "Extreme value %d differs.", i);
+            error_count++;
+        }
+    }
+    if (events.size() != 0)
+    {
+        Log::error("ReplayBase", "Event data not fully consumed.");
+        error_count++;
+    }
+
+    // Truncated data must be detected
+    BareNetworkString truncated(events.getData(), 10);
+    bool thrown = false;
+    try
+    {
+        decodeEvent(truncated, decoded);
+    }
+    catch (std::out_of_range&)
+    {
+        thrown = true;
+    }
+    if (!thrown)
+    {
+        Log::error("ReplayBase", "Truncated event was not detected.");
+        error_count++;
+    }
+
+    assert(error_count == 0);
+}   // unitTesting
@@ -22,10 +22,13 @@
 #include "LinearMath/btTransform.h"
 #include "utils/no_copy.hpp"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string>
 #include <vector>
 
+class BareNetworkString;
+
 /**
   * \ingroup race
   */
@@ -98,14 +101,73 @@ protected:
     };   // KartReplayEvent
 
     // ------------------------------------------------------------------------
-    FILE *openReplayFile(bool writeable, bool full_path = false, int replay_file_number=1);
+    /** The fixed-size header at the start of a binary replay file. It
+     *  contains everything needed to sort and list a replay, and the
+     *  position of the info block (stk version, mode, track and karts)
+     *  which is written after the last event once the race is finished. */
+    struct BinaryHeader
+    {
+        /** Version of the replay file. */
+        unsigned int        m_version;
+        /** False while the replay is still being recorded. */
+        bool                m_complete;
+        /** Number of recorded karts. */
+        unsigned int        m_num_karts;
+        /** If the track was driven in reverse. */
+        bool                m_reverse;
+        /** The race difficulty. */
+        unsigned int        m_difficulty;
+        /** Number of laps, 0 in modes without laps. */
+        unsigned int        m_laps;
+        /** The finishing time of the fastest recorded kart. */
+        float               m_min_time;
+        /** The unique identifier of this replay. */
+        uint64_t            m_replay_uid;
+        /** Number of events of all karts. */
+        unsigned int        m_num_events;
+        /** Offset of the info block in the file. */
+        uint32_t            m_info_offset;
+        /** Size of the info block in bytes. */
+        uint32_t            m_info_size;
+    };   // BinaryHeader
+
+    /** Size of the binary header on disk. Unused bytes are reserved
+     *  for later versions. */
+    static const unsigned int BINARY_HEADER_SIZE = 64;
+
+    /** Number of quantized values stored for each event in a binary
+     *  replay. */
+    static const unsigned int NUM_EVENT_VALUES = 26;
+
+    // ------------------------------------------------------------------------
+    static void writeBinaryHeader(const BinaryHeader &header,
+                                  BareNetworkString *out);
+    static bool readBinaryHeader(const BareNetworkString &in,
+                                 BinaryHeader *header);
+    static void quantizeEvent(const TransformEvent &p, const PhysicInfo &q,
+                              const BonusInfo &b, const KartReplayEvent &r,
+                              int32_t *values);
+    static void dequantizeEvent(const int32_t *values, TransformEvent *p,
+                                PhysicInfo *q, BonusInfo *b,
+                                KartReplayEvent *r);
+    static void encodeEvent(const int32_t *values, int32_t *previous,
+                            BareNetworkString *out);
+    static void decodeEvent(const BareNetworkString &in, int32_t *values);
+    // ------------------------------------------------------------------------
+    FILE *openReplayFile(bool writeable, bool full_path = false,
+                         int replay_file_number = 1, bool binary = false);
     // ------------------------------------------------------------------------
     /** Returns the filename that was opened. */
     virtual const std::string& getReplayFilename(int replay_file_number = 1) const = 0;
     // ------------------------------------------------------------------------
     /** Returns the version number of the replay file recorderd by this executable.
      *  This is also used as a maximum supported version by this exexcutable. */
-    unsigned int getCurrentReplayVersion() const { return 4; }
+    unsigned int getCurrentReplayVersion() const { return 5; }
+
+    // ------------------------------------------------------------------------
+    /** Replays starting from this version are stored in the binary format,
+     *  older ones are text files. */
+    unsigned int getFirstBinaryReplayVersion() const { return 5; }
 
     // ------------------------------------------------------------------------
     /** This is used to check that a loaded replay file can still
@@ -115,6 +177,7 @@ protected:
 public:
              ReplayBase();
     virtual ~ReplayBase() {};
+    static void unitTesting();
 };   // ReplayBase
 
 #endif
@@ -23,6 +23,7 @@
 #include "karts/ghost_kart.hpp"
 #include "karts/controller/ghost_controller.hpp"
 #include "modes/world.hpp"
+#include "network/network_string.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
@@ -31,6 +32,7 @@
 #include "utils/string_utils.hpp"
 
 #include <stdio.h>
+#include <stdexcept>
 #include <string>
 #include <cinttypes>
 
@@ -109,17 +111,41 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     char s[1024], s1[1024];
     if (StringUtils::getExtension(fn) != "replay") return false;
-    FILE* fd = FileUtils::fopenU8Path(custom_replay ? fn :
-        file_manager->getReplayDir() + fn, "r");
+    const std::string path = custom_replay ? fn
+                                           : file_manager->getReplayDir() + fn;
+    FILE* fd = FileUtils::fopenU8Path(path, "rb");
     if (fd == NULL) return false;
-    auto scoped = [&]() { fclose(fd); };
-    MemUtils::deref<decltype(scoped)> cls(scoped); 
     ReplayData rd;
 
     // custom_replay is true when full path of filename is given
     rd.m_custom_replay_file = custom_replay;
     rd.m_filename = fn;
 
+    // Binary replays can be listed from their fixed-size header and the
+    // info block, without reading any events.
+    char header_data[BINARY_HEADER_SIZE];
+    BinaryHeader header;
+    if (fread(header_data, 1, BINARY_HEADER_SIZE, fd) == BINARY_HEADER_SIZE &&
+        readBinaryHeader(BareNetworkString(header_data, BINARY_HEADER_SIZE),
+                         &header))
+    {
+        const bool ok = readBinaryInfo(fd, header, &rd) &&
+                        findReplayTrack(&rd);
+        fclose(fd);
+        if (!ok) return false;
+        m_replay_file_list.push_back(rd);
+        if (custom_replay)
+            m_current_replay_file = (unsigned int)m_replay_file_list.size() - 1;
+        return true;
+    }
+
+    // Otherwise it is a text replay, which is read in text mode.
+    fclose(fd);
+    fd = FileUtils::fopenU8Path(path, "r");
+    if (fd == NULL) return false;
+    auto scoped = [&]() { fclose(fd); };
+    MemUtils::deref<decltype(scoped)> cls(scoped); 
+
     fgets(s, 1023, fd);
     unsigned int version;
     if (sscanf(s,"version: %u", &version) != 1)
@@ -134,10 +160,10 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
                   version, getMinSupportedReplayVersion(), fn.c_str());
         return false;
     }
-    else if (version > getCurrentReplayVersion())
+    else if (version >= getFirstBinaryReplayVersion())
     {
-        Log::warn("Replay", "Replay is version '%d', STK replay version is '%d', skipped '%s'",
-                  version, getCurrentReplayVersion(), fn.c_str());
+        Log::warn("Replay", "Text replay can't be version '%d', skipped '%s'",
+                  version, fn.c_str());
         return false;
     }
 
@@ -267,21 +293,8 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
         return false;
     }
 
-    // If former official tracks are present as addons, show the matching replays.
-    if (rd.m_track_name.compare("greenvalley") == 0)
-        rd.m_track_name = std::string("addon_green-valley");
-    if (rd.m_track_name.compare("mansion") == 0)
-        rd.m_track_name = std::string("addon_blackhill-mansion");
-
-    Track* t = track_manager->getTrack(rd.m_track_name);
-    if (t == NULL)
-    {
-        Log::warn("Replay", "Track '%s' used in replay '%s' not found in STK!",
-        rd.m_track_name.c_str(), fn.c_str());
+    if (!findReplayTrack(&rd))
         return false;
-    }
-
-    rd.m_track = t;
 
     fgets(s, 1023, fd);
     if (sscanf(s, "info: %1023s", s1) == 1)
@@ -330,6 +343,111 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
 }   // addReplayFile
 
+//-----------------------------------------------------------------------------
+/** Sets the track of a replay from its track name.
+ *  \return False if the track is not available.
+ */
+bool ReplayPlay::findReplayTrack(ReplayData *rd)
+{
+    // If former official tracks are present as addons, show the matching replays.
+    if (rd->m_track_name.compare("greenvalley") == 0)
+        rd->m_track_name = std::string("addon_green-valley");
+    if (rd->m_track_name.compare("mansion") == 0)
+        rd->m_track_name = std::string("addon_blackhill-mansion");
+
+    Track* t = track_manager->getTrack(rd->m_track_name);
+    if (t == NULL)
+    {
+        Log::warn("Replay", "Track '%s' used in replay '%s' not found in STK!",
+        rd->m_track_name.c_str(), rd->m_filename.c_str());
+        return false;
+    }
+
+    rd->m_track = t;
+    return true;
+}   // findReplayTrack
+
+//-----------------------------------------------------------------------------
+/** Reads the replay data of a binary replay file from its header and the
+ *  info block at the end of the file.
+ *  \param fd The replay file.
+ *  \param header The already read header of the file.
+ *  \param rd The replay data to fill in.
+ *  \return False if the file is not a valid replay.
+ */
+bool ReplayPlay::readBinaryInfo(FILE *fd, const BinaryHeader &header,
+                                ReplayData *rd)
+{
+    const std::string &fn = rd->m_filename;
+    if (header.m_version < getFirstBinaryReplayVersion() ||
+        header.m_version > getCurrentReplayVersion())
+    {
+        Log::warn("Replay", "Replay is version '%d', STK replay version is '%d', skipped '%s'",
+                  header.m_version, getCurrentReplayVersion(), fn.c_str());
+        return false;
+    }
+    if (!header.m_complete)
+    {
+        Log::warn("Replay", "Replay file '%s' is incomplete.", fn.c_str());
+        return false;
+    }
+    // The info block only contains a few short strings per kart
+    if (header.m_info_size == 0 || header.m_info_size > 65536 ||
+        header.m_info_offset < BINARY_HEADER_SIZE)
+    {
+        Log::warn("Replay", "Invalid header in replay file '%s'.", fn.c_str());
+        return false;
+    }
+
+    std::vector<char> info(header.m_info_size);
+    if (fseek(fd, header.m_info_offset, SEEK_SET) != 0 ||
+        fread(info.data(), 1, info.size(), fd) != info.size())
+    {
+        Log::warn("Replay", "Replay file '%s' is truncated.", fn.c_str());
+        return false;
+    }
+
+    BareNetworkString data(info.data(), (int)info.size());
+    try
+    {
+        data.decodeStringW(&rd->m_stk_version);
+        data.decodeString(&rd->m_minor_mode);
+        data.decodeString(&rd->m_track_name);
+        for (unsigned int i = 0; i < header.m_num_karts; i++)
+        {
+            std::string ident;
+            core::stringw name;
+            data.decodeString(&ident);
+            data.decodeStringW(&name);
+            rd->m_kart_list.push_back(ident);
+            rd->m_name_list.push_back(name);
+            rd->m_kart_color.push_back(data.getFloat());
+        }
+    }
+    catch (std::out_of_range&)
+    {
+        Log::warn("Replay", "Invalid info block in replay file '%s'.",
+                  fn.c_str());
+        return false;
+    }
+    if (rd->m_track_name.empty() || rd->m_kart_list.empty())
+    {
+        Log::warn("Replay", "No track or karts in replay file '%s'.",
+                  fn.c_str());
+        return false;
+    }
+
+    // First user is the game master and the "owner" of this replay file
+    rd->m_user_name      = rd->m_name_list[0];
+    rd->m_replay_version = header.m_version;
+    rd->m_reverse        = header.m_reverse;
+    rd->m_difficulty     = header.m_difficulty;
+    rd->m_laps           = header.m_laps;
+    rd->m_min_time       = header.m_min_time;
+    rd->m_replay_uid     = header.m_replay_uid;
+    return true;
+}   // readBinaryInfo
+
 //-----------------------------------------------------------------------------
 void ReplayPlay::load()
 {
@@ -350,9 +468,12 @@ void ReplayPlay::loadFile(bool second_replay)
 
     int replay_index = second_replay ? m_second_replay_file : m_current_replay_file;
     int replay_file_number = second_replay ? 2 : 1;
+    const bool binary = m_replay_file_list.at(replay_index).m_replay_version
+                     >= getFirstBinaryReplayVersion();
 
     FILE *fd = openReplayFile(/*writeable*/false,
-            m_replay_file_list.at(replay_index).m_custom_replay_file, replay_file_number);
+            m_replay_file_list.at(replay_index).m_custom_replay_file,
+            replay_file_number, binary);
 
     if(!fd)
     {
@@ -365,6 +486,13 @@ void ReplayPlay::loadFile(bool second_replay)
     Log::info("Replay", "Reading replay file '%s'.",
                     getReplayFilename(replay_file_number).c_str());
 
+    if (binary)
+    {
+        readBinaryEvents(fd, second_replay);
+        fclose(fd);
+        return;
+    }
+
     ReplayData &rd = m_replay_file_list[replay_index];
     unsigned int num_kart = (unsigned int)m_replay_file_list.at(replay_index)
                                                             .m_kart_list.size();
@@ -387,13 +515,76 @@ void ReplayPlay::loadFile(bool second_replay)
 }   // loadFile
 
 //-----------------------------------------------------------------------------
-/** Reads all data from a replay file for a specific kart.
+/** Reads all events of a binary replay file and adds them to newly created
+ *  ghost karts. Each event starts with the index of its kart and is delta
+ *  coded against the previous event of the same kart.
  *  \param fd The file descriptor from which to read.
  */
-void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
+void ReplayPlay::readBinaryEvents(FILE *fd, bool second_replay)
 {
-    char s[1024];
+    int replay_index = second_replay ? m_second_replay_file
+                                     : m_current_replay_file;
+    const ReplayData &rd = m_replay_file_list[replay_index];
+
+    char header_data[BINARY_HEADER_SIZE];
+    BinaryHeader header;
+    if (fread(header_data, 1, BINARY_HEADER_SIZE, fd) != BINARY_HEADER_SIZE ||
+        !readBinaryHeader(BareNetworkString(header_data, BINARY_HEADER_SIZE),
+                          &header) ||
+        header.m_info_offset < BINARY_HEADER_SIZE)
+    {
+        Log::error("Replay", "Invalid header in replay file '%s'.",
+                   rd.m_filename.c_str());
+        return;
+    }
+
+    const unsigned int num_karts = (unsigned int)rd.m_kart_list.size();
+    const unsigned int first_kart = (unsigned int)m_ghost_karts.size();
+    for (unsigned int i = 0; i < num_karts; i++)
+        addGhostKart(second_replay);
 
+    std::vector<char> events(header.m_info_offset - BINARY_HEADER_SIZE);
+    if (fread(events.data(), 1, events.size(), fd) != events.size())
+    {
+        Log::warn("Replay", "Replay file '%s' is truncated.",
+                  rd.m_filename.c_str());
+        return;
+    }
+
+    BareNetworkString data(events.data(), (int)events.size());
+    std::vector<int32_t> values(num_karts * NUM_EVENT_VALUES, 0);
+    try
+    {
+        for (unsigned int i = 0; i < header.m_num_events; i++)
+        {
+            const unsigned int kart = data.getUInt8();
+            if (kart >= num_karts)
+                throw std::out_of_range("Invalid kart index.");
+            int32_t *kart_values = &(values[kart * NUM_EVENT_VALUES]);
+            decodeEvent(data, kart_values);
+
+            TransformEvent p;
+            PhysicInfo q;
+            BonusInfo b;
+            KartReplayEvent r;
+            dequantizeEvent(kart_values, &p, &q, &b, &r);
+            m_ghost_karts[first_kart + kart]->addReplayEvent(p.m_time,
+                p.m_transform, q, b, r);
+        }
+    }
+    catch (std::out_of_range&)
+    {
+        Log::warn("Replay", "Invalid event data in replay file '%s', "
+                  "remaining events ignored.", rd.m_filename.c_str());
+    }
+}   // readBinaryEvents
+
+//-----------------------------------------------------------------------------
+/** Creates the ghost kart for the next kart of a replay file.
+ *  \return The index of the new ghost kart.
+ */
+unsigned int ReplayPlay::addGhostKart(bool second_replay)
+{
     int replay_index = second_replay ? m_second_replay_file
                                      : m_current_replay_file;
 
@@ -412,6 +603,21 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
     Controller* controller = new GhostController(getGhostKart(kart_num).get(),
                                                  rd.m_name_list[kart_num-first_loaded_f_num]);
     getGhostKart(kart_num)->setController(controller);
+    return kart_num;
+}   // addGhostKart
+
+//-----------------------------------------------------------------------------
+/** Reads all data from a replay file for a specific kart.
+ *  \param fd The file descriptor from which to read.
+ */
+void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
+{
+    char s[1024];
+
+    int replay_index = second_replay ? m_second_replay_file
+                                     : m_current_replay_file;
+    const ReplayData &rd = m_replay_file_list[replay_index];
+    const unsigned int kart_num = addGhostKart(second_replay);
 
     unsigned int size;
     if(sscanf(next_line,"size: %u",&size)!=1)
@@ -126,6 +126,11 @@ private:
           ReplayPlay();
          ~ReplayPlay();
     void  readKartData(FILE *fd, char *next_line, bool second_replay);
+    void  readBinaryEvents(FILE *fd, bool second_replay);
+    bool  readBinaryInfo(FILE *fd, const BinaryHeader &header,
+                         ReplayData *rd);
+    bool  findReplayTrack(ReplayData *rd);
+    unsigned int addGhostKart(bool second_replay);
 public:
     void  reset();
     void  load();
@@ -31,16 +31,22 @@
 #include "modes/easter_egg_hunt.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/world.hpp"
+#include "network/network_string.hpp"
 #include "physics/btKart.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
 #include <algorithm>
 #include <stdio.h>
 #include <string>
-#include <cinttypes>
+#ifdef WIN32
+#  include <process.h>
+#else
+#  include <unistd.h>
+#endif
 
 ReplayRecorder *ReplayRecorder::m_replay_recorder = NULL;
 
@@ -52,6 +58,8 @@ ReplayRecorder::ReplayRecorder()
     m_complete_replay = false;
     m_incorrect_replay = false;
     m_previous_steer   = 0.0f;
+    m_fd               = NULL;
+    m_num_events       = 0;
 
     assert(stk_config->m_replay_max_frames >= 0);
     m_max_frames = stk_config->m_replay_max_frames;
@@ -61,6 +69,7 @@ ReplayRecorder::ReplayRecorder()
 /** Frees all stored data. */
 ReplayRecorder::~ReplayRecorder()
 {
+    discardFile();
 }   // ~Replay
 
 //-----------------------------------------------------------------------------
@@ -69,10 +78,12 @@ void ReplayRecorder::reset()
 {
     m_complete_replay = false;
     m_incorrect_replay = false;
-    m_transform_events.clear();
-    m_physic_info.clear();
-    m_bonus_info.clear();
-    m_kart_replay_event.clear();
+    discardFile();
+    m_num_events = 0;
+    m_last_physic_info.clear();
+    m_last_bonus_info.clear();
+    m_previous_bonus_info.clear();
+    m_last_values.clear();
     m_count_transforms.clear();
     m_last_saved_time.clear();
 
@@ -84,41 +95,77 @@ void ReplayRecorder::reset()
 }   // clear
 
 //-----------------------------------------------------------------------------
-/** Initialise the replay recorder. It especially allocates memory
- *  to store the replay data.
+/** Initialise the replay recorder. It opens the file to which the events
+ *  are written during the race. The file starts with a placeholder header,
+ *  which is completed in save().
  */
 void ReplayRecorder::init()
 {
     reset();
-    m_transform_events.resize(RaceManager::get()->getNumberOfKarts());
-    m_physic_info.resize(RaceManager::get()->getNumberOfKarts());
-    m_bonus_info.resize(RaceManager::get()->getNumberOfKarts());
-    m_kart_replay_event.resize(RaceManager::get()->getNumberOfKarts());
-
-    for(unsigned int i=0; i<RaceManager::get()->getNumberOfKarts(); i++)
+    const unsigned int num_karts = RaceManager::get()->getNumberOfKarts();
+    m_last_physic_info.resize(num_karts);
+    m_last_bonus_info.resize(num_karts);
+    m_previous_bonus_info.resize(num_karts);
+    m_last_values.resize(num_karts * NUM_EVENT_VALUES, 0);
+    m_count_transforms.resize(num_karts, 0);
+    m_last_saved_time.resize(num_karts, -1.0f);
+
+    // The final name is only known when the race is over, the process id
+    // keeps several instances sharing a replay directory apart
+#ifdef WIN32
+    const int pid = _getpid();
+#else
+    const int pid = getpid();
+#endif
+    m_filename = StringUtils::insertValues("recording_%d.replay.part", pid);
+    m_fd = openReplayFile(/*writeable*/true, /*full_path*/false,
+                          /*replay_file_number*/1, /*binary*/true);
+    if (!m_fd)
     {
-        m_transform_events[i].resize(m_max_frames);
-        m_physic_info[i].resize(m_max_frames);
-        m_bonus_info[i].resize(m_max_frames);
-        m_kart_replay_event[i].resize(m_max_frames);
+        Log::error("ReplayRecorder", "Can't open '%s' for writing - "
+            "can't record replay data.", getReplayFilename().c_str());
+        m_incorrect_replay = true;
+        return;
     }
 
-    m_count_transforms.resize(RaceManager::get()->getNumberOfKarts(), 0);
-    m_last_saved_time.resize(RaceManager::get()->getNumberOfKarts(), -1.0f);
-
+    BinaryHeader header = BinaryHeader();
+    header.m_version = getCurrentReplayVersion();
+    BareNetworkString header_data(BINARY_HEADER_SIZE);
+    writeBinaryHeader(header, &header_data);
+    if (fwrite(header_data.getData(), 1, header_data.getTotalSize(), m_fd)
+        != header_data.getTotalSize())
+    {
+        Log::error("ReplayRecorder", "Can't write to '%s'.",
+                   getReplayFilename().c_str());
+        m_incorrect_replay = true;
+    }
 }   // init
 
+//-----------------------------------------------------------------------------
+/** Closes and deletes the file of a replay which is not going to be saved.
+ */
+void ReplayRecorder::discardFile()
+{
+    if (!m_fd) return;
+    fclose(m_fd);
+    m_fd = NULL;
+    file_manager->removeFile(file_manager->getReplayDir() + m_filename);
+}   // discardFile
+
 //-----------------------------------------------------------------------------
 /** Saves the current replay data.
  *  \param ticks Number of physics time steps - should be 1.
  */
 void ReplayRecorder::update(int ticks)
 {
-    if (m_incorrect_replay || m_complete_replay) return;
+    if (m_incorrect_replay || m_complete_replay || !m_fd) return;
 
     World *world = World::getWorld();
     const bool single_player = RaceManager::get()->getNumPlayers() == 1;
     unsigned int num_karts = world->getNumKarts();
+    // Index of a kart in the replay, which does not contain ghost karts
+    unsigned int replay_kart = 0;
+    BareNetworkString event_data(64);
 
     float time = world->getTime();
     for(unsigned int i=0; i<num_karts; i++)
@@ -128,6 +175,7 @@ void ReplayRecorder::update(int ticks)
         if (kart->isEliminated() && single_player) return;
 
         if (kart->isGhostKart()) continue;
+        replay_kart++;
 #ifdef DEBUG
         m_count++;
 #endif
@@ -162,9 +210,9 @@ void ReplayRecorder::update(int ticks)
 
         if (m_count_transforms[i] >= 2)
         {
-            BonusInfo *b_prev       = &(m_bonus_info[i][m_count_transforms[i]-1]);
-            BonusInfo *b_prev2      = &(m_bonus_info[i][m_count_transforms[i]-2]);
-            PhysicInfo *q_prev      = &(m_physic_info[i][m_count_transforms[i]-1]);
+            BonusInfo *b_prev       = &(m_last_bonus_info[i]);
+            BonusInfo *b_prev2      = &(m_previous_bonus_info[i]);
+            PhysicInfo *q_prev      = &(m_last_physic_info[i]);
 
             // If the kart changes its steering
             if (fabsf(kart->getControls().getSteer() - m_previous_steer) >
@@ -249,10 +297,10 @@ void ReplayRecorder::update(int ticks)
         m_previous_steer = kart->getControls().getSteer();
         m_last_saved_time[i] = time;
         m_count_transforms[i]++;
-        if (m_count_transforms[i] >= m_transform_events[i].size())
+        if (m_count_transforms[i] >= m_max_frames)
         {
             // Only print this message once.
-            if (m_count_transforms[i] == m_transform_events[i].size())
+            if (m_count_transforms[i] == m_max_frames)
             {
                 Log::warn("ReplayRecorder", "Can't store more events for kart %s.",
                     kart->getIdent().c_str());
@@ -260,10 +308,13 @@ void ReplayRecorder::update(int ticks)
             }
             continue;
         }
-        TransformEvent *p      = &(m_transform_events[i][m_count_transforms[i]-1]);
-        PhysicInfo *q          = &(m_physic_info[i][m_count_transforms[i]-1]);
-        BonusInfo *b           = &(m_bonus_info[i][m_count_transforms[i]-1]);
-        KartReplayEvent *r     = &(m_kart_replay_event[i][m_count_transforms[i]-1]);
+        m_previous_bonus_info[i] = m_last_bonus_info[i];
+        TransformEvent transform_event;
+        KartReplayEvent kart_replay_event;
+        TransformEvent *p      = &transform_event;
+        PhysicInfo *q          = &(m_last_physic_info[i]);
+        BonusInfo *b           = &(m_last_bonus_info[i]);
+        KartReplayEvent *r     = &kart_replay_event;
 
         p->m_time              = World::getWorld()->getTime();
         p->m_transform.setOrigin(kart->getXYZ());
@@ -302,6 +353,24 @@ void ReplayRecorder::update(int ticks)
         kart->getKartGFX()->getGFXStatus(&(r->m_nitro_usage),
             &(r->m_zipper_usage), &(r->m_skidding_effect), &(r->m_red_skidding));
         r->m_jumping = kart->isJumping();
+
+        // Write the event directly, so nothing but the last event of
+        // each kart needs to be kept in memory.
+        int32_t values[NUM_EVENT_VALUES];
+        quantizeEvent(*p, *q, *b, *r, values);
+        event_data.getBuffer().clear();
+        event_data.addUInt8((uint8_t)(replay_kart - 1));
+        encodeEvent(values, &(m_last_values[i * NUM_EVENT_VALUES]),
+                    &event_data);
+        if (fwrite(event_data.getData(), 1, event_data.getTotalSize(), m_fd)
+            != event_data.getTotalSize())
+        {
+            Log::error("ReplayRecorder", "Can't write to '%s'.",
+                       getReplayFilename().c_str());
+            m_incorrect_replay = true;
+            return;
+        }
+        m_num_events++;
     }   // for i
 
     if (world->getPhase() == World::RESULT_DISPLAY_PHASE && !m_complete_replay)
@@ -348,7 +417,8 @@ uint64_t ReplayRecorder::computeUID(float min_time)
 }
 
 //-----------------------------------------------------------------------------
-/** Saves the replay data stored in the internal data structures.
+/** Completes the replay file: writes the info block after the events,
+ *  fills in the header and renames the file to its final name.
  */
 void ReplayRecorder::save()
 {
@@ -358,6 +428,11 @@ void ReplayRecorder::save()
             _("Incomplete replay file will not be saved."));
         return;
     }
+    if (!m_fd)
+    {
+        Log::warn("ReplayRecorder", "Replay was already saved.");
+        return;
+    }
 
 #ifdef DEBUG
     Log::debug("ReplayRecorder", "%d frames, %d removed because of"
@@ -374,6 +449,7 @@ void ReplayRecorder::save()
             min_time = cur_time;
     }
 
+    const std::string part_path = file_manager->getReplayDir() + m_filename;
     int day, month, year;
     StkTime::getDate(&day, &month, &year);
     std::string time = StringUtils::toString(min_time);
@@ -383,38 +459,29 @@ void ReplayRecorder::save()
         << "_" << num_karts << "_" << time << ".replay";
     m_filename = oss.str();
 
-    FILE *fd = openReplayFile(/*writeable*/true);
-    if (!fd)
-    {
-        Log::error("ReplayRecorder", "Can't open '%s' for writing - "
-            "can't save replay data.", getReplayFilename().c_str());
-        return;
-    }
-
-    core::stringw msg = _("Replay saved in \"%s\".",
-        StringUtils::utf8ToWide(file_manager->getReplayDir() + getReplayFilename()));
-    MessageQueue::add(MessageQueue::MT_GENERIC, msg);
-
-    fprintf(fd, "version: %d\n", getCurrentReplayVersion());
-    fprintf(fd, "stk_version: %s\n", STK_VERSION);
+    BareNetworkString info(256);
+    info.encodeString(std::string(STK_VERSION))
+        .encodeString(RaceManager::get()->getMinorModeName())
+        .encodeString(Track::getCurrentTrack()->getIdent());
 
     unsigned int player_count = 0;
+    unsigned int replay_karts = 0;
     for (unsigned int real_karts = 0; real_karts < num_karts; real_karts++)
     {
         const AbstractKart *kart = world->getKart(real_karts);
         if (kart->isGhostKart()) continue;
 
-        // XML encode the username to handle Unicode
-        fprintf(fd, "kart: %s %s\n", kart->getIdent().c_str(),
-                StringUtils::xmlEncode(kart->getController()->getName()).c_str());
-
+        replay_karts++;
+        info.encodeString(kart->getIdent())
+            .encodeString(kart->getController()->getName());
         if (kart->getController()->isPlayerController())
         {
-            fprintf(fd, "kart_color: %f\n", StateManager::get()->getActivePlayer(player_count)->getConstProfile()->getDefaultKartColor());
+            info.addFloat(StateManager::get()->getActivePlayer(player_count)
+                          ->getConstProfile()->getDefaultKartColor());
             player_count++;
         }
         else
-            fprintf(fd, "kart_color: 0\n");
+            info.addFloat(0.0f);
     }
 
     m_last_uid = computeUID(min_time);
@@ -422,61 +489,45 @@ void ReplayRecorder::save()
     int num_laps = RaceManager::get()->getNumLaps();
     if (num_laps == 9999) num_laps = 0; // no lap in that race mode
 
-    fprintf(fd, "kart_list_end\n");
-    fprintf(fd, "reverse: %d\n",    (int)RaceManager::get()->getReverseTrack());
-    fprintf(fd, "difficulty: %d\n", RaceManager::get()->getDifficulty());
-    fprintf(fd, "mode: %s\n",       RaceManager::get()->getMinorModeName().c_str());
-    fprintf(fd, "track: %s\n",      Track::getCurrentTrack()->getIdent().c_str());
-    fprintf(fd, "laps: %d\n",       num_laps);
-    fprintf(fd, "min_time: %f\n",   min_time);
-    fprintf(fd, "replay_uid: %" PRIu64 "\n", m_last_uid);
-
-    for (unsigned int k = 0; k < num_karts; k++)
+    BinaryHeader header;
+    header.m_version     = getCurrentReplayVersion();
+    header.m_complete    = true;
+    header.m_num_karts   = replay_karts;
+    header.m_reverse     = RaceManager::get()->getReverseTrack();
+    header.m_difficulty  = RaceManager::get()->getDifficulty();
+    header.m_laps        = num_laps;
+    header.m_min_time    = min_time;
+    header.m_replay_uid  = m_last_uid;
+    header.m_num_events  = m_num_events;
+    header.m_info_offset = (uint32_t)ftell(m_fd);
+    header.m_info_size   = info.getTotalSize();
+    BareNetworkString header_data(BINARY_HEADER_SIZE);
+    writeBinaryHeader(header, &header_data);
+
+    bool written =
+        fwrite(info.getData(), 1, info.getTotalSize(), m_fd) ==
+                                                       info.getTotalSize() &&
+        fseek(m_fd, 0, SEEK_SET) == 0 &&
+        fwrite(header_data.getData(), 1, header_data.getTotalSize(), m_fd) ==
+                                                header_data.getTotalSize();
+    written = fclose(m_fd) == 0 && written;
+    m_fd = NULL;
+
+    // The behaviour of rename is unspecified if the target file
+    // already exists - so remove it.
+    const std::string path = file_manager->getReplayDir() + m_filename;
+    file_manager->removeFile(path);
+    if (!written || FileUtils::renameU8Path(part_path, path) != 0)
     {
-        if (world->getKart(k)->isGhostKart()) continue;
-
-        const unsigned int num_transforms = std::min(m_max_frames,
-                                                     m_count_transforms[k]);
-
-        fprintf(fd, "size:     %d\n", num_transforms);
-
-        for (unsigned int i = 0; i < num_transforms; i++)
-        {
-            const TransformEvent *p  = &(m_transform_events[k][i]);
-            const PhysicInfo *q      = &(m_physic_info[k][i]);
-            const BonusInfo *b      = &(m_bonus_info[k][i]);
-            const KartReplayEvent *r = &(m_kart_replay_event[k][i]);
-            fprintf(fd, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f %d  %d %f %d %d %d  %f %d %d %d %d %d\n",
-                    p->m_time,
-                    p->m_transform.getOrigin().getX(),
-                    p->m_transform.getOrigin().getY(),
-                    p->m_transform.getOrigin().getZ(),
-                    p->m_transform.getRotation().getX(),
-                    p->m_transform.getRotation().getY(),
-                    p->m_transform.getRotation().getZ(),
-                    p->m_transform.getRotation().getW(),
-                    q->m_speed,
-                    q->m_steer,
-                    q->m_suspension_length[0],
-                    q->m_suspension_length[1],
-                    q->m_suspension_length[2],
-                    q->m_suspension_length[3],
-                    q->m_skidding_state,
-                    b->m_attachment,
-                    b->m_nitro_amount,
-                    b->m_item_amount,
-                    b->m_item_type,
-                    b->m_special_value,
-                    r->m_distance,
-                    r->m_nitro_usage,
-                    (int)r->m_zipper_usage,
-                    r->m_skidding_effect,
-                    (int)r->m_red_skidding,
-                    (int)r->m_jumping
-                );
-        }   // for i
+        Log::error("ReplayRecorder", "Can't write '%s' - "
+            "can't save replay data.", path.c_str());
+        file_manager->removeFile(part_path);
+        return;
     }
-    fclose(fd);
+
+    core::stringw msg = _("Replay saved in \"%s\".",
+        StringUtils::utf8ToWide(path));
+    MessageQueue::add(MessageQueue::MT_GENERIC, msg);
 }   // save
 
 /* Returns an encoding value for a given attachment type.
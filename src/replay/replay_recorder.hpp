@@ -34,17 +34,23 @@ class ReplayRecorder : public ReplayBase
 private:
     std::string m_filename;
 
-    /** A separate vector of Replay Events for all transforms. */
-    std::vector< std::vector<TransformEvent> > m_transform_events;
+    /** The file to which events are written while the race is running.
+     *  It is renamed to its final name once the replay is saved. */
+    FILE *m_fd;
 
-    /** A separate vector of Replay Events for all physic info. */
-    std::vector< std::vector<PhysicInfo> > m_physic_info;
+    /** Number of events written to m_fd. */
+    unsigned int m_num_events;
 
-    /** A separate vector of Replay Events for all item/nitro info. */
-    std::vector< std::vector<BonusInfo> > m_bonus_info;
+    /** The last recorded physic info of each kart. */
+    std::vector<PhysicInfo> m_last_physic_info;
 
-    /** A separate vector of Replay Events for all other events. */
-    std::vector< std::vector<KartReplayEvent> > m_kart_replay_event;
+    /** The last two recorded item/nitro info of each kart. */
+    std::vector<BonusInfo> m_last_bonus_info;
+    std::vector<BonusInfo> m_previous_bonus_info;
+
+    /** The quantized values of the last written event of each kart, which
+     *  the next event is delta coded against. */
+    std::vector<int32_t> m_last_values;
 
     /** Time at which a transform was saved for the last time. */
     std::vector<float> m_last_saved_time;
@@ -85,6 +91,8 @@ private:
     /** Compute the replay's UID ; partly based on race data ; partly randomly */
     uint64_t computeUID(float min_time);
 
+    void discardFile();
+
 
           ReplayRecorder();
          ~ReplayRecorder();
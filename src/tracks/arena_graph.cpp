@@ -21,24 +21,43 @@
 #include "config/user_config.hpp"
 #include "io/file_manager.hpp"
 #include "io/xml_node.hpp"
+#include "network/crypto.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/arena_node.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 
 #include <algorithm>
 #include <queue>
 
 // -----------------------------------------------------------------------------
-ArenaGraph::ArenaGraph(const std::string &navmesh, const XMLNode *node)
+/** Constructor, loads the navmesh and computes all shortest paths.
+ *  \param navmesh File name of the navmesh.
+ *  \param node XML node with the goal lines for soccer, can be NULL.
+ *  \param use_path_cache If the shortest paths are loaded from (and saved
+ *         to) the cache in the user's cache directory.
+ */
+ArenaGraph::ArenaGraph(const std::string &navmesh, const XMLNode *node,
+                       bool use_path_cache)
           : Graph()
 {
     loadNavmesh(navmesh);
-    buildGraph();
-    // Compute shortest distance from all nodes
-    for (unsigned int i = 0; i < getNumNodes(); i++)
-        computeDijkstra(i);
+    buildGrid();
+    // The shortest paths only depend on the navmesh, so they are only
+    // computed if they are not cached yet
+    const std::string cache_file =
+        use_path_cache ? getPathCacheFile(navmesh) : "";
+    if (cache_file.empty() || !loadPathCache(cache_file))
+    {
+        buildGraph();
+        // Compute shortest distance from all nodes
+        for (unsigned int i = 0; i < getNumNodes(); i++)
+            computeDijkstra(i);
+        if (!cache_file.empty())
+            savePathCache(cache_file);
+    }
 
     setNearbyNodesOfAllNodes();
     if (node && RaceManager::get()->getMinorMode() == RaceManager::MINOR_MODE_SOCCER)
@@ -179,8 +198,7 @@ void ArenaGraph::buildGraph()
 {
     const unsigned int n_nodes = getNumNodes();
 
-    m_distance_matrix = std::vector<std::vector<float>>
-        (n_nodes, std::vector<float>(n_nodes, 9999.9f));
+    m_distance_matrix.assign(n_nodes * n_nodes, 9999.9f);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         ArenaNode* cur_node = getNode(i);
@@ -188,22 +206,21 @@ void ArenaGraph::buildGraph()
         {
             Vec3 diff = getNode(adjacent)->getCenter() - cur_node->getCenter();
             float distance = diff.length();
-            m_distance_matrix[i][adjacent] = distance;
+            m_distance_matrix[i * n_nodes + adjacent] = distance;
         }
-        m_distance_matrix[i][i] = 0.0f;
+        m_distance_matrix[i * n_nodes + i] = 0.0f;
     }
 
     // Allocate and initialise the previous node data structure:
-    m_parent_node = std::vector<std::vector<int16_t>>
-        (n_nodes, std::vector<int16_t>(n_nodes, Graph::UNKNOWN_SECTOR));
+    m_parent_node.assign(n_nodes * n_nodes, Graph::UNKNOWN_SECTOR);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         for (unsigned int j = 0; j < n_nodes; j++)
         {
-            if (i == j || m_distance_matrix[i][j] >= 9899.9f)
-                m_parent_node[i][j] = -1;
+            if (i == j || m_distance_matrix[i * n_nodes + j] >= 9899.9f)
+                m_parent_node[i * n_nodes + j] = -1;
             else
-                m_parent_node[i][j] = i;
+                m_parent_node[i * n_nodes + j] = i;
         }   // for j
     }   // for i
 
@@ -235,6 +252,8 @@ void ArenaGraph::computeDijkstra(int source)
     IndDistPair begin(source, 0.0f);
     queue.push(begin);
     const unsigned int n = getNumNodes();
+    float* distance = &m_distance_matrix[source * n];
+    int16_t* parent = &m_parent_node[source * n];
     std::vector<bool> visited;
     visited.resize(n, false);
     while (!queue.empty())
@@ -252,11 +271,11 @@ void ArenaGraph::computeDijkstra(int source)
             if (visited[adjacent]) continue;
 
             float new_dist =
-                current.second + m_distance_matrix[cur_index][adjacent];
-            if (new_dist < m_distance_matrix[source][adjacent])
+                current.second + m_distance_matrix[cur_index * n + adjacent];
+            if (new_dist < distance[adjacent])
             {
-                m_distance_matrix[source][adjacent] = new_dist;
-                m_parent_node[source][adjacent] = cur_index;
+                distance[adjacent] = new_dist;
+                parent[adjacent] = cur_index;
             }
             IndDistPair pair(adjacent, new_dist);
             queue.push(pair);
@@ -284,12 +303,12 @@ void ArenaGraph::computeFloydWarshall()
         {
             for (unsigned int j = 0; j < n; j++)
             {
-                if ((m_distance_matrix[i][k] + m_distance_matrix[k][j]) <
-                    m_distance_matrix[i][j])
+                if ((m_distance_matrix[i * n + k] +
+                     m_distance_matrix[k * n + j]) < m_distance_matrix[i * n + j])
                 {
-                    m_distance_matrix[i][j] =
-                        m_distance_matrix[i][k] + m_distance_matrix[k][j];
-                    m_parent_node[i][j] = m_parent_node[k][j];
+                    m_distance_matrix[i * n + j] =
+                        m_distance_matrix[i * n + k] + m_distance_matrix[k * n + j];
+                    m_parent_node[i * n + j] = m_parent_node[k * n + j];
                 }
             }
         }
@@ -297,6 +316,115 @@ void ArenaGraph::computeFloydWarshall()
 
 }   // computeFloydWarshall
 
+// ----------------------------------------------------------------------------
+/** Returns the name of the file in which the shortest paths of a navmesh are
+ *  cached, which contains the hash of the navmesh so that a changed navmesh
+ *  is not using old paths. Returns an empty string if the navmesh can not
+ *  be read.
+ *  \param navmesh Full path of the navmesh file.
+ */
+std::string ArenaGraph::getPathCacheFile(const std::string &navmesh) const
+{
+    FILE* fp = FileUtils::fopenU8Path(navmesh, "rb");
+    if (!fp)
+        return "";
+    std::string content;
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        content.append(buffer, size);
+    fclose(fp);
+
+    std::string hash;
+    char hex[3];
+    for (uint8_t byte : Crypto::sha256(content))
+    {
+        snprintf(hex, sizeof(hex), "%02x", byte);
+        hash += hex;
+    }
+    return file_manager->getCachedDataDir() + "navmesh-" + hash + ".paths";
+}   // getPathCacheFile
+
+// ----------------------------------------------------------------------------
+/** Version of the path cache files, must be increased if the format or the
+ *  computation of the paths is changed. */
+static const uint8_t PATH_CACHE_VERSION = 1;
+
+/** Loads the distance and parent node matrices from the cache.
+ *  \return False if there is no valid cache file.
+ */
+bool ArenaGraph::loadPathCache(const std::string &cache_file)
+{
+    FILE* fp = FileUtils::fopenU8Path(cache_file, "rb");
+    if (!fp)
+        return false;
+
+    const size_t n = getNumNodes();
+    uint8_t version = 0;
+    uint32_t num_nodes = 0;
+    bool valid = fread(&version, 1, 1, fp) == 1 &&
+                 version == PATH_CACHE_VERSION &&
+                 fread(&num_nodes, 4, 1, fp) == 1 && num_nodes == n;
+    if (valid)
+    {
+        // Each matrix is read in one go straight into its final storage
+        m_distance_matrix.resize(n * n);
+        m_parent_node.resize(n * n);
+        valid = fread(m_distance_matrix.data(), sizeof(float), n * n,
+                      fp) == n * n &&
+                fread(m_parent_node.data(), sizeof(int16_t), n * n,
+                      fp) == n * n &&
+                fgetc(fp) == EOF;
+    }
+    fclose(fp);
+
+    if (!valid)
+    {
+        Log::warn("ArenaGraph", "Ignoring invalid path cache '%s'.",
+            cache_file.c_str());
+        m_distance_matrix.clear();
+        m_parent_node.clear();
+    }
+    return valid;
+}   // loadPathCache
+
+// ----------------------------------------------------------------------------
+/** Saves the distance and parent node matrices in the cache. A temporary
+ *  file with a unique name is renamed at the end, so another process (or
+ *  the server in this process) never reads or writes a partly written file.
+ */
+void ArenaGraph::savePathCache(const std::string &cache_file) const
+{
+    const std::string tmp_file = FileUtils::getUniqueTempPath(cache_file);
+    FILE* fp = FileUtils::fopenU8Path(tmp_file, "wb");
+    if (!fp)
+    {
+        Log::warn("ArenaGraph", "Can not write path cache '%s'.",
+            tmp_file.c_str());
+        return;
+    }
+    const uint32_t num_nodes = getNumNodes();
+    bool written = fwrite(&PATH_CACHE_VERSION, 1, 1, fp) == 1 &&
+                   fwrite(&num_nodes, 4, 1, fp) == 1 &&
+                   fwrite(m_distance_matrix.data(), sizeof(float),
+                          m_distance_matrix.size(), fp) ==
+                       m_distance_matrix.size() &&
+                   fwrite(m_parent_node.data(), sizeof(int16_t),
+                          m_parent_node.size(), fp) == m_parent_node.size();
+    written = fclose(fp) == 0 && written;
+    if (!written || FileUtils::renameU8Path(tmp_file, cache_file) != 0)
+    {
+        // On windows rename fails if another writer was faster, its file
+        // has the same content then
+        if (!written || !file_manager->fileExists(cache_file))
+        {
+            Log::warn("ArenaGraph", "Can not write path cache '%s'.",
+                cache_file.c_str());
+        }
+        file_manager->removeFile(tmp_file);
+    }
+}   // savePathCache
+
 // -----------------------------------------------------------------------------
 void ArenaGraph::loadGoalNodes(const XMLNode *node)
 {
@@ -342,26 +470,28 @@ void ArenaGraph::loadGoalNodes(const XMLNode *node)
 // ----------------------------------------------------------------------------
 void ArenaGraph::setNearbyNodesOfAllNodes()
 {
+    const unsigned int n = getNumNodes();
     // Only save the nearby 8 nodes
-    const unsigned int try_count = 8;
-    for (unsigned int i = 0; i < getNumNodes(); i++)
+    const unsigned int try_count = std::min(8u, n > 0 ? n - 1 : 0);
+    std::vector<int> nodes;
+    for (unsigned int i = 0; i < n; i++)
     {
-        // Get the distance to all nodes at i
-        ArenaNode* cur_node = getNode(i);
-        std::vector<int> nearby_nodes;
-        std::vector<float> dist = m_distance_matrix[i];
-
-        // Skip the same node
-        dist[i] = 999999.0f;
-        for (unsigned int j = 0; j < try_count; j++)
+        // Sort the nodes by their distance to i, only as far as needed
+        const float* dist = &m_distance_matrix[i * n];
+        nodes.clear();
+        for (unsigned int j = 0; j < n; j++)
         {
-            std::vector<float>::iterator it =
-                std::min_element(dist.begin(), dist.end());
-            const int pos = int(it - dist.begin());
-            nearby_nodes.push_back(pos);
-            dist[pos] = 999999.0f;
+            // Skip the same node
+            if (j != i)
+                nodes.push_back(j);
         }
-        cur_node->setNearbyNodes(nearby_nodes);
+        std::partial_sort(nodes.begin(), nodes.begin() + try_count,
+            nodes.end(), [dist](int a, int b)
+            {
+                return dist[a] < dist[b] || (dist[a] == dist[b] && a < b);
+            });
+        nodes.resize(try_count);
+        getNode(i)->setNearbyNodes(nodes);
     }
 
 }   // setNearbyNodesOfAllNodes
@@ -370,14 +500,14 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
 /** Determines the full path from 'from' to 'to' and returns it in a
  *  std::vector (in reverse order). Used only for unit testing.
  */
-std::vector<int16_t> ArenaGraph::getPathFromTo(int from, int to,
-                      const std::vector< std::vector< int16_t > >& parent_node)
+std::vector<int16_t> ArenaGraph::getPathFromTo(int from, int to, unsigned n,
+                                         const std::vector<int16_t>& parent_node)
 {
     std::vector<int16_t> path;
     path.push_back(to);
     while(from!=to)
     {
-        to = parent_node[from][to];
+        to = parent_node[from * n + to];
         path.push_back(to);
     }
     return path;
@@ -395,14 +525,19 @@ void ArenaGraph::unitTesting()
     Track *track = track_manager->getTrack("cave");
     std::string navmesh_file_name=track->getTrackFile("navmesh.xml");
 
+    // Bypass the path cache, so the constructor computes all paths with
+    // Dijkstra (and the test does not write into the user's cache
+    // directory).
     double s = StkTime::getRealTime();
-    ArenaGraph* ag = new ArenaGraph(navmesh_file_name);
+    ArenaGraph* ag = new ArenaGraph(navmesh_file_name, NULL,
+                                    /*use_path_cache*/false);
     double e = StkTime::getRealTime();
-    Log::error("Time", "Dijkstra       %lf", e-s);
+    Log::error("Time", "Load+Dijkstra  %lf", e-s);
 
-    // Save the Dijkstra results
-    std::vector< std::vector< float > > distance_matrix = ag->m_distance_matrix;
-    std::vector< std::vector< int16_t > > parent_node = ag->m_parent_node;
+    // Save the Dijkstra results, and reset the matrices to the edges of
+    // the graph for Floyd-Warshall
+    std::vector<float> distance_matrix = ag->m_distance_matrix;
+    std::vector<int16_t> parent_node = ag->m_parent_node;
     ag->buildGraph();
 
     // Now compute results with Floyd-Warshall
@@ -412,15 +547,17 @@ void ArenaGraph::unitTesting()
     Log::error("Time", "Floyd-Warshall %lf", e-s);
 
     int error_count = 0;
-    for(unsigned int i=0; i<ag->m_distance_matrix.size(); i++)
+    const unsigned int n = ag->getNumNodes();
+    for(unsigned int i=0; i<n; i++)
     {
-        for(unsigned int j=0; j<ag->m_distance_matrix[i].size(); j++)
+        for(unsigned int j=0; j<n; j++)
         {
-            if(ag->m_distance_matrix[i][j] - distance_matrix[i][j] > 0.001f)
+            if(ag->m_distance_matrix[i*n+j] - distance_matrix[i*n+j] > 0.001f)
             {
                 Log::error("ArenaGraph",
                            "Incorrect distance %d, %d: Dijkstra: %f F.W.: %f",
-                           i, j, distance_matrix[i][j], ag->m_distance_matrix[i][j]);
+                           i, j, distance_matrix[i*n+j],
+                           ag->m_distance_matrix[i*n+j]);
                 error_count++;
             }    // if distance is too different
 
@@ -432,16 +569,16 @@ void ArenaGraph::unitTesting()
             // debugging in the feature
 #undef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
 #ifdef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
-            if(ag->m_parent_node[i][j] != parent_node[i][j])
+            if(ag->m_parent_node[i*n+j] != parent_node[i*n+j])
             {
                 error_count++;
-                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, parent_node);
-                std::vector<int16_t> floyd_path = getPathFromTo(i, j, ag->m_parent_node);
+                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, n, parent_node);
+                std::vector<int16_t> floyd_path = getPathFromTo(i, j, n, ag->m_parent_node);
                 if(dijkstra_path.size()!=floyd_path.size())
                 {
                     Log::error("ArenaGraph",
                                "Incorrect path length %d, %d: Dijkstra: %d F.W.: %d",
-                               i, j, parent_node[i][j], ag->m_parent_node[i][j]);
+                               i, j, parent_node[i*n+j], ag->m_parent_node[i*n+j]);
                     continue;
                 }
                 Log::error("ArenaGraph", "Path problems from %d to %d:",
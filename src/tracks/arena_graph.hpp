@@ -34,11 +34,14 @@ class XMLNode;
 class ArenaGraph : public Graph
 {
 private:
-    /** The actual graph data structure, it is an adjacency matrix. */
-    std::vector<std::vector<float>> m_distance_matrix;
+    /** The actual graph data structure, it is an adjacency matrix stored
+     *  row by row, m_distance_matrix[i * n + j] is the distance from node i
+     *  to node j. */
+    std::vector<float> m_distance_matrix;
 
-    /** The matrix that is used to store computed shortest paths. */
-    std::vector<std::vector<int16_t>> m_parent_node;
+    /** The matrix that is used to store computed shortest paths, stored row
+     *  by row like m_distance_matrix. */
+    std::vector<int16_t> m_parent_node;
 
     /** Used in soccer mode to colorize the goal lines in minimap. */
     std::set<int> m_red_node;
@@ -58,8 +61,14 @@ private:
     // ------------------------------------------------------------------------
     void computeFloydWarshall();
     // ------------------------------------------------------------------------
-    static std::vector<int16_t> getPathFromTo(int from, int to,
-                     const std::vector< std::vector< int16_t > >& parent_node);
+    std::string getPathCacheFile(const std::string &navmesh) const;
+    // ------------------------------------------------------------------------
+    bool loadPathCache(const std::string &cache_file);
+    // ------------------------------------------------------------------------
+    void savePathCache(const std::string &cache_file) const;
+    // ------------------------------------------------------------------------
+    static std::vector<int16_t> getPathFromTo(int from, int to, unsigned n,
+                                        const std::vector<int16_t>& parent_node);
     // ------------------------------------------------------------------------
     virtual bool hasLapLine() const OVERRIDE                  { return false; }
     // ------------------------------------------------------------------------
@@ -70,7 +79,8 @@ public:
     // ------------------------------------------------------------------------
     static void unitTesting();
     // ------------------------------------------------------------------------
-    ArenaGraph(const std::string &navmesh, const XMLNode *node = NULL);
+    ArenaGraph(const std::string &navmesh, const XMLNode *node = NULL,
+               bool use_path_cache = true);
     // ------------------------------------------------------------------------
     virtual ~ArenaGraph() {}
     // ------------------------------------------------------------------------
@@ -84,7 +94,7 @@ public:
     {
         if (i == Graph::UNKNOWN_SECTOR || j == Graph::UNKNOWN_SECTOR)
             return Graph::UNKNOWN_SECTOR;
-        return (int)(m_parent_node[j][i]);
+        return (int)(m_parent_node[j * getNumNodes() + i]);
     }
     // ------------------------------------------------------------------------
     /** Returns the distance between any two nodes */
@@ -92,7 +102,7 @@ public:
     {
         if (from == Graph::UNKNOWN_SECTOR || to == Graph::UNKNOWN_SECTOR)
             return 99999.0f;
-        return m_distance_matrix[from][to];
+        return m_distance_matrix[from * getNumNodes() + to];
     }
 
 };   // ArenaGraph
@@ -174,6 +174,44 @@ void CheckLine::resetAfterKartMove(unsigned int kart_index)
     m_previous_position[kart_index] = kart->getXYZ();
 }   // resetAfterKartMove
 
+// ----------------------------------------------------------------------------
+/** Updates the side of the line a kart is on, as isTriggered does. */
+void CheckLine::notTriggered(const Vec3 &new_pos, int kart_index)
+{
+    if (kart_index >= 0)
+    {
+        m_previous_sign[kart_index] = new_pos.sideofPlane(
+            m_check_plane[0].pointA, m_check_plane[0].pointB,
+            m_check_plane[0].pointC) >= 0;
+    }
+}   // notTriggered
+
+// ----------------------------------------------------------------------------
+/** Returns the bounding box of all check planes, including the ones used
+ *  when ignoring the height. A line from old to new position can only
+ *  intersect a check plane if its bounding box overlaps this box.
+ */
+bool CheckLine::getBoundingBox(Vec3 *min, Vec3 *max) const
+{
+    *min = Vec3(m_check_plane[0].pointA);
+    *max = *min;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        const core::vector3df* points[3] = { &m_check_plane[i].pointA,
+            &m_check_plane[i].pointB, &m_check_plane[i].pointC };
+        for (const core::vector3df* p : points)
+        {
+            min->min(Vec3(*p));
+            max->max(Vec3(*p));
+        }
+    }
+    // Allow for rounding errors in the intersection test
+    const Vec3 margin(0.1f, 0.1f, 0.1f);
+    *min -= margin;
+    *max += margin;
+    return true;
+}   // getBoundingBox
+
 // ----------------------------------------------------------------------------
 void CheckLine::changeDebugColor(bool is_active)
 {
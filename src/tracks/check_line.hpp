@@ -74,6 +74,8 @@ public:
     virtual     ~CheckLine();
     virtual bool isTriggered(const Vec3 &old_pos, const Vec3 &new_pos,
                              int indx) OVERRIDE;
+    virtual void notTriggered(const Vec3 &new_pos, int indx) OVERRIDE;
+    virtual bool getBoundingBox(Vec3 *min, Vec3 *max) const OVERRIDE;
     virtual void reset(const Track &track) OVERRIDE;
     virtual void resetAfterKartMove(unsigned int kart_index) OVERRIDE;
     virtual void resetAfterRewind(unsigned int kart_index) OVERRIDE
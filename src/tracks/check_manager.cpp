@@ -23,6 +23,7 @@
 
 #include "io/xml_node.hpp"
 #include "karts/abstract_kart.hpp"
+#include "modes/linear_world.hpp"
 #include "modes/world.hpp"
 #include "tracks/check_cannon.hpp"
 #include "tracks/check_goal.hpp"
@@ -114,8 +115,34 @@ void CheckManager::reset(const Track &track)
     std::vector<CheckStructure*>::iterator i;
     for(i=m_all_checks.begin(); i!=m_all_checks.end(); i++)
         (*i)->reset(track);
+    updateBoundingBoxes();
 }   // reset
 
+// ----------------------------------------------------------------------------
+/** Stores the bounding boxes of all check structures which have one. */
+void CheckManager::updateBoundingBoxes()
+{
+    const unsigned int n = (unsigned int)m_all_checks.size();
+    m_box_min_x.resize(n);
+    m_box_min_y.resize(n);
+    m_box_min_z.resize(n);
+    m_box_max_x.resize(n);
+    m_box_max_y.resize(n);
+    m_box_max_z.resize(n);
+    m_use_box.resize(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        Vec3 min, max;
+        m_use_box[i] = m_all_checks[i]->getBoundingBox(&min, &max);
+        m_box_min_x[i] = min.getX();
+        m_box_min_y[i] = min.getY();
+        m_box_min_z[i] = min.getZ();
+        m_box_max_x[i] = max.getX();
+        m_box_max_y[i] = max.getY();
+        m_box_max_z[i] = max.getZ();
+    }
+}   // updateBoundingBoxes
+
 // ----------------------------------------------------------------------------
 /** Called after a kart is moved (e.g. after a rescue) to reset any cached
  *  check information. Without this an incorrect crossing of a checkline
@@ -175,14 +202,52 @@ void CheckManager::removeFlyableFromCannons(Flyable *flyable)
 }   // addFlyable
 
 // ----------------------------------------------------------------------------
-/** Updates all animations. Called one per time step.
+/** Updates all check structures. Called one per time step. The front
+ *  positions of the karts are only gathered once, and check structures with
+ *  a bounding box only do the expensive isTriggered test for karts whose
+ *  movement since the last test overlaps this box. The check structures
+ *  are still updated in order, since triggering one can change the state
+ *  of later ones.
  *  \param dt Time since last call.
  */
 void CheckManager::update(float dt)
 {
-    std::vector<CheckStructure*>::iterator i;
-    for(i=m_all_checks.begin(); i!=m_all_checks.end(); i++)
-        (*i)->update(dt);
+    if (m_use_box.size() != m_all_checks.size())
+        updateBoundingBoxes();
+
+    World *world = World::getWorld();
+    LinearWorld *lw = dynamic_cast<LinearWorld*>(world);
+    const unsigned int num_karts = world->getNumKarts();
+    m_kart_front_xyz.resize(num_karts);
+    for (unsigned int k = 0; k < num_karts; k++)
+        m_kart_front_xyz[k] = world->getKart(k)->getFrontXYZ();
+
+    for (unsigned int i = 0; i < m_all_checks.size(); i++)
+    {
+        CheckStructure *cs = m_all_checks[i];
+        if (!m_use_box[i])
+        {
+            cs->update(dt);
+            continue;
+        }
+        const float min_x = m_box_min_x[i], max_x = m_box_max_x[i];
+        const float min_y = m_box_min_y[i], max_y = m_box_max_y[i];
+        const float min_z = m_box_min_z[i], max_z = m_box_max_z[i];
+        for (unsigned int k = 0; k < num_karts; k++)
+        {
+            if (world->getKart(k)->getKartAnimation()) continue;
+            const Vec3 &from = cs->getPreviousPosition(k);
+            const Vec3 &to   = m_kart_front_xyz[k];
+            const bool overlaps =
+                std::max(from.getX(), to.getX()) >= min_x &&
+                std::min(from.getX(), to.getX()) <= max_x &&
+                std::max(from.getY(), to.getY()) >= min_y &&
+                std::min(from.getY(), to.getY()) <= max_y &&
+                std::max(from.getZ(), to.getZ()) >= min_z &&
+                std::min(from.getZ(), to.getZ()) <= max_z;
+            cs->updateKart(k, to, overlaps, lw);
+        }
+    }
 }   // update
 
 // ----------------------------------------------------------------------------
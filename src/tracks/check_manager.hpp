@@ -19,7 +19,9 @@
 #ifndef HEADER_CHECK_MANAGER_HPP
 #define HEADER_CHECK_MANAGER_HPP
 
+#include "utils/aligned_array.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
 
 #include <assert.h>
 #include <string>
@@ -30,7 +32,6 @@ class CheckStructure;
 class Flyable;
 class Track;
 class XMLNode;
-class Vec3;
 
 /**
   * \brief Controls all checks structures of a track.
@@ -40,6 +41,19 @@ class CheckManager : public NoCopy
 {
 private:
     std::vector<CheckStructure*> m_all_checks;
+
+    /** Bounding boxes of the check structures, one entry for each check
+     *  structure stored as separate arrays so they can be tested in a tight
+     *  loop. Only used if m_use_box is true for the check structure,
+     *  otherwise its own update function is called. */
+    std::vector<float> m_box_min_x, m_box_min_y, m_box_min_z;
+    std::vector<float> m_box_max_x, m_box_max_y, m_box_max_z;
+    std::vector<bool>  m_use_box;
+
+    /** Front positions of all karts, gathered once per update. */
+    AlignedArray<Vec3> m_kart_front_xyz;
+
+    void   updateBoundingBoxes();
 public:
     ~CheckManager();
     void   add(CheckStructure* strct) { m_all_checks.push_back(strct); }
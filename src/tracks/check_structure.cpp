@@ -114,23 +114,45 @@ void CheckStructure::update(float dt)
     LinearWorld* lw = dynamic_cast<LinearWorld*>(World::getWorld());
     for(unsigned int i=0; i<world->getNumKarts(); i++)
     {
-        const Vec3 &xyz = world->getKart(i)->getFrontXYZ();
         if(world->getKart(i)->getKartAnimation()) continue;
-        // Only check active checklines.
-        if(m_is_active[i] && isTriggered(m_previous_position[i], xyz, i))
+        updateKart(i, world->getKart(i)->getFrontXYZ(),
+                   /*can_trigger*/true, lw);
+    }   // for i<getNumKarts
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Tests if a kart triggers this check structure and stores its position.
+ *  \param kart_index Index of the kart.
+ *  \param xyz The current front position of the kart.
+ *  \param can_trigger False if the kart is known to be too far away to
+ *         trigger this check structure, so the test can be skipped.
+ *  \param lw The linear world, or NULL in other modes.
+ */
+void CheckStructure::updateKart(unsigned int kart_index, const Vec3 &xyz,
+                                bool can_trigger, LinearWorld *lw)
+{
+    // Only check active checklines.
+    if (m_is_active[kart_index])
+    {
+        if (!can_trigger)
+            notTriggered(xyz, kart_index);
+        else if (isTriggered(m_previous_position[kart_index], xyz,
+                             kart_index))
         {
+            World *world = World::getWorld();
             if(UserConfigParams::m_check_debug)
                 Log::info("CheckStructure",
                           "Check structure %d triggered for kart %s at %f.",
-                          m_index, world->getKart(i)->getIdent().c_str(),
-                          World::getWorld()->getTime());
-            trigger(i);
+                          m_index,
+                          world->getKart(kart_index)->getIdent().c_str(),
+                          world->getTime());
+            trigger(kart_index);
             if (triggeringCheckline() && lw)
-                lw->updateCheckLinesServer(getIndex(), i);
+                lw->updateCheckLinesServer(getIndex(), kart_index);
         }
-        m_previous_position[i] = xyz;
-    }   // for i<getNumKarts
-}   // update
+    }
+    m_previous_position[kart_index] = xyz;
+}   // updateKart
 
 // ----------------------------------------------------------------------------
 /** Changes the status (active/inactive) of all check structures contained
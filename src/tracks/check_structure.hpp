@@ -26,6 +26,7 @@
 
 class BareNetworkString;
 class CheckManager;
+class LinearWorld;
 class Track;
 class XMLNode;
 
@@ -123,6 +124,24 @@ public:
                              int indx)=0;
     virtual void trigger(unsigned int kart_index);
     virtual void reset(const Track &track);
+    void         updateKart(unsigned int kart_index, const Vec3 &xyz,
+                            bool can_trigger, LinearWorld *lw);
+    // ------------------------------------------------------------------------
+    /** Called instead of isTriggered for an active check structure if the
+     *  kart is too far away to trigger it, to update kart specific data
+     *  which isTriggered would have updated. */
+    virtual void notTriggered(const Vec3 &new_pos, int indx) {}
+    // ------------------------------------------------------------------------
+    /** Returns a bounding box which contains all points at which this check
+     *  structure can be triggered, so the CheckManager can skip karts which
+     *  are not close. Only used for check structures which are updated by
+     *  CheckStructure::update.
+     *  \return False if this check structure has no such bounding box. */
+    virtual bool getBoundingBox(Vec3 *min, Vec3 *max) const { return false; }
+    // ------------------------------------------------------------------------
+    /** Returns the position of a kart when it was last tested. */
+    const Vec3& getPreviousPosition(unsigned int kart_index) const
+                                    { return m_previous_position[kart_index]; }
 
     // ------------------------------------------------------------------------
     /** Returns the type of this check structure. */
@@ -18,6 +18,7 @@
 #include "tracks/check_trigger.hpp"
 #include "karts/abstract_kart.hpp"
 #include "modes/world.hpp"
+#include "network/rewind_manager.hpp"
 #include "utils/time.hpp"
 
 /** Constructor for a check trigger.
@@ -43,6 +44,9 @@ bool CheckTrigger::isTriggered(const Vec3 &old_pos, const Vec3 &new_pos,
     // kart_id will be -1 if called by CheckManager::getChecklineTriggering
     if (kart_id < 0 || kart_id >= (int)World::getWorld()->getNumKarts())
         return false;
+    // The script was already run when the tick was first simulated
+    if (RewindManager::get()->isRewinding())
+        return false;
     if (m_last_triggered_time + 2000 > StkTime::getMonoTimeMs())
         return false;
     AbstractKart* k = World::getWorld()->getKart(kart_id);
@@ -36,6 +36,9 @@
 #include <ICameraSceneNode.h>
 #include <ISceneManager.h>
 
+#include <algorithm>
+#include <cmath>
+
 #ifndef SERVER_ONLY
 #include <ge_main.hpp>
 #endif
@@ -55,6 +58,11 @@ Graph::Graph()
     m_bb_min      = Vec3( 99999,  99999,  99999);
     m_bb_max      = Vec3(-99999, -99999, -99999);
     memset(m_bb_nodes, 0, 4 * sizeof(int));
+    m_grid_min_x     = 0.0f;
+    m_grid_min_z     = 0.0f;
+    m_grid_cell_size = 1.0f;
+    m_grid_cols      = 0;
+    m_grid_rows      = 0;
 }  // Graph
 
 // -----------------------------------------------------------------------------
@@ -652,6 +660,112 @@ void Graph::createQuad(const Vec3 &p0, const Vec3 &p1, const Vec3 &p2,
 
 }   // createQuad
 
+//-----------------------------------------------------------------------------
+/** Builds the grid used by findRoadSector and findOutOfRoadSector. Each quad
+ *  is added to all cells overlapping the x/z area in which it can contain a
+ *  point, which also contains the line used for the distance to the quad.
+ *  Must be called after all quads are created.
+ */
+void Graph::buildGrid()
+{
+    m_grid_offsets.clear();
+    m_grid_quads.clear();
+    const int n = (int)m_all_nodes.size();
+    if (n == 0)
+        return;
+
+    // Min x, min z, max x and max z of each quad
+    std::vector<float> bounds(4 * n);
+    float total_size = 0.0f;
+    Vec3 grid_min = m_all_nodes[0]->getCenter();
+    Vec3 grid_max = grid_min;
+    for (int i = 0; i < n; i++)
+    {
+        const Quad* q = m_all_nodes[i];
+        Vec3 box_min = (*q)[0];
+        Vec3 box_max = (*q)[0];
+        for (int j = 0; j < 4; j++)
+        {
+            box_min.min((*q)[j]);
+            box_max.max((*q)[j]);
+            if (q->is3DQuad())
+            {
+                // The box of BoundingBox3D reaches at most 5 units along
+                // the normal
+                box_min.min((*q)[j] + 5.0f * q->getNormal());
+                box_max.max((*q)[j] + 5.0f * q->getNormal());
+                box_min.min((*q)[j] - 5.0f * q->getNormal());
+                box_max.max((*q)[j] - 5.0f * q->getNormal());
+            }
+        }
+        bounds[4 * i    ] = box_min.getX();
+        bounds[4 * i + 1] = box_min.getZ();
+        bounds[4 * i + 2] = box_max.getX();
+        bounds[4 * i + 3] = box_max.getZ();
+        grid_min.min(box_min);
+        grid_max.max(box_max);
+        total_size += std::max(box_max.getX() - box_min.getX(),
+                               box_max.getZ() - box_min.getZ());
+    }
+
+    // Use cells about the size of a quad, but limit the number of cells
+    // for tracks with a few small quads far apart
+    m_grid_cell_size = std::max(total_size / n, 1.0f);
+    const float width = grid_max.getX() - grid_min.getX();
+    const float depth = grid_max.getZ() - grid_min.getZ();
+    const float max_cells = 4.0f * n + 16.0f;
+    float num_cells = (width / m_grid_cell_size + 1.0f) *
+                      (depth / m_grid_cell_size + 1.0f);
+    if (num_cells > max_cells)
+        m_grid_cell_size *= sqrtf(num_cells / max_cells);
+    m_grid_min_x = grid_min.getX();
+    m_grid_min_z = grid_min.getZ();
+    m_grid_cols  = (int)(width / m_grid_cell_size) + 1;
+    m_grid_rows  = (int)(depth / m_grid_cell_size) + 1;
+
+    auto cell_range = [this](float min, float max, int cells,
+                             int* first, int* last)
+    {
+        *first = std::min((int)(min / m_grid_cell_size), cells - 1);
+        *last  = std::min((int)(max / m_grid_cell_size), cells - 1);
+    };
+
+    // Count the quads of each cell first, then fill them in
+    m_grid_offsets.resize(m_grid_cols * m_grid_rows + 1, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        std::vector<int> next;
+        if (pass == 1)
+        {
+            for (unsigned i = 1; i < m_grid_offsets.size(); i++)
+                m_grid_offsets[i] += m_grid_offsets[i - 1];
+            m_grid_quads.resize(m_grid_offsets.back());
+            next.assign(m_grid_offsets.begin(), m_grid_offsets.end() - 1);
+        }
+        for (int i = 0; i < n; i++)
+        {
+            int col_first, col_last, row_first, row_last;
+            cell_range(bounds[4 * i] - m_grid_min_x,
+                bounds[4 * i + 2] - m_grid_min_x, m_grid_cols, &col_first,
+                &col_last);
+            cell_range(bounds[4 * i + 1] - m_grid_min_z,
+                bounds[4 * i + 3] - m_grid_min_z, m_grid_rows, &row_first,
+                &row_last);
+            for (int row = row_first; row <= row_last; row++)
+            {
+                for (int col = col_first; col <= col_last; col++)
+                {
+                    const int cell = row * m_grid_cols + col;
+                    if (pass == 0)
+                        m_grid_offsets[cell + 1]++;
+                    else
+                        m_grid_quads[next[cell]++] = i;
+                }
+            }
+        }
+    }
+}   // buildGrid
+
 //-----------------------------------------------------------------------------
 /** findRoadSector returns in which sector on the road the position
  *  xyz is. If xyz is not on top of the road, it sets UNKNOWN_SECTOR as sector.
@@ -693,6 +807,35 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
                             ? (unsigned int)all_sectors->size()
                             : (unsigned int)m_all_nodes.size();
     *sector = UNKNOWN_SECTOR;
+
+    if (!all_sectors && !m_grid_offsets.empty())
+    {
+        // Only test the quads of the cell, but return the same quad as
+        // the search through all quads would find first if several quads
+        // contain xyz
+        const float x = (xyz.getX() - m_grid_min_x) / m_grid_cell_size;
+        const float z = (xyz.getZ() - m_grid_min_z) / m_grid_cell_size;
+        // Also false for NAN
+        if (!(x >= 0.0f && x < m_grid_cols && z >= 0.0f && z < m_grid_rows))
+            return;
+        const int n = (int)m_all_nodes.size();
+        const int start = indx + 1;
+        const int cell = (int)z * m_grid_cols + (int)x;
+        int min_order = n;
+        for (int k = m_grid_offsets[cell]; k < m_grid_offsets[cell + 1]; k++)
+        {
+            const int i = m_grid_quads[k];
+            const int order = i >= start ? i - start : i - start + n;
+            if (order < min_order &&
+                getQuad(i)->pointInside(xyz, ignore_vertical))
+            {
+                min_order = order;
+                *sector   = i;
+            }
+        }
+        return;
+    }
+
     for(unsigned int i=0; i<max_count; i++)
     {
         if(all_sectors)
@@ -737,6 +880,9 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
     Probably the best solution would be to construct a quad that reaches
     until the next higher overlapping line segment, and find the closest
     one to XYZ.
+
+    If all_sectors is not given, the grid is used to only test the quads
+    close to XYZ, the result is the same as testing all quads.
  */
 int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
                                std::vector<int> *all_sectors,
@@ -766,6 +912,23 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
         if(current_sector<0) current_sector += getNumNodes();
     }
 
+    if (!all_sectors && !m_grid_offsets.empty() &&
+        std::isfinite(xyz.getX()) && std::isfinite(xyz.getZ()))
+    {
+        int start = current_sector + 1;
+        if (start < 0)
+            start += getNumNodes();
+        for (int phase = 0; phase < 2; phase++)
+        {
+            int sector = findNearestSectorInGrid(xyz, start, phase == 0,
+                ignore_vertical);
+            if (sector != UNKNOWN_SECTOR)
+                return sector;
+        }
+        Log::warn("Graph", "unknown sector found.");
+        return 0;
+    }
+
     int   min_sector = UNKNOWN_SECTOR;
     float min_dist_2 = 999999.0f*999999.0f;
 
@@ -821,6 +984,80 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
     return 0;
 }   // findOutOfRoadSector
 
+//-----------------------------------------------------------------------------
+/** Finds the quad which findOutOfRoadSector would find in one phase, using
+ *  the grid. The cells are searched in growing rings around xyz, till the
+ *  closest quad found is closer than any quad outside of the ring can be.
+ *  \param xyz The position to find the sector of.
+ *  \param start The index of the quad the search through all quads would
+ *         start with, it decides between quads at the same distance.
+ *  \param test_height If the height of xyz is tested for 2d quads.
+ *  \param ignore_vertical Ignore the height of xyz.
+ */
+int Graph::findNearestSectorInGrid(const Vec3& xyz, int start,
+                                   bool test_height,
+                                   bool ignore_vertical) const
+{
+    // A position outside of the grid is moved to the border cells, which
+    // only makes it closer to all quads
+    const float x = (xyz.getX() - m_grid_min_x) / m_grid_cell_size;
+    const float z = (xyz.getZ() - m_grid_min_z) / m_grid_cell_size;
+    const int col = x < 0.0f ? -1 : x >= m_grid_cols ? m_grid_cols : (int)x;
+    const int row = z < 0.0f ? -1 : z >= m_grid_rows ? m_grid_rows : (int)z;
+    const int max_ring = std::max(m_grid_cols, m_grid_rows) + 1;
+
+    const int n = (int)m_all_nodes.size();
+    int   min_sector = UNKNOWN_SECTOR;
+    float min_dist_2 = 999999.0f*999999.0f;
+    int   min_order  = n;
+    for (int ring = 0; ring <= max_ring; ring++)
+    {
+        const int row_first = std::max(row - ring, 0);
+        const int row_last  = std::min(row + ring, m_grid_rows - 1);
+        for (int r = row_first; r <= row_last; r++)
+        {
+            // Only the first and last row of a ring are completely new
+            const bool full_row = r == row - ring || r == row + ring;
+            const int step = full_row ? 1 : 2 * ring;
+            for (int c = col - ring; c <= col + ring; c += step)
+            {
+                if (c < 0 || c >= m_grid_cols)
+                    continue;
+                const int cell = r * m_grid_cols + c;
+                // A quad in several cells is tested several times, which
+                // does not change the result
+                for (int k = m_grid_offsets[cell];
+                     k < m_grid_offsets[cell + 1]; k++)
+                {
+                    const int i = m_grid_quads[k];
+                    const Quad* q = getQuad(i);
+                    if (q->isIgnored())
+                        continue;
+                    const int order = i >= start ? i - start : i - start + n;
+                    float dist_2 = q->getDistance2FromPoint(xyz);
+                    if (dist_2 > min_dist_2 ||
+                        (dist_2 == min_dist_2 && order >= min_order))
+                        continue;
+                    // Same height test as in findOutOfRoadSector
+                    float dist = xyz.getY() - q->getMinHeight();
+                    if (!test_height || (dist < 5.0f && dist > -1.0f) ||
+                        q->is3DQuad() || ignore_vertical)
+                    {
+                        min_dist_2 = dist_2;
+                        min_sector = i;
+                        min_order  = order;
+                    }
+                }   // for k
+            }   // for c
+        }   // for r
+        // Any quad not tested yet is at least this far away
+        const float reach = ring * m_grid_cell_size;
+        if (min_sector != UNKNOWN_SECTOR && min_dist_2 < reach * reach)
+            break;
+    }   // for ring
+    return min_sector;
+}   // findNearestSectorInGrid
+
 //-----------------------------------------------------------------------------
 void Graph::loadBoundingBoxNodes()
 {
@@ -833,3 +1070,75 @@ void Graph::loadBoundingBoxNodes()
     m_bb_nodes[3] = findOutOfRoadSector(Vec3(m_bb_max.x(), 0, m_bb_max.z()),
         -1/*curr_sector*/, NULL/*all_sectors*/, true/*ignore_vertical*/);
 }   // loadBoundingBoxNodes
+
+//-----------------------------------------------------------------------------
+void Graph::unitTesting()
+{
+    class TestGraph : public Graph
+    {
+        virtual bool hasLapLine() const OVERRIDE              { return false; }
+        virtual void differentNodeColor(int n, video::SColor* c) const
+            OVERRIDE {}
+    public:
+        void addQuad(const Vec3& p0, const Vec3& p1, const Vec3& p2,
+                     const Vec3& p3)
+        {
+            createQuad(p0, p1, p2, p3, getNumNodes(), false/*invisible*/,
+                false/*ai_ignore*/, true/*is_arena*/, false/*ignore*/);
+        }
+    };
+
+    uint32_t seed = 12345;
+    auto random = [&seed](float min, float max)
+    {
+        seed = seed * 1103515245 + 12345;
+        return min + (max - min) * (float)((seed >> 8) & 0xffff) / 65535.0f;
+    };
+
+    // Flat quads, some of them on a bridge above the others, and ramps
+    // steep enough to be 3d quads
+    TestGraph graph;
+    for (int i = 0; i < 300; i++)
+    {
+        const float x = random(0.0f, 100.0f);
+        const float z = random(0.0f, 100.0f);
+        const float w = random(1.0f, 8.0f);
+        const float d = random(1.0f, 8.0f);
+        const float y = i % 4 == 0 ? 10.0f : random(0.0f, 0.5f);
+        const float rise = i % 5 == 0 ? d * 1.5f : 0.0f;
+        graph.addQuad(Vec3(x, y, z), Vec3(x + w, y, z),
+            Vec3(x + w, y + rise, z + d), Vec3(x, y + rise, z + d));
+    }
+    graph.buildGrid();
+    assert(!graph.m_grid_offsets.empty());
+
+    std::vector<int> offsets;
+    int error_count = 0;
+    for (int i = 0; i < 2000; i++)
+    {
+        const Vec3 xyz(random(-20.0f, 120.0f), random(-2.0f, 14.0f),
+            random(-20.0f, 120.0f));
+        const int start = (int)random(-1.0f, 299.0f);
+        const bool ignore_vertical = i % 3 == 0;
+        int sector = start;
+        graph.findRoadSector(xyz, &sector, NULL, ignore_vertical);
+        int out_sector = graph.findOutOfRoadSector(xyz, start, NULL,
+            ignore_vertical);
+
+        // Compare with the search through all quads
+        offsets.swap(graph.m_grid_offsets);
+        int expected = start;
+        graph.findRoadSector(xyz, &expected, NULL, ignore_vertical);
+        int expected_out = graph.findOutOfRoadSector(xyz, start, NULL,
+            ignore_vertical);
+        offsets.swap(graph.m_grid_offsets);
+        if (sector != expected || out_sector != expected_out)
+        {
+            Log::error("Graph", "Incorrect sector at %f %f %f: %d %d, "
+                "search through all quads: %d %d", xyz.getX(), xyz.getY(),
+                xyz.getZ(), sector, out_sector, expected, expected_out);
+            error_count++;
+        }
+    }
+    assert(error_count == 0);
+}   // unitTesting
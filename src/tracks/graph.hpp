@@ -66,6 +66,8 @@ protected:
     // ------------------------------------------------------------------------
     /** Map 4 bounding box points to 4 closest graph nodes. */
     void loadBoundingBoxNodes();
+    // ------------------------------------------------------------------------
+    void buildGrid();
 
 private:
     /** The 2d bounding box, used for hashing. */
@@ -75,6 +77,19 @@ private:
     /** The 4 closest graph nodes to the bounding box. */
     int m_bb_nodes[4];
 
+    /** A uniform grid over the x/z area in which each quad can contain a
+     *  point, so the sector searches only test the quads of nearby cells.
+     *  The quads of cell i are m_grid_quads[m_grid_offsets[i]] till
+     *  m_grid_quads[m_grid_offsets[i+1]] (excluded), sorted by index.
+     *  Empty if the grid is not built. */
+    std::vector<int> m_grid_offsets;
+    std::vector<int> m_grid_quads;
+
+    /** Position of the first cell, size and number of cells of the grid. */
+    float m_grid_min_x, m_grid_min_z;
+    float m_grid_cell_size;
+    int m_grid_cols, m_grid_rows;
+
     /** The node of the graph mesh. */
     scene::ISceneNode *m_node;
 
@@ -103,6 +118,9 @@ private:
     // ------------------------------------------------------------------------
     void cleanupDebugMesh();
     // ------------------------------------------------------------------------
+    int findNearestSectorInGrid(const Vec3& xyz, int start, bool test_height,
+                                bool ignore_vertical) const;
+    // ------------------------------------------------------------------------
     virtual bool hasLapLine() const = 0;
     // ------------------------------------------------------------------------
     virtual void differentNodeColor(int n, video::SColor* c) const = 0;
@@ -172,6 +190,8 @@ public:
     const Vec3& getBBMax() const                           { return m_bb_max; }
     // ------------------------------------------------------------------------
     const int* getBBNodes() const                        { return m_bb_nodes; }
+    // ------------------------------------------------------------------------
+    static void unitTesting();
 
 };   // Graph
 
@@ -922,13 +922,24 @@ void Track::createPhysicsModel(unsigned int main_track_count,
         uploadNodeVertexBuffer(m_all_nodes[i]);
     }
     main_loop->renderGUI(5580);
+    // The static track meshes are the same in each load, so their BVH is
+    // cached on disk
     if (for_height_map)
-        m_track_mesh->createCollisionShape();
+    {
+        m_track_mesh->createCollisionShape(/*create_collision_object*/true,
+                                           /*use_bvh_cache*/true);
+    }
     else
-        m_track_mesh->createPhysicalBody(m_friction);
+    {
+        m_track_mesh->createPhysicalBody(m_friction,
+            (btCollisionObject::CollisionFlags)0, /*use_bvh_cache*/true);
+    }
     main_loop->renderGUI(5585);
     if (m_gfx_effect_mesh)
-        m_gfx_effect_mesh->createCollisionShape();
+    {
+        m_gfx_effect_mesh->createCollisionShape(
+            /*create_collision_object*/true, /*use_bvh_cache*/true);
+    }
     main_loop->renderGUI(5590);
 
 }   // createPhysicsModel
@@ -1540,7 +1551,8 @@ bool Track::loadMainTrack(const XMLNode &root)
         Log::fatal("track", "m_track_mesh == NULL, cannot loadMainTrack\n");
     }
 
-    m_gfx_effect_mesh->createCollisionShape();
+    m_gfx_effect_mesh->createCollisionShape(/*create_collision_object*/true,
+                                            /*use_bvh_cache*/true);
     scene_node->setMaterialFlag(video::EMF_LIGHTING, true);
     scene_node->setMaterialFlag(video::EMF_GOURAUD_SHADING, true);
     main_loop->renderGUI(4500);
@@ -3013,8 +3025,10 @@ void Track::initChildTrack()
 
     // We call physics init in child process too
     Physics::get()->init(m_aabb_min, m_aabb_max);
-    m_track_mesh->createPhysicalBody(m_friction);
-    m_gfx_effect_mesh->createCollisionShape();
+    m_track_mesh->createPhysicalBody(m_friction,
+        (btCollisionObject::CollisionFlags)0, /*use_bvh_cache*/true);
+    m_gfx_effect_mesh->createCollisionShape(/*create_collision_object*/true,
+                                            /*use_bvh_cache*/true);
 
     // All child track objects are only cloned if they have physical objects
     for (auto* to : m_track_object_manager->getObjects().m_contents_vector)
@@ -544,6 +544,19 @@ void TrackObject::update(float dt)
     if (m_animator) m_animator->updateWithWorldTicks(true/*has_physics*/);
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Update during a rewind, only the physical object and an animation moving
+ *  it need to be simulated again.
+ *  \param dt Timestep.
+ */
+void TrackObject::updateForRewind(float dt)
+{
+    if (!m_physical_object)
+        return;
+    m_physical_object->update(dt);
+    if (m_animator) m_animator->updateWithWorldTicks(true/*has_physics*/);
+}   // updateForRewind
+
 
 // ----------------------------------------------------------------------------
 /** This reset all physical object moved by 3d animation back to current ticks
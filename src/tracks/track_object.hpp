@@ -127,6 +127,7 @@ public:
                              const PhysicalObject::Settings* physicsSettings);
     virtual      ~TrackObject();
     virtual void update(float dt);
+    void updateForRewind(float dt);
     virtual void updateGraphics(float dt);
     virtual void resetAfterRewind();
     void move(const core::vector3df& xyz, const core::vector3df& hpr,
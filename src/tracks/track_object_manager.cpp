@@ -195,6 +195,21 @@ void TrackObjectManager::update(float dt)
     }
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Updates only the track objects which affect the physics, used for each
+ *  time step replayed in a rewind. Graphical objects were already updated
+ *  when these time steps were simulated the first time.
+ *  \param dt Time step size.
+ */
+void TrackObjectManager::updateForRewind(float dt)
+{
+    TrackObject* curr;
+    for_in (curr, m_all_objects)
+    {
+        curr->updateForRewind(dt);
+    }
+}   // updateForRewind
+
 // ----------------------------------------------------------------------------
 void TrackObjectManager::resetAfterRewind()
 {
@@ -19,9 +19,17 @@
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 
+#include <atomic>
+#include <functional>
 #include <stdio.h>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
+#if defined(WIN32)
+#  include <process.h>
+#else
+#  include <unistd.h>
+#endif
 
 // ----------------------------------------------------------------------------
 #if defined(WIN32)
@@ -166,3 +174,24 @@ int FileUtils::renameU8Path(const std::string& u8_path_old,
     return rename(u8_path_old.c_str(), u8_path_new.c_str());
 #endif
 }   // renameU8Path
+
+// ----------------------------------------------------------------------------
+/** Returns the name of a temporary file next to u8_path, which is written
+ *  and then renamed to u8_path. The name contains the process id, the thread
+ *  id and a counter, so several processes (or the client and the server
+ *  running in one process) writing the same file never share the temporary
+ *  file.
+ */
+std::string FileUtils::getUniqueTempPath(const std::string& u8_path)
+{
+    static std::atomic<unsigned> counter(0);
+#if defined(WIN32)
+    const int pid = _getpid();
+#else
+    const int pid = getpid();
+#endif
+    const size_t thread_id =
+        std::hash<std::thread::id>()(std::this_thread::get_id());
+    return StringUtils::insertValues("%s.%d-%d-%d.tmp", u8_path.c_str(), pid,
+        (unsigned)thread_id, counter.fetch_add(1));
+}   // getUniqueTempPath
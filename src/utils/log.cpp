@@ -21,11 +21,18 @@
 #include "config/user_config.hpp"
 #include "network/network_config.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/tls.hpp"
+#include "utils/vs.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <ctime>
+#include <mutex>
 #include <stdio.h>
+#include <thread>
 
 #ifdef ANDROID
 #  include <android/log.h>
@@ -45,9 +52,162 @@ bool          Log::m_no_colors     = false;
 FILE*         Log::m_file_stdout   = NULL;
 size_t        Log::m_buffer_size = 1;
 bool          Log::m_console_log = true;
-Synchronised<std::vector<struct Log::LineInfo> > Log::m_line_buffer;
 thread_local  char g_prefix[11] = {};
 
+// ============================================================================
+/** A bounded multi-producer single-consumer ring of preformatted log lines
+ *  (based on Dmitry Vyukov's bounded queue). Producers claim a slot with a
+ *  CAS on the enqueue position, the sequence number of each slot tells if
+ *  it is free or ready to be written out. The consumer side is serialised
+ *  by g_write_mutex, so either the logger thread or a thread flushing the
+ *  log writes the lines.
+ */
+class LogQueue
+{
+public:
+    /** Number of slots, must be a power of 2. */
+    static const size_t SIZE = 2048;
+
+    /** One preformatted line. */
+    struct Record
+    {
+        std::atomic<size_t> m_sequence;
+        int                 m_level;
+        /** Where the server time stamp is inserted, or -1. */
+        int                 m_time_position;
+        /** Time the message was created. Converting it to a string
+         *  is left to the logger thread. */
+        std::chrono::steady_clock::time_point m_time;
+        /** The text of the line. Its capacity is kept when the slot is
+         *  reused, so queuing usually does not allocate. */
+        std::string         m_line;
+    };   // Record
+
+private:
+    Record              m_records[SIZE];
+    std::atomic<size_t> m_enqueue_position;
+    std::atomic<size_t> m_dequeue_position;
+
+public:
+    /** Only used by the consumer: the last server time stamp, which only
+     *  needs to be recreated once per second, and a buffer to insert the
+     *  time stamp into a line. */
+    StkTime::TimeType   m_last_time;
+    std::string         m_time_string;
+    std::string         m_write_buffer;
+
+    LogQueue()
+    {
+        for (size_t i = 0; i < SIZE; i++)
+            m_records[i].m_sequence.store(i, std::memory_order_relaxed);
+        m_enqueue_position.store(0);
+        m_dequeue_position.store(0);
+        m_last_time = 0;
+    }   // LogQueue
+    // ------------------------------------------------------------------------
+    /** Adds a line to the queue (thread-safe, lock-free).
+     *  \return False if the queue is full. */
+    bool push(int level, int time_position,
+              std::chrono::steady_clock::time_point time,
+              const char *line, size_t length)
+    {
+        size_t pos = m_enqueue_position.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Record &r = m_records[pos & (SIZE - 1)];
+            const size_t seq = r.m_sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (m_enqueue_position.compare_exchange_weak(pos, pos + 1))
+                {
+                    r.m_level         = level;
+                    r.m_time_position = time_position;
+                    r.m_time          = time;
+                    r.m_line.assign(line, length);
+                    r.m_sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = m_enqueue_position.load(std::memory_order_relaxed);
+        }
+    }   // push
+    // ------------------------------------------------------------------------
+    /** Returns the oldest line, or NULL if there is none. Only to be called
+     *  by the consumer. */
+    const Record* front() const
+    {
+        const size_t pos = m_dequeue_position.load(std::memory_order_relaxed);
+        const Record &r = m_records[pos & (SIZE - 1)];
+        if (r.m_sequence.load(std::memory_order_acquire) != pos + 1)
+            return NULL;
+        return &r;
+    }   // front
+    // ------------------------------------------------------------------------
+    /** Frees the slot of the oldest line. Only to be called by the
+     *  consumer after front() returned a line. */
+    void pop()
+    {
+        const size_t pos = m_dequeue_position.load(std::memory_order_relaxed);
+        m_records[pos & (SIZE - 1)].m_sequence
+            .store(pos + SIZE, std::memory_order_release);
+        m_dequeue_position.store(pos + 1);
+    }   // pop
+    // ------------------------------------------------------------------------
+    /** Returns the number of claimed slots (including lines which are still
+     *  being written by a producer). */
+    size_t getNumQueued() const
+    {
+        return m_enqueue_position.load() - m_dequeue_position.load();
+    }   // getNumQueued
+};   // LogQueue
+
+// ----------------------------------------------------------------------------
+/** The queue is allocated on first use and never freed, so logging works
+ *  during static initialisation and destruction. */
+static LogQueue* getLogQueue()
+{
+    static LogQueue *queue = new LogQueue();
+    return queue;
+}   // getLogQueue
+
+/** Serialises writing the queued lines. */
+static std::mutex               g_write_mutex;
+/** Used to wake up a sleeping logger thread. */
+static std::mutex               g_sleep_mutex;
+static std::condition_variable  g_logger_cv;
+static std::atomic_bool         g_logger_sleeping(false);
+static std::atomic_bool         g_logger_running(false);
+static bool                     g_logger_quit = false;
+static std::thread             *g_logger_thread = NULL;
+/** Number of lines below LL_ERROR dropped because the queue was full. */
+static std::atomic<uint64_t>    g_dropped_lines(0);
+/** Number of lines which had to wait for a free slot in the queue. */
+static std::atomic<uint64_t>    g_delayed_lines(0);
+
+// ----------------------------------------------------------------------------
+static void wakeLoggerThread()
+{
+    if (g_logger_sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(g_sleep_mutex);
+        g_logger_cv.notify_one();
+    }
+}   // wakeLoggerThread
+
+// ----------------------------------------------------------------------------
+/** Stops the logger thread (which writes all queued lines) when the
+ *  program exits without doing so, e.g. by calling exit(). Otherwise the
+ *  thread could still use the synchronisation objects while they are
+ *  destroyed. */
+static void stopLoggerAtExit()
+{
+    Log::stopLoggerThread();
+}   // stopLoggerAtExit
+
 // ----------------------------------------------------------------------------
 void Log::setPrefix(const char* prefix)
 {
@@ -144,10 +304,12 @@ void Log::resetTerminalColor()
 }   // resetTerminalColor
 
 // ----------------------------------------------------------------------------
-/** This actually creates a log message. If the messages are to be buffered,
- *  it will be appended to the output buffer. If the buffer is full, it will
- *  be flushed. If the message is not to be buffered, it will be immediately
- *  written using writeLine().
+/** This actually creates a log message. The formatted line is added to the
+ *  queue of the logger thread, which writes it using writeLine(). If the
+ *  logger thread is not running, the line is written immediately. Fatal
+ *  messages are always written before this function returns.
+ *  If the queue is full, messages below LL_ERROR are dropped (and counted),
+ *  more important ones wait until the logger thread has made space.
 
  *  \param level Log level of the message to print.
  *  \param format A printf-like format string.
@@ -173,18 +335,21 @@ void Log::printMessage(int level, const char *component, const char *format,
         remaining = MAX_LENGTH - index > 0 ? MAX_LENGTH - index : 0;
     }
 
-#ifdef MOBILE_STK
-    // Mobile STK already has timestamp logging in console
-    std::string server_prefix = "Server";
-#else
-    std::string server_prefix = StkTime::getLogTime();
-#endif
+    // Position at which the server time stamp is inserted. It is
+    // converted to a string by the logger thread.
+    int time_position = -1;
     if (NetworkConfig::get()->isNetworking() &&
         NetworkConfig::get()->isServer())
     {
+#ifdef MOBILE_STK
+        // Mobile STK already has timestamp logging in console
+        index += snprintf (line + index, remaining,
+            "Server [%s] %s: ", names[level], component);
+#else
+        time_position = index < MAX_LENGTH ? index : MAX_LENGTH;
         index += snprintf (line + index, remaining,
-            "%s [%s] %s: ", server_prefix.c_str(),
-            names[level], component);
+            " [%s] %s: ", names[level], component);
+#endif
     }
     else
     {
@@ -199,35 +364,154 @@ void Log::printMessage(int level, const char *component, const char *format,
     index = index > MAX_LENGTH - 1 ? MAX_LENGTH - 1 : index;
     sprintf(line + index, "\n");
 
-    // If the data is not buffered, immediately print it:
-    if (m_buffer_size <= 1)
+    LogQueue *queue = getLogQueue();
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    bool delayed = false;
+    while (!queue->push(level, time_position, now, line, index + 1))
     {
-        writeLine(line, level);
-        return;
+        if (!g_logger_running.load())
+        {
+            // Another thread filled the queue, write it out here
+            writeQueuedLines();
+            continue;
+        }
+        if (level < LL_ERROR)
+        {
+            g_dropped_lines.fetch_add(1);
+            wakeLoggerThread();
+            return;
+        }
+        if (!delayed)
+        {
+            delayed = true;
+            g_delayed_lines.fetch_add(1);
+        }
+        wakeLoggerThread();
+        std::this_thread::yield();
     }
 
-    // Now the data needs to be buffered. Add an entry to the buffer,
-    // and if necessary flush the buffers.
-    struct LineInfo li;
-    li.m_level = level;
-    li.m_line  = std::string(line);
-    m_line_buffer.lock();
-    m_line_buffer.getData().push_back(li);
-    if (m_line_buffer.getData().size() < m_buffer_size)
+    if (level >= LL_FATAL || !g_logger_running.load())
     {
-        // Buffer not yet full, don't flush data.
-        m_line_buffer.unlock();
+        writeQueuedLines();
         return;
     }
-    m_line_buffer.unlock();
-    // Because of the unlock above it can happen that another thread adds
-    // another line and calls flushBuffers() first before this thread can
-    // call it, but that doesn't really matter, when this thread will finally
-    // call flushBuffer() it will then just print nothing if another thread
-    // had been actively flushing it in between.
-    flushBuffers();
+    if (queue->getNumQueued() >= m_buffer_size)
+        wakeLoggerThread();
 }   // printMessage
 
+// ----------------------------------------------------------------------------
+/** Writes all queued lines, inserting the server time stamps. This is done
+ *  by the logger thread, or by the calling thread if there is no logger
+ *  thread or the log is flushed.
+ */
+void Log::writeQueuedLines()
+{
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+
+    // Map the monotonic time of the lines to the wall clock
+    const std::chrono::steady_clock::time_point mono_now =
+        std::chrono::steady_clock::now();
+    const std::chrono::system_clock::time_point wall_now =
+        std::chrono::system_clock::now();
+
+    LogQueue *queue = getLogQueue();
+    while (const LogQueue::Record *r = queue->front())
+    {
+        if (r->m_time_position < 0)
+        {
+            writeLine(r->m_line.c_str(), r->m_level);
+            queue->pop();
+            continue;
+        }
+        const StkTime::TimeType t = std::chrono::system_clock::to_time_t(
+            wall_now - std::chrono::duration_cast
+            <std::chrono::system_clock::duration>(mono_now - r->m_time));
+        if (t != queue->m_last_time || queue->m_time_string.empty())
+        {
+            queue->m_time_string = StkTime::getLogTime(t);
+            queue->m_last_time = t;
+        }
+        std::string &buffer = queue->m_write_buffer;
+        buffer.assign(r->m_line, 0, r->m_time_position);
+        buffer += queue->m_time_string;
+        buffer.append(r->m_line, r->m_time_position, std::string::npos);
+        writeLine(buffer.c_str(), r->m_level);
+        queue->pop();
+    }
+
+    const uint64_t dropped = g_dropped_lines.exchange(0);
+    const uint64_t delayed = g_delayed_lines.exchange(0);
+    if (dropped > 0 || delayed > 0)
+    {
+        char line[256];
+        snprintf(line, 256, "[warn   ] Log: The log queue was full, %lu "
+                 "messages were dropped and %lu delayed.\n",
+                 (unsigned long)dropped, (unsigned long)delayed);
+        writeLine(line, LL_WARN);
+    }
+}   // writeQueuedLines
+
+// ----------------------------------------------------------------------------
+/** The logger thread. It sleeps until enough lines are queued (see
+ *  setBufferSize()) or at most one second, and then writes them.
+ */
+void Log::loggerThread()
+{
+    VS::setThreadName("Logger");
+    while (true)
+    {
+        writeQueuedLines();
+        std::unique_lock<std::mutex> ul(g_sleep_mutex);
+        if (g_logger_quit)
+            break;
+        g_logger_sleeping.store(true);
+        const size_t wait_size = m_buffer_size > 1 ? m_buffer_size : 1;
+        if (getLogQueue()->getNumQueued() < wait_size)
+            g_logger_cv.wait_for(ul, std::chrono::seconds(1));
+        g_logger_sleeping.store(false);
+    }
+}   // loggerThread
+
+// ----------------------------------------------------------------------------
+/** Starts the thread which writes all log messages, so that a slow terminal
+ *  or log file does not slow down the threads that log.
+ */
+void Log::startLoggerThread()
+{
+    if (g_logger_thread)
+        return;
+    static bool at_exit_registered = false;
+    if (!at_exit_registered)
+    {
+        atexit(stopLoggerAtExit);
+        at_exit_registered = true;
+    }
+    g_logger_quit = false;
+    g_logger_thread = new std::thread(&Log::loggerThread);
+    g_logger_running.store(true);
+}   // startLoggerThread
+
+// ----------------------------------------------------------------------------
+/** Stops the logger thread after writing all queued lines. Messages logged
+ *  afterwards are written immediately.
+ */
+void Log::stopLoggerThread()
+{
+    if (!g_logger_thread)
+        return;
+    g_logger_running.store(false);
+    {
+        std::lock_guard<std::mutex> lock(g_sleep_mutex);
+        g_logger_quit = true;
+        g_logger_cv.notify_one();
+    }
+    g_logger_thread->join();
+    delete g_logger_thread;
+    g_logger_thread = NULL;
+    writeQueuedLines();
+}   // stopLoggerThread
+
 // ----------------------------------------------------------------------------
 /** Writes the specified line to the various output devices, e.g. terminal,
  *  log file etc. If log messages are not redirected to a file, it tries to
@@ -295,18 +579,12 @@ void Log::toggleConsoleLog(bool val)
 }   // toggleConsoleLog
 
 // ----------------------------------------------------------------------------
-/** Flushes all stored log messages to the various output devices (thread safe).
+/** Writes all queued log messages to the various output devices before
+ *  returning (thread safe).
  */
 void Log::flushBuffers()
 {
-    m_line_buffer.lock();
-    for (unsigned int i = 0; i < m_line_buffer.getData().size(); i++)
-    {
-        const LineInfo &li = m_line_buffer.getData()[i];
-        writeLine(li.m_line.c_str(), li.m_level);
-    }
-    m_line_buffer.getData().clear();
-    m_line_buffer.unlock();
+    writeQueuedLines();
 }   // flushBuffers
 
 // ----------------------------------------------------------------------------
@@ -316,23 +594,32 @@ void Log::flushBuffers()
  */
 void Log::openOutputFiles(const std::string &logout)
 {
-    m_file_stdout = FileUtils::fopenU8Path(logout, "w");
-    if (!m_file_stdout)
+    FILE* file = FileUtils::fopenU8Path(logout, "w");
+    if (!file)
     {
         Log::error("main", "Can not open log file '%s'. Writing to "
                            "stdout instead.", logout.c_str());
+        return;
     }
-    else
-    {
-        // Disable buffering so that messages are seen asap
-        setvbuf(m_file_stdout, NULL, _IONBF, 0);
-    }
-} // closeOutputFiles
+    // Disable buffering so that messages are seen asap
+    setvbuf(file, NULL, _IONBF, 0);
+
+    // The logger thread might already be running, so the lines queued so
+    // far are written to the old output, and the file is only set while
+    // no line is written
+    writeQueuedLines();
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    m_file_stdout = file;
+} // openOutputFiles
 
 // ----------------------------------------------------------------------------
 /** Function to close output files */
 void Log::closeOutputFiles()
 {
-    fclose(m_file_stdout);
+    writeQueuedLines();
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    if (m_file_stdout)
+        fclose(m_file_stdout);
+    m_file_stdout = NULL;
 } // closeOutputFiles
 
@@ -66,21 +66,15 @@ private:
     /** The file where stdout output will be written */
     static FILE* m_file_stdout;
 
-    /** An optional buffer for lines to be output. */
-    struct LineInfo
-    {
-        std::string m_line;
-        int m_level;
-    };
-    static Synchronised<std::vector<struct LineInfo> > m_line_buffer;
-
     /** <0 if no buffered logging is to be used, otherwise this is
-     ** the maximum number of lines the buffer should hold. */
+     ** the number of lines the logger thread collects before writing. */
     static size_t m_buffer_size;
 
     static void setTerminalColor(LogLevel level);
     static void resetTerminalColor();
     static void writeLine(const char *line, int level);
+    static void writeQueuedLines();
+    static void loggerThread();
 
     static void printMessage(int level, const char *component,
                              const char *format, VALIST va_list);
@@ -118,6 +112,8 @@ public:
     static void closeOutputFiles();
     static void flushBuffers();
     static void toggleConsoleLog(bool val);
+    static void startLoggerThread();
+    static void stopLoggerThread();
 
     // ------------------------------------------------------------------------
     /** Sets the number of lines to buffer. Setting the buffer size to a 
@@ -36,6 +36,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <iomanip>
 #include <ostream>
 #include <stack>
 #include <sstream>
@@ -72,12 +73,12 @@ Profiler profiler;
     }   // getTimeMilliseconds
 
 #else
-    #include <sys/time.h>
+    #include <chrono>
     double getTimeMilliseconds()
     {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        return double(tv.tv_sec * 1000) + (double(tv.tv_usec) / 1000.0);
+        // Use a monotonic clock, the events of all threads are ordered by it
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
     }   // getTimeMilliseconds
 #endif
 // --- End portable precise timer ---
@@ -85,6 +86,7 @@ Profiler profiler;
 //-----------------------------------------------------------------------------
 Profiler::Profiler()
 {
+    m_all_threads_data    = NULL;
     m_time_last_sync      = getTimeMilliseconds();
     m_time_between_sync   = 0.0;
     m_freeze_state        = UNFROZEN;
@@ -96,23 +98,45 @@ Profiler::Profiler()
     m_current_frame       = 0;
     m_has_wrapped_around  = false;
     m_drawing             = true;
-    m_threads_used = 1;
+    m_threads_used        = 1;
+    m_session             = 0;
+    m_dropped_events      = 0;
+    m_next_trace_event    = 0;
+    m_trace_start_time    = m_time_last_sync;
 }   // Profiler
 
 //-----------------------------------------------------------------------------
 Profiler::~Profiler()
 {
+    delete [] m_all_threads_data;
 }   // ~Profiler
 
+/** Id of the calling thread in the profiler, -1 if it has not been assigned
+ *  yet, -2 if there are too many threads and this one is not profiled. */
 thread_local int g_thread_id = -1;
-const int MAX_THREADS = 10;
+
+/** Number of events this thread has started and recorded, but not ended. */
+thread_local unsigned int g_open_events = 0;
+
+/** Number of events this thread has started, but which could not be recorded
+ *  (including all events nested in them). */
+thread_local unsigned int g_skipped_events = 0;
+
+/** The profiler session for which the two counters above are valid. */
+thread_local int g_session = -1;
+
 //-----------------------------------------------------------------------------
 /** It is split from the constructor so that it can be avoided allocating
  *  unnecessary memory when the profiler is never used (for example in no
  *  graphics). */
 void Profiler::init()
 {
-    m_all_threads_data.resize(MAX_THREADS);
+    if (m_all_threads_data)
+        return;
+
+    m_all_threads_data = new ThreadData[MAX_THREADS];
+    for (int i = 0; i < MAX_THREADS; i++)
+        m_all_threads_data[i].m_event_buffer.init(EVENT_BUFFER_SIZE);
 
     // Add this thread to the thread mapping
     g_thread_id = 0;
@@ -127,14 +151,17 @@ void Profiler::reset()
     for (int i = 0; i < m_threads_used; i++)
     {
         ThreadData &td = m_all_threads_data[i];
+        td.m_event_buffer.clear();
         td.m_all_event_data.clear();
         td.m_event_stack.clear();
         td.m_ordered_headings.clear();
     }   // for i in threads
 
-    m_all_threads_data.clear();
-    m_gpu_times.clear();
-    m_all_event_names.clear();
+    std::fill(m_gpu_times.begin(), m_gpu_times.end(), 0);
+    m_trace_events.clear();
+    m_next_trace_event    = 0;
+    m_trace_start_time    = getTimeMilliseconds();
+    m_dropped_events      = 0;
     m_current_frame       = 0;
     m_has_wrapped_around  = false;
     m_freeze_state        = UNFROZEN;
@@ -142,55 +169,100 @@ void Profiler::reset()
 
 //-----------------------------------------------------------------------------
 /** Returns a unique index for a thread. If the calling thread is not yet in
- *  the mapping, it will assign a new unique id to this thread. */
+ *  the mapping, it will assign a new unique id to this thread. Returns a
+ *  negative value if there are already MAX_THREADS threads. */
 int Profiler::getThreadID()
 {
     if (g_thread_id == -1)
     {
-        if (m_threads_used >= MAX_THREADS)
+        int id = m_threads_used.load();
+        do
         {
-            g_thread_id = MAX_THREADS - 1;
-            return g_thread_id;
-        }
-        g_thread_id = m_threads_used.fetch_add(1);
+            if (id >= MAX_THREADS)
+            {
+                g_thread_id = -2;
+                return g_thread_id;
+            }
+        } while (!m_threads_used.compare_exchange_weak(id, id + 1));
+        g_thread_id = id;
     }
     return g_thread_id;
 }   // getThreadID
 
+//-----------------------------------------------------------------------------
+/** Returns the id of an event name, adding the name if it is not known yet.
+ *  The colour of an event is the one used when the name is first added.
+ *  \param name Name of the event.
+ *  \param colour Colour for the on-screen display of this event.
+ */
+int Profiler::getNameID(const char* name, const video::SColor& colour)
+{
+    std::lock_guard<std::mutex> lock(m_names_mutex);
+    std::map<std::string, int>::iterator i = m_name_ids.find(name);
+    if (i != m_name_ids.end())
+        return i->second;
+
+    int id = (int)m_all_names.size();
+    m_all_names.push_back(name);
+    m_all_colours.push_back(colour);
+    m_name_ids[name] = id;
+    return id;
+}   // getNameID
+
+//-----------------------------------------------------------------------------
+/** Returns the name for a name id. */
+std::string Profiler::getName(int name_id) const
+{
+    std::lock_guard<std::mutex> lock(m_names_mutex);
+    return m_all_names[name_id];
+}   // getName
+
 //-----------------------------------------------------------------------------
 /// Push a new marker that starts now
-void Profiler::pushCPUMarker(const char* name, const video::SColor& colour)
+void Profiler::pushCPUMarker(int name_id)
 {
     // Don't do anything when disabled or frozen
     if (!UserConfigParams::m_profiler_enabled ||
          m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE )
         return;
 
-    // We need to look before getting the thread id (since this might
-    // be a new thread which changes the structure).
-    m_lock.lock();
     int thread_id = getThreadID();
+    if (thread_id < 0 || !m_all_threads_data)
+        return;
 
-    ThreadData &td = m_all_threads_data[thread_id];
-    AllEventData::iterator i = td.m_all_event_data.find(name);
-    double  start = getTimeMilliseconds() - m_time_last_sync;
-    if (i != td.m_all_event_data.end())
+    if (g_session != m_session.load(std::memory_order_relaxed))
     {
-        i->second.setStart(m_current_frame, start, (int)td.m_event_stack.size());
+        g_session        = m_session.load(std::memory_order_relaxed);
+        g_open_events    = 0;
+        g_skipped_events = 0;
     }
-    else
-    {
-        EventData ed(colour, m_max_frames);
-        ed.setStart(m_current_frame, start, (int)td.m_event_stack.size());
-        td.m_all_event_data[name] = ed;
-        // Ordered headings is used to determine the order in which the
-        // bar graph is drawn. Outer profiling events will be added first,
-        // so they will be drawn first, which gives the proper nested
-        // displayed of events.
-        td.m_ordered_headings.push_back(name);
+
+    // If an event can not be recorded, all events nested in it are skipped
+    // too, so that the end events still match the right start events.
+    // Space for the end of this and all other open events is reserved.
+    RecordedEvent event;
+    event.m_time     = getTimeMilliseconds();
+    event.m_name_id  = name_id;
+    event.m_is_start = true;
+    if (g_skipped_events > 0 ||
+        !m_all_threads_data[thread_id].m_event_buffer.add(event,
+                                                          g_open_events + 1))
+    {
+        g_skipped_events++;
+        m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
-    td.m_event_stack.push_back(name);
-    m_lock.unlock();
+    g_open_events++;
+}   // pushCPUMarker
+
+//-----------------------------------------------------------------------------
+/** Push a new marker with a name that is not static (and so is looked up
+ *  each time). */
+void Profiler::pushCPUMarker(const char* name, const video::SColor& colour)
+{
+    if (!UserConfigParams::m_profiler_enabled)
+        return;
+    pushCPUMarker(getNameID(name, colour));
 }   // pushCPUMarker
 
 //-----------------------------------------------------------------------------
@@ -203,26 +275,28 @@ void Profiler::popCPUMarker()
         return;
     double now = getTimeMilliseconds();
 
-    m_lock.lock();
-    int thread_id = getThreadID();
-    ThreadData &td = m_all_threads_data[thread_id];
-
     // When the profiler gets enabled (which happens in the middle of the
     // main loop), there can be some pops without matching pushes (for one
     // frame) - ignore those events.
-    if (td.m_event_stack.size() == 0)
+    if (g_thread_id < 0 ||
+        g_session != m_session.load(std::memory_order_relaxed))
+        return;
+
+    if (g_skipped_events > 0)
     {
-        m_lock.unlock();
+        g_skipped_events--;
         return;
     }
+    if (g_open_events == 0)
+        return;
 
-    assert(td.m_event_stack.size() > 0);
-
-    const std::string &name = td.m_event_stack.back();
-    td.m_all_event_data[name].setEnd(m_current_frame, now - m_time_last_sync);
-
-    td.m_event_stack.pop_back();
-    m_lock.unlock();
+    RecordedEvent event;
+    event.m_time     = now;
+    event.m_name_id  = -1;
+    event.m_is_start = false;
+    // The space for this event was reserved when the event was started
+    m_all_threads_data[g_thread_id].m_event_buffer.add(event, 0);
+    g_open_events--;
 }   // popCPUMarker
 
 //-----------------------------------------------------------------------------
@@ -233,7 +307,11 @@ void Profiler::activate()
     // If the profiler is not already turned on, reset to avoid data
     // from multiple profiling sessions from merging in one report
     if (!UserConfigParams::m_profiler_enabled)
+    {
+        init();
         reset();
+        m_session.fetch_add(1);
+    }
 
     UserConfigParams::m_profiler_enabled = true;
 
@@ -255,6 +333,94 @@ void Profiler::desactivate()
     computeStableFPS();
 }   // desactivate
 
+//-----------------------------------------------------------------------------
+/** Moves all events the threads recorded till 'now' into the current frame.
+ *  Any events that are then still active (e.g. in a separate thread) will be
+ *  split in two parts: the beginning (till now) in the current frame, the
+ *  rest will be added to the next frame. Only called from the main thread.
+ *  \param now The time of the frame synchronisation.
+ *  \param next_frame Index of the next frame.
+ */
+void Profiler::processEvents(double now, int next_frame)
+{
+    for (int i = 0; i < m_threads_used; i++)
+    {
+        ThreadData &td = m_all_threads_data[i];
+        const RecordedEvent *event;
+        while ((event = td.m_event_buffer.front()) != NULL)
+        {
+            // An event recorded after the synchronisation belongs to the
+            // next frame.
+            if (event->m_time > now)
+                break;
+
+            if (event->m_is_start)
+            {
+                const int id = event->m_name_id;
+                if (id >= (int)td.m_all_event_data.size())
+                    td.m_all_event_data.resize(id + 1);
+                EventData &ed = td.m_all_event_data[id];
+                if (!ed.isUsed())
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(m_names_mutex);
+                        ed = EventData(m_all_colours[id], m_max_frames);
+                    }
+                    // Ordered headings is used to determine the order in
+                    // which the bar graph is drawn. Outer profiling events
+                    // will be added first, so they will be drawn first,
+                    // which gives the proper nested displayed of events.
+                    td.m_ordered_headings.push_back(id);
+                }
+                ed.setStart(m_current_frame, event->m_time - m_time_last_sync,
+                            (int)td.m_event_stack.size());
+                OpenEvent open_event;
+                open_event.m_name_id = id;
+                open_event.m_start   = event->m_time;
+                td.m_event_stack.push_back(open_event);
+            }
+            else if (!td.m_event_stack.empty())
+            {
+                const OpenEvent &open_event = td.m_event_stack.back();
+                td.m_all_event_data[open_event.m_name_id]
+                    .setEnd(m_current_frame, event->m_time - m_time_last_sync);
+                addTraceEvent(open_event.m_name_id, i, open_event.m_start,
+                              event->m_time);
+                td.m_event_stack.pop_back();
+            }
+            td.m_event_buffer.pop();
+        }   // while event
+
+        for (unsigned int j = 0; j < td.m_event_stack.size(); j++)
+        {
+            EventData &ed = td.m_all_event_data[td.m_event_stack[j].m_name_id];
+            ed.setEnd(m_current_frame, now - m_time_last_sync);
+            ed.setStart(next_frame, 0, j);
+        }   // for j in event stack
+    }   // for i in threads
+}   // processEvents
+
+//-----------------------------------------------------------------------------
+/** Stores a complete event for the Chrome trace export. If the buffer is
+ *  full, the oldest event is overwritten.
+ */
+void Profiler::addTraceEvent(int name_id, int thread_id, double start,
+                             double end)
+{
+    TraceEvent trace_event;
+    trace_event.m_name_id   = name_id;
+    trace_event.m_thread_id = thread_id;
+    trace_event.m_start     = start - m_trace_start_time;
+    trace_event.m_duration  = end - start;
+    if ((int)m_trace_events.size() < MAX_TRACE_EVENTS)
+    {
+        m_trace_events.push_back(trace_event);
+        return;
+    }
+    m_trace_events[m_next_trace_event] = trace_event;
+    m_next_trace_event = (m_next_trace_event + 1) % MAX_TRACE_EVENTS;
+}   // addTraceEvent
+
 //-----------------------------------------------------------------------------
 /** Saves all data for the current frame, and starts the next frame in the
  *  circular buffer. Any events that are currently active (e.g. in a separate
@@ -271,7 +437,6 @@ void Profiler::synchronizeFrame()
     // which would yield different results
     double now = getTimeMilliseconds();
 
-    m_lock.lock();
     // Set index to next frame
     int next_frame = m_current_frame+1;
     if (next_frame >= m_max_frames)
@@ -280,20 +445,12 @@ void Profiler::synchronizeFrame()
         m_has_wrapped_around = true;
     }
 
-    // First finish all markers that are currently in progress, and add
-    // a new start marker for the next frame. So e.g. if a thread is busy in
-    // one event while the main thread syncs the frame, this event will get
-    // split into two parts in two consecutive frames
-    for (int i = 0; i < m_threads_used; i++)
-    {
-        ThreadData &td = m_all_threads_data[i];
-        for(unsigned int j=0; j<td.m_event_stack.size(); j++)
-        {
-            EventData &ed = td.m_all_event_data[td.m_event_stack[j]];
-            ed.setEnd(m_current_frame, now-m_time_last_sync);
-            ed.setStart(next_frame, 0, j);
-        }   // for j in event stack
-    }   // for i in threads
+    // First collect the events all threads recorded in this frame, and
+    // finish all markers that are currently in progress, adding a new start
+    // marker for the next frame. So e.g. if a thread is busy in one event
+    // while the main thread syncs the frame, this event will get split into
+    // two parts in two consecutive frames
+    processEvents(now, next_frame);
 
     if (m_has_wrapped_around)
     {
@@ -302,11 +459,12 @@ void Profiler::synchronizeFrame()
         // the data from a previous frame.
         for (int i = 0; i < m_threads_used; i++)
         {
-            ThreadData &td = m_all_threads_data[i];
-            AllEventData &aed = td.m_all_event_data;
-            AllEventData::iterator k;
-            for (k = aed.begin(); k != aed.end(); ++k)
-                k->second.getMarker(next_frame).clear();
+            std::vector<EventData> &aed = m_all_threads_data[i].m_all_event_data;
+            for (unsigned int k = 0; k < aed.size(); k++)
+            {
+                if (aed[k].isUsed())
+                    aed[k].getMarker(next_frame).clear();
+            }
         }
     }   // is has wrapped around
 
@@ -321,8 +479,6 @@ void Profiler::synchronizeFrame()
         m_freeze_state = FROZEN;
     else if(m_freeze_state == WAITING_FOR_UNFREEZE)
         m_freeze_state = UNFROZEN;
-
-    m_lock.unlock();
 }   // synchronizeFrame
 
 //-----------------------------------------------------------------------------
@@ -338,10 +494,8 @@ void Profiler::draw()
 
     // Current frame points to the frame in which currently data is
     // being accumulated. Draw the previous (i.e. complete) frame.
-    m_lock.lock();
     int indx = m_current_frame - 1;
     if (indx < 0) indx = m_max_frames - 1;
-    m_lock.unlock();
 
     drawBackground();
 
@@ -365,11 +519,13 @@ void Profiler::draw()
     // threads might have 'unfinished' events, or multiple identical events
     // in this frame (i.e. start time would be incorrect).
     int thread_id = getThreadID();
-    AllEventData &aed = m_all_threads_data[thread_id].m_all_event_data;
-    AllEventData::iterator j;
-    for (j = aed.begin(); j != aed.end(); ++j)
+    const std::vector<EventData> &aed =
+                                 m_all_threads_data[thread_id].m_all_event_data;
+    for (unsigned int j = 0; j < aed.size(); j++)
     {
-        const Marker &marker = j->second.getMarker(indx);
+        if (!aed[j].isUsed())
+            continue;
+        const Marker &marker = aed[j].getMarker(indx);
         start = std::min(start, marker.getStart());
         end = std::max(end, marker.getEnd());
     }   // for j in events
@@ -381,11 +537,11 @@ void Profiler::draw()
     // Get the mouse pos
     core::vector2di mouse_pos = GUIEngine::EventHandler::get()->getMousePos();
 
-    std::stack<AllEventData::iterator> hovered_markers;
+    // Stores the hovered markers as pairs of event data and name id
+    std::stack<std::pair<const EventData*, int> > hovered_markers;
     for (int i = 0; i < m_threads_used; i++)
     {
         ThreadData &td = m_all_threads_data[i];
-        AllEventData &aed = td.m_all_event_data;
 
         // Thread 1 has 'proper' start and end events (assuming that each
         // event is at most called once). But all other threads might have
@@ -394,8 +550,9 @@ void Profiler::draw()
         double start_xpos = 0;
         for(int k=0; k<(int)td.m_ordered_headings.size(); k++)
         {
-            AllEventData::iterator j = aed.find(td.m_ordered_headings[k]);
-            const Marker &marker = j->second.getMarker(indx);
+            const int name_id = td.m_ordered_headings[k];
+            const EventData &ed = td.m_all_event_data[name_id];
+            const Marker &marker = ed.getMarker(indx);
             if (i == thread_id)
                 start_xpos = factor*marker.getStart();
             core::rect<s32> pos((s32)(x_offset + start_xpos),
@@ -410,14 +567,14 @@ void Profiler::draw()
             pos.UpperLeftCorner.Y  += 2 * (int)marker.getLayer();
             pos.LowerRightCorner.Y -= 2 * (int)marker.getLayer();
 
-            GL32_draw2DRectangle(j->second.getColour(), pos);
+            GL32_draw2DRectangle(ed.getColour(), pos);
             // If the mouse cursor is over the marker, get its information
             if (pos.isPointInside(mouse_pos))
             {
-                hovered_markers.push(j);
+                hovered_markers.push(std::make_pair(&ed, name_id));
             }
 
-        }   // for j in AllEventdata
+        }   // for k in ordered headings
     }   // for i in threads
 
 
@@ -490,11 +647,11 @@ void Profiler::draw()
         core::stringw text;
         while(!hovered_markers.empty())
         {
-            AllEventData::iterator j = hovered_markers.top();
-            const Marker &marker = j->second.getMarker(indx);
+            const Marker &marker =
+                               hovered_markers.top().first->getMarker(indx);
             std::ostringstream oss;
             oss.precision(4);
-            oss << j->first << " [" << (marker.getDuration()) << " ms / ";
+            oss << getName(hovered_markers.top().second) << " [" << (marker.getDuration()) << " ms / ";
             oss.precision(3);
             oss << marker.getDuration()*100.0 / duration << "%]" << std::endl;
             text += oss.str().c_str();
@@ -587,7 +744,15 @@ void Profiler::computeStableFPS()
     //       If not, then additional code to identify the correct
     //       frametime values is needed. Once the vector of frametimes
     //       is produced, the rest of the computations are unchanged.
-    m_lock.lock();
+    // Nothing was recorded yet
+    if (!m_all_threads_data ||
+        m_all_threads_data[0].m_ordered_headings.empty())
+    {
+        m_frame_times.clear();
+        m_total_frametime = m_total_frames = 0;
+        m_fps_metrics_high = m_fps_metrics_mid = m_fps_metrics_low = 0;
+        return;
+    }
 
     ThreadData &td = m_all_threads_data[0];
     int start = m_has_wrapped_around ? m_current_frame + 1 : 0;
@@ -651,8 +816,11 @@ void Profiler::computeStableFPS()
     }
 
     Log::info("Profiler", "Frame count '%i', Time (ms) '%i', Steady FPS '%i', Mostly stable FPS '%i', Typical FPS '%i'", m_total_frames, m_total_frametime/1000, m_fps_metrics_low, m_fps_metrics_mid, m_fps_metrics_high);
-
-    m_lock.unlock();
+    if (m_dropped_events > 0)
+    {
+        Log::warn("Profiler", "%d events were not recorded since the event "
+                  "buffer of their thread was full.", (int)m_dropped_events);
+    }
 } // computeStableFPS
 
 // --------------------------------------------------------------------------------------------
@@ -692,7 +860,6 @@ void Profiler::writeToFile()
     if (UserConfigParams::m_profiler_enabled)
         desactivate();
 
-    m_lock.lock();
     std::string base_name =
                file_manager->getUserConfigFile(file_manager->getStdoutName());
 
@@ -766,7 +933,7 @@ void Profiler::writeToFile()
         ThreadData &td = m_all_threads_data[thread_id];
         f << "#  ";
         for (unsigned int i = 0; i < td.m_ordered_headings.size(); i++)
-            f << "\"" << td.m_ordered_headings[i] << "(" << i+1 <<")\",   ";
+            f << "\"" << getName(td.m_ordered_headings[i]) << "(" << i+1 <<")\",   ";
         f << std::endl;
         int start = m_has_wrapped_around ? m_current_frame + 1 : 0;
         if (start > m_max_frames) start -= m_max_frames;
@@ -807,6 +974,100 @@ void Profiler::writeToFile()
         start = (start + 1) % m_max_frames;
     }
     f_gpu.close();
-    m_lock.unlock();
 
+    // 4: Save the events in the Chrome trace format
+    writeChromeTrace(base_name + ".trace-" +
+        (Track::getCurrentTrack() != NULL ? Track::getCurrentTrack()->getIdent() : "menu") + ".json");
 }   // writeFile
+
+//-----------------------------------------------------------------------------
+/** Writes a string as JSON string (including the quotes). */
+static void writeJSONString(std::ostream &out, const std::string &s)
+{
+    out << "\"";
+    for (unsigned int i = 0; i < s.size(); i++)
+    {
+        const unsigned char c = s[i];
+        if (c == '"' || c == '\\')
+            out << "\\" << c;
+        else if (c < 0x20)
+            out << "\\u00" << "0123456789abcdef"[c >> 4]
+                << "0123456789abcdef"[c & 0xf];
+        else
+            out << c;
+    }
+    out << "\"";
+}   // writeJSONString
+
+//-----------------------------------------------------------------------------
+/** Writes all recorded events in the Chrome trace event format, which can be
+ *  loaded in chrome://tracing or https://ui.perfetto.dev. Each complete
+ *  event is written as an 'X' event with start and duration in
+ *  microseconds. Events that are still in progress are not written. Unlike
+ *  the bar graph and writeToFile this does not need graphics, so it can be
+ *  used for servers.
+ *  \param filename Name of the file to write.
+ *  \return True if the file could be written.
+ */
+bool Profiler::writeChromeTrace(const std::string &filename)
+{
+    std::ofstream f(FileUtils::getPortableWritingPath(filename));
+    if (!f.is_open())
+    {
+        Log::error("Profiler", "Can't open '%s' to write the trace.",
+                   filename.c_str());
+        return false;
+    }
+
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(m_names_mutex);
+        names = m_all_names;
+    }
+
+    f << std::fixed << std::setprecision(3);
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (int i = 0; i < m_threads_used; i++)
+    {
+        f << (i == 0 ? "\n" : ",\n")
+          << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+          << ",\"args\":{\"name\":\""
+          << (i == 0 ? std::string("Main") : "Thread " + StringUtils::toString(i))
+          << "\"}}";
+    }
+
+    // Once the buffer has wrapped around the oldest event is the next one
+    // to be overwritten.
+    const unsigned int num_events = (unsigned int)m_trace_events.size();
+    for (unsigned int i = 0; i < num_events; i++)
+    {
+        const TraceEvent &te =
+                        m_trace_events[(m_next_trace_event + i) % num_events];
+        f << ",\n{\"name\":";
+        writeJSONString(f, names[te.m_name_id]);
+        f << ",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":" << te.m_start * 1000.0
+          << ",\"dur\":" << te.m_duration * 1000.0
+          << ",\"pid\":1,\"tid\":" << te.m_thread_id << "}";
+    }
+    f << "\n]}\n";
+    f.close();
+
+    Log::info("Profiler", "Wrote %u events to trace file '%s'.", num_events,
+              filename.c_str());
+    return true;
+}   // writeChromeTrace
+
+//-----------------------------------------------------------------------------
+/** Writes the Chrome trace if a trace file was requested on the command
+ *  line. Called when STK exits.
+ */
+void Profiler::writeChromeTraceOnExit()
+{
+    if (m_trace_file.empty())
+        return;
+
+    // Add the events of the last (incomplete) frame
+    if (UserConfigParams::m_profiler_enabled && m_freeze_state != FROZEN)
+        processEvents(getTimeMilliseconds(), m_current_frame);
+    writeChromeTrace(m_trace_file);
+}   // writeChromeTraceOnExit
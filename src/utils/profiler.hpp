@@ -18,13 +18,13 @@
 #ifndef PROFILER_HPP
 #define PROFILER_HPP
 
-#include "utils/synchronised.hpp"
-
 #include <assert.h>
+#include <stdint.h>
 #include <atomic>
 #include <iostream>
 #include <list>
 #include <map>
+#include <mutex>
 #include <ostream>
 #include <stack>
 #include <streambuf>
@@ -72,7 +72,19 @@ double getTimeMilliseconds();
 #define ENABLE_PROFILER
 
 #ifdef ENABLE_PROFILER
-    #define PROFILER_PUSH_CPU_MARKER(name, r, g, b) \
+    /** Each call site interns its (static) name only once, the marker
+     *  itself then only records the name id. */
+    #define PROFILER_PUSH_CPU_MARKER(name, r, g, b)                        \
+        profiler.pushCPUMarker([]() -> int                                 \
+        {                                                                  \
+            static const int profiler_name_id =                            \
+                profiler.getNameID(name, video::SColor(0xFF, r, g, b));    \
+            return profiler_name_id;                                       \
+        }())
+
+    /** For names which are created at runtime, the name is looked up
+     *  each time (only while the profiler is enabled). */
+    #define PROFILER_PUSH_DYNAMIC_CPU_MARKER(name, r, g, b) \
         profiler.pushCPUMarker(name, video::SColor(0xFF, r, g, b))
 
     #define PROFILER_POP_CPU_MARKER()  \
@@ -85,6 +97,7 @@ double getTimeMilliseconds();
         profiler.draw()
 #else
     #define PROFILER_PUSH_CPU_MARKER(name, r, g, b)
+    #define PROFILER_PUSH_DYNAMIC_CPU_MARKER(name, r, g, b)
     #define PROFILER_POP_CPU_MARKER()
     #define PROFILER_SYNC_FRAME()
     #define PROFILER_DRAW()
@@ -201,31 +214,143 @@ private:
         /** Returns the colour for this event. */
         video::SColor getColour() const { return m_colour;  }
         // --------------------------------------------------------------------
+        /** Returns if this event was used (i.e. markers are allocated). */
+        bool isUsed() const { return !m_all_markers.empty(); }
+        // --------------------------------------------------------------------
     };   // EventData
 
     // ========================================================================
-    /** The mapping of event names to the corresponding EventData. */
-    typedef std::map<std::string, EventData> AllEventData;
+    /** A begin or end of an event as recorded by the thread it happened in.
+     */
+    struct RecordedEvent
+    {
+        /** Absolute time of this event (in ms). */
+        double m_time;
+        /** Id of the interned name of the event. */
+        int    m_name_id;
+        /** True if this starts an event, false if it ends the last one. */
+        bool   m_is_start;
+    };   // RecordedEvent
+
+    // ========================================================================
+    /** A single producer single consumer ring buffer of recorded events. The
+     *  owning thread adds events in push/popCPUMarker, synchronizeFrame
+     *  removes them in the main thread, so neither side needs a lock.
+     */
+    class EventBuffer
+    {
+    private:
+        /** The events, the size is a power of 2. */
+        std::vector<RecordedEvent> m_events;
+
+        /** Index of the next event to write, only changed by the producer. */
+        std::atomic<uint32_t> m_write_index;
+
+        /** Index of the next event to read, only changed by the consumer. */
+        std::atomic<uint32_t> m_read_index;
+
+    public:
+        EventBuffer() : m_write_index(0), m_read_index(0) {}
+        // --------------------------------------------------------------------
+        void init(unsigned int size)             { m_events.resize(size); }
+        // --------------------------------------------------------------------
+        /** Adds an event if there is space for it and additionally for
+         *  'reserve' events (used so that the end of all currently open
+         *  events can always be added). Only called by the owning thread.
+         *  \return False if the event was not added. */
+        bool add(const RecordedEvent &event, unsigned int reserve)
+        {
+            uint32_t write = m_write_index.load(std::memory_order_relaxed);
+            uint32_t read  = m_read_index.load(std::memory_order_acquire);
+            if (write - read + reserve >= m_events.size())
+                return false;
+            m_events[write & (m_events.size() - 1)] = event;
+            m_write_index.store(write + 1, std::memory_order_release);
+            return true;
+        }   // add
+        // --------------------------------------------------------------------
+        /** Returns the oldest event, or NULL if the buffer is empty. Only
+         *  called by the consumer. */
+        const RecordedEvent* front() const
+        {
+            uint32_t read = m_read_index.load(std::memory_order_relaxed);
+            if (read == m_write_index.load(std::memory_order_acquire))
+                return NULL;
+            return &m_events[read & (m_events.size() - 1)];
+        }   // front
+        // --------------------------------------------------------------------
+        /** Removes the oldest event. Only called by the consumer. */
+        void pop()
+        {
+            m_read_index.store(m_read_index.load(std::memory_order_relaxed)+1,
+                               std::memory_order_release);
+        }   // pop
+        // --------------------------------------------------------------------
+        /** Discards all events. Only called by the consumer. */
+        void clear()
+        {
+            m_read_index.store(m_write_index.load(std::memory_order_acquire),
+                               std::memory_order_release);
+        }   // clear
+    };   // EventBuffer
+
+    // ========================================================================
+    /** An event that has started, but not yet ended. */
+    struct OpenEvent
+    {
+        /** Id of the interned name of the event. */
+        int    m_name_id;
+        /** Absolute start time of the event (in ms). */
+        double m_start;
+    };   // OpenEvent
+
+    // ========================================================================
+    /** A complete event for the Chrome trace export. */
+    struct TraceEvent
+    {
+        int    m_name_id;
+        int    m_thread_id;
+        /** Start time (in ms, relative to the activation of the profiler). */
+        double m_start;
+        /** Duration (in ms). */
+        double m_duration;
+    };   // TraceEvent
+
     // ========================================================================
     struct ThreadData
     {
-        /** Stack of events to detect nesting. */
-        std::vector< std::string > m_event_stack;
+        /** Events recorded by this thread which are not yet processed. */
+        EventBuffer m_event_buffer;
+
+        /** Stack of events to detect nesting. Only used by the main thread
+         *  when processing the recorded events. */
+        std::vector<OpenEvent> m_event_stack;
 
-        /** This stores the event names in the order in which they occur.
+        /** This stores the event name ids in the order in which they occur.
         *  This means that 'outer' events occur here before any child
         *  events. This list is then used to determine the order in which the
         *  bar graphs are drawn, which results in the proper nesting of events.*/
-        std::vector<std::string> m_ordered_headings;
+        std::vector<int> m_ordered_headings;
 
-        AllEventData m_all_event_data;
+        /** The event data indexed by name id. Names not (yet) used in this
+         *  thread have an empty EventData. */
+        std::vector<EventData> m_all_event_data;
     };   // class ThreadData
 
     // ========================================================================
 
+    /** Maximum number of threads that are profiled. */
+    static const int MAX_THREADS = 32;
+
+    /** Number of events each thread can record between two frames. */
+    static const int EVENT_BUFFER_SIZE = 8192;
+
+    /** Maximum number of events kept for the Chrome trace export. */
+    static const int MAX_TRACE_EVENTS = 1024 * 1024;
+
     /** Data structure containing all currently buffered markers. The index
-     *  is the thread id. */
-    std::vector< ThreadData> m_all_threads_data;
+     *  is the thread id. It is only allocated in init(). */
+    ThreadData *m_all_threads_data;
 
     /** Buffer for the GPU times (in ms). */
     std::vector<int> m_gpu_times;
@@ -236,11 +361,38 @@ private:
     /** Index of the current frame in the buffer. */
     int m_current_frame;
 
-    /** We don't need the bool, but easiest way to get a lock for the whole
-     *  instance (since we need to avoid that a synch is done which changes
-     *  the current frame while another threaded uses this variable, or
-     *  while a new thread is added. */
-    Synchronised<bool> m_lock;
+    /** Protects the interned names, which can be added from any thread. */
+    mutable std::mutex m_names_mutex;
+
+    /** Maps an event name to its id. */
+    std::map<std::string, int> m_name_ids;
+
+    /** The names and colours of all events, indexed by name id. */
+    std::vector<std::string> m_all_names;
+    std::vector<video::SColor> m_all_colours;
+
+    /** Increased each time the profiler is activated, so that each thread
+     *  resets its count of open events. */
+    std::atomic<int> m_session;
+
+    /** Number of events that could not be recorded since the buffer of
+     *  their thread was full. */
+    std::atomic<int> m_dropped_events;
+
+    /** Cyclic buffer of complete events for the Chrome trace export. */
+    std::vector<TraceEvent> m_trace_events;
+
+    /** Index of the oldest event in m_trace_events once it is full, which
+     *  is overwritten by the next event. */
+    unsigned int m_next_trace_event;
+
+    /** Time at which the profiler was activated, trace times are relative
+     *  to this. */
+    double m_trace_start_time;
+
+    /** If not empty, the Chrome trace is written to this file when STK
+     *  exits. */
+    std::string m_trace_file;
 
     /** Stores the frame times (in µs), once FPS metrics are computed. */
     std::vector<int> m_frame_times;
@@ -288,11 +440,6 @@ private:
     /** Time between now and last sync, used to scale the GUI bar. */
     double m_time_between_sync;
 
-    /** List of all event names. This list is sorted to make sure
-     *  if the circular buffer is dumped more than once the order
-     *  of events remains the same. */
-    std::vector<std::string> m_all_event_names;
-
     // Handling freeze/unfreeze by clicking on the display
     enum FreezeState
     {
@@ -302,17 +449,22 @@ private:
         WAITING_FOR_UNFREEZE,
     };
 
-    FreezeState     m_freeze_state;
+    std::atomic<FreezeState> m_freeze_state;
 
 private:
     int  getThreadID();
+    void processEvents(double now, int next_frame);
+    void addTraceEvent(int name_id, int thread_id, double start, double end);
     void drawBackground();
+    std::string getName(int name_id) const;
 
 public:
              Profiler();
     virtual ~Profiler();
     void     init();
     void     reset();
+    int      getNameID(const char* name, const video::SColor& colour);
+    void     pushCPUMarker(int name_id);
     void     pushCPUMarker(const char* name="N/A",
                            const video::SColor& color=video::SColor());
     void     popCPUMarker();
@@ -324,11 +476,16 @@ public:
     void     computeStableFPS();
     void     startBenchmark();
     void     writeToFile();
+    bool     writeChromeTrace(const std::string &filename);
+    void     writeChromeTraceOnExit();
 
     // ------------------------------------------------------------------------
     bool isFrozen() const { return m_freeze_state == FROZEN; }
     // ------------------------------------------------------------------------
     void setDrawing(bool drawing) { m_drawing = drawing; }
+    // ------------------------------------------------------------------------
+    /** Sets the file the Chrome trace is written to when STK exits. */
+    void setTraceFile(const std::string &filename) { m_trace_file = filename; }
 
     int getTotalFrametime() { return m_total_frametime;  }
     int getTotalFrames()    { return m_total_frames;     }
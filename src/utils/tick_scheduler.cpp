@@ -0,0 +1,152 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/tick_scheduler.hpp"
+
+#include "utils/log.hpp"
+
+#include <thread>
+
+#ifdef WIN32
+#  include <windows.h>
+#elif defined(__linux__) && defined(__GLIBC__)
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+// ----------------------------------------------------------------------------
+TickScheduler::TickScheduler()
+{
+    m_strategy = TS_HYBRID;
+    // Covers the usual oversleeping of the os scheduler
+    m_spin_time = std::chrono::milliseconds(2);
+    resetStatistics();
+}   // TickScheduler
+
+// ----------------------------------------------------------------------------
+void TickScheduler::resetStatistics()
+{
+    m_waits = 0;
+    m_ticks = 0;
+    m_late_ticks = 0;
+    m_total_lateness = 0;
+    m_max_lateness = 0;
+}   // resetStatistics
+
+// ----------------------------------------------------------------------------
+/** Sets up the scheduler for the current thread from the server config.
+ *  \param strategy A SleepStrategy value.
+ *  \param core The core to pin the current thread to, or -1.
+ */
+void TickScheduler::init(int strategy, int core)
+{
+    if (strategy < TS_SLEEP || strategy > TS_SPIN)
+    {
+        Log::warn("TickScheduler", "Unknown sleep strategy %d.", strategy);
+        strategy = TS_HYBRID;
+    }
+    m_strategy = (SleepStrategy)strategy;
+    if (core >= 0)
+    {
+        if (pinCurrentThread(core))
+            Log::info("TickScheduler", "Simulation pinned to core %d.", core);
+        else
+            Log::warn("TickScheduler", "Cannot pin simulation to core %d.",
+                core);
+    }
+}   // init
+
+// ----------------------------------------------------------------------------
+/** Returns when deadline is reached, using the current sleep strategy. */
+void TickScheduler::waitUntil(const TimePoint& deadline)
+{
+    m_waits++;
+    if (m_strategy == TS_SLEEP)
+    {
+        std::this_thread::sleep_until(deadline);
+        return;
+    }
+    if (m_strategy == TS_HYBRID)
+    {
+        TimePoint wake_up = deadline - m_spin_time;
+        if (std::chrono::steady_clock::now() < wake_up)
+            std::this_thread::sleep_until(wake_up);
+    }
+    while (std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+}   // waitUntil
+
+// ----------------------------------------------------------------------------
+/** Records that a tick was started.
+ *  \param deadline When the tick should have been started.
+ *  \param now When it was started.
+ *  \param tick_time Duration of a tick.
+ */
+void TickScheduler::addTick(const TimePoint& deadline, const TimePoint& now,
+                            const std::chrono::nanoseconds& tick_time)
+{
+    m_ticks++;
+    if (now <= deadline)
+        return;
+    uint64_t lateness = std::chrono::duration_cast<std::chrono::microseconds>
+        (now - deadline).count();
+    m_total_lateness += lateness;
+    if (lateness > m_max_lateness)
+        m_max_lateness = lateness;
+    if (now - deadline >= tick_time)
+        m_late_ticks++;
+}   // addTick
+
+// ----------------------------------------------------------------------------
+void TickScheduler::logStatistics(const std::string& name) const
+{
+    if (m_ticks == 0)
+        return;
+    Log::info("TickScheduler", "%s: %lu ticks in %lu wake ups, %lu ticks "
+        "more than a tick late, lateness average %luus max %luus.",
+        name.c_str(), (unsigned long)m_ticks, (unsigned long)m_waits,
+        (unsigned long)m_late_ticks, (unsigned long)getAverageLateness(),
+        (unsigned long)m_max_lateness);
+}   // logStatistics
+
+// ----------------------------------------------------------------------------
+/** Restricts the current thread to run on the given core only, so the
+ *  simulation is not moved between cores.
+ *  \return False if not supported or failed.
+ */
+bool TickScheduler::pinCurrentThread(int core)
+{
+    if (core < 0)
+        return false;
+#ifdef WIN32
+    if (core >= 64)
+        return false;
+    return SetThreadAffinityMask(GetCurrentThread(),
+        (DWORD_PTR)1 << core) != 0;
+#elif defined(__linux__) && defined(__GLIBC__)
+    if (core >= CPU_SETSIZE)
+        return false;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+        &cpuset) == 0;
+#else
+    return false;
+#endif
+}   // pinCurrentThread
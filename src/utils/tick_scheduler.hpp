@@ -0,0 +1,97 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TICK_SCHEDULER_HPP
+#define HEADER_TICK_SCHEDULER_HPP
+
+#include "utils/types.hpp"
+
+#include <chrono>
+#include <string>
+
+/** Waits for the deadline of the next physics tick in a server, instead of
+ *  sleeping whole milliseconds and running all ticks which became due
+ *  meanwhile. A sleep usually takes longer than requested, so with the
+ *  hybrid strategy it sleeps till shortly before the deadline and yields
+ *  the rest. It also keeps statistics about how late the ticks were run.
+ */
+class TickScheduler
+{
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    enum SleepStrategy : int
+    {
+        /** Sleep till the deadline, cheapest but least accurate. */
+        TS_SLEEP = 0,
+        /** Sleep till shortly before the deadline, then yield. */
+        TS_HYBRID = 1,
+        /** Yield till the deadline, uses a full core. */
+        TS_SPIN = 2
+    };
+
+private:
+    SleepStrategy m_strategy;
+
+    /** Time before a deadline at which the hybrid strategy stops
+     *  sleeping. */
+    std::chrono::nanoseconds m_spin_time;
+
+    /** Number of times the loop waited for a tick. */
+    uint64_t m_waits;
+
+    /** Number of ticks run, and how many of them were more than one tick
+     *  late (i.e. run in a burst with the next one). */
+    uint64_t m_ticks;
+    uint64_t m_late_ticks;
+
+    /** Sum and maximum of how late ticks were started, in microseconds. */
+    uint64_t m_total_lateness;
+    uint64_t m_max_lateness;
+
+public:
+    TickScheduler();
+    // ------------------------------------------------------------------------
+    void setStrategy(SleepStrategy strategy)        { m_strategy = strategy; }
+    // ------------------------------------------------------------------------
+    void init(int strategy, int core);
+    // ------------------------------------------------------------------------
+    void waitUntil(const TimePoint& deadline);
+    // ------------------------------------------------------------------------
+    void addTick(const TimePoint& deadline, const TimePoint& now,
+                 const std::chrono::nanoseconds& tick_time);
+    // ------------------------------------------------------------------------
+    void resetStatistics();
+    // ------------------------------------------------------------------------
+    void logStatistics(const std::string& name) const;
+    // ------------------------------------------------------------------------
+    uint64_t getTicks() const                              { return m_ticks; }
+    // ------------------------------------------------------------------------
+    uint64_t getLateTicks() const                     { return m_late_ticks; }
+    // ------------------------------------------------------------------------
+    /** Returns the average time in microseconds a tick was started after
+     *  its deadline. */
+    uint64_t getAverageLateness() const
+                  { return m_ticks == 0 ? 0 : m_total_lateness / m_ticks; }
+    // ------------------------------------------------------------------------
+    uint64_t getMaxLateness() const                 { return m_max_lateness; }
+    // ------------------------------------------------------------------------
+    static bool pinCurrentThread(int core);
+};   // class TickScheduler
+
+#endif // HEADER_TICK_SCHEDULER_HPP
@@ -44,11 +44,10 @@ void StkTime::init()
 }   // init
 
 // ----------------------------------------------------------------------------
-/** Get the time in string for game server logging prefix (thread-safe)*/
-std::string StkTime::getLogTime()
+/** Get the given time in string for game server logging prefix
+ *  (thread-safe). */
+std::string StkTime::getLogTime(TimeType time_now)
 {
-    time_t time_now = 0;
-    time(&time_now);
     std::tm timeptr = {};
 #ifdef WIN32
     localtime_s(&timeptr, &time_now);
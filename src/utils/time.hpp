@@ -57,7 +57,9 @@ public:
 
     // ------------------------------------------------------------------------
     /** Get the time in string for game server logging prefix (thread-safe)*/
-    static std::string getLogTime();
+    static std::string getLogTime() { return getLogTime(time(NULL)); }
+    // ------------------------------------------------------------------------
+    static std::string getLogTime(TimeType time_now);
     // ------------------------------------------------------------------------
     /** Converts the time in this object to a human readable string. */
     static std::string toString(const TimeType &tt);
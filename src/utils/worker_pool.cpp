@@ -0,0 +1,190 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/worker_pool.hpp"
+
+#include "utils/log.hpp"
+
+#include <cassert>
+
+WorkerPool* WorkerPool::m_worker_pool = NULL;
+
+// ----------------------------------------------------------------------------
+/** Creates the worker pool.
+ *  \param num_threads Number of threads helping the caller, or -1 to use
+ *         one less than the number of cores.
+ */
+void WorkerPool::create(int num_threads)
+{
+    assert(!m_worker_pool);
+    if (num_threads < 0)
+    {
+        num_threads = (int)std::thread::hardware_concurrency() - 1;
+        if (num_threads < 0)
+            num_threads = 0;
+    }
+    m_worker_pool = new WorkerPool(num_threads);
+    Log::info("WorkerPool", "Using %d worker threads.", num_threads);
+}   // create
+
+// ----------------------------------------------------------------------------
+void WorkerPool::destroy()
+{
+    delete m_worker_pool;
+    m_worker_pool = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+WorkerPool::WorkerPool(unsigned int num_threads)
+{
+    m_job          = NULL;
+    m_job_count    = 0;
+    m_next_job     = 0;
+    m_process_type = PT_MAIN;
+    m_generation   = 0;
+    m_busy_threads = 0;
+    m_exit         = false;
+    for (unsigned int i = 0; i < num_threads; i++)
+        m_threads.emplace_back(&WorkerPool::threadLoop, this);
+}   // WorkerPool
+
+// ----------------------------------------------------------------------------
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+    m_start.notify_all();
+    for (std::thread& t : m_threads)
+        t.join();
+}   // ~WorkerPool
+
+// ----------------------------------------------------------------------------
+/** Runs jobs of the current call till none are left. */
+void WorkerPool::runJobs()
+{
+    unsigned int i;
+    while ((i = m_next_job.fetch_add(1)) < m_job_count)
+        (*m_job)(i);
+}   // runJobs
+
+// ----------------------------------------------------------------------------
+void WorkerPool::threadLoop()
+{
+    uint64_t generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, generation]()
+                {
+                    return m_exit || m_generation != generation;
+                });
+            if (m_exit)
+                return;
+            generation = m_generation;
+            STKProcess::init(m_process_type);
+        }
+        runJobs();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy_threads == 0)
+            m_finished.notify_one();
+    }
+}   // threadLoop
+
+// ----------------------------------------------------------------------------
+/** Calls job for each index from 0 to count-1, using the worker threads
+ *  and the calling thread, and returns once all are done. The jobs must be
+ *  independent of each other, they are run in any order.
+ *  \param count Number of jobs.
+ *  \param job Function called with the index of a job.
+ */
+void WorkerPool::parallelFor(unsigned int count,
+                             const std::function<void(unsigned int)>& job)
+{
+    WorkerPool* wp = m_worker_pool;
+    if (!wp || wp->m_threads.empty() || count < 2 ||
+        !wp->m_run_mutex.try_lock())
+    {
+        for (unsigned int i = 0; i < count; i++)
+            job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wp->m_mutex);
+        wp->m_job          = &job;
+        wp->m_job_count    = count;
+        wp->m_next_job     = 0;
+        wp->m_process_type = STKProcess::getType();
+        wp->m_busy_threads = (unsigned int)wp->m_threads.size();
+        wp->m_generation++;
+    }
+    wp->m_start.notify_all();
+    wp->runJobs();
+    {
+        std::unique_lock<std::mutex> lock(wp->m_mutex);
+        wp->m_finished.wait(lock, [wp]() { return wp->m_busy_threads == 0; });
+        wp->m_job = NULL;
+    }
+    wp->m_run_mutex.unlock();
+}   // parallelFor
+
+// ----------------------------------------------------------------------------
+void WorkerPool::unitTesting()
+{
+    const bool created = m_worker_pool == NULL;
+    if (created)
+        create(3);
+    int error_count = 0;
+    for (unsigned int count : { 0u, 1u, 2u, 7u, 1000u })
+    {
+        std::vector<std::atomic<int> > calls(count);
+        for (unsigned int i = 0; i < count; i++)
+            calls[i] = 0;
+        parallelFor(count, [&calls](unsigned int i) { calls[i]++; });
+        for (unsigned int i = 0; i < count; i++)
+        {
+            if (calls[i] != 1)
+            {
+                Log::error("WorkerPool", "Job %d of %d called %d times.",
+                           i, count, (int)calls[i]);
+                error_count++;
+            }
+        }
+    }
+    // Jobs must see the process type of the caller
+    STKProcess::init(PT_CHILD);
+    std::atomic<int> wrong_type(0);
+    parallelFor(100, [&wrong_type](unsigned int i)
+        {
+            if (STKProcess::getType() != PT_CHILD)
+                wrong_type++;
+        });
+    STKProcess::init(PT_MAIN);
+    if (wrong_type != 0)
+    {
+        Log::error("WorkerPool", "%d jobs used the wrong process type.",
+                   (int)wrong_type);
+        error_count++;
+    }
+    if (created)
+        destroy();
+    assert(error_count == 0);
+}   // unitTesting
@@ -0,0 +1,95 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_WORKER_POOL_HPP
+#define HEADER_WORKER_POOL_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/stk_process.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** A fixed set of threads which help the calling thread to run independent
+ *  jobs, e.g. the AI of all karts. The threads use the process type (main
+ *  or child) of the caller, so World::getWorld() etc. work as expected in
+ *  a job. Only one caller can use the threads at a time, if they are busy
+ *  (e.g. used by the server child process) the jobs are run by the caller
+ *  alone.
+ */
+class WorkerPool : public NoCopy
+{
+private:
+    static WorkerPool* m_worker_pool;
+
+    std::vector<std::thread> m_threads;
+
+    /** Protects all data below. */
+    std::mutex m_mutex;
+
+    /** Signals the threads that new jobs are available or that they should
+     *  exit. */
+    std::condition_variable m_start;
+
+    /** Signals the caller that all threads have finished. */
+    std::condition_variable m_finished;
+
+    /** Only one caller can use the threads at a time. */
+    std::mutex m_run_mutex;
+
+    /** The jobs of the current call. */
+    const std::function<void(unsigned int)>* m_job;
+    unsigned int m_job_count;
+    std::atomic<unsigned int> m_next_job;
+
+    /** Process type of the current caller. */
+    ProcessType m_process_type;
+
+    /** Increased for each call, so the threads know about new jobs. */
+    uint64_t m_generation;
+
+    /** Number of threads still working on the current call. */
+    unsigned int m_busy_threads;
+
+    bool m_exit;
+
+    WorkerPool(unsigned int num_threads);
+    ~WorkerPool();
+    void threadLoop();
+    void runJobs();
+
+public:
+    static void create(int num_threads);
+    // ------------------------------------------------------------------------
+    static void destroy();
+    // ------------------------------------------------------------------------
+    static WorkerPool* get()                          { return m_worker_pool; }
+    // ------------------------------------------------------------------------
+    static void parallelFor(unsigned int count,
+                            const std::function<void(unsigned int)>& job);
+    // ------------------------------------------------------------------------
+    unsigned int getNumThreads() const   { return (unsigned)m_threads.size(); }
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+};   // class WorkerPool
+
+#endif // HEADER_WORKER_POOL_HPP